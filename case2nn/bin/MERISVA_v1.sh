@@ -1,5 +1,5 @@
 cd ../data/MERISVA_v1
-../../../nnftool-1.3/bin/nnftool -ffbp -n -o MVA_wcrtm_inv.nna 60x20x5_639.4.net
+${NNFTOOL:-../../../nnftool-1.3/bin/nnftool} -ffbp -n -o MVA_wcrtm_inv.nna 60x20x5_639.4.net
 
-../../../nnftool-1.3/bin/nnftool -ffbp -n -o MVA_wcrtm_fwd.nna 15x20_144.8.net
+${NNFTOOL:-../../../nnftool-1.3/bin/nnftool} -ffbp -n -o MVA_wcrtm_fwd.nna 15x20_144.8.net
 
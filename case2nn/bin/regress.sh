@@ -0,0 +1,167 @@
+#!/bin/sh
+#
+# Regression harness for the case2 nets.
+#
+# Runs the given v*_test.sh scripts (all of them by default), compares the
+# outputs of their case2 command in ../data/<version> with the stored
+# expectations ../data/<version>/<script>.exp and checks the load time and
+# throughput of the case2 program for the script's net against the baseline
+# file regress_baseline.txt.
+#
+# Usage: regress.sh [-u] [-b] [-e tol] [-p percent] [-n repeats] [script ...]
+#   -u          update the expected outputs instead of checking them
+#   -b          update the performance baseline instead of checking it
+#   -e tol      output tolerance, |out - exp| <= tol * max(1, |exp|) (default 1e-5)
+#   -p percent  allowed performance regression in percent (default 20)
+#   -n repeats  number of times the test cases are processed for timing (default 200)
+#
+# The nnftool and case2 programs are taken from $NNFTOOL and $CASE2, by default
+# from the build directories of this source tree. Exits with 1 if a check fails.
+#
+
+BINDIR=`cd \`dirname $0\` && pwd`
+NNFTOOL=${NNFTOOL:-$BINDIR/../../nnftool/build/release/nnftool}
+CASE2=${CASE2:-$BINDIR/../build/release/case2}
+BASELINE=${BASELINE:-$BINDIR/regress_baseline.txt}
+export NNFTOOL CASE2
+
+UPDATE_EXP=0
+UPDATE_BASE=0
+TOL=1e-5
+PERCENT=20
+REPEATS=200
+
+while [ $# -gt 0 ]; do
+    case $1 in
+        -u) UPDATE_EXP=1 ;;
+        -b) UPDATE_BASE=1 ;;
+        -e) shift; TOL=$1 ;;
+        -p) shift; PERCENT=$1 ;;
+        -n) shift; REPEATS=$1 ;;
+        -*) echo "regress.sh: unknown option $1" >&2; exit 2 ;;
+        *)  break ;;
+    esac
+    shift
+done
+
+cd $BINDIR || exit 2
+SCRIPTS=${*:-`ls v*_test.sh`}
+
+if [ ! -x "$NNFTOOL" ] || [ ! -x "$CASE2" ]; then
+    echo "regress.sh: $NNFTOOL or $CASE2 not found, build them first" >&2
+    exit 2
+fi
+
+NEWBASE=/tmp/regress_baseline.$$
+[ -f $BASELINE ] && grep -v '^#' $BASELINE > $NEWBASE
+touch $NEWBASE
+
+NUM_PASS=0
+NUM_FAIL=0
+NUM_SKIP=0
+
+for SCRIPT in $SCRIPTS; do
+    NAME=`basename $SCRIPT .sh`
+    DATADIR=`sed -n 's|^cd \(\.\./data/[^ ]*\).*|\1|p' $SCRIPT | head -1`
+    STATUS=PASS
+    INFO=
+
+    if [ -z "$DATADIR" ] || [ ! -d "$DATADIR" ]; then
+        echo "SKIP $NAME: no data directory $DATADIR"
+        NUM_SKIP=`expr $NUM_SKIP + 1`
+        continue
+    fi
+
+    # The net, input and output files of the script's case2 command
+    set -- `sed -n 's|^\${CASE2[^}]*} *\([^ ]*\) *\([^ ]*\) *\([^ ]*\).*|\1 \2 \3|p' $SCRIPT | head -1`
+    NETFILE=$1
+    INPFILE=$2
+    OUTFILE=$DATADIR/$3
+    if [ -z "$3" ]; then
+        echo "SKIP $NAME: no case2 command"
+        NUM_SKIP=`expr $NUM_SKIP + 1`
+        continue
+    fi
+
+    # Convert the nets and run case2 as the script does, answer overwrite prompts
+    rm -f $OUTFILE
+    if ! yes | sh ./$SCRIPT > /tmp/regress_$NAME.log 2>&1 || [ ! -f $OUTFILE ]; then
+        echo "FAIL $NAME: script failed, see /tmp/regress_$NAME.log"
+        NUM_FAIL=`expr $NUM_FAIL + 1`
+        continue
+    fi
+
+    # Check the outputs
+    EXP=$DATADIR/$NAME.exp
+    if [ $UPDATE_EXP = 1 ]; then
+        cp $OUTFILE $EXP
+        INFO=" expectations updated"
+    elif [ ! -f $EXP ]; then
+        STATUS=FAIL
+        INFO=" no expectations $EXP, run with -u"
+    else
+        DIFF=`awk -v tol=$TOL '
+            NR == FNR { for (i = 1; i <= NF; i++) e[FNR, i] = $i; n[FNR] = NF; ne = FNR; next }
+            {
+                if (n[FNR] != NF) { bad++; next }
+                for (i = 1; i <= NF; i++) {
+                    d = $i - e[FNR, i]; if (d < 0) d = -d
+                    m = e[FNR, i]; if (m < 0) m = -m; if (m < 1) m = 1
+                    if (d > tol * m) { bad++; next }
+                }
+            }
+            END { if (FNR != ne) bad++; print bad + 0 }' $EXP $OUTFILE`
+        if [ "$DIFF" != 0 ]; then
+            STATUS=FAIL
+            INFO=" $DIFF output lines differ"
+        fi
+    fi
+
+    # Check the performance
+    TIMING=`cd $DATADIR && $CASE2 -t $REPEATS $NETFILE $INPFILE /tmp/regress_$NAME.out | sed -n 's/^timing: //p'`
+    LOAD=`echo $TIMING | sed -n 's/.*load_ms=\([^ ]*\).*/\1/p'`
+    PPS=`echo $TIMING | sed -n 's/.*pixels_per_s=\([^ ]*\).*/\1/p'`
+    if [ -z "$LOAD" ] || [ -z "$PPS" ]; then
+        STATUS=FAIL
+        INFO="$INFO no timing"
+    elif [ $UPDATE_BASE = 1 ]; then
+        grep -v "^$NAME " $NEWBASE > $NEWBASE.tmp
+        echo "$NAME $LOAD $PPS" >> $NEWBASE.tmp
+        mv $NEWBASE.tmp $NEWBASE
+        INFO="$INFO load ${LOAD}ms, ${PPS} pixels/s, baseline updated"
+    else
+        BASE=`grep "^$NAME " $NEWBASE`
+        if [ -z "$BASE" ]; then
+            INFO="$INFO load ${LOAD}ms, ${PPS} pixels/s, no baseline"
+        else
+            # Load times get an absolute slack of 0.5ms, they are too short to be stable
+            PERF=`echo "$BASE $LOAD $PPS" | awk -v p=$PERCENT '{
+                r = ""
+                if ($4 > $2 * (1 + p / 100) + 0.5) r = r " load " $2 "ms -> " $4 "ms"
+                if ($5 < $3 * (1 - p / 100))       r = r " throughput " $3 " -> " $5 " pixels/s"
+                print r }'`
+            if [ -n "$PERF" ]; then
+                STATUS=FAIL
+                INFO="$INFO regression:$PERF"
+            else
+                INFO="$INFO load ${LOAD}ms, ${PPS} pixels/s"
+            fi
+        fi
+    fi
+
+    echo "$STATUS $NAME:$INFO"
+    if [ $STATUS = PASS ]; then
+        NUM_PASS=`expr $NUM_PASS + 1`
+    else
+        NUM_FAIL=`expr $NUM_FAIL + 1`
+    fi
+done
+
+if [ $UPDATE_BASE = 1 ]; then
+    echo "# script load_ms pixels_per_s (written by regress.sh -b)" > $BASELINE
+    sort $NEWBASE >> $BASELINE
+fi
+rm -f $NEWBASE
+
+echo "$NUM_PASS passed, $NUM_FAIL failed, $NUM_SKIP skipped"
+[ $NUM_FAIL = 0 ]
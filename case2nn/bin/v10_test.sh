@@ -1,5 +1,5 @@
 cd ../data/v6_00.1
-../../../nnftool-1.3/bin/nnftool -ffbpx -is1-3 57.29577951308232 -n -b -o case2.nnf o9_52x20x5_1037.1.bunet o9_15x20_122.0.bunet 0.1 processCase2Net
-../../../nnftool-1.3/bin/nnftool -o case2.nna case2.nnf
-../../bin/case2 case2.nnf case2_gkss.inp case2_nnf.out
+${NNFTOOL:-../../../nnftool-1.3/bin/nnftool} -ffbpx -is1-3 57.29577951308232 -n -b -o case2.nnf o9_52x20x5_1037.1.bunet o9_15x20_122.0.bunet 0.1 processCase2Net
+${NNFTOOL:-../../../nnftool-1.3/bin/nnftool} -o case2.nna case2.nnf
+${CASE2:-../../bin/case2} case2.nnf case2_gkss.inp case2_nnf.out
 cd ../../bin
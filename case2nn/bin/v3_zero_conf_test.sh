@@ -1,4 +1,4 @@
 cd ../data/v3
-../../../nnftool-1.3/bin/nnftool -b -o case2_zero_conf.nna case2_zero_conf.nnf
-../../bin/case2 case2_zero_conf.nnf case2_gkss.inp case2__zero_conf_nnf.out
+${NNFTOOL:-../../../nnftool-1.3/bin/nnftool} -b -o case2_zero_conf.nna case2_zero_conf.nnf
+${CASE2:-../../bin/case2} case2_zero_conf.nnf case2_gkss.inp case2__zero_conf_nnf.out
 cd ../../bin
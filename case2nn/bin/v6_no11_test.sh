@@ -1,4 +1,4 @@
 cd ../data/v6
-../../../nnftool-1.3/bin/nnftool -b -o case2_no11.nnf case2_no11.nna
-../../bin/case2 case2_no11.nnf case2_gkss.inp case2_nnf_no11.out
+${NNFTOOL:-../../../nnftool-1.3/bin/nnftool} -b -o case2_no11.nnf case2_no11.nna
+${CASE2:-../../bin/case2} case2_no11.nnf case2_gkss.inp case2_nnf_no11.out
 cd ../../bin
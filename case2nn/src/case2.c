@@ -5,20 +5,67 @@
 #include <ctype.h>
 #include <math.h>
 #include <errno.h>
+#include <sys/time.h>
 
 #include <NnBase.h>
 #include <NnCheck.h>
 #include <NnProc.h>
 #include <NnMemIO.h>
 #include <NnBinIO.h>
+#include <NnTrace.h>
 #include "processCase2Net.h"
 
 #define NUM_INP_UNITS 11
 #define NUM_OUT_UNITS 4
 
+#define DEFAULT_FILL_VALUE -1.0
+
 void printUsage()
 {
-    fprintf(stderr, "Usage: case2 nnfFile inpFile outFile\n");
+    fprintf(stderr, "Usage: case2 [-f fillValue] [-r] [-t numRepeats] [-trace traceFile] nnfFile inpFile outFile\n");
+    fprintf(stderr, "  -f  output value for test cases with non-positive reflectances (default %g)\n", DEFAULT_FILL_VALUE);
+    fprintf(stderr, "  -r  skip test cases out of the training ranges of the net, their flag is set to 1\n");
+    fprintf(stderr, "  -t  process the test cases numRepeats times and print the load time and throughput\n");
+    fprintf(stderr, "  -trace  write a timeline of the processing stages to traceFile (Chrome trace format,\n"
+                    "          viewable with Perfetto)\n");
+}
+
+double getWallTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+char* readTextFile(FILE* istream, size_t* pSize)
+{
+    char* text = NULL;
+    char* newText;
+    size_t size = 0;
+    size_t maxSize = 0;
+    size_t n;
+
+    for (;;)
+    {
+        if (size + 1 >= maxSize)
+        {
+            maxSize = maxSize > 0 ? 2 * maxSize : 65536;
+            newText = (char*) realloc(text, maxSize);
+            if (newText == NULL)
+            {
+                free(text);
+                return NULL;
+            }
+            text = newText;
+        }
+        n = fread(text + size, 1, maxSize - size - 1, istream);
+        if (n == 0)
+            break;
+        size += n;
+    }
+    text[size] = '\0';
+    *pSize = size;
+    return text;
 }
 
 int main(int argc, char* argv[])
@@ -27,17 +74,70 @@ int main(int argc, char* argv[])
     FILE* ostream;
     FILE* lstream = stdout;
     NN_PNET pNet;
-    double inpVector[NUM_INP_UNITS];
-    double outVector[NUM_OUT_UNITS];
+    double* inpVectors = NULL;
+    double* outVectors = NULL;
+    double* newVectors;
+    double fillValue = DEFAULT_FILL_VALUE;
     const char* netFile = NULL;
     const char* inpFile = NULL;
     const char* outFile = NULL;
-    int i, iArg = 0;
-    BOOL isEOF = FALSE;
+    const char* traceFile = NULL;
+    char* inpText;
+    char* inpPos;
+    char* endPos;
+    size_t inpSize = 0;
+    int i, j, iArg = 0;
     int numTestCases = 0;
+    int maxTestCases = 0;
+    int numValidCases;
+    int numSkippedCases = 0;
+    BOOL skipOutOfRange = FALSE;
+    int numRepeats = 0;
+    double loadTime = 0.0;
+    double procTime = 0.0;
+    double t0;
+    double traceTime;
 
     for (i = 1; i < argc; i++)
     {
+        if (strcmp(argv[i], "-f") == 0)
+        {
+            if (++i == argc)
+            {
+                fprintf(stderr, "missing argument for option -f\n");
+                printUsage();
+                return -1;
+            }
+            fillValue = atof(argv[i]);
+            continue;
+        }
+        if (strcmp(argv[i], "-r") == 0)
+        {
+            skipOutOfRange = TRUE;
+            continue;
+        }
+        if (strcmp(argv[i], "-t") == 0)
+        {
+            if (++i == argc || atoi(argv[i]) <= 0)
+            {
+                fprintf(stderr, "missing or invalid argument for option -t\n");
+                printUsage();
+                return -1;
+            }
+            numRepeats = atoi(argv[i]);
+            continue;
+        }
+        if (strcmp(argv[i], "-trace") == 0)
+        {
+            if (++i == argc)
+            {
+                fprintf(stderr, "missing argument for option -trace\n");
+                printUsage();
+                return -1;
+            }
+            traceFile = argv[i];
+            continue;
+        }
         if (iArg == 0)
             netFile = argv[i];
         else if (iArg == 1)
@@ -60,9 +160,20 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    if (traceFile != NULL)
+    {
+        if (Nn_OpenTrace(traceFile) != NN_OK)
+        {
+            fprintf(lstream, "%s\n", Nn_GetErrMsg());
+            return 5;
+        }
+        Nn_SetTraceThreadName("case2");
+    }
 
     fprintf(lstream, "loading neural net %s...\n", netFile);
+    t0 = getWallTime();
     Nn_CreateNetFromBinFile(netFile, NUM_INP_UNITS, NUM_OUT_UNITS, &pNet);
+    loadTime = getWallTime() - t0;
     if (pNet == NULL)
     {
         fprintf(lstream, "%s\n", Nn_GetErrMsg());
@@ -90,41 +201,97 @@ int main(int argc, char* argv[])
     }
     fprintf(lstream, "output file opened\n");
 
-    fprintf(lstream, "processing test cases...\n");
+    fprintf(lstream, "reading test cases...\n");
+    traceTime = Nn_GetTraceTime();
+    inpText = readTextFile(istream, &inpSize);
+    Nn_AddTraceSpan("case2", "read", traceTime, (long) inpSize);
+    if (inpText == NULL)
+    {
+        fprintf(lstream, "out of memory\n");
+        return 4;
+    }
+
+    traceTime = Nn_GetTraceTime();
+    inpPos = inpText;
     for (;;) 
     {
-        for (i = 0; i < NUM_INP_UNITS; i++)
+        if (numTestCases == maxTestCases)
         {
-            if (fscanf(istream, "%lf", &inpVector[i]) != 1)
+            maxTestCases = maxTestCases > 0 ? 2 * maxTestCases : 1024;
+            newVectors = (double*) realloc(inpVectors, maxTestCases * NUM_INP_UNITS * sizeof (double));
+            if (newVectors == NULL)
             {
-                isEOF = TRUE;
-                break;
+                fprintf(lstream, "out of memory\n");
+                return 4;
             }
+            inpVectors = newVectors;
         }
-        if (isEOF)
+
+        for (i = 0; i < NUM_INP_UNITS; i++)
+        {
+            inpVectors[numTestCases * NUM_INP_UNITS + i] = strtod(inpPos, &endPos);
+            if (endPos == inpPos)
+                break;
+            inpPos = endPos;
+        }
+        if (i < NUM_INP_UNITS)
             break;
 
-	numTestCases++;
-        fprintf(stdout, "*");
-        if (numTestCases % 50 == 0) 
-           fprintf(stdout, "\n");
-        fflush(stdout);
+        numTestCases++;
+    }
+    free(inpText);
+    Nn_AddTraceSpan("case2", "parse", traceTime, numTestCases);
+    fprintf(lstream, "%d test cases read\n", numTestCases);
 
-        processCase2Net(pNet, inpVector, outVector);
+    fprintf(lstream, "processing test cases...\n");
+    outVectors = (double*) malloc((numTestCases + 1) * NUM_OUT_UNITS * sizeof (double));
+    t0 = getWallTime();
+    numValidCases = outVectors != NULL ? processCase2NetBatch(pNet, numTestCases, inpVectors, outVectors, fillValue, skipOutOfRange, &numSkippedCases) : -1;
+    for (j = 1; j < numRepeats && numValidCases >= 0; j++)
+        processCase2NetBatch(pNet, numTestCases, inpVectors, outVectors, fillValue, skipOutOfRange, &numSkippedCases);
+    procTime = getWallTime() - t0;
+    if (numValidCases < 0)
+    {
+        fprintf(lstream, "out of memory\n");
+        return 4;
+    }
 
+    traceTime = Nn_GetTraceTime();
+    for (j = 0; j < numTestCases; j++)
+    {
         for (i = 0; i < NUM_OUT_UNITS; i++)
-            fprintf(ostream, "%f%s", outVector[i], (i < NUM_OUT_UNITS-1) ? "\t" : "");
+            fprintf(ostream, "%f%s", outVectors[j * NUM_OUT_UNITS + i], (i < NUM_OUT_UNITS-1) ? "\t" : "");
         fprintf(ostream, "\n");
     }
+    fflush(ostream);
+    Nn_AddTraceSpan("case2", "write", traceTime, numTestCases);
 
-    fprintf(lstream, "\n%d test cases processed\n", numTestCases);
+    fprintf(lstream, "%d test cases masked out due to non-positive reflectances\n", numTestCases - numValidCases);
+    if (skipOutOfRange)
+        fprintf(lstream, "%d test cases skipped due to out-of-range inputs\n", numSkippedCases);
+    fprintf(lstream, "%d test cases processed\n", numTestCases);
+    if (numRepeats > 0)
+    {
+        /* Parsed by bin/regress.sh, keep the format */
+        fprintf(lstream, "timing: load_ms=%.3f pixels_per_s=%.1f\n", 
+                1e3 * loadTime, 
+                procTime > 0.0 ? (double) numTestCases * numRepeats / procTime : 0.0);
+    }
 
     fclose(istream); 
     fclose(ostream); 
     if (lstream != stdout) 
         fclose(lstream);
 
+    free(inpVectors);
+    free(outVectors);
     Nn_DeleteNet(pNet);
+
+    if (traceFile != NULL && Nn_CloseTrace() != NN_OK)
+    {
+        fprintf(stderr, "%s\n", Nn_GetErrMsg());
+        return 5;
+    }
     return 0;
 }
 
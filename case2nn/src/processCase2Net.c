@@ -4,6 +4,7 @@
 
 #include <NnBase.h>
 #include <NnProc.h>
+#include <NnTrace.h>
 #include "processCase2Net.h"
 
 /**
@@ -34,6 +35,8 @@
  * This normalisation must be part of the neural net
  * given by <code>pNet</code> and is not performed within the processCase2Net
  * function.
+ * If the log/exp transformations are embedded into the neural net (nnftool
+ * option -t), they are not performed within the processCase2Net function either.
  * 
  * @param pNet the neural net
  * @param pdInp input vector, points to an array of at least 11 double values
@@ -45,6 +48,12 @@ void processCase2Net(NN_PNET pNet, const double* pdInp, double* pdOut)
 {
 	double adInp[11];
 
+	if (Nn_HasTransforms(pNet))
+	{
+		Nn_ProcessNet(pNet, pdInp, pdOut);
+		return;
+	}
+
 	adInp[ 0] = pdInp[ 0];
 	adInp[ 1] = pdInp[ 1];
 	adInp[ 2] = pdInp[ 2];
@@ -63,3 +72,111 @@ void processCase2Net(NN_PNET pNet, const double* pdInp, double* pdOut)
 	pdOut[ 1] = exp(pdOut[ 1]);
 	pdOut[ 2] = exp(pdOut[ 2]);
 }
+
+/**
+ * The processCase2NetBatch function processes a batch of input vectors with the
+ * same neural net and transformations as <code>processCase2Net</code>.
+ * <p>
+ * Input vectors having a non-positive reflectance (elements 4 to 11) can not be
+ * log-transformed. They are masked out and not passed to the neural net, all
+ * elements of their output vectors are set to <code>dFillValue</code>.
+ * <p>
+ * If the transformations are embedded into the neural net (nnftool option -t),
+ * the input vectors are directly passed to the neural net.
+ * <p>
+ * If <code>bSkipOutOfRange</code> is set, input vectors outside the training
+ * ranges kept with the neural net are not passed to the neural net either. The
+ * concentrations of these vectors are set to <code>dFillValue</code> and their
+ * out-of-scope flag is set to 1.0.
+ *
+ * @param pNet the neural net
+ * @param nNumPixels the number of input vectors
+ * @param pdInp input vectors, points to an array of at least 11*nNumPixels double values
+ * @param pdOut output vectors, points to an array of at least 4*nNumPixels double values
+ * @param dFillValue the output value for masked input vectors
+ * @param bSkipOutOfRange if non-zero, input vectors out of the training ranges are skipped
+ * @param pnNumSkipped if not NULL, receives the number of skipped input vectors
+ * @return the number of valid input vectors, or -1 if out of memory
+ */
+int processCase2NetBatch(NN_PNET pNet, int nNumPixels, const double* pdInp, double* pdOut, double dFillValue,
+                         int bSkipOutOfRange, int* pnNumSkipped)
+{
+	double*        adInp;
+	unsigned char* pMask;
+	unsigned char* pRangeMask;
+	const double*  pdI;
+	double*        pdO;
+	int            iP, i, nNumValid = 0, nNumSkipped = 0;
+	BOOL           bEmbedded;
+	double         dTraceStart;
+
+	bEmbedded = Nn_HasTransforms(pNet);
+
+	adInp = bEmbedded ? NULL : (double*) malloc((size_t) nNumPixels * 11 * sizeof (double));
+	pMask = (unsigned char*) calloc(NN_MASK_SIZE(nNumPixels), 1);
+	pRangeMask = bSkipOutOfRange ? (unsigned char*) malloc(NN_MASK_SIZE(nNumPixels)) : NULL;
+	if ((adInp == NULL && !bEmbedded) || pMask == NULL || (pRangeMask == NULL && bSkipOutOfRange))
+	{
+		free(adInp);
+		free(pMask);
+		free(pRangeMask);
+		return -1;
+	}
+
+	dTraceStart = Nn_GetTraceTime();
+	for (iP = 0; iP < nNumPixels; iP++)
+	{
+		pdI = pdInp + iP * 11;
+		for (i = 3; i < 11; i++)
+		{
+			if (!(pdI[i] > 0.0))
+				break;
+		}
+		if (i < 11)
+			continue;
+
+		NN_MASK_SET(pMask, iP);
+		nNumValid++;
+
+		if (bEmbedded)
+			continue;
+
+		adInp[iP * 11 +  0] = pdI[ 0];
+		adInp[iP * 11 +  1] = pdI[ 1];
+		adInp[iP * 11 +  2] = pdI[ 2];
+		for (i = 3; i < 11; i++)
+			adInp[iP * 11 + i] = log(pdI[i]);
+	}
+	Nn_AddTraceSpan("case2", "input transform", dTraceStart, nNumPixels);
+
+	if (Nn_ProcessNetBatchRanged(pNet, nNumPixels, bEmbedded ? pdInp : adInp, pdOut, 
+	                             pMask, pRangeMask, bSkipOutOfRange, dFillValue) != NN_OK)
+		nNumValid = -1;
+
+	dTraceStart = Nn_GetTraceTime();
+	for (iP = 0; iP < nNumPixels && nNumValid >= 0; iP++)
+	{
+		if (!NN_MASK_GET(pMask, iP))
+			continue;
+		if (bSkipOutOfRange && NN_MASK_GET(pRangeMask, iP))
+		{
+			pdOut[iP * 4 + 3] = 1.0;
+			nNumSkipped++;
+			continue;
+		}
+		if (bEmbedded)
+			continue;
+		pdO = pdOut + iP * 4;
+		pdO[ 0] = exp(pdO[ 0]);
+		pdO[ 1] = exp(pdO[ 1]);
+		pdO[ 2] = exp(pdO[ 2]);
+	}
+	Nn_AddTraceSpan("case2", "output transform", dTraceStart, nNumPixels);
+
+	free(adInp);
+	free(pMask);
+	free(pRangeMask);
+	if (pnNumSkipped != NULL)
+		*pnNumSkipped = nNumSkipped;
+	return nNumValid;
+}
@@ -39,6 +39,8 @@ typedef struct SNnNet* NN_PNET;
  * This normalisation must be part of the neural net
  * given by <code>pNet</code> and is not performed within the processCase2Net
  * function.
+ * If the log/exp transformations are embedded into the neural net (nnftool
+ * option -t), they are not performed within the processCase2Net function either.
  * 
  * @param pNet the neural net
  * @param pdInp input vector, points to an array of at least 11 double values
@@ -48,6 +50,34 @@ typedef struct SNnNet* NN_PNET;
  */
 void processCase2Net(NN_PNET pNet, const double* pdInp, double* pdOut);
 
+/**
+ * The processCase2NetBatch function processes a batch of input vectors with the
+ * same neural net and transformations as <code>processCase2Net</code>.
+ * <p>
+ * Input vectors having a non-positive reflectance (elements 4 to 11) can not be
+ * log-transformed. They are masked out and not passed to the neural net, all
+ * elements of their output vectors are set to <code>dFillValue</code>.
+ * <p>
+ * If the transformations are embedded into the neural net (nnftool option -t),
+ * the input vectors are directly passed to the neural net.
+ * <p>
+ * If <code>bSkipOutOfRange</code> is set, input vectors outside the training
+ * ranges kept with the neural net are not passed to the neural net either. The
+ * concentrations of these vectors are set to <code>dFillValue</code> and their
+ * out-of-scope flag is set to 1.0.
+ *
+ * @param pNet the neural net
+ * @param nNumPixels the number of input vectors
+ * @param pdInp input vectors, points to an array of at least 11*nNumPixels double values
+ * @param pdOut output vectors, points to an array of at least 4*nNumPixels double values
+ * @param dFillValue the output value for masked input vectors
+ * @param bSkipOutOfRange if non-zero, input vectors out of the training ranges are skipped
+ * @param pnNumSkipped if not NULL, receives the number of skipped input vectors
+ * @return the number of valid input vectors, or -1 if out of memory
+ */
+int processCase2NetBatch(NN_PNET pNet, int nNumPixels, const double* pdInp, double* pdOut, double dFillValue,
+                         int bSkipOutOfRange, int* pnNumSkipped);
+
 #ifdef __cplusplus
 }
 #endif
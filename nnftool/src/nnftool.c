@@ -14,13 +14,25 @@
 #include <ctype.h>
 #include <math.h>
 #include <errno.h>
+#include <float.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
 
 #include <NnBase.h>
 #include <NnCheck.h>
 #include <NnProc.h>
+#include <NnProf.h>
+#include <NnTrace.h>
 #include <NnMemIO.h>
 #include <NnBinIO.h>
+#include <NnBin2IO.h>
 #include <NnAscIO.h>
+#include <NnLoad.h>
+#include <NnStream.h>
 
 
 #define NNFT_PROGRAM_NAME    "nnftool"
@@ -40,8 +52,44 @@
  * V 1.4.1: openFile now logs the file being opened to stderr, added message to file-format-errors
  *
  * V 1.5: Added new option -ib to also privide per unit scaling offsets.  
+ *
+ * V 1.6: Added new option -t to embed the input/output transforms into the NNF net
+ *
+ * V 1.6.1: Option -t also keeps the training ranges with the NNF net
+ *
+ * V 1.7: Added new option -prof to print the per-layer profile in test mode
+ *
+ * V 1.8: Added new mode -bench for inference benchmarks on synthetic nets
+ *
+ * V 1.9: Added new mode -verify comparing all processing routines with Nn_ProcessNet
+ *
+ * V 1.10: Option -prof also prints the hardware counters of loading and evaluating the net
+ *
+ * V 1.11: Added new option -trace to write a timeline of the benchmark threads
+ *
+ * V 1.12: Added new mode -mem printing the memory footprint of a net
+ *
+ * V 1.13: Mode -mem also prints the arena of the net
+ *
+ * V 1.14: Modes -mem and -verify also cover the net frozen by Nn_FreezeNet
+ *
+ * V 1.15: Mode -mem also prints the allocator calls of loading the net
+ *
+ * V 1.16: Added new option -map loading binary nets through a memory mapping
+ *
+ * V 1.17: Added new options -v2 and -f32 writing binary nets in NNFF 2.0
+ *
+ * V 1.18: Added new mode -batch converting a set of nets in parallel
+ *
+ * V 1.19: Added new option -z writing NNFF 2.0 nets with packed weights
+ *
+ * V 1.20: Added new option -stream reading nets as a byte stream, and the
+ *         input file name '-' reading a net from the standard input
+ *
+ * V 1.21: Option -map gives the frozen net of a mapped NNFF 2.0 file for
+ *         testing, the conversions read NNFF 2.0 files without the mapping
  */
-#define NNFT_VERSION_INFO    "Version 1.5"  
+#define NNFT_VERSION_INFO    "Version 1.21"  
 
 #define NUM_LAYERS_MAX  16
 
@@ -58,6 +106,11 @@
 
 #define ERR_LIMIT 1e-4
 
+#define BENCH_THREADS_MAX  64
+#define BENCH_NUM_PIXELS   4096
+
+#define VERIFY_NUM_PIXELS  4096
+
 typedef enum 
 {
 	NNFTOOL_HELP,
@@ -65,7 +118,11 @@ typedef enum
 	NNFTOOL_FFBP2NNF,
 	NNFTOOL_FFBPX2NNF,
 	NNFTOOL_TEST,
-	NNFTOOL_CREATE
+	NNFTOOL_CREATE,
+	NNFTOOL_BENCH,
+	NNFTOOL_VERIFY,
+	NNFTOOL_MEM,
+	NNFTOOL_BATCH
 }
 PRG_MODE;
 
@@ -92,32 +149,58 @@ static char     g_pchNnOFile  [NN_MAX_PATH+1]  = "";
 static char     g_pchPatIFile [NN_MAX_PATH+1]  = "";
 static char     g_pchPatOFile [NN_MAX_PATH+1]  = "";
 static char     g_pchFuncName [NN_MAX_PATH+1]  = "";
+static char     g_pchTraceFile[NN_MAX_PATH+1]  = "";
 static BOOL     g_bLayerDump                   = FALSE;
+static BOOL     g_bPrintProfile                = FALSE;
 static BOOL     g_bForceBinaryOut              = FALSE;
 static BOOL     g_bForceMemoryCreat            = FALSE;
+static BOOL     g_bMapFile                     = FALSE;
+static BOOL     g_bStreamFile                  = FALSE;
+static BOOL     g_bBin2Out                     = FALSE;
+static BOOL     g_bSinglePayload               = FALSE;
+static BOOL     g_bPackedPayload               = FALSE;
 static int      g_nNumLinesSkip                = 0;
 static int      g_nNumLayers                   = 0;
 static int      g_anNumUnits  [NUM_LAYERS_MAX] = {0};
 static BOOL     g_bInternalNormalising         = FALSE;
 static BOOL     g_bInputScaling                = FALSE;
 static BOOL     g_bOutputScaling               = FALSE;
+static BOOL     g_bEmbedTransforms             = FALSE;
 static double   g_dThreshold                   = 0.0;
+static int      g_nNumThreads                  = 0;
+static double   g_dBenchTime                   = 0.5;
+static int      g_nNumVerifyPixels             = 1000000;
+static unsigned g_nVerifySeed                  = 1;
+static double   g_dVerifyMaxAbs                = -1.0;
+static double   g_dVerifyMaxRel                = -1.0;
+static double   g_dVerifyMaxUlp                = -1.0;
+static char**   g_ppchBatchArgs                = NULL;
+static int      g_nNumBatchArgs                = 0;
 static double   g_dIBiases[IO_VECTOR_SIZE_MAX];
 static double   g_dIScales[IO_VECTOR_SIZE_MAX];
 static double   g_dOBiases[IO_VECTOR_SIZE_MAX];
 static double   g_dOScales[IO_VECTOR_SIZE_MAX];
 
-NN_PNET  readNnfNet     (const char* pchFile, BOOL bForceMemoryCreat);
+NN_PNET  readNnfNet     (const char* pchFile, BOOL bForceMemoryCreat, BOOL bFrozen);
 NN_PNET  readFfbpNet(const char* pchFfbpFile, FFBP_TRANS* pFfbpTrans, BOOL bInternalNormalising, BOOL bInputScaling, BOOL bOutputScaling);
 NN_PNET  createFfbpxNet (const NN_PNET pNet1, const FFBP_TRANS* pFfbpTrans1, const NN_PNET pNet2, const FFBP_TRANS* pFfbpTrans2, double threshold, BOOL bInternalNormalising);
 NN_PNET  createNnfNet   (int nNumLayers, const int* pnNumUnits);
+void     setFfbpTrans   (NN_PNET pNet, const FFBP_TRANS* pFfbpTrans, BOOL bInternalNormalising, BOOL bEmbedTransforms);
 void     writeFfbpFunc  (const char* pchFuncName, const FFBP_TRANS* pFfbpTrans, BOOL bInternalNormalising, BOOL isIMTNet);
 void     writeFfbpFuncDecl (FILE* ostream, const char* pchFunc, const FFBP_TRANS* pFfbpTrans, BOOL bInternalNormalising, BOOL isIMTNet);
 void     testNnfNet     (NN_PNET pNet, const char* pszIFile, const char* pszOFile, int nNumLinesSkip, int bLayerDump);
+void     printNnfProfile(NN_PNET pNet);
+void     printNnfHwProfile(PCSTR pchName, const NN_PROFILE* pProf, int nMask);
+void     printNnfMemory (NN_PNET pNet, const NN_ALLOC_STATS* pLoadStats);
+BOOL     verifyNnfNet   (const char* pchNnfFile, int nNumPixels, int nNumThreads, unsigned nSeed);
+BOOL     batchConvertNets (int nNumArgs, char** ppchArgs, int nNumThreads);
+void     benchNnfNets   (FILE* ostream, int nNumShapes, const int* pnNumLayers, const int (*panNumUnits)[NUM_LAYERS_MAX], int nNumThreads, double dMinTime);
 void     copyNet        (NN_PNET sourceNet, NN_PNET targetNet, int layerOffset);
 FILE* openFile(const char* pchFile, const char* pchMode);
 void  closeFile(FILE* stream);
 BOOL  isBinaryFile (const char* pchFile);
+BOOL  isBin2File (const char* pchFile);
+int   getBin2Payload ();
 void  replaceFileExt(char* pchFile, const char* pchExt);
 BOOL  overwriteExistingFile  (const char* pchFile);
 BOOL  existsFile (const char* pchFile);
@@ -127,7 +210,7 @@ BOOL  isOptionString(const char* pch);
 BOOL  isEmptyString(const char* pch);
 void  makeValidFunctionName(char* name);
 void  printUsage ();
-void  printProgramInfo();
+void  printProgramInfo(FILE* ostream);
 
 char*  readLine(FILE* istream, int* piLine);
 int    parseInt(char** ppchLine, int iLine);
@@ -142,7 +225,14 @@ int main (int argc, char *argv[])
 	int   iArg;
 	int   nNumArgs;
 
-    printProgramInfo();
+	/* In bench mode stdout is reserved for the JSON output */
+	for (iArg = 1; iArg < argc; iArg++) 
+	{
+		if (equalStrings(argv[iArg], "-bench"))
+			g_nPrgMode = NNFTOOL_BENCH;
+	}
+
+    printProgramInfo(g_nPrgMode == NNFTOOL_BENCH ? stderr : stdout);
 
 	if (argc <= 1) 
     {
@@ -191,10 +281,107 @@ int main (int argc, char *argv[])
             {
 				g_nPrgMode = NNFTOOL_CREATE;
 			}
+			else if (equalStrings(pchOption, "bench")) 
+            {
+				g_nPrgMode = NNFTOOL_BENCH;
+			}
+			else if (equalStrings(pchOption, "verify")) 
+            {
+				g_nPrgMode = NNFTOOL_VERIFY;
+			}
+			else if (equalStrings(pchOption, "mem")) 
+            {
+				g_nPrgMode = NNFTOOL_MEM;
+			}
+			else if (equalStrings(pchOption, "batch")) 
+            {
+				g_nPrgMode = NNFTOOL_BATCH;
+			}
+			else if (equalStrings(pchOption, "pixels")) 
+            {
+				if (iArg < argc-1 && !isOptionString(argv[iArg+1])) 
+                {
+					iArg++;
+					g_nNumVerifyPixels = atoi(argv[iArg]);
+					if (g_nNumVerifyPixels <= 0)
+						throwInvalidOptionArgumentException(pchOption);
+				}
+				else
+					throwMissingOptionArgumentException(pchOption);
+			}
+			else if (equalStrings(pchOption, "seed")) 
+            {
+				if (iArg < argc-1 && !isOptionString(argv[iArg+1])) 
+                {
+					iArg++;
+					g_nVerifySeed = (unsigned) atoi(argv[iArg]);
+				}
+				else
+					throwMissingOptionArgumentException(pchOption);
+			}
+			else if (equalStrings(pchOption, "maxabs") || 
+			         equalStrings(pchOption, "maxrel") || 
+			         equalStrings(pchOption, "maxulp")) 
+            {
+				if (iArg < argc-1 && !isOptionString(argv[iArg+1])) 
+                {
+					double value;
+					iArg++;
+					value = atof(argv[iArg]);
+					if (value < 0.0)
+						throwInvalidOptionArgumentException(pchOption);
+					if (pchOption[3] == 'a')
+						g_dVerifyMaxAbs = value;
+					else if (pchOption[3] == 'r')
+						g_dVerifyMaxRel = value;
+					else
+						g_dVerifyMaxUlp = value;
+				}
+				else
+					throwMissingOptionArgumentException(pchOption);
+			}
+			else if (equalStrings(pchOption, "threads")) 
+            {
+				if (iArg < argc-1 && !isOptionString(argv[iArg+1])) 
+                {
+					iArg++;
+					g_nNumThreads = atoi(argv[iArg]);
+					if (g_nNumThreads <= 0 || g_nNumThreads > BENCH_THREADS_MAX)
+						throwInvalidOptionArgumentException(pchOption);
+				}
+				else
+					throwMissingOptionArgumentException(pchOption);
+			}
+			else if (equalStrings(pchOption, "time")) 
+            {
+				if (iArg < argc-1 && !isOptionString(argv[iArg+1])) 
+                {
+					iArg++;
+					g_dBenchTime = atof(argv[iArg]);
+					if (g_dBenchTime <= 0.0)
+						throwInvalidOptionArgumentException(pchOption);
+				}
+				else
+					throwMissingOptionArgumentException(pchOption);
+			}
+			else if (equalStrings(pchOption, "trace")) 
+            {
+				if (iArg < argc-1 && !isOptionString(argv[iArg+1])) 
+                {
+					iArg++;
+					strcpy(g_pchTraceFile, argv[iArg]);
+				}
+				else
+					throwMissingOptionArgumentException(pchOption);
+			}
 			else if (equalStrings(pchOption, "dump")) 
             {
 				g_bLayerDump = TRUE;
 			}
+			else if (equalStrings(pchOption, "prof")) 
+            {
+				g_bPrintProfile = TRUE;
+			}
 			else if (equalStrings(pchOption, "b")) 
             {
 				g_bForceBinaryOut = TRUE;
@@ -203,10 +390,39 @@ int main (int argc, char *argv[])
             {
 				g_bForceMemoryCreat = TRUE;
 			}
+			else if (equalStrings(pchOption, "map")) 
+            {
+				g_bMapFile = TRUE;
+			}
+			else if (equalStrings(pchOption, "stream")) 
+            {
+				g_bStreamFile = TRUE;
+			}
+			else if (equalStrings(pchOption, "v2")) 
+            {
+				g_bForceBinaryOut = TRUE;
+				g_bBin2Out = TRUE;
+			}
+			else if (equalStrings(pchOption, "f32")) 
+            {
+				g_bForceBinaryOut = TRUE;
+				g_bBin2Out = TRUE;
+				g_bSinglePayload = TRUE;
+			}
+			else if (equalStrings(pchOption, "z")) 
+            {
+				g_bForceBinaryOut = TRUE;
+				g_bBin2Out = TRUE;
+				g_bPackedPayload = TRUE;
+			}
 			else if (equalStrings(pchOption, "n")) 
             {
 				g_bInternalNormalising = TRUE;
 			}
+			else if (equalStrings(pchOption, "t")) 
+            {
+				g_bEmbedTransforms = TRUE;
+			}
 			else if ((pchOption[0] == 'i' || pchOption[0] == 'o') 
                      && (pchOption[1] == 's' || pchOption[1] == 'b') 
 					 && isdigit(pchOption[2])) 
@@ -339,14 +555,25 @@ int main (int argc, char *argv[])
                     makeValidFunctionName(g_pchFuncName);
 				}
 			}
-			else if (g_nPrgMode == NNFTOOL_TEST) 
+			else if (g_nPrgMode == NNFTOOL_TEST || g_nPrgMode == NNFTOOL_VERIFY || g_nPrgMode == NNFTOOL_MEM) 
             {
 				if (nNumArgs == 0)
 					strcpy(g_pchNnIFile, argv[iArg]);
 				else if (nNumArgs == 1)
 					strcpy(g_pchPatIFile, argv[iArg]);
 			}
-			else if (g_nPrgMode == NNFTOOL_CREATE) 
+			else if (g_nPrgMode == NNFTOOL_BATCH) 
+            {
+				if (g_ppchBatchArgs == NULL)
+					g_ppchBatchArgs = (char**) malloc(argc * sizeof (char*));
+				if (g_ppchBatchArgs == NULL)
+				{
+					fprintf(stderr, "Out of memory\n");
+					return -1;
+				}
+				g_ppchBatchArgs[g_nNumBatchArgs++] = argv[iArg];
+			}
+			else if (g_nPrgMode == NNFTOOL_CREATE || g_nPrgMode == NNFTOOL_BENCH) 
             {
 				if (nNumArgs < NUM_LAYERS_MAX) 
                 {
@@ -369,12 +596,23 @@ int main (int argc, char *argv[])
 		(g_nPrgMode == NNFTOOL_FFBPX2NNF && nNumArgs < 3)  ||
 		(g_nPrgMode == NNFTOOL_TEST      && nNumArgs != 2) ||
 		(g_nPrgMode == NNFTOOL_CREATE    && (nNumArgs < 2) || nNumArgs >= NUM_LAYERS_MAX) ||
+		(g_nPrgMode == NNFTOOL_BENCH     && nNumArgs == 1) ||
+		(g_nPrgMode == NNFTOOL_VERIFY    && nNumArgs != 1) ||
+		(g_nPrgMode == NNFTOOL_MEM       && nNumArgs != 1) ||
+		(g_nPrgMode == NNFTOOL_BATCH     && nNumArgs < 1)  ||
 		(g_nPrgMode == NNFTOOL_HELP      && nNumArgs != 0))
 	{
 		fprintf(stderr, "Invalid number of arguments\n");
 		return -1;
 	}
 
+	/* The name of the output file can not be derived from the standard input */
+	if (g_nPrgMode == NNFTOOL_NNF2NNF && equalStrings(g_pchNnIFile, "-") && isEmptyString(g_pchNnOFile))
+	{
+		fprintf(stderr, "Option -o is required for input from '-'\n");
+		return -1;
+	}
+
     Nn_SetOutStream(stdout);
 
 
@@ -388,14 +626,20 @@ int main (int argc, char *argv[])
 
 		if (g_nPrgMode == NNFTOOL_NNF2NNF) 
         {
-			pNet = readNnfNet(g_pchNnIFile, g_bForceMemoryCreat);
+			pNet = readNnfNet(g_pchNnIFile, g_bForceMemoryCreat, FALSE);
 		}
 		else if (g_nPrgMode == NNFTOOL_FFBP2NNF) 
         {
     		FFBP_TRANS ffbpTrans; 
 			pNet = readFfbpNet(g_pchNnIFile, &ffbpTrans, g_bInternalNormalising, g_bInputScaling, g_bOutputScaling);
-			if (!isEmptyString(g_pchFuncName))
-				writeFfbpFunc(g_pchFuncName, &ffbpTrans, g_bInternalNormalising, FALSE);
+			setFfbpTrans(pNet, &ffbpTrans, g_bInternalNormalising, g_bEmbedTransforms);
+			if (!isEmptyString(g_pchFuncName)) 
+            {
+				if (g_bEmbedTransforms)
+					printf("Transforms are embedded into the net, function %s not generated\n", g_pchFuncName);
+				else
+					writeFfbpFunc(g_pchFuncName, &ffbpTrans, g_bInternalNormalising, FALSE);
+			}
 		}
 		else if (g_nPrgMode == NNFTOOL_FFBPX2NNF) 
         {
@@ -404,8 +648,14 @@ int main (int argc, char *argv[])
             NN_PNET pNet1 = readFfbpNet(g_pchNnIFile, &ffbpTrans1, g_bInternalNormalising, g_bInputScaling, g_bOutputScaling);
             NN_PNET pNet2 = readFfbpNet(g_pchNnI2File, &ffbpTrans2, FALSE, FALSE, FALSE);
 			pNet = createFfbpxNet(pNet1, &ffbpTrans1, pNet2, &ffbpTrans2, g_dThreshold, g_bInternalNormalising);
-			if (!isEmptyString(g_pchFuncName))
-				writeFfbpFunc(g_pchFuncName, &ffbpTrans1, g_bInternalNormalising, TRUE);
+			setFfbpTrans(pNet, &ffbpTrans1, g_bInternalNormalising, g_bEmbedTransforms);
+			if (!isEmptyString(g_pchFuncName)) 
+            {
+				if (g_bEmbedTransforms)
+					printf("Transforms are embedded into the net, function %s not generated\n", g_pchFuncName);
+				else
+					writeFfbpFunc(g_pchFuncName, &ffbpTrans1, g_bInternalNormalising, TRUE);
+			}
 		}
 		else 
         {
@@ -421,7 +671,10 @@ int main (int argc, char *argv[])
 			}
 			if (existsFile(g_pchNnOFile) && !overwriteExistingFile(g_pchNnOFile))
 				return 0;
-			nns = Nn_WriteNetToBinFile(g_pchNnOFile, pNet);
+			if (g_bBin2Out)
+				nns = Nn_WriteNetToBin2File(g_pchNnOFile, pNet, getBin2Payload());
+			else
+				nns = Nn_WriteNetToBinFile(g_pchNnOFile, pNet);
 		}
 		else 
         {
@@ -445,15 +698,106 @@ int main (int argc, char *argv[])
 	}
 	else if (g_nPrgMode == NNFTOOL_TEST) 
     {
-		NN_PNET pNet = readNnfNet(g_pchNnIFile, g_bForceMemoryCreat);
+		NN_PNET pNet;
+		/* Switch on the hardware counters before loading, so that the load is counted too */
+		Nn_SetHwProfiling(g_bPrintProfile);
+		pNet = readNnfNet(g_pchNnIFile, g_bForceMemoryCreat, TRUE);
 		if (isEmptyString(g_pchPatOFile)) 
         {
 			strcpy(g_pchPatOFile, g_pchPatIFile);
 			replaceFileExt(g_pchPatOFile, "_res.txt");
 		}
 		testNnfNet(pNet, g_pchPatIFile, g_pchPatOFile, g_nNumLinesSkip, g_bLayerDump);
+		if (g_bPrintProfile)
+			printNnfProfile(pNet);
+		Nn_DeleteNet(pNet);
+	}
+	else if (g_nPrgMode == NNFTOOL_MEM) 
+    {
+		NN_ALLOC_STATS loadStats;
+		NN_PNET        pNet;
+		/* Count the allocations of loading the net only */
+		Nn_ResetAllocStats();
+		pNet = readNnfNet(g_pchNnIFile, FALSE, TRUE);
+		Nn_GetAllocStats(&loadStats);
+		printNnfMemory(pNet, &loadStats);
 		Nn_DeleteNet(pNet);
 	}
+	else if (g_nPrgMode == NNFTOOL_VERIFY) 
+    {
+		int nNumThreads = g_nNumThreads;
+		if (nNumThreads <= 0)
+		{
+			nNumThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+			if (nNumThreads <= 0)
+				nNumThreads = 1;
+			if (nNumThreads > BENCH_THREADS_MAX)
+				nNumThreads = BENCH_THREADS_MAX;
+		}
+		if (!verifyNnfNet(g_pchNnIFile, g_nNumVerifyPixels, nNumThreads, g_nVerifySeed))
+			return -1;
+	}
+	else if (g_nPrgMode == NNFTOOL_BATCH) 
+    {
+		int nNumThreads = g_nNumThreads;
+		if (nNumThreads <= 0)
+		{
+			nNumThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+			if (nNumThreads <= 0)
+				nNumThreads = 1;
+			if (nNumThreads > BENCH_THREADS_MAX)
+				nNumThreads = BENCH_THREADS_MAX;
+		}
+		if (!batchConvertNets(g_nNumBatchArgs, g_ppchBatchArgs, nNumThreads))
+			return -1;
+	}
+	else if (g_nPrgMode == NNFTOOL_BENCH) 
+    {
+		/* The default grid: our case2 net up to 256 units wide and 4 hidden layers deep */
+		static const int anDefNumLayers[] = { 4, 4, 4, 4, 4, 4, 6, 6 };
+		static const int anDefNumUnits[][NUM_LAYERS_MAX] = 
+		{
+			{ 11,  20,   5,   4 },
+			{ 11,  16,  16,   4 },
+			{ 11,  32,  32,   4 },
+			{ 11,  64,  64,   4 },
+			{ 11, 128, 128,   4 },
+			{ 11, 256, 256,   4 },
+			{ 11,  64,  64,  64,  64,   4 },
+			{ 11, 256, 256, 256, 256,   4 }
+		};
+		FILE* ostream = stdout;
+		int   nNumThreads = g_nNumThreads;
+
+		if (nNumThreads <= 0)
+		{
+			nNumThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+			if (nNumThreads <= 0)
+				nNumThreads = 1;
+			if (nNumThreads > BENCH_THREADS_MAX)
+				nNumThreads = BENCH_THREADS_MAX;
+		}
+		if (!isEmptyString(g_pchNnOFile))
+			ostream = openFile(g_pchNnOFile, "w");
+		if (!isEmptyString(g_pchTraceFile) && Nn_OpenTrace(g_pchTraceFile) != NN_OK)
+        {
+			fprintf(stderr, "NNF-Error: %s (NN_STATUS=%d)\n", Nn_GetErrMsg(), Nn_GetErrNo());
+			exit(-1);
+		}
+
+		if (g_nNumLayers > 0)
+			benchNnfNets(ostream, 1, &g_nNumLayers, (const int (*)[NUM_LAYERS_MAX]) g_anNumUnits, nNumThreads, g_dBenchTime);
+		else
+			benchNnfNets(ostream, sizeof (anDefNumLayers) / sizeof (int), anDefNumLayers, anDefNumUnits, nNumThreads, g_dBenchTime);
+
+		if (ostream != stdout)
+			closeFile(ostream);
+		if (Nn_CloseTrace() != NN_OK)
+        {
+			fprintf(stderr, "NNF-Error: %s (NN_STATUS=%d)\n", Nn_GetErrMsg(), Nn_GetErrNo());
+			exit(-1);
+		}
+	}
 	else 
     {
 		printUsage();
@@ -463,15 +807,42 @@ int main (int argc, char *argv[])
 }
 
 
-NN_PNET readNnfNet(const char* pchNnfFile, BOOL bForceMemoryCreat)
+/**
+ * Reads a net from a NNFF file, or from the standard input for '-'. With
+ * bFrozen the net is only processed, so the option -map may give the frozen
+ * net of a mapped NNFF 2.x file; otherwise such a file is read into an
+ * editable net.
+ */
+NN_PNET readNnfNet(const char* pchNnfFile, BOOL bForceMemoryCreat, BOOL bFrozen)
 {
 	NN_PNET   pNet = NULL;
 	NN_STATUS nns;
 	FILE*     istream;
+	int       hFile;
 
-	istream = openFile(pchNnfFile, "rb");
+	/* A single '-' reads the net from the standard input */
+	istream = NULL;
+	if (!equalStrings(pchNnfFile, "-"))
+		istream = openFile(pchNnfFile, "rb");
 
-	if (isBinaryFile(pchNnfFile)) 
+	if (istream == NULL) 
+    {
+		fprintf(stderr, "Reading from standard input...\n");
+		nns = Nn_CreateNetFromFd(STDIN_FILENO, "stdin", -1, -1, &pNet);
+	}
+	else if (g_bStreamFile) 
+    {
+		closeFile(istream);
+		hFile = open(pchNnfFile, O_RDONLY);
+		if (hFile < 0) 
+        {
+			fprintf(stderr, "Error: can not open file '%s'\n", pchNnfFile);
+			exit(-1);
+		}
+		nns = Nn_CreateNetFromFd(hFile, pchNnfFile, -1, -1, &pNet);
+		close(hFile);
+	}
+	else if (isBinaryFile(pchNnfFile)) 
     {
 		if (bForceMemoryCreat) 
         {
@@ -488,6 +859,11 @@ NN_PNET readNnfNet(const char* pchNnfFile, BOOL bForceMemoryCreat)
 			printf("Memory creation status: %i bytes file size, %i bytes converted\n", nFileSize, nBytesRead);
 			free(pMem);
 		}
+		else if (g_bMapFile && (bFrozen || !isBin2File(pchNnfFile))) 
+        {
+			closeFile(istream);
+			nns = Nn_MapNetFromBinFile(pchNnfFile, -1, -1, &pNet);
+		}
 		else 
         {
 			closeFile(istream);
@@ -815,6 +1191,78 @@ NN_PNET readFfbpNet(const char* pchFfbpFile, FFBP_TRANS* pFfbpTrans, BOOL bInter
 }
 
 
+/**
+ * Stores the input/output transforms of an FFBP net in the units of the
+ * input and output layer of the given net, so that they are applied by
+ * the processing routines instead of a generated function (see writeFfbpFunc).
+ * Outputs are transformed with the inverse of their function, e.g. the
+ * engine applies exp() to an output named "log(...)".
+ * The training ranges are kept in any case (NN_TRN_RANGE), so that the
+ * batch routines can check the net inputs against them. Without
+ * bEmbedTransforms only the ranges are stored, as seen by the net behind
+ * the generated function: the ranges of the transformed values with
+ * internal normalising, [0,1] otherwise.
+ * If the net has more outputs than the FFBP net (flag of the FFBPX nets),
+ * the additional ones are left untouched.
+ */
+void setFfbpTrans(NN_PNET pNet, 
+                  const FFBP_TRANS* pFfbpTrans, 
+                  BOOL bInternalNormalising,
+                  BOOL bEmbedTransforms)
+{
+	NN_PLAYER pLayer;
+	NN_PUNIT  pUnit;
+	NN_STATUS nns;
+	short     iU;
+
+	pLayer = Nn_GetInputLayer(pNet);
+	for (iU = 0; iU < pFfbpTrans->nNumInp && iU < pLayer->la.nNumUnits; iU++) 
+    {
+		pUnit = Nn_GetUnitAt(pLayer, iU);
+		if (!bEmbedTransforms)
+		{
+			pUnit->ua.nTrnFlags = NN_TRN_RANGE;
+			pUnit->ua.fTrnMin   = bInternalNormalising ? pFfbpTrans->pdInpMin[iU] : 0.0;
+			pUnit->ua.fTrnMax   = bInternalNormalising ? pFfbpTrans->pdInpMax[iU] : 1.0;
+			continue;
+		}
+		pUnit->ua.nTrnFnId  = (short) pFfbpTrans->pnInpFnId[iU];
+		pUnit->ua.nTrnFlags = (short) (NN_TRN_RANGE | (bInternalNormalising ? 0 : NN_TRN_SCALE));
+		pUnit->ua.fTrnMin   = pFfbpTrans->pdInpMin[iU];
+		pUnit->ua.fTrnMax   = pFfbpTrans->pdInpMax[iU];
+	}
+
+	pLayer = Nn_GetOutputLayer(pNet);
+	for (iU = 0; iU < pFfbpTrans->nNumOut && iU < pLayer->la.nNumUnits; iU++) 
+    {
+		pUnit = Nn_GetUnitAt(pLayer, iU);
+		if (!bEmbedTransforms)
+		{
+			pUnit->ua.nTrnFlags = NN_TRN_RANGE;
+			pUnit->ua.fTrnMin   = bInternalNormalising ? pFfbpTrans->pdOutMin[iU] : 0.0;
+			pUnit->ua.fTrnMax   = bInternalNormalising ? pFfbpTrans->pdOutMax[iU] : 1.0;
+			continue;
+		}
+		if (pFfbpTrans->pnOutFnId[iU] == NN_FUNC_EXPONENTIAL)
+			pUnit->ua.nTrnFnId = NN_FUNC_LOGARITHMIC;
+		else if (pFfbpTrans->pnOutFnId[iU] == NN_FUNC_LOGARITHMIC)
+			pUnit->ua.nTrnFnId = NN_FUNC_EXPONENTIAL;
+		else
+			pUnit->ua.nTrnFnId = NN_FUNC_IDENTITY;
+		pUnit->ua.nTrnFlags = (short) (NN_TRN_RANGE | (bInternalNormalising ? 0 : NN_TRN_SCALE));
+		pUnit->ua.fTrnMin   = pFfbpTrans->pdOutMin[iU];
+		pUnit->ua.fTrnMax   = pFfbpTrans->pdOutMax[iU];
+	}
+
+	nns = Nn_AssertSemanticIntegrity(pNet, -1, -1);
+	if (nns != NN_OK) 
+    {
+		fprintf(stderr, "NNF-Error: %s (NN_STATUS=%d)\n", Nn_GetErrMsg(), Nn_GetErrNo());
+		exit(-1);
+	}
+}
+
+
 void writeFfbpFunc(const char* pchFunc, 
                    const FFBP_TRANS* pFfbpTrans, 
                    BOOL bInternalNormalising, 
@@ -1568,70 +2016,1194 @@ void testNnfNet(NN_PNET pNet,
 }
 
 
-
-void copyNet(NN_PNET sourceNet, NN_PNET targetNet, int layerOffset)
+/**
+ * Prints the per-layer profile of the net evaluations performed so far.
+ * The counters are only maintained if the nnif library has been built
+ * with profiling enabled.
+ */
+void printNnfProfile(NN_PNET pNet)
 {
-    NN_PLAYER pL1;
-    NN_PLAYER pL2;
-    NN_PUNIT  pU1;
-    NN_PUNIT  pU2;
-    NN_PCONN  pC1;
-    NN_PCONN  pC2;
+	NN_PROFILE prof;
+	int        iL, nMask;
 
-    short iL, nL;
-    short iU, nU;
-    short iC, nC;
-
-    nL = sourceNet->na.nNumLayers;
-    for (iL = 0; iL < nL; iL++) 
-    {
-        pL1 = Nn_GetLayerAt(sourceNet, iL);
-        pL2 = Nn_GetLayerAt(targetNet, iL + layerOffset);
-
-        memcpy(&pL2->la, &pL1->la, sizeof (NN_LAYER_ATTRIB));
-        pL2->la.iLayer += layerOffset;
-        Nn_CreateUnits(pL2);
+	if (!Nn_IsProfilingEnabled())
+	{
+		printf("No profile available, rebuild the nnif library using 'make profile'\n");
+		return;
+	}
 
-        nU = pL1->la.nNumUnits;
-        for (iU = 0; iU < nU; iU++)
-        {
-            pU1 = Nn_GetUnitAt(pL1, iU);
-            pU2 = Nn_GetUnitAt(pL2, iU);
+	printf("Profile (ticks in %s):\n", Nn_GetProfileTickUnit());
+	printf("%6s %10s %10s %14s %14s %14s %12s\n",
+		"layer", "calls", "pixels", "ticks", "macs", "trans", "ticks/pixel");
+	for (iL = -1; iL < pNet->na.nNumLayers; iL++)
+	{
+		if (Nn_GetProfile(pNet, iL, &prof) != NN_OK)
+			continue;
+		if (iL >= 0)
+			printf("%6d", iL + 1);
+		else
+			printf("%6s", "net");
+		printf(" %10.0f %10.0f %14.0f %14.0f %14.0f %12.1f\n",
+			(double) prof.nNumCalls,
+			(double) prof.nNumPixels,
+			(double) prof.nNumTicks,
+			(double) prof.nNumMacs,
+			(double) prof.nNumTrans,
+			prof.nNumPixels > 0 ? (double) prof.nNumTicks / (double) prof.nNumPixels : 0.0);
+	}
 
-            memcpy(&pU2->ua, &pU1->ua, sizeof (NN_UNIT_ATTRIB));
-            pU2->ua.iLayer += layerOffset;
-            Nn_CreateConns(pU2);
+	nMask = Nn_GetHwCounterMask();
+	printf("Hardware counters: %s\n", Nn_GetHwCounterStatus());
+	if (nMask == 0)
+		return;
+	printf("%6s %14s %14s %6s %12s %12s %12s %12s %12s\n",
+		"", "instrs", "cycles", "ipc", "l1d-misses", "llc-misses", "br-misses", 
+		"instrs/pixel", "cycles/pixel");
+	if (Nn_GetProfile(pNet, NN_PROF_LOAD, &prof) == NN_OK)
+		printNnfHwProfile("load", &prof, nMask);
+	if (Nn_GetProfile(pNet, NN_PROF_NET, &prof) == NN_OK)
+		printNnfHwProfile("net", &prof, nMask);
+}
 
-            nC = pU1->ua.nNumConns;
-            for (iC = 0; iC < nC; iC++)
-            {
-                pC1 = Nn_GetConnAt(pU1, iC);
-                pC2 = Nn_GetConnAt(pU2, iC); 
 
-                memcpy(&pC2->ca, &pC1->ca, sizeof (NN_CONN_ATTRIB));
-                pC2->ca.iLayer += layerOffset;
-            } /* next iC */
-        } /* next iU */
-    } /* next iL */
+/**
+ * Prints a line of hardware counters, counters not available
+ * on this machine are printed as "n/a".
+ */
+void printNnfHwProfile(PCSTR pchName, const NN_PROFILE* pProf, int nMask)
+{
+	const NN_COUNTER anValue[NN_HW_NUM_COUNTERS] = 
+	{ 
+		pProf->nNumInstrs, pProf->nNumCycles, pProf->nNumL1dMisses, 
+		pProf->nNumLlcMisses, pProf->nNumBrMisses 
+	};
+	const int anWidth[NN_HW_NUM_COUNTERS] = { 14, 14, 12, 12, 12 };
+	double dNumPixels;
+	int    i;
+
+	dNumPixels = (double) pProf->nNumPixels;
+
+	printf("%6s", pchName);
+	for (i = 0; i < NN_HW_NUM_COUNTERS; i++)
+	{
+		if (i == 2)
+		{
+			/* Instructions per cycle */
+			if ((nMask & (NN_HW_INSTRS | NN_HW_CYCLES)) == (NN_HW_INSTRS | NN_HW_CYCLES) && anValue[1] > 0)
+				printf(" %6.2f", (double) anValue[0] / (double) anValue[1]);
+			else
+				printf(" %6s", "n/a");
+		}
+		if (nMask & (1 << i))
+			printf(" %*.0f", anWidth[i], (double) anValue[i]);
+		else
+			printf(" %*s", anWidth[i], "n/a");
+	}
+	for (i = 0; i < 2; i++)
+	{
+		if ((nMask & (1 << i)) && dNumPixels > 0)
+			printf(" %12.1f", (double) anValue[i] / dNumPixels);
+		else
+			printf(" %12s", "n/a");
+	}
+	printf("\n");
 }
 
 
-
-FILE* openFile(const char* pchFile, const char* pchMode)
+/**
+ * Prints the heap memory held by the net, once as loaded, once with
+ * the work buffer allocated by the first batch call and once frozen,
+ * and the allocator counters of loading the net and of the whole run.
+ */
+void printNnfMemory(NN_PNET pNet, const NN_ALLOC_STATS* pLoadStats)
 {
-	FILE* stream;
-
-	if (*pchMode == 'r' && !existsFile(pchFile)) 
+	NN_MEMORY_STATS stats[3];
+	NN_ALLOC_STATS  allocStats;
+	const char*     apchName[] = { "net", "layers", "units", "conns", "matrices", "plans", "caches", "arena", "total" };
+	size_t          anBytes[3][9];
+	int             i, j;
+
+	Nn_GetMemoryStats(pNet, &stats[0]);
+	if (Nn_ProcessNetBatch(pNet, 0, NULL, NULL) != NN_OK)
     {
-		fprintf(stderr, "Error: can not find file '%s'\n", pchFile);
+		fprintf(stderr, "NNF-Error: %s (NN_STATUS=%d)\n", Nn_GetErrMsg(), Nn_GetErrNo());
 		exit(-1);
 	}
-
-    if (*pchMode == 'r') 
+	Nn_GetMemoryStats(pNet, &stats[1]);
+	if (Nn_FreezeNet(pNet) != NN_OK)
     {
-        fprintf(stderr, "Reading from file '%s'...\n", pchFile);
-    }
-    else 
+		fprintf(stderr, "NNF-Error: %s (NN_STATUS=%d)\n", Nn_GetErrMsg(), Nn_GetErrNo());
+		exit(-1);
+	}
+	Nn_GetMemoryStats(pNet, &stats[2]);
+
+	for (j = 0; j < 3; j++)
+	{
+		anBytes[j][0] = stats[j].nNetBytes;
+		anBytes[j][1] = stats[j].nLayerBytes;
+		anBytes[j][2] = stats[j].nUnitBytes;
+		anBytes[j][3] = stats[j].nConnBytes;
+		anBytes[j][4] = stats[j].nMatrixBytes;
+		anBytes[j][5] = stats[j].nPlanBytes;
+		anBytes[j][6] = stats[j].nCacheBytes;
+		anBytes[j][7] = stats[j].nArenaBytes;
+		anBytes[j][8] = stats[j].nTotalBytes;
+	}
+
+	printf("Memory footprint (bytes, without allocator overhead):\n");
+	printf("%10s %14s %14s %14s\n", "", "loaded", "after batch", "frozen");
+	for (i = 0; i < 9; i++)
+		printf("%10s %14lu %14lu %14lu\n", apchName[i], 
+			(unsigned long) anBytes[0][i], (unsigned long) anBytes[1][i], (unsigned long) anBytes[2][i]);
+	printf("%10s %14ld %14ld %14ld\n", "allocs", stats[0].nNumAllocs, stats[1].nNumAllocs, stats[2].nNumAllocs);
+	printf("%ld units, %ld connections, %lu bytes of weights and matrix elements (%.1f%% of total)\n",
+		stats[1].nNumUnits, stats[1].nNumConns, (unsigned long) stats[1].nParamBytes,
+		100.0 * (double) stats[1].nParamBytes / (double) stats[1].nTotalBytes);
+	printf("Nets per GiB: %.0f (frozen: %.0f)\n", 1073741824.0 / (double) stats[1].nTotalBytes,
+		1073741824.0 / (double) stats[2].nTotalBytes);
+
+	Nn_GetAllocStats(&allocStats);
+	printf("Allocator calls (requested bytes):\n");
+	printf("%10s %10s %10s %14s %14s\n", "", "allocs", "frees", "live", "peak");
+	printf("%10s %10lu %10lu %14lu %14lu\n", "loading", 
+		(unsigned long) pLoadStats->nNumAllocs, (unsigned long) pLoadStats->nNumFrees,
+		(unsigned long) pLoadStats->nLiveBytes, (unsigned long) pLoadStats->nPeakBytes);
+	printf("%10s %10lu %10lu %14lu %14lu\n", "all", 
+		(unsigned long) allocStats.nNumAllocs, (unsigned long) allocStats.nNumFrees,
+		(unsigned long) allocStats.nLiveBytes, (unsigned long) allocStats.nPeakBytes);
+}
+
+
+/**
+ * A single benchmark measurement. Used as thread argument for the
+ * multithreaded path, each thread owns its net.
+ */
+typedef struct
+{
+	NN_PNET       pNet;
+	const double* pdInp;
+	double*       pdOut;
+	int           nNumPixels;
+	BOOL          bBatch;
+	double        dMinTime;
+	double        dNumPixels;  /* Result: number of pixels processed */
+	double        dTime;       /* Result: elapsed time in seconds    */
+}
+BENCH_RUN;
+
+/**
+ * Gets the wall clock time in seconds.
+ */
+double getWallTime()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+/**
+ * Evaluates the input vectors of the given run repeatedly until the
+ * minimum run time is over, either pixel by pixel or batch-wise.
+ */
+void* runBench(void* pvRun)
+{
+	BENCH_RUN* pRun = (BENCH_RUN*) pvRun;
+	int        nNumInp = Nn_GetInputLayer(pRun->pNet)->la.nNumUnits;
+	int        nNumOut = Nn_GetOutputLayer(pRun->pNet)->la.nNumUnits;
+	double     dTime0 = getWallTime();
+	int        i;
+
+	Nn_SetTraceThreadName(pRun->bBatch ? "bench batch" : "bench single");
+	pRun->dNumPixels = 0.0;
+	do
+	{
+		if (pRun->bBatch)
+		{
+			if (Nn_ProcessNetBatch(pRun->pNet, pRun->nNumPixels, pRun->pdInp, pRun->pdOut) != NN_OK)
+			{
+				fprintf(stderr, "NNF-Error: %s (NN_STATUS=%d)\n", Nn_GetErrMsg(), Nn_GetErrNo());
+				exit(-1);
+			}
+		}
+		else
+		{
+			for (i = 0; i < pRun->nNumPixels; i++)
+				Nn_ProcessNet(pRun->pNet, pRun->pdInp + i * nNumInp, pRun->pdOut + i * nNumOut);
+		}
+		pRun->dNumPixels += pRun->nNumPixels;
+		pRun->dTime = getWallTime() - dTime0;
+	}
+	while (pRun->dTime < pRun->dMinTime);
+
+	Nn_CloseHwCounters();
+	return NULL;
+}
+
+/**
+ * Writes the JSON object of a single benchmark path.
+ */
+void writeBenchResult(FILE* ostream, const char* pchPath, double dNumPixels, double dTime, double dMacsPerPixel, BOOL bLast)
+{
+	double dPixelsPerSec = dNumPixels / dTime;
+
+	fprintf(ostream,
+		"        \"%s\": { \"pixels\": %.0f, \"seconds\": %.6f, \"ns_per_pixel\": %.3f, "
+		"\"pixels_per_s\": %.1f, \"gflops\": %.4f }%s\n",
+		pchPath, dNumPixels, dTime, 1e9 / dPixelsPerSec, dPixelsPerSec,
+		2.0 * dMacsPerPixel * dPixelsPerSec * 1e-9, bLast ? "" : ",");
+}
+
+/**
+ * Benchmarks synthetic nets created with createNnfNet for the given shapes.
+ * For each shape the single-pixel path (Nn_ProcessNet), the batch path
+ * (Nn_ProcessNetBatch) and the batch path in nNumThreads threads with a
+ * net per thread are measured. The effective GFLOP/s count a multiply-add
+ * as two operations, the activation functions are not counted.
+ */
+void benchNnfNets(FILE* ostream,
+                  int nNumShapes,
+                  const int* pnNumLayers,
+                  const int (*panNumUnits)[NUM_LAYERS_MAX],
+                  int nNumThreads,
+                  double dMinTime)
+{
+	NN_PNET    apNet[BENCH_THREADS_MAX];
+	BENCH_RUN  aRun[BENCH_THREADS_MAX];
+	pthread_t  aThread[BENCH_THREADS_MAX];
+	double*    pdInp;
+	double*    pdOut;
+	double     dMacsPerPixel, dNumPixels, dTime;
+	int        nNumInp, nNumOut;
+	int        iS, iL, iU, iT, i;
+	NN_PLAYER  pLayer;
+
+	fprintf(ostream, "{\n");
+	fprintf(ostream, "  \"program\": \"%s\",\n", NNFT_PROGRAM_NAME);
+	fprintf(ostream, "  \"version\": \"%s\",\n", NNFT_VERSION_INFO);
+	fprintf(ostream, "  \"batch_size\": %d,\n", NN_BATCH_SIZE);
+	fprintf(ostream, "  \"threads\": %d,\n", nNumThreads);
+	fprintf(ostream, "  \"min_time\": %g,\n", dMinTime);
+	fprintf(ostream, "  \"results\": [\n");
+
+	for (iS = 0; iS < nNumShapes; iS++)
+	{
+		/* Same weights for every run */
+		srand(1);
+		for (iT = 0; iT < nNumThreads; iT++)
+			apNet[iT] = createNnfNet(pnNumLayers[iS], panNumUnits[iS]);
+
+		nNumInp = panNumUnits[iS][0];
+		nNumOut = panNumUnits[iS][pnNumLayers[iS] - 1];
+		dMacsPerPixel = 0.0;
+		for (iL = 0; iL < apNet[0]->na.nNumLayers; iL++)
+		{
+			pLayer = Nn_GetLayerAt(apNet[0], iL);
+			for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+				dMacsPerPixel += Nn_GetUnitAt(pLayer, iU)->ua.nNumConns;
+		}
+
+		pdInp = (double*) malloc(nNumThreads * BENCH_NUM_PIXELS * nNumInp * sizeof (double));
+		pdOut = (double*) malloc(nNumThreads * BENCH_NUM_PIXELS * nNumOut * sizeof (double));
+		if (pdInp == NULL || pdOut == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(-1);
+		}
+		for (i = 0; i < nNumThreads * BENCH_NUM_PIXELS * nNumInp; i++)
+			pdInp[i] = (double) rand() / RAND_MAX;
+
+		fprintf(stderr, "Benchmarking net");
+		for (iL = 0; iL < pnNumLayers[iS]; iL++)
+			fprintf(stderr, "%c%d", iL == 0 ? ' ' : 'x', panNumUnits[iS][iL]);
+		fprintf(stderr, "...\n");
+
+		fprintf(ostream, "    {\n");
+		fprintf(ostream, "      \"shape\": [");
+		for (iL = 0; iL < pnNumLayers[iS]; iL++)
+			fprintf(ostream, "%s%d", iL == 0 ? "" : ", ", panNumUnits[iS][iL]);
+		fprintf(ostream, "],\n");
+		fprintf(ostream, "      \"macs_per_pixel\": %.0f,\n", dMacsPerPixel);
+		fprintf(ostream, "      \"paths\": {\n");
+
+		/* Single-pixel and batch path in the calling thread */
+		for (i = 0; i < 2; i++)
+		{
+			aRun[0].pNet       = apNet[0];
+			aRun[0].pdInp      = pdInp;
+			aRun[0].pdOut      = pdOut;
+			aRun[0].nNumPixels = BENCH_NUM_PIXELS;
+			aRun[0].bBatch     = (i == 1);
+			aRun[0].dMinTime   = dMinTime;
+			runBench(&aRun[0]);
+			writeBenchResult(ostream, i == 0 ? "single" : "batch",
+				aRun[0].dNumPixels, aRun[0].dTime, dMacsPerPixel, FALSE);
+		}
+
+		/* Batch path in multiple threads, each having its own net and pixels */
+		for (iT = 0; iT < nNumThreads; iT++)
+		{
+			aRun[iT].pNet       = apNet[iT];
+			aRun[iT].pdInp      = pdInp + iT * BENCH_NUM_PIXELS * nNumInp;
+			aRun[iT].pdOut      = pdOut + iT * BENCH_NUM_PIXELS * nNumOut;
+			aRun[iT].nNumPixels = BENCH_NUM_PIXELS;
+			aRun[iT].bBatch     = TRUE;
+			aRun[iT].dMinTime   = dMinTime;
+			if (pthread_create(&aThread[iT], NULL, runBench, &aRun[iT]) != 0)
+			{
+				fprintf(stderr, "Failed to create thread\n");
+				exit(-1);
+			}
+		}
+		dNumPixels = 0.0;
+		dTime = 0.0;
+		for (iT = 0; iT < nNumThreads; iT++)
+		{
+			pthread_join(aThread[iT], NULL);
+			dNumPixels += aRun[iT].dNumPixels;
+			if (aRun[iT].dTime > dTime)
+				dTime = aRun[iT].dTime;
+		}
+		writeBenchResult(ostream, "threads", dNumPixels, dTime, dMacsPerPixel, TRUE);
+
+		fprintf(ostream, "      }\n");
+		fprintf(ostream, "    }%s\n", iS < nNumShapes - 1 ? "," : "");
+
+		free(pdInp);
+		free(pdOut);
+		for (iT = 0; iT < nNumThreads; iT++)
+			Nn_DeleteNet(apNet[iT]);
+	}
+
+	fprintf(ostream, "  ]\n");
+	fprintf(ostream, "}\n");
+}
+
+
+/**
+ * The processing routines checked against the reference Nn_ProcessNet by
+ * verifyNnfNet, with their default error limits. New processing routines
+ * shall be added here and in verifyChunk.
+ */
+typedef enum
+{
+	VERIFY_F32,
+	VERIFY_BATCH,
+	VERIFY_MASKED,
+	VERIFY_RANGED,
+	VERIFY_FROZEN,
+	VERIFY_FROZEN_BATCH,
+	VERIFY_NUM_ROUTINES
+}
+VERIFY_ROUTINE;
+
+static const char* g_apchVerifyRoutine[VERIFY_NUM_ROUTINES] =
+{
+	"Nn_ProcessNet_f32",
+	"Nn_ProcessNetBatch",
+	"Nn_ProcessNetBatchMasked",
+	"Nn_ProcessNetBatchRanged",
+	"frozen Nn_ProcessNet",
+	"frozen Nn_ProcessNetBatch"
+};
+
+/* Default limits for the absolute, relative and ULP error (0 = unchecked) */
+static const double g_adVerifyLimit[VERIFY_NUM_ROUTINES][3] =
+{
+	{ 1e-5,  1e-4,  0.0 },
+	{ 1e-12, 1e-12, 0.0 },
+	{ 1e-12, 1e-12, 0.0 },
+	{ 1e-12, 1e-12, 0.0 },
+	{ 0.0,   0.0,   0.0 },
+	{ 1e-12, 1e-12, 0.0 }
+};
+
+/**
+ * Error statistics of a processing routine for a single output unit.
+ */
+typedef struct
+{
+	double dMaxAbs;
+	double dMaxRel;
+	double dMaxUlp;
+	double dNumFailed;
+}
+VERIFY_STAT;
+
+/**
+ * A verification thread, each thread owns its net.
+ */
+typedef struct
+{
+	NN_PNET      pNet;
+	NN_PNET      pFrozenNet;  /* The same net, frozen by Nn_FreezeNet */
+	int          nNumPixels;
+	unsigned     nSeed;
+	BOOL         bEdgeCases;
+	double*      pdMin;       /* Lower input bounds (DIM=nNumInp) */
+	double*      pdMax;       /* Upper input bounds (DIM=nNumInp) */
+	double       adLimit[VERIFY_NUM_ROUTINES][3];
+	VERIFY_STAT* pStat;       /* Result (DIM=VERIFY_NUM_ROUTINES*nNumOut) */
+	double       dNumFlagged; /* Result: in-range pixels flagged by the range check */
+}
+VERIFY_RUN;
+
+/**
+ * Gets a random number in [0,1] from the given linear congruential generator.
+ */
+double getRandom(unsigned* pnState)
+{
+	*pnState = *pnState * 1664525u + 1013904223u;
+	return (double) (*pnState >> 8) / (double) 0xFFFFFF;
+}
+
+/**
+ * Gets the distance from x to the next representable number in double or
+ * single precision.
+ */
+double getUlp(double x, BOOL bFloat)
+{
+	int e;
+
+	if (x == 0.0)
+		return bFloat ? FLT_MIN * FLT_EPSILON : DBL_MIN * DBL_EPSILON;
+	frexp(x, &e);
+	return ldexp(1.0, e - (bFloat ? FLT_MANT_DIG : DBL_MANT_DIG));
+}
+
+/**
+ * Adds the error of a single output value to the statistics. An output fails
+ * if both the absolute and the relative limit are exceeded, or the ULP limit
+ * if it is checked. NaN is only accepted if the reference is NaN too.
+ */
+void addVerifyError(VERIFY_STAT* pStat, const double* adLimit, double dRef, double dVal, BOOL bFloat)
+{
+	double dAbs, dRel, dUlp;
+
+	if (dRef != dRef || dVal != dVal)
+	{
+		if (!(dRef != dRef && dVal != dVal))
+			pStat->dNumFailed++;
+		return;
+	}
+
+	dAbs = fabs(dVal - dRef);
+	dRel = (dRef != 0.0) ? dAbs / fabs(dRef) : (dAbs > 0.0 ? HUGE_VAL : 0.0);
+	dUlp = dAbs / getUlp(dRef, bFloat);
+
+	if (dAbs > pStat->dMaxAbs)
+		pStat->dMaxAbs = dAbs;
+	if (dRel > pStat->dMaxRel)
+		pStat->dMaxRel = dRel;
+	if (dUlp > pStat->dMaxUlp)
+		pStat->dMaxUlp = dUlp;
+
+	if ((dAbs > adLimit[0] && dRel > adLimit[1]) || (adLimit[2] > 0.0 && dUlp > adLimit[2]))
+		pStat->dNumFailed++;
+}
+
+/**
+ * Generates the input vectors of a chunk. If bEdgeCases is set, the chunk
+ * starts with vectors at the bounds: all inputs at the lower bound, at the
+ * upper bound and at the centre, then each input alone at its bounds.
+ */
+void makeVerifyInputs(const VERIFY_RUN* pRun, int nNumInp, int nNumPixels, double* pdInp, unsigned* pnState, BOOL bEdgeCases)
+{
+	int    iP, i, k;
+	double dMid;
+
+	for (iP = 0; iP < nNumPixels; iP++)
+	{
+		for (i = 0; i < nNumInp; i++)
+			pdInp[iP * nNumInp + i] = pRun->pdMin[i] + getRandom(pnState) * (pRun->pdMax[i] - pRun->pdMin[i]);
+	}
+
+	if (!bEdgeCases)
+		return;
+
+	for (iP = 0; iP < nNumPixels && iP < 3 + 2 * nNumInp; iP++)
+	{
+		for (i = 0; i < nNumInp; i++)
+		{
+			dMid = 0.5 * (pRun->pdMin[i] + pRun->pdMax[i]);
+			if (iP == 0)
+				pdInp[iP * nNumInp + i] = pRun->pdMin[i];
+			else if (iP == 1)
+				pdInp[iP * nNumInp + i] = pRun->pdMax[i];
+			else
+				pdInp[iP * nNumInp + i] = dMid;
+		}
+		if (iP >= 3)
+		{
+			k = (iP - 3) / 2;
+			pdInp[iP * nNumInp + k] = ((iP - 3) % 2 == 0) ? pRun->pdMin[k] : pRun->pdMax[k];
+		}
+	}
+}
+
+/**
+ * Verifies a chunk of input vectors with all processing routines.
+ */
+void verifyChunk(VERIFY_RUN* pRun, int nNumPixels, const double* pdInp, double* pdRef, double* pdOut,
+                 float* pfInp, float* pfOut, unsigned char* pMask, unsigned char* pRangeMask)
+{
+	const double dFill = -999.0;
+	NN_PNET      pNet = pRun->pNet;
+	int          nNumInp = Nn_GetInputLayer(pNet)->la.nNumUnits;
+	int          nNumOut = Nn_GetOutputLayer(pNet)->la.nNumUnits;
+	int          iR, iP, i;
+	NN_STATUS    nns = NN_OK;
+	VERIFY_STAT* pStat;
+
+	/* The reference */
+	for (iP = 0; iP < nNumPixels; iP++)
+		Nn_ProcessNet(pNet, pdInp + iP * nNumInp, pdRef + iP * nNumOut);
+
+	for (iR = 0; iR < VERIFY_NUM_ROUTINES; iR++)
+	{
+		pStat = pRun->pStat + iR * nNumOut;
+
+		switch (iR)
+		{
+		case VERIFY_F32:
+			for (i = 0; i < nNumPixels * nNumInp; i++)
+				pfInp[i] = (float) pdInp[i];
+			for (iP = 0; iP < nNumPixels; iP++)
+				Nn_ProcessNet_f32(pNet, pfInp + iP * nNumInp, pfOut + iP * nNumOut);
+			for (i = 0; i < nNumPixels * nNumOut; i++)
+				pdOut[i] = pfOut[i];
+			break;
+		case VERIFY_BATCH:
+			nns = Nn_ProcessNetBatch(pNet, nNumPixels, pdInp, pdOut);
+			break;
+		case VERIFY_MASKED:
+			/* Every 7th pixel is invalid, so the valid ones get compacted */
+			memset(pMask, 0, NN_MASK_SIZE(nNumPixels));
+			for (iP = 0; iP < nNumPixels; iP++)
+			{
+				if (iP % 7 != 6)
+					NN_MASK_SET(pMask, iP);
+			}
+			nns = Nn_ProcessNetBatchMasked(pNet, nNumPixels, pdInp, pdOut, pMask, dFill);
+			break;
+		case VERIFY_RANGED:
+			nns = Nn_ProcessNetBatchRanged(pNet, nNumPixels, pdInp, pdOut, NULL, pRangeMask, FALSE, dFill);
+			for (iP = 0; iP < nNumPixels; iP++)
+				pRun->dNumFlagged += NN_MASK_GET(pRangeMask, iP);
+			break;
+		case VERIFY_FROZEN:
+			for (iP = 0; iP < nNumPixels; iP++)
+				Nn_ProcessNet(pRun->pFrozenNet, pdInp + iP * nNumInp, pdOut + iP * nNumOut);
+			break;
+		case VERIFY_FROZEN_BATCH:
+			nns = Nn_ProcessNetBatch(pRun->pFrozenNet, nNumPixels, pdInp, pdOut);
+			break;
+		}
+
+		if (nns != NN_OK)
+		{
+			fprintf(stderr, "NNF-Error: %s (NN_STATUS=%d)\n", Nn_GetErrMsg(), Nn_GetErrNo());
+			exit(-1);
+		}
+
+		for (iP = 0; iP < nNumPixels; iP++)
+		{
+			for (i = 0; i < nNumOut; i++)
+			{
+				if (iR == VERIFY_MASKED && !NN_MASK_GET(pMask, iP))
+					addVerifyError(pStat + i, pRun->adLimit[iR], dFill, pdOut[iP * nNumOut + i], FALSE);
+				else
+					addVerifyError(pStat + i, pRun->adLimit[iR], pdRef[iP * nNumOut + i], pdOut[iP * nNumOut + i], iR == VERIFY_F32);
+			}
+		}
+	}
+}
+
+/**
+ * Thread function of verifyNnfNet.
+ */
+void* runVerify(void* pvRun)
+{
+	VERIFY_RUN*    pRun = (VERIFY_RUN*) pvRun;
+	int            nNumInp = Nn_GetInputLayer(pRun->pNet)->la.nNumUnits;
+	int            nNumOut = Nn_GetOutputLayer(pRun->pNet)->la.nNumUnits;
+	int            n = VERIFY_NUM_PIXELS;
+	unsigned       nState = pRun->nSeed;
+	double*        pdInp  = (double*) malloc(n * nNumInp * sizeof (double));
+	double*        pdRef  = (double*) malloc(n * nNumOut * sizeof (double));
+	double*        pdOut  = (double*) malloc(n * nNumOut * sizeof (double));
+	float*         pfInp  = (float*)  malloc(n * nNumInp * sizeof (float));
+	float*         pfOut  = (float*)  malloc(n * nNumOut * sizeof (float));
+	unsigned char* pMask  = (unsigned char*) malloc(NN_MASK_SIZE(n));
+	unsigned char* pRange = (unsigned char*) malloc(NN_MASK_SIZE(n));
+	int            iP;
+
+	if (pdInp == NULL || pdRef == NULL || pdOut == NULL || pfInp == NULL || pfOut == NULL || pMask == NULL || pRange == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(-1);
+	}
+
+	for (iP = 0; iP < pRun->nNumPixels; iP += n)
+	{
+		if (n > pRun->nNumPixels - iP)
+			n = pRun->nNumPixels - iP;
+		makeVerifyInputs(pRun, nNumInp, n, pdInp, &nState, pRun->bEdgeCases && iP == 0);
+		verifyChunk(pRun, n, pdInp, pdRef, pdOut, pfInp, pfOut, pMask, pRange);
+	}
+
+	free(pdInp);
+	free(pdRef);
+	free(pdOut);
+	free(pfInp);
+	free(pfOut);
+	free(pMask);
+	free(pRange);
+	Nn_CloseHwCounters();
+	return NULL;
+}
+
+/**
+ * Compares the outputs of all processing routines with those of the reference
+ * Nn_ProcessNet for random input vectors within the training ranges of the
+ * input units (see NN_TRN_RANGE, stored by the FFBP conversion from the
+ * FFBP_TRANS ranges), inputs without range are taken from [0,1]. The first vectors are
+ * edge cases at the bounds. Prints the maximum absolute, relative and ULP
+ * error per routine and output unit.
+ * Returns TRUE if no output exceeds the error limits.
+ */
+BOOL verifyNnfNet(const char* pchNnfFile, int nNumPixels, int nNumThreads, unsigned nSeed)
+{
+	NN_PNET     apNet[BENCH_THREADS_MAX];
+	NN_PNET     apFrozenNet[BENCH_THREADS_MAX];
+	VERIFY_RUN  aRun[BENCH_THREADS_MAX];
+	pthread_t   aThread[BENCH_THREADS_MAX];
+	VERIFY_STAT stat, *pStat;
+	NN_PLAYER   pLayer;
+	NN_FLOAT    fMin, fMax;
+	double*     pdMin;
+	double*     pdMax;
+	double      dNumFlagged = 0.0;
+	double      dTime0 = getWallTime();
+	int         nNumInp, nNumOut;
+	int         iT, iR, i, j;
+	BOOL        bOk = TRUE;
+
+	for (iT = 0; iT < nNumThreads; iT++)
+	{
+		apNet[iT] = readNnfNet(pchNnfFile, FALSE, FALSE);
+		apFrozenNet[iT] = readNnfNet(pchNnfFile, FALSE, TRUE);
+		if (Nn_FreezeNet(apFrozenNet[iT]) != NN_OK)
+		{
+			fprintf(stderr, "NNF-Error: %s (NN_STATUS=%d)\n", Nn_GetErrMsg(), Nn_GetErrNo());
+			exit(-1);
+		}
+	}
+
+	nNumInp = Nn_GetInputLayer(apNet[0])->la.nNumUnits;
+	nNumOut = Nn_GetOutputLayer(apNet[0])->la.nNumUnits;
+
+	pdMin = (double*) malloc(nNumInp * sizeof (double));
+	pdMax = (double*) malloc(nNumInp * sizeof (double));
+	if (pdMin == NULL || pdMax == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(-1);
+	}
+
+	pLayer = Nn_GetInputLayer(apNet[0]);
+	for (i = 0; i < nNumInp; i++)
+	{
+		Nn_GetInpBounds(Nn_GetUnitAt(pLayer, i), &fMin, &fMax);
+		if (fMin == -HUGE_VAL || fMax == HUGE_VAL)
+		{
+			fMin = 0.0;
+			fMax = 1.0;
+		}
+		pdMin[i] = fMin;
+		pdMax[i] = fMax;
+	}
+
+	printf("Verifying %d input vectors using %d thread(s)...\n", nNumPixels, nNumThreads);
+
+	for (iT = 0; iT < nNumThreads; iT++)
+	{
+		aRun[iT].pNet        = apNet[iT];
+		aRun[iT].pFrozenNet  = apFrozenNet[iT];
+		aRun[iT].nNumPixels  = nNumPixels / nNumThreads + (iT < nNumPixels % nNumThreads ? 1 : 0);
+		aRun[iT].nSeed       = nSeed * 7919u + iT;
+		aRun[iT].bEdgeCases  = (iT == 0);
+		aRun[iT].pdMin       = pdMin;
+		aRun[iT].pdMax       = pdMax;
+		aRun[iT].dNumFlagged = 0.0;
+		aRun[iT].pStat       = (VERIFY_STAT*) calloc(VERIFY_NUM_ROUTINES * nNumOut, sizeof (VERIFY_STAT));
+		if (aRun[iT].pStat == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(-1);
+		}
+		for (iR = 0; iR < VERIFY_NUM_ROUTINES; iR++)
+		{
+			aRun[iT].adLimit[iR][0] = g_dVerifyMaxAbs >= 0.0 ? g_dVerifyMaxAbs : g_adVerifyLimit[iR][0];
+			aRun[iT].adLimit[iR][1] = g_dVerifyMaxRel >= 0.0 ? g_dVerifyMaxRel : g_adVerifyLimit[iR][1];
+			aRun[iT].adLimit[iR][2] = g_dVerifyMaxUlp >= 0.0 ? g_dVerifyMaxUlp : g_adVerifyLimit[iR][2];
+		}
+		if (pthread_create(&aThread[iT], NULL, runVerify, &aRun[iT]) != 0)
+		{
+			fprintf(stderr, "Failed to create thread\n");
+			exit(-1);
+		}
+	}
+	for (iT = 0; iT < nNumThreads; iT++)
+	{
+		pthread_join(aThread[iT], NULL);
+		dNumFlagged += aRun[iT].dNumFlagged;
+	}
+
+	printf("%-26s %4s %12s %12s %12s %10s\n", "routine", "out", "max_abs", "max_rel", "max_ulp", "failed");
+	for (iR = 0; iR < VERIFY_NUM_ROUTINES; iR++)
+	{
+		for (j = 0; j < nNumOut; j++)
+		{
+			memset(&stat, 0, sizeof (stat));
+			for (iT = 0; iT < nNumThreads; iT++)
+			{
+				pStat = aRun[iT].pStat + iR * nNumOut + j;
+				if (pStat->dMaxAbs > stat.dMaxAbs)
+					stat.dMaxAbs = pStat->dMaxAbs;
+				if (pStat->dMaxRel > stat.dMaxRel)
+					stat.dMaxRel = pStat->dMaxRel;
+				if (pStat->dMaxUlp > stat.dMaxUlp)
+					stat.dMaxUlp = pStat->dMaxUlp;
+				stat.dNumFailed += pStat->dNumFailed;
+			}
+			printf("%-26s %4d %12.4g %12.4g %12.4g %10.0f\n",
+				g_apchVerifyRoutine[iR], j + 1, stat.dMaxAbs, stat.dMaxRel, stat.dMaxUlp, stat.dNumFailed);
+			if (stat.dNumFailed > 0.0)
+				bOk = FALSE;
+		}
+	}
+	if (dNumFlagged > 0.0)
+		printf("Warning: %.0f input vectors within the bounds were flagged out of range\n", dNumFlagged);
+
+	printf("Verification %s (%.1f s)\n", bOk ? "passed" : "FAILED", getWallTime() - dTime0);
+
+	for (iT = 0; iT < nNumThreads; iT++)
+	{
+		free(aRun[iT].pStat);
+		Nn_DeleteNet(apNet[iT]);
+		Nn_DeleteNet(apFrozenNet[iT]);
+	}
+	free(pdMin);
+	free(pdMax);
+	return bOk;
+}
+
+
+
+/**
+ * A net of the batch conversion: the input and output file and the result
+ * of writing the net. The load results are kept by batchConvertNets.
+ */
+typedef struct
+{
+	char       pchInpFile[NN_MAX_PATH+1];
+	char       pchOutFile[NN_MAX_PATH+1];
+	BOOL       bSkip;             /* Output file exists and is kept      */
+	NN_STATUS  nWriteStatus;      /* Result: status of writing the net   */
+	char       pchErrMsg[512];    /* Result: error message of writing    */
+	double     dWriteTime;        /* Result: time of writing in seconds  */
+}
+BATCH_NET;
+
+/**
+ * The nets to be written by the threads of batchConvertNets. Each thread
+ * takes the next net from the shared counter.
+ */
+typedef struct
+{
+	BATCH_NET*     pNets;
+	NN_PNET*       apNets;
+	int            nNumNets;
+	volatile int   nNumTaken;
+}
+BATCH_RUN;
+
+/**
+ * Appends a NNF input file to the nets of the batch conversion. The output
+ * file has the extension of the output format and is located in the output
+ * directory, if one is given, or next to the input file.
+ */
+void addBatchNet(BATCH_NET** ppNets, int* pnNumNets, int* pnMaxNets, const char* pchInpFile)
+{
+	BATCH_NET*  pNet;
+	const char* pchName;
+
+	if (strlen(pchInpFile) > NN_MAX_PATH)
+	{
+		fprintf(stderr, "Error: path too long '%s'\n", pchInpFile);
+		exit(-1);
+	}
+	if (*pnNumNets == *pnMaxNets)
+	{
+		*pnMaxNets = *pnMaxNets > 0 ? 2 * *pnMaxNets : 16;
+		*ppNets = (BATCH_NET*) realloc(*ppNets, *pnMaxNets * sizeof (BATCH_NET));
+		if (*ppNets == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(-1);
+		}
+	}
+	pNet = *ppNets + (*pnNumNets)++;
+	memset(pNet, 0, sizeof (BATCH_NET));
+
+	strcpy(pNet->pchInpFile, pchInpFile);
+	if (isEmptyString(g_pchNnOFile))
+	{
+		strcpy(pNet->pchOutFile, pchInpFile);
+	}
+	else
+	{
+		pchName = strrchr(pchInpFile, '/');
+		pchName = pchName != NULL ? pchName + 1 : pchInpFile;
+		/* Leaves room for the extension */
+		if (snprintf(pNet->pchOutFile, sizeof (pNet->pchOutFile) - strlen(NN_BIN_EXT), "%s/%s",
+				g_pchNnOFile, pchName) >= (int) (sizeof (pNet->pchOutFile) - strlen(NN_BIN_EXT)))
+		{
+			fprintf(stderr, "Error: path too long '%s/%s'\n", g_pchNnOFile, pchName);
+			exit(-1);
+		}
+	}
+	replaceFileExt(pNet->pchOutFile, g_bForceBinaryOut ? NN_BIN_EXT : NN_ASC_EXT);
+}
+
+/**
+ * Compares two strings for qsort.
+ */
+int compareStrings(const void* pv1, const void* pv2)
+{
+	return strcmp(*(const char* const*) pv1, *(const char* const*) pv2);
+}
+
+/**
+ * Appends the nets of a command line argument to the nets of the batch
+ * conversion. The argument is a NNF input file, a directory or, if it
+ * starts with '@', a manifest file listing files and directories, one per
+ * line. Of a directory, the ASCII files are taken when writing binary
+ * files, the binary files otherwise, in the order of their names.
+ */
+void addBatchArg(BATCH_NET** ppNets, int* pnNumNets, int* pnMaxNets, const char* pchArg)
+{
+	struct stat    st;
+	DIR*           pDir;
+	struct dirent* pEntry;
+	FILE*          istream;
+	char**         ppchNames;
+	const char*    pchExt;
+	char*          pchLine;
+	char           pchBuf[LINE_LEN_MAX+1];
+	char           pchPath[NN_MAX_PATH+1];
+	int            nNumNames, nMaxNames, i;
+	size_t         nLen;
+
+	if (*pchArg == '@')
+	{
+		istream = openFile(pchArg + 1, "r");
+		while (fgets(pchBuf, LINE_LEN_MAX, istream) != NULL)
+		{
+			pchLine = pchBuf;
+			nLen = strlen(pchLine);
+			while (nLen > 0 && isspace((unsigned char) pchLine[nLen-1]))
+				pchLine[--nLen] = '\0';
+			while (isspace((unsigned char) *pchLine))
+				pchLine++;
+			if (*pchLine != '\0' && *pchLine != '#' && *pchLine != '@')
+				addBatchArg(ppNets, pnNumNets, pnMaxNets, pchLine);
+		}
+		closeFile(istream);
+	}
+	else if (stat(pchArg, &st) == 0 && S_ISDIR(st.st_mode))
+	{
+		pDir = opendir(pchArg);
+		if (pDir == NULL)
+		{
+			fprintf(stderr, "Error: can not open directory '%s'\n", pchArg);
+			exit(-1);
+		}
+		pchExt = g_bForceBinaryOut ? NN_ASC_EXT : NN_BIN_EXT;
+		ppchNames = NULL;
+		nNumNames = 0;
+		nMaxNames = 0;
+		while ((pEntry = readdir(pDir)) != NULL)
+		{
+			nLen = strlen(pEntry->d_name);
+			if (nLen <= strlen(pchExt) || strcmp(pEntry->d_name + nLen - strlen(pchExt), pchExt) != 0)
+				continue;
+			if (nNumNames == nMaxNames)
+			{
+				nMaxNames = nMaxNames > 0 ? 2 * nMaxNames : 16;
+				ppchNames = (char**) realloc(ppchNames, nMaxNames * sizeof (char*));
+			}
+			if (ppchNames == NULL || (ppchNames[nNumNames++] = strdup(pEntry->d_name)) == NULL)
+			{
+				fprintf(stderr, "Out of memory\n");
+				exit(-1);
+			}
+		}
+		closedir(pDir);
+
+		qsort(ppchNames, nNumNames, sizeof (char*), compareStrings);
+		for (i = 0; i < nNumNames; i++)
+		{
+			if (snprintf(pchPath, sizeof (pchPath), "%s/%s", pchArg, ppchNames[i]) >= (int) sizeof (pchPath))
+			{
+				fprintf(stderr, "Error: path too long '%s/%s'\n", pchArg, ppchNames[i]);
+				exit(-1);
+			}
+			addBatchNet(ppNets, pnNumNets, pnMaxNets, pchPath);
+			free(ppchNames[i]);
+		}
+		free(ppchNames);
+	}
+	else
+	{
+		if (!existsFile(pchArg))
+		{
+			fprintf(stderr, "Error: can not find file '%s'\n", pchArg);
+			exit(-1);
+		}
+		addBatchNet(ppNets, pnNumNets, pnMaxNets, pchArg);
+	}
+}
+
+/**
+ * Writes the loaded nets of the given run until all nets are taken.
+ */
+void* runBatch(void* pvRun)
+{
+	BATCH_RUN* pRun = (BATCH_RUN*) pvRun;
+	BATCH_NET* pNet;
+	double     dTime0;
+	int        i;
+
+	Nn_SetTraceThreadName("batch writer");
+	while ((i = __sync_fetch_and_add(&pRun->nNumTaken, 1)) < pRun->nNumNets)
+	{
+		pNet = pRun->pNets + i;
+		if (pNet->bSkip || pRun->apNets[i] == NULL)
+			continue;
+
+		dTime0 = getWallTime();
+		if (!g_bForceBinaryOut)
+			pNet->nWriteStatus = Nn_WriteNetToAscFile(pNet->pchOutFile, pRun->apNets[i]);
+		else if (g_bBin2Out)
+			pNet->nWriteStatus = Nn_WriteNetToBin2File(pNet->pchOutFile, pRun->apNets[i], getBin2Payload());
+		else
+			pNet->nWriteStatus = Nn_WriteNetToBinFile(pNet->pchOutFile, pRun->apNets[i]);
+		pNet->dWriteTime = getWallTime() - dTime0;
+
+		/* The error state is per thread, so keep the message with the net */
+		if (pNet->nWriteStatus != NN_OK)
+		{
+			strncpy(pNet->pchErrMsg, Nn_GetErrMsg(), sizeof (pNet->pchErrMsg) - 1);
+			pNet->pchErrMsg[sizeof (pNet->pchErrMsg) - 1] = '\0';
+		}
+	}
+	Nn_CloseHwCounters();
+	return NULL;
+}
+
+/**
+ * Converts the nets of the given command line arguments (see addBatchArg)
+ * to ASCII or binary NNF files. The nets are loaded by Nn_LoadNets and
+ * written by nNumThreads threads. Prints the stage times of each net.
+ * Returns TRUE if no net failed.
+ */
+BOOL batchConvertNets(int nNumArgs, char** ppchArgs, int nNumThreads)
+{
+	BATCH_NET*       pNets = NULL;
+	NN_PNET*         apNets;
+	PCSTR*           apchPaths;
+	NN_LOAD_RESULT*  aResults;
+	NN_LOAD_OPTIONS  options;
+	BATCH_RUN        run;
+	pthread_t        aThread[BENCH_THREADS_MAX];
+	double           dTime0, dLoadTime, dWriteTime;
+	int              nNumNets = 0, nMaxNets = 0, nNumDone = 0, nNumFailed = 0;
+	int              iT, i;
+
+	for (i = 0; i < nNumArgs; i++)
+		addBatchArg(&pNets, &nNumNets, &nMaxNets, ppchArgs[i]);
+	if (nNumNets <= 0)
+	{
+		fprintf(stderr, "No NNF input files found\n");
+		return FALSE;
+	}
+
+	/* The nets are written concurrently, so no two of them to the same file */
+	for (i = 0; i < nNumNets; i++)
+	{
+		for (iT = 0; iT < i; iT++)
+		{
+			if (strcmp(pNets[iT].pchOutFile, pNets[i].pchOutFile) == 0)
+			{
+				fprintf(stderr, "Error: '%s' and '%s' are both converted to '%s'\n", 
+					pNets[iT].pchInpFile, pNets[i].pchInpFile, pNets[i].pchOutFile);
+				exit(-1);
+			}
+		}
+	}
+
+	for (i = 0; i < nNumNets; i++)
+	{
+		if (existsFile(pNets[i].pchOutFile) && !overwriteExistingFile(pNets[i].pchOutFile))
+			pNets[i].bSkip = TRUE;
+	}
+
+	apNets    = (NN_PNET*) malloc((size_t) nNumNets * sizeof (NN_PNET));
+	apchPaths = (PCSTR*) malloc((size_t) nNumNets * sizeof (PCSTR));
+	aResults  = (NN_LOAD_RESULT*) malloc((size_t) nNumNets * sizeof (NN_LOAD_RESULT));
+	if (apNets == NULL || apchPaths == NULL || aResults == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(-1);
+	}
+	for (i = 0; i < nNumNets; i++)
+		apchPaths[i] = pNets[i].pchInpFile;
+
+	options.nNumThreads  = nNumThreads;
+	options.nNumInpUnits = -1;
+	options.nNumOutUnits = -1;
+	options.bMapFile     = g_bMapFile;
+	options.bFreeze      = FALSE;
+
+	fprintf(stderr, "Loading %d nets with %d threads...\n", nNumNets, nNumThreads);
+	dTime0 = getWallTime();
+	Nn_LoadNets(apchPaths, nNumNets, &options, apNets, aResults);
+	dLoadTime = getWallTime() - dTime0;
+
+	fprintf(stderr, "Writing %d nets with %d threads...\n", nNumNets, nNumThreads);
+	run.pNets     = pNets;
+	run.apNets    = apNets;
+	run.nNumNets  = nNumNets;
+	run.nNumTaken = 0;
+	dTime0 = getWallTime();
+	for (iT = 1; iT < nNumThreads && iT < nNumNets; iT++)
+	{
+		if (pthread_create(&aThread[iT], NULL, runBatch, &run) != 0)
+		{
+			fprintf(stderr, "Error: can not create thread\n");
+			exit(-1);
+		}
+	}
+	runBatch(&run);
+	for (iT = 1; iT < nNumThreads && iT < nNumNets; iT++)
+		pthread_join(aThread[iT], NULL);
+	dWriteTime = getWallTime() - dTime0;
+
+	printf("%-8s %6s %9s %9s %9s  %s\n", "status", "thread", "wait[ms]", "load[ms]", "write[ms]", "file");
+	for (i = 0; i < nNumNets; i++)
+	{
+		if (aResults[i].nStatus != NN_OK)
+		{
+			printf("%-8s %6d %9.2f %9.2f %9s  %s\n", "failed", aResults[i].iThread,
+				1e3 * aResults[i].dStartTime, 1e3 * aResults[i].dLoadTime, "-", pNets[i].pchInpFile);
+			printf("         %s\n", aResults[i].pchErrMsg);
+			nNumFailed++;
+		}
+		else if (pNets[i].bSkip)
+		{
+			printf("%-8s %6d %9.2f %9.2f %9s  %s\n", "skipped", aResults[i].iThread,
+				1e3 * aResults[i].dStartTime, 1e3 * aResults[i].dLoadTime, "-", pNets[i].pchInpFile);
+		}
+		else if (pNets[i].nWriteStatus != NN_OK)
+		{
+			printf("%-8s %6d %9.2f %9.2f %9.2f  %s\n", "failed", aResults[i].iThread,
+				1e3 * aResults[i].dStartTime, 1e3 * aResults[i].dLoadTime, 1e3 * pNets[i].dWriteTime, pNets[i].pchOutFile);
+			printf("         %s\n", pNets[i].pchErrMsg);
+			nNumFailed++;
+		}
+		else
+		{
+			printf("%-8s %6d %9.2f %9.2f %9.2f  %s -> %s\n", "ok", aResults[i].iThread,
+				1e3 * aResults[i].dStartTime, 1e3 * aResults[i].dLoadTime, 1e3 * pNets[i].dWriteTime,
+				pNets[i].pchInpFile, pNets[i].pchOutFile);
+			nNumDone++;
+		}
+		Nn_DeleteNet(apNets[i]);
+	}
+	printf("%d of %d nets converted, loading %.3f s, writing %.3f s\n", nNumDone, nNumNets, dLoadTime, dWriteTime);
+
+	free(aResults);
+	free(apchPaths);
+	free(apNets);
+	free(pNets);
+	return nNumFailed == 0;
+}
+
+
+void copyNet(NN_PNET sourceNet, NN_PNET targetNet, int layerOffset)
+{
+    NN_PLAYER pL1;
+    NN_PLAYER pL2;
+    NN_PUNIT  pU1;
+    NN_PUNIT  pU2;
+    NN_PCONN  pC1;
+    NN_PCONN  pC2;
+
+    short iL, nL;
+    short iU, nU;
+    short iC, nC;
+
+    nL = sourceNet->na.nNumLayers;
+    for (iL = 0; iL < nL; iL++) 
+    {
+        pL1 = Nn_GetLayerAt(sourceNet, iL);
+        pL2 = Nn_GetLayerAt(targetNet, iL + layerOffset);
+
+        memcpy(&pL2->la, &pL1->la, sizeof (NN_LAYER_ATTRIB));
+        pL2->la.iLayer += layerOffset;
+        Nn_CreateUnits(pL2);
+
+        nU = pL1->la.nNumUnits;
+        for (iU = 0; iU < nU; iU++)
+        {
+            pU1 = Nn_GetUnitAt(pL1, iU);
+            pU2 = Nn_GetUnitAt(pL2, iU);
+
+            memcpy(&pU2->ua, &pU1->ua, sizeof (NN_UNIT_ATTRIB));
+            pU2->ua.iLayer += layerOffset;
+            Nn_CreateConns(pU2);
+
+            nC = pU1->ua.nNumConns;
+            for (iC = 0; iC < nC; iC++)
+            {
+                pC1 = Nn_GetConnAt(pU1, iC);
+                pC2 = Nn_GetConnAt(pU2, iC); 
+
+                memcpy(&pC2->ca, &pC1->ca, sizeof (NN_CONN_ATTRIB));
+                pC2->ca.iLayer += layerOffset;
+            } /* next iC */
+        } /* next iU */
+    } /* next iL */
+}
+
+
+
+FILE* openFile(const char* pchFile, const char* pchMode)
+{
+	FILE* stream;
+
+	if (*pchMode == 'r' && !existsFile(pchFile)) 
+    {
+		fprintf(stderr, "Error: can not find file '%s'\n", pchFile);
+		exit(-1);
+	}
+
+    if (*pchMode == 'r') 
+    {
+        fprintf(stderr, "Reading from file '%s'...\n", pchFile);
+    }
+    else 
     {
         fprintf(stderr, "Writing to file '%s'...\n", pchFile);
     }
@@ -1701,6 +3273,30 @@ BOOL isBinaryFile (const char* pchPath)
 }
 
 
+BOOL isBin2File (const char* pchPath)
+{
+	FILE* pStream = fopen(pchPath, "rb");
+	unsigned char achMagic[8];
+	size_t nSize;
+
+	if (pStream == NULL)
+		return FALSE;
+	nSize = fread(achMagic, 1, sizeof (achMagic), pStream);
+	fclose(pStream);
+
+	return Nn_IsBin2Mem(achMagic, nSize);
+}
+
+/**
+ * Gets the payload type of NNFF 2.0 output files given by the options
+ * -f32 and -z.
+ */
+int getBin2Payload ()
+{
+	return (g_bSinglePayload ? NN_PREC_SINGLE : NN_PREC_DOUBLE) | (g_bPackedPayload ? NN_BIN2_PACKED : 0);
+}
+
+
 
 char* readLine(FILE* istream, int* piLine)
 {
@@ -1769,7 +3365,8 @@ BOOL equalStrings(const char* pch1, const char* pch2)
 
 BOOL isOptionString(const char* pch)
 {
-	return *pch == '-' || *pch == '/';
+	/* A single '-' names the standard input */
+	return (*pch == '-' && pch[1] != '\0') || *pch == '/';
 }
 
 
@@ -1803,9 +3400,9 @@ void throwInvalidOptionArgumentException(const char* pchOption)
 /**
  * Prints the proigram name, version and copyrights.
  */
-void printProgramInfo()
+void printProgramInfo(FILE* ostream)
 {
-	printf("\n%s, %s\n%s\n\n", 
+	fprintf(ostream, "\n%s, %s\n%s\n\n", 
            NNFT_PROGRAM_NAME, 
            NNFT_VERSION_INFO, 
            NNFT_COPYRIGHT_INFO);
@@ -1818,28 +3415,40 @@ void printUsage()
 {
 	printf(
 		"Usage:\n"
-		"%s [-nnf] [-o file] [-b] [-m] file\n"
+		"%s [-nnf] [-o file] [-b] [-v2] [-f32] [-z] [-m] [-map] [-stream] file\n"
 		"  -nnf     Switches to NNF ASCII/binary conversion mode (default mode)\n"
 		"  -o file  Specifies a name for the NNF output file\n"
 		"  -b       Forces creation of a binary NNF output file\n"
+		"  -v2      Writes the binary NNF output file in NNFF 2.0 (implies -b),\n"
+		"           binary input files are read in NNFF 1.x and 2.0\n"
+		"  -f32     Same as -v2 with single precision weights\n"
+		"  -z       Same as -v2 with packed weights, can be combined with -f32\n"
 		"  -m       Forces in-memory creation of NNF net (for internal tests)\n"
-		"  file     Name of a NNF input file (ASCII or binary)\n"
+		"  -map     Loads a binary NNFF 1.x net through a memory mapping of the\n"
+		"           file, NNFF 2.0 nets are read as without it\n"
+		"  -stream  Reads the NNF net as a byte stream, as from a pipe\n"
+		"  file     Name of a NNF input file (ASCII or binary), '-' for the\n"
+		"           standard input\n"
 		"or\n"
-		"%s -ffbp [-o file] [-b] [-i] [-<i|o><o|s><i1>[-<i2>] value] file [func]\n"
+		"%s -ffbp [-o file] [-b] [-n] [-t] [-<i|o><o|s><i1>[-<i2>] value] file [func]\n"
 		"  -ffbp    Switches to FFBP conversion mode\n"
 		"  -o file  Specifies a name for the NNF output file\n"
 		"  -b       Forces creation of a binary NNF output file\n"
 		"  -n       Includes input/output normalizing into the NNF file\n"
+		"  -t       Includes the input/output transforms into the NNF file,\n"
+		"           no C-function is generated then\n"
 		"  -i<o|s>  Offset (o) or factor (s) for linear scaling of input units i1 to i2\n"
 		"  -o<o|s>  Offset (o) or factor (s) for linear scaling of output units i1 to i2\n"
 		"  file     Name of FFBP input file (ASCII)\n"
 		"  func     Name of the C-function to be generated\n"
 		"or\n"
-		"%s -ffbpx [-o file] [-b] [-i] [-<i|o><o|s><i1>[-<i2>] value] file1 file2 thres [func]\n"
+		"%s -ffbpx [-o file] [-b] [-n] [-t] [-<i|o><o|s><i1>[-<i2>] value] file1 file2 thres [func]\n"
 		"  -ffbp    Switches to FFBP conversion mode\n"
 		"  -o file  Specifies a name for the NNF output file\n"
 		"  -b       Forces creation of a binary NNF output file\n"
 		"  -n       Includes input/output normalizing into the NNF file\n"
+		"  -t       Includes the input/output transforms into the NNF file,\n"
+		"           no C-function is generated then\n"
 		"  -i<o|s>  Offset (o) or factor (s) for linear scaling of input units i1 to i2\n"
 		"  -o<o|s>  Offset (o) or factor (s) for linear scaling of output units i1 to i2\n"
 		"  file1    Name of the inverse FFBP input file (ASCII)\n"
@@ -1853,19 +3462,66 @@ void printUsage()
 		"  -b       Forces creation of a binary NNF output file\n"
 		"  int{i}   Number of units in layer {i}, i=1: input, 1<i<n: hidden, i=n: output\n"
 		"or\n"
-		"%s -test [-l int] [-o file] [-m] file1 file2\n"
+		"%s -bench [-o file] [-threads int] [-time sec] [-trace file] [int1 int2 int3 ...]\n"
+		"  -bench   Switches to benchmark mode, results are written in JSON format\n"
+		"  -o file  Specifies a name for the JSON output file (default is stdout)\n"
+		"  -threads Number of threads for the multithreaded path (default: all CPUs)\n"
+		"  -time    Minimum run time per measurement in seconds (default: 0.5)\n"
+		"  -trace file  Writes a timeline of the batch calls of all threads to file\n"
+		"           (Chrome trace format, viewable with Perfetto)\n"
+		"  int{i}   Net shape as for -create, default is a grid of shapes\n"
+		"or\n"
+		"%s -verify [-pixels int] [-threads int] [-seed int] [-max<abs|rel|ulp> value] file\n"
+		"  -verify  Switches to verification mode, compares all processing routines\n"
+		"           with Nn_ProcessNet for random inputs within the training ranges\n"
+		"  -pixels  Number of random input vectors (default: 1000000)\n"
+		"  -threads Number of threads (default: all CPUs)\n"
+		"  -seed    Seed of the random inputs (default: 1)\n"
+		"  -max<abs|rel|ulp>  Error limit for all routines, an output fails if both\n"
+		"           the absolute and the relative limit or the ULP limit is exceeded\n"
+		"  file     Name of a NNF input file (ASCII or binary)\n"
+		"or\n"
+		"%s -test [-l int] [-o file] [-m] [-map] [-stream] [-prof] file1 file2\n"
 		"  -test    Switches to NNF test mode\n"
 		"  -o file  Specifies a name for a pattern output file\n"
 		"  -m       Forces in-memory creation of NNF net (for internal tests)\n"
+		"  -map     Loads a binary NNF net through a memory mapping of the file,\n"
+		"           a NNFF 2.0 net as a frozen net using the mapped weights\n"
+		"  -stream  Reads the NNF net as a byte stream, as from a pipe\n"
+		"  -prof    Prints the per-layer profile of the net evaluation and the\n"
+		"           hardware counters of loading and evaluating the net\n"
 		"  -l int   Specifies the number of lines to skip in input pattern file\n"
-		"  file1    Name of a NNF input file (ASCII or binary)\n"
+		"  file1    Name of a NNF input file (ASCII or binary), '-' for the\n"
+		"           standard input\n"
 		"  file2    Name of a pattern input file\n"
+		"or\n"
+		"%s -mem file\n"
+		"  -mem     Prints the memory footprint of the net\n"
+		"  file     Name of a NNF input file (ASCII or binary)\n"
+		"or\n"
+		"%s -batch [-o dir] [-b] [-v2] [-f32] [-z] [-map] [-threads int] path1 path2 ...\n"
+		"  -batch   Switches to batch conversion mode, the nets are loaded and\n"
+		"           written in parallel and the times per net are printed\n"
+		"  -o dir   Specifies a directory for the NNF output files\n"
+		"           (default: the directories of the input files)\n"
+		"  -b, -v2, -f32, -z, -map  As in NNF conversion mode\n"
+		"  -threads Number of threads (default: all CPUs)\n"
+		"  path{i}  Name of a NNF input file, a directory or, prefixed with '@',\n"
+		"           a manifest file listing files and directories line by line.\n"
+		"           Of a directory all *%s files are converted with -b, all\n"
+		"           *%s files otherwise\n"
 		"\n",
 		NNFT_PROGRAM_NAME,
 		NNFT_PROGRAM_NAME,
 		NNFT_PROGRAM_NAME,
 		NNFT_PROGRAM_NAME,
-		NNFT_PROGRAM_NAME
+		NNFT_PROGRAM_NAME,
+		NNFT_PROGRAM_NAME,
+		NNFT_PROGRAM_NAME,
+		NNFT_PROGRAM_NAME,
+		NNFT_PROGRAM_NAME,
+		NN_ASC_EXT,
+		NN_BIN_EXT
 	);
 }
 
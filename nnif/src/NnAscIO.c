@@ -17,7 +17,10 @@
 
 #include "NnBase.h"
 #include "NnCheck.h"
+#include "NnProf.h"
+#include "NnTrace.h"
 #include "NnAscIO.h"
+#include "NnStream.h"
 
 /*////////////////////////////////////////////////////////////////////////////*/
 static const NN_KWENT aKwEntSect[] = 
@@ -36,6 +39,10 @@ static const NN_KWENT aKwEntKey[] =
 	{ NN_KEY_INP_SCALE,   NN_NAME_INP_SCALE   },
 	{ NN_KEY_OUT_BIAS,    NN_NAME_OUT_BIAS    },
 	{ NN_KEY_OUT_SCALE,   NN_NAME_OUT_SCALE   },
+	{ NN_KEY_TRN_FNID,    NN_NAME_TRN_FNID    },
+	{ NN_KEY_TRN_FLAGS,   NN_NAME_TRN_FLAGS   },
+	{ NN_KEY_TRN_MIN,     NN_NAME_TRN_MIN     },
+	{ NN_KEY_TRN_MAX,     NN_NAME_TRN_MAX     },
 	{ NN_KEY_MATRIX,      NN_NAME_MATRIX      },
 	{ NN_KEY_NUM_UNITS,   NN_NAME_NUM_UNITS   },
 	{ NN_KEY_INP_FNID,    NN_NAME_INP_FNID    },
@@ -89,6 +96,15 @@ static const NN_KWENT aKwEntOutFn[] =
 	{ NN_FUNC_LOGARITHMIC, NN_NAME_LOGARITHMIC }
 }; 
 
+/*////////////////////////////////////////////////////////////////////////////*/
+static const NN_KWENT aKwEntTrnFn[] = 
+{
+	{ NN_FUNC_ZERO,        NN_NAME_ZERO        },
+	{ NN_FUNC_IDENTITY,    NN_NAME_IDENTITY    },
+	{ NN_FUNC_EXPONENTIAL, NN_NAME_EXPONENTIAL },
+	{ NN_FUNC_LOGARITHMIC, NN_NAME_LOGARITHMIC }
+}; 
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /*static const size_t nEntSize = sizeof (NN_KWENT);                           */
 #define nEntSize  (sizeof (NN_KWENT))
@@ -98,12 +114,9 @@ static const NN_KWTAB g_tabKey   = { sizeof aKwEntKey   / nEntSize, aKwEntKey };
 static const NN_KWTAB g_tabInpFn = { sizeof aKwEntInpFn / nEntSize, aKwEntInpFn };
 static const NN_KWTAB g_tabActFn = { sizeof aKwEntActFn / nEntSize, aKwEntActFn };
 static const NN_KWTAB g_tabOutFn = { sizeof aKwEntOutFn / nEntSize, aKwEntOutFn };
+static const NN_KWTAB g_tabTrnFn = { sizeof aKwEntTrnFn / nEntSize, aKwEntTrnFn };
 static const NN_KWTAB g_tabPrec  = { sizeof aKwEntPrec  / nEntSize, aKwEntPrec };
 
-/*////////////////////////////////////////////////////////////////////////////*/
-static char  g_pchFilePath [NN_MAX_PATH+1];
-static FILE* g_stream;
-
 /*////////////////////////////////////////////////////////////////////////////*/
 /*                                                                            */
 /*  Nn_ReadAscFile implementation                                             */
@@ -119,19 +132,26 @@ NN_STATUS Nn_CreateNetFromAscFile
 	NN_PNET* ppNet
 )
 {
-	NN_STATUS nns;
+	NN_ASC_SCANNER  scanner;
+	NN_ASC_SCANNER* pScan = &scanner;
+	NN_STATUS       nns;
+	double          dTraceStart;
+	NN_HWPROF_DECL(hwSample)
 
 	assert(pchFilePath != NULL && *pchFilePath != '\0');
 	assert(ppNet != NULL);
 
 	*ppNet = NULL;
 
+	NN_HWPROF_START(hwSample)
+	dTraceStart = Nn_GetTraceTime();
+
 	Nn_ClearError();
 
-	nns = Nn_OpenAscFileScanner(pchFilePath);
+	nns = Nn_OpenAscFileScanner(pScan, pchFilePath);
 	if (nns == NN_OK)
 	{
-		if (Nn_ParseNet(ppNet))
+		if (Nn_ParseNet(pScan, ppNet))
 			nns = NN_OK;
 		else
 			nns = Nn_Error(NN_FILE_READ_ERROR, 
@@ -139,48 +159,74 @@ NN_STATUS Nn_CreateNetFromAscFile
 				Nn_GetNumErrors(), 
 				pchFilePath);
 
-		Nn_CloseAscFileScanner();
+		Nn_CloseAscFileScanner(pScan);
 	}
 
 	if (nns == NN_OK)
 		nns = Nn_AssertSemanticIntegrity(*ppNet, nNumInpUnits, nNumOutUnits);
 
+	/* The counters are reset by Nn_AssertSemanticIntegrity, so count afterwards */
+	if (nns == NN_OK)
+	{
+		NN_HWPROF_STOP(*ppNet, NN_PROF_LOAD, 0, hwSample)
+	}
+
+	Nn_AddTraceSpan("nnif", "load", dTraceStart, -1);
 	return nns;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-static int   g_nSection;
-static int   g_nKey;
-static short g_iL;
-static short g_iU;
+NN_STATUS Nn_ReadAscStreamNet
+(
+	NN_ISTREAM* pIStream,
+	PCSTR       pchName,
+	NN_PNET*    ppNet
+)
+{
+	NN_ASC_SCANNER scanner;
+
+	assert(pIStream != NULL);
+	assert(ppNet != NULL);
 
-BOOL Nn_ParseNet (NN_PNET* ppNet)
+	*ppNet = NULL;
+
+	Nn_OpenAscStreamScanner(&scanner, pIStream, pchName);
+	if (Nn_ParseNet(&scanner, ppNet))
+		return NN_OK;
+	return Nn_Error(NN_FILE_READ_ERROR, 
+		NN_ERR_PREFIX "%d errors in file '%s'", 
+		Nn_GetNumErrors(), 
+		pchName);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+BOOL Nn_ParseNet (NN_ASC_SCANNER* pScan, NN_PNET* ppNet)
 {
-	*ppNet     = NULL;
-	g_nSection = -1;
-	g_nKey     = -1;
-	g_iL       = -1;
-	g_iU       = -1;
+	*ppNet          = NULL;
+	pScan->nSection = -1;
+	pScan->nKey     = -1;
+	pScan->iL       = -1;
+	pScan->iU       = -1;
 	
 	if (Nn_CreateNet(ppNet) != NN_OK)
 		return FALSE;
 	
-	while (Nn_ReadLine())
+	while (Nn_ReadLine(pScan))
 	{
-		if (Nn_ParseTokenOpt(NN_TOK_EOL))
+		if (Nn_ParseTokenOpt(pScan, NN_TOK_EOL))
 			continue;
 
-		if (Nn_ParsePunctuatorOpt('['))
+		if (Nn_ParsePunctuatorOpt(pScan, '['))
 		{
-			if (Nn_ParseSectionHeader(*ppNet))
+			if (Nn_ParseSectionHeader(pScan, *ppNet))
 			{
-				if (Nn_ParsePunctuator(']'))
-					Nn_ParseToken(NN_TOK_EOL);
+				if (Nn_ParsePunctuator(pScan, ']'))
+					Nn_ParseToken(pScan, NN_TOK_EOL);
 			}
 		}
 		else
 		{
-			Nn_ParseSectionEntry(*ppNet);
+			Nn_ParseSectionEntry(pScan, *ppNet);
 		}
 	}
 	
@@ -195,36 +241,36 @@ BOOL Nn_ParseNet (NN_PNET* ppNet)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseSectionHeader(NN_PNET pNet)
+BOOL Nn_ParseSectionHeader(NN_ASC_SCANNER* pScan, NN_PNET pNet)
 {
 	NN_PLAYER pLayer;
 	char szName[NN_MAX_TOKEN+1];
 	short iL, iU;
 
-	if (!Nn_ParseToken(NN_TOK_NAME))
+	if (!Nn_ParseToken(pScan, NN_TOK_NAME))
 		return FALSE;
 
-	Nn_GetToken(szName);
-	g_nSection = Nn_FindKeywordIdent(&g_tabSect, szName);
-	if (g_nSection == -1)
+	Nn_GetToken(pScan, szName);
+	pScan->nSection = Nn_FindKeywordIdent(&g_tabSect, szName);
+	if (pScan->nSection == -1)
 	{
-		Nn_AscReadError("unknown section [%s]", szName);
+		Nn_AscReadError(pScan, "unknown section [%s]", szName);
 		return FALSE;
 	}
 
-	switch (g_nSection)
+	switch (pScan->nSection)
 	{
 	case NN_SECT_NET:
 		return TRUE;
 		break;
 
 	case NN_SECT_LAYER:
-		g_iL = -1;
-		if (!Nn_ParsePunctuator('('))
+		pScan->iL = -1;
+		if (!Nn_ParsePunctuator(pScan, '('))
 			return FALSE;
-		if (!Nn_ParseIndex(-1, &iL))
+		if (!Nn_ParseIndex(pScan, -1, &iL))
 			return FALSE;
-		if (!Nn_ParsePunctuator(')'))
+		if (!Nn_ParsePunctuator(pScan, ')'))
 			return FALSE;
 
 		if (!Nn_LayersCreated(pNet))
@@ -233,22 +279,22 @@ BOOL Nn_ParseSectionHeader(NN_PNET pNet)
 				return FALSE;
 		}
 
-		if (!Nn_CheckLayerIndex(pNet, iL))
+		if (!Nn_CheckLayerIndex(pScan, pNet, iL))
 			return FALSE;
 		
-		g_iL = iL;
+		pScan->iL = iL;
 		break;
 
 	case NN_SECT_UNIT:
-		if (!Nn_ParsePunctuator('('))
+		if (!Nn_ParsePunctuator(pScan, '('))
 			return FALSE;
-		if (!Nn_ParseIndex(-1, &iL))
+		if (!Nn_ParseIndex(pScan, -1, &iL))
 			return FALSE;
-		if (!Nn_ParsePunctuator(','))
+		if (!Nn_ParsePunctuator(pScan, ','))
 			return FALSE;
-		if (!Nn_ParseIndex(-1, &iU))
+		if (!Nn_ParseIndex(pScan, -1, &iU))
 			return FALSE;
-		if (!Nn_ParsePunctuator(')'))
+		if (!Nn_ParsePunctuator(pScan, ')'))
 			return FALSE;
 
 		if (!Nn_LayersCreated(pNet))
@@ -256,7 +302,7 @@ BOOL Nn_ParseSectionHeader(NN_PNET pNet)
 			if (Nn_CreateLayers(pNet) != NN_OK)
 				return FALSE;
 		}
-		if (!Nn_CheckLayerIndex(pNet, iL))
+		if (!Nn_CheckLayerIndex(pScan, pNet, iL))
 			return FALSE;
 		pLayer = Nn_GetLayerAt(pNet, iL);
 
@@ -265,11 +311,11 @@ BOOL Nn_ParseSectionHeader(NN_PNET pNet)
 			if (Nn_CreateUnits(pLayer) != NN_OK)
 				return FALSE;
 		}
-		if (!Nn_CheckUnitIndex(pLayer, iU))
+		if (!Nn_CheckUnitIndex(pScan, pLayer, iU))
 			return FALSE;
 
-		g_iL = iL;
-		g_iU = iU;
+		pScan->iL = iL;
+		pScan->iU = iU;
 		break;
 	}
 
@@ -277,33 +323,33 @@ BOOL Nn_ParseSectionHeader(NN_PNET pNet)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseSectionEntry(NN_PNET pNet)
+BOOL Nn_ParseSectionEntry(NN_ASC_SCANNER* pScan, NN_PNET pNet)
 {
 	char szName[NN_MAX_TOKEN+1];
 
-	if (!Nn_ParseToken(NN_TOK_NAME))
+	if (!Nn_ParseToken(pScan, NN_TOK_NAME))
 		return FALSE;
 
-	Nn_GetToken(szName);
-	g_nKey = Nn_FindKeywordIdent(&g_tabKey, szName);
-	if (g_nKey == -1)
+	Nn_GetToken(pScan, szName);
+	pScan->nKey = Nn_FindKeywordIdent(&g_tabKey, szName);
+	if (pScan->nKey == -1)
 	{
-		Nn_AscReadError("unknown key '%s'", szName);
+		Nn_AscReadError(pScan, "unknown key '%s'", szName);
 		return FALSE;
 	}
 
-	switch (g_nSection)
+	switch (pScan->nSection)
 	{
 	case NN_SECT_NET:
-		return Nn_ParseNetSectionEntry(pNet);
+		return Nn_ParseNetSectionEntry(pScan, pNet);
 	case NN_SECT_LAYER:
-		if (g_iL >= 0)
-			return Nn_ParseLayerSectionEntry(pNet);
+		if (pScan->iL >= 0)
+			return Nn_ParseLayerSectionEntry(pScan, pNet);
 		else
 			return FALSE;
 	case NN_SECT_UNIT:
-		if (g_iL >= 0 && g_iU >= 0)
-			return Nn_ParseUnitSectionEntry(pNet);
+		if (pScan->iL >= 0 && pScan->iU >= 0)
+			return Nn_ParseUnitSectionEntry(pScan, pNet);
 		else
 			return FALSE;
 	}
@@ -312,86 +358,94 @@ BOOL Nn_ParseSectionEntry(NN_PNET pNet)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseNetSectionEntry(NN_PNET pNet)
+BOOL Nn_ParseNetSectionEntry(NN_ASC_SCANNER* pScan, NN_PNET pNet)
 {
-	switch (g_nKey)
+	switch (pScan->nKey)
 	{
 	case NN_KEY_NUM_LAYERS:
-		return Nn_ParseCountAssign(1, 256, &pNet->na.nNumLayers);
+		return Nn_ParseCountAssign(pScan, 1, 256, &pNet->na.nNumLayers);
 	case NN_KEY_MAJ_VERSION:
-		return Nn_ParseCountAssign(1, 10, &pNet->na.anVersion[0]);
+		return Nn_ParseCountAssign(pScan, 1, 10, &pNet->na.anVersion[0]);
 	case NN_KEY_MIN_VERSION:
-		return Nn_ParseCountAssign(0, 10, &pNet->na.anVersion[1]);
+		return Nn_ParseCountAssign(pScan, 0, 10, &pNet->na.anVersion[1]);
 	case NN_KEY_INP_LAYER:
-		return Nn_ParseIndexAssign(pNet->na.nNumLayers, &pNet->na.iInpLayer);
+		return Nn_ParseIndexAssign(pScan, pNet->na.nNumLayers, &pNet->na.iInpLayer);
 	case NN_KEY_OUT_LAYER:  
-		return Nn_ParseIndexAssign(pNet->na.nNumLayers, &pNet->na.iOutLayer);
+		return Nn_ParseIndexAssign(pScan, pNet->na.nNumLayers, &pNet->na.iOutLayer);
 	case NN_KEY_PRECISION: 
-		return Nn_ParseKeywordAssign(&g_tabPrec, &pNet->na.nPrecision);
+		return Nn_ParseKeywordAssign(pScan, &g_tabPrec, &pNet->na.nPrecision);
 	default:
-		Nn_AscReadError("key is not allowed here");
+		Nn_AscReadError(pScan, "key is not allowed here");
 	}
 
 	return FALSE;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseLayerSectionEntry(NN_PNET pNet)
+BOOL Nn_ParseLayerSectionEntry(NN_ASC_SCANNER* pScan, NN_PNET pNet)
 {
-	NN_PLAYER pLayer = Nn_GetLayerAt(pNet, g_iL);
+	NN_PLAYER pLayer = Nn_GetLayerAt(pNet, pScan->iL);
 
-	switch (g_nKey)
+	switch (pScan->nKey)
 	{
 	case NN_KEY_NUM_UNITS:
-		return Nn_ParseCountAssign(0, 32000, &pLayer->la.nNumUnits);
+		return Nn_ParseCountAssign(pScan, 0, 32000, &pLayer->la.nNumUnits);
 	case NN_KEY_INP_FNID:
-		return Nn_ParseKeywordAssign(&g_tabInpFn, &pLayer->la.nInpFnId);
+		return Nn_ParseKeywordAssign(pScan, &g_tabInpFn, &pLayer->la.nInpFnId);
 	case NN_KEY_ACT_FNID:
-		return Nn_ParseKeywordAssign(&g_tabActFn, &pLayer->la.nActFnId);
+		return Nn_ParseKeywordAssign(pScan, &g_tabActFn, &pLayer->la.nActFnId);
 	case NN_KEY_OUT_FNID:
-		return Nn_ParseKeywordAssign(&g_tabOutFn, &pLayer->la.nOutFnId);
+		return Nn_ParseKeywordAssign(pScan, &g_tabOutFn, &pLayer->la.nOutFnId);
 	case NN_KEY_ACT_SLOPE:
-		return Nn_ParseFloatAssign(&pLayer->la.fActSlope);
+		return Nn_ParseFloatAssign(pScan, &pLayer->la.fActSlope);
 	case NN_KEY_ACT_THRES:
-		return Nn_ParseFloatAssign(&pLayer->la.fActThres);
+		return Nn_ParseFloatAssign(pScan, &pLayer->la.fActThres);
 	default:
-		Nn_AscReadError("key is not allowed here");
+		Nn_AscReadError(pScan, "key is not allowed here");
 	}
 
 	return FALSE;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseUnitSectionEntry(NN_PNET pNet)
+BOOL Nn_ParseUnitSectionEntry(NN_ASC_SCANNER* pScan, NN_PNET pNet)
 {
-	NN_PLAYER pLayer = Nn_GetLayerAt(pNet, g_iL);
-	NN_PUNIT  pUnit  = Nn_GetUnitAt(pLayer, g_iU);
+	NN_PLAYER pLayer = Nn_GetLayerAt(pNet, pScan->iL);
+	NN_PUNIT  pUnit  = Nn_GetUnitAt(pLayer, pScan->iU);
 
-	switch (g_nKey)
+	switch (pScan->nKey)
 	{
 	case NN_KEY_NUM_CONNS:
-		return Nn_ParseCountAssign(0, 32000, &pUnit->ua.nNumConns);
+		return Nn_ParseCountAssign(pScan, 0, 32000, &pUnit->ua.nNumConns);
 	case NN_KEY_INP_BIAS:
-		return Nn_ParseFloatAssign(&pUnit->ua.fInpBias);
+		return Nn_ParseFloatAssign(pScan, &pUnit->ua.fInpBias);
 	case NN_KEY_INP_SCALE:
-		return Nn_ParseFloatAssign(&pUnit->ua.fInpScale);
+		return Nn_ParseFloatAssign(pScan, &pUnit->ua.fInpScale);
 	case NN_KEY_OUT_BIAS:
-		return Nn_ParseFloatAssign(&pUnit->ua.fOutBias);
+		return Nn_ParseFloatAssign(pScan, &pUnit->ua.fOutBias);
 	case NN_KEY_OUT_SCALE:
-		return Nn_ParseFloatAssign(&pUnit->ua.fOutScale);
+		return Nn_ParseFloatAssign(pScan, &pUnit->ua.fOutScale);
+	case NN_KEY_TRN_FNID:
+		return Nn_ParseKeywordAssign(pScan, &g_tabTrnFn, &pUnit->ua.nTrnFnId);
+	case NN_KEY_TRN_FLAGS:
+		return Nn_ParseShortAssign(pScan, &pUnit->ua.nTrnFlags);
+	case NN_KEY_TRN_MIN:
+		return Nn_ParseFloatAssign(pScan, &pUnit->ua.fTrnMin);
+	case NN_KEY_TRN_MAX:
+		return Nn_ParseFloatAssign(pScan, &pUnit->ua.fTrnMax);
 	case NN_KEY_CONNECTION:
-		return Nn_ParseConnEntryAssign(pNet, pUnit);
+		return Nn_ParseConnEntryAssign(pScan, pNet, pUnit);
 	case NN_KEY_MATRIX:
-		return Nn_ParseMatrixEntryAssign(pNet, pUnit);
+		return Nn_ParseMatrixEntryAssign(pScan, pNet, pUnit);
 	default:
-		Nn_AscReadError("key is not allowed here");
+		Nn_AscReadError(pScan, "key is not allowed here");
 	}
 
 	return FALSE;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseConnEntryAssign(const NN_PNET pNet, NN_PUNIT pUnit)
+BOOL Nn_ParseConnEntryAssign(NN_ASC_SCANNER* pScan, const NN_PNET pNet, NN_PUNIT pUnit)
 {
 	short iC;
 	NN_CONN c;
@@ -402,30 +456,30 @@ BOOL Nn_ParseConnEntryAssign(const NN_PNET pNet, NN_PUNIT pUnit)
 			return FALSE;
 	}
 
-	if (!Nn_ParsePunctuator('('))
+	if (!Nn_ParsePunctuator(pScan, '('))
 		return FALSE;
-	if (!Nn_ParseIndex(-1, &iC))
+	if (!Nn_ParseIndex(pScan, -1, &iC))
 		return FALSE;
-	if (!Nn_ParsePunctuator(')'))
+	if (!Nn_ParsePunctuator(pScan, ')'))
 		return FALSE;
-	if (!Nn_ParsePunctuator('='))
+	if (!Nn_ParsePunctuator(pScan, '='))
 		return FALSE;
-	if (!Nn_ParseIndex(-1, &c.ca.iLayer))
+	if (!Nn_ParseIndex(pScan, -1, &c.ca.iLayer))
 		return FALSE;
-	if (!Nn_ParsePunctuator(','))
+	if (!Nn_ParsePunctuator(pScan, ','))
 		return FALSE;
-	if (!Nn_ParseIndex(-1, &c.ca.iUnit))
+	if (!Nn_ParseIndex(pScan, -1, &c.ca.iUnit))
 		return FALSE;
-	if (!Nn_ParsePunctuator(','))
+	if (!Nn_ParsePunctuator(pScan, ','))
 		return FALSE;
-	if (!Nn_ParseFloat(&c.ca.fWeight))
+	if (!Nn_ParseFloat(pScan, &c.ca.fWeight))
 		return FALSE;
 	
-	if (!Nn_CheckConnIndex(pUnit, iC))
+	if (!Nn_CheckConnIndex(pScan, pUnit, iC))
 		return FALSE;
-	if (!Nn_CheckLayerIndex(pNet, c.ca.iLayer))
+	if (!Nn_CheckLayerIndex(pScan, pNet, c.ca.iLayer))
 		return FALSE;
-	if (!Nn_CheckUnitIndex(Nn_GetLayerAt(pNet, c.ca.iLayer), c.ca.iUnit))
+	if (!Nn_CheckUnitIndex(pScan, Nn_GetLayerAt(pNet, c.ca.iLayer), c.ca.iUnit))
 		return FALSE;
 
 	c.pUnit = Nn_GetUnitAt(Nn_GetLayerAt(pNet, c.ca.iLayer), c.ca.iUnit);
@@ -434,7 +488,7 @@ BOOL Nn_ParseConnEntryAssign(const NN_PNET pNet, NN_PUNIT pUnit)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseMatrixEntryAssign(const NN_PNET pNet, NN_PUNIT pUnit)
+BOOL Nn_ParseMatrixEntryAssign(NN_ASC_SCANNER* pScan, const NN_PNET pNet, NN_PUNIT pUnit)
 {
 	short iC1, iC2;
 	NN_FLOAT fM;
@@ -445,24 +499,24 @@ BOOL Nn_ParseMatrixEntryAssign(const NN_PNET pNet, NN_PUNIT pUnit)
 			return FALSE;
 	}
 
-	if (!Nn_ParsePunctuator('('))
+	if (!Nn_ParsePunctuator(pScan, '('))
 		return FALSE;
-	if (!Nn_ParseIndex(pUnit->ua.nNumConns, &iC1))
+	if (!Nn_ParseIndex(pScan, pUnit->ua.nNumConns, &iC1))
 		return FALSE;
-	if (!Nn_ParsePunctuator(','))
+	if (!Nn_ParsePunctuator(pScan, ','))
 		return FALSE;
-	if (!Nn_ParseIndex(pUnit->ua.nNumConns, &iC2))
+	if (!Nn_ParseIndex(pScan, pUnit->ua.nNumConns, &iC2))
 		return FALSE;
-	if (!Nn_ParsePunctuator(')'))
+	if (!Nn_ParsePunctuator(pScan, ')'))
 		return FALSE;
-	if (!Nn_ParsePunctuator('='))
+	if (!Nn_ParsePunctuator(pScan, '='))
 		return FALSE;
-	if (!Nn_ParseFloat(&fM))
+	if (!Nn_ParseFloat(pScan, &fM))
 		return FALSE;
 
-	if (!Nn_CheckConnIndex(pUnit, iC1))
+	if (!Nn_CheckConnIndex(pScan, pUnit, iC1))
 		return FALSE;
-	if (!Nn_CheckConnIndex(pUnit, iC2))
+	if (!Nn_CheckConnIndex(pScan, pUnit, iC2))
 		return FALSE;
 
 	Nn_SetMatrixElemAt(pUnit, iC1, iC2, fM);
@@ -470,31 +524,31 @@ BOOL Nn_ParseMatrixEntryAssign(const NN_PNET pNet, NN_PUNIT pUnit)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseKeywordAssign(const NN_KWTAB* pTab, short* pnKwId)
+BOOL Nn_ParseKeywordAssign(NN_ASC_SCANNER* pScan, const NN_KWTAB* pTab, short* pnKwId)
 {
 	int nKwId;
 
-	if (!Nn_ParsePunctuator('='))
+	if (!Nn_ParsePunctuator(pScan, '='))
 		return FALSE;
 
-	if (Nn_ParseTokenOpt(NN_TOK_NAME))
+	if (Nn_ParseTokenOpt(pScan, NN_TOK_NAME))
 	{
 		char szName[NN_MAX_LINE+1];
-		Nn_GetToken(szName);
+		Nn_GetToken(pScan, szName);
 
 		nKwId = Nn_FindKeywordIdent(pTab, szName);
 		if (nKwId == -1)
 		{
-			Nn_AscReadError("invalid keyword '%s'", szName);
+			Nn_AscReadError(pScan, "invalid keyword '%s'", szName);
 			return FALSE;
 		}
 	}
-	else if (Nn_ParseToken(NN_TOK_INT))
+	else if (Nn_ParseToken(pScan, NN_TOK_INT))
 	{
-		nKwId = Nn_GetTokenValInt();
+		nKwId = Nn_GetTokenValInt(pScan);
 		if (Nn_FindKeywordName(pTab, nKwId) == NULL)
 		{
-			Nn_AscReadError("invalid identifier (ID=%d)", nKwId);
+			Nn_AscReadError(pScan, "invalid identifier (ID=%d)", nKwId);
 			return FALSE;
 		}
 	}
@@ -506,101 +560,101 @@ BOOL Nn_ParseKeywordAssign(const NN_KWTAB* pTab, short* pnKwId)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseFloat(NN_FLOAT* pf)
+BOOL Nn_ParseFloat(NN_ASC_SCANNER* pScan, NN_FLOAT* pf)
 {
-	if (!Nn_ParseTokenOpt(NN_TOK_INT))
+	if (!Nn_ParseTokenOpt(pScan, NN_TOK_INT))
 	{
-		if (!Nn_ParseToken(NN_TOK_FLOAT))
+		if (!Nn_ParseToken(pScan, NN_TOK_FLOAT))
 			return FALSE;
-		*pf = (NN_FLOAT) Nn_GetTokenValFloat();
+		*pf = (NN_FLOAT) Nn_GetTokenValFloat(pScan);
 	}
 	else
-		*pf = (NN_FLOAT) Nn_GetTokenValInt();
+		*pf = (NN_FLOAT) Nn_GetTokenValInt(pScan);
 	return TRUE;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseFloatAssign(NN_FLOAT* pf)
+BOOL Nn_ParseFloatAssign(NN_ASC_SCANNER* pScan, NN_FLOAT* pf)
 {
-	if (!Nn_ParsePunctuator('='))
+	if (!Nn_ParsePunctuator(pScan, '='))
 		return FALSE;
-	return Nn_ParseFloat(pf);
+	return Nn_ParseFloat(pScan, pf);
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseShort(short* ps)
+BOOL Nn_ParseShort(NN_ASC_SCANNER* pScan, short* ps)
 {
-	if (!Nn_ParseToken(NN_TOK_INT))
+	if (!Nn_ParseToken(pScan, NN_TOK_INT))
 		return FALSE;
-	*ps = (short) Nn_GetTokenValInt();
+	*ps = (short) Nn_GetTokenValInt(pScan);
 	return TRUE;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseShortAssign(short* ps)
+BOOL Nn_ParseShortAssign(NN_ASC_SCANNER* pScan, short* ps)
 {
-	if (!Nn_ParsePunctuator('='))
+	if (!Nn_ParsePunctuator(pScan, '='))
 		return FALSE;
-	return Nn_ParseShort(ps);
+	return Nn_ParseShort(pScan, ps);
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseCount(short sMin, short sMax, short* ps)
+BOOL Nn_ParseCount(NN_ASC_SCANNER* pScan, short sMin, short sMax, short* ps)
 {
-	if (!Nn_ParseShort(ps))
+	if (!Nn_ParseShort(pScan, ps))
 		return FALSE;
 	if (sMin >= 0 && *ps < sMin)
 	{
-		Nn_AscReadError("integer must be less than %d", sMin);
+		Nn_AscReadError(pScan, "integer must be less than %d", sMin);
 		return FALSE;
 	}
 	else if (sMax >= 0 && *ps > sMax)
 	{
-		Nn_AscReadError("integer must be greater than %d", sMax);
+		Nn_AscReadError(pScan, "integer must be greater than %d", sMax);
 		return FALSE;
 	}
 	return TRUE;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseCountAssign(short sMin, short sMax, short* ps)
+BOOL Nn_ParseCountAssign(NN_ASC_SCANNER* pScan, short sMin, short sMax, short* ps)
 {
-	if (!Nn_ParsePunctuator('='))
+	if (!Nn_ParsePunctuator(pScan, '='))
 		return FALSE;
-	return Nn_ParseCount(sMin, sMax, ps);
+	return Nn_ParseCount(pScan, sMin, sMax, ps);
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseIndex(short sMax, short* ps)
+BOOL Nn_ParseIndex(NN_ASC_SCANNER* pScan, short sMax, short* ps)
 {
-	if (!Nn_ParseCount(1, sMax, ps))
+	if (!Nn_ParseCount(pScan, 1, sMax, ps))
 		return FALSE;
 	(*ps)--;
 	return TRUE;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseIndexAssign(short sMax, short* ps)
+BOOL Nn_ParseIndexAssign(NN_ASC_SCANNER* pScan, short sMax, short* ps)
 {
-	if (!Nn_ParsePunctuator('='))
+	if (!Nn_ParsePunctuator(pScan, '='))
 		return FALSE;
-	return Nn_ParseIndex(sMax, ps);
+	return Nn_ParseIndex(pScan, sMax, ps);
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_CheckLayerIndex(const NN_PNET pNet, int iL)
+BOOL Nn_CheckLayerIndex(NN_ASC_SCANNER* pScan, const NN_PNET pNet, int iL)
 {	
 	assert(pNet != NULL);
 
 	if (pNet->na.nNumLayers <= 0 || pNet->aLayers == NULL)
 	{
-		Nn_AscReadError("Layer(%d): missing layer definition", iL+1);
+		Nn_AscReadError(pScan, "Layer(%d): missing layer definition", iL+1);
 		return FALSE;
 	}
 	
 	if (iL < 0 || iL >= pNet->na.nNumLayers)
 	{
-		Nn_AscReadError("Layer(%d): layer index out of range", iL+1);
+		Nn_AscReadError(pScan, "Layer(%d): layer index out of range", iL+1);
 		return FALSE;
 	}
 
@@ -608,19 +662,19 @@ BOOL Nn_CheckLayerIndex(const NN_PNET pNet, int iL)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_CheckUnitIndex(const NN_PLAYER pLayer, int iU)
+BOOL Nn_CheckUnitIndex(NN_ASC_SCANNER* pScan, const NN_PLAYER pLayer, int iU)
 {	
 	assert(pLayer != NULL);
 
 	if (pLayer->la.nNumUnits <= 0 || pLayer->aUnits == NULL)
 	{
-		Nn_AscReadError("Unit(%d): missing unit definition", iU+1);
+		Nn_AscReadError(pScan, "Unit(%d): missing unit definition", iU+1);
 		return FALSE;
 	}
 	
 	if (iU < 0 || iU >= pLayer->la.nNumUnits)
 	{
-		Nn_AscReadError("Unit(%d): unit index out of range", iU+1);
+		Nn_AscReadError(pScan, "Unit(%d): unit index out of range", iU+1);
 		return FALSE;
 	}
 
@@ -628,19 +682,19 @@ BOOL Nn_CheckUnitIndex(const NN_PLAYER pLayer, int iU)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_CheckConnIndex(const NN_PUNIT pUnit, int iC)
+BOOL Nn_CheckConnIndex(NN_ASC_SCANNER* pScan, const NN_PUNIT pUnit, int iC)
 {	
 	assert(pUnit != NULL);
 
 	if (pUnit->ua.nNumConns <= 0 || pUnit->aConns == NULL)
 	{
-		Nn_AscReadError("C(%d): missing connection definition", iC+1);
+		Nn_AscReadError(pScan, "C(%d): missing connection definition", iC+1);
 		return FALSE;
 	}
 	
 	if (iC < 0 || iC >= pUnit->ua.nNumConns)
 	{
-		Nn_AscReadError("C(%d): connection index out of range", iC+1);
+		Nn_AscReadError(pScan, "C(%d): connection index out of range", iC+1);
 		return FALSE;
 	}
 
@@ -672,9 +726,8 @@ PCSTR Nn_FindKeywordName(const NN_KWTAB* pTab, int nKwId)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-PCSTR Nn_GetPrintKeyword(const NN_KWTAB* pTab, int nKwId)
+PCSTR Nn_GetPrintKeyword(const NN_KWTAB* pTab, int nKwId, char pchName[256])
 {
-	static char pchName[256];
 	int i;
 	for (i = 0; i < pTab->nSize; i++)
 	{
@@ -700,63 +753,68 @@ int Nn_CompareKw(PCSTR pstr1, PCSTR pstr2)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-static char      g_pchLine [NN_MAX_LINE+1];
-static PCSTR     g_pchCur;
-static PCSTR     g_pchToken;
-static int       g_nTokenLen;
-static NN_TOKEN  g_nTokenId;
-static BOOL      g_bTokenConsumed;
-static double    g_dTokenVal;
-static long      g_lTokenVal;
-static int       g_nLineNo;
-static int       g_nNumErrors;
-
-#define Nn_ConsumeToken() (g_bTokenConsumed = TRUE)
-#define Nn_GetTokenId()   (g_nTokenId)
-#define Nn_PeekChar()     (*g_pchCur)
-#define Nn_ConsumeChar()  (++g_pchCur)
-#define Nn_PeekBinary()   (*g_pchCur >= 0 && *g_pchCur < 32 || *g_pchCur == 127)
-
-long   Nn_GetTokenValInt ()   { return g_lTokenVal; }
-double Nn_GetTokenValFloat () { return g_dTokenVal; }
+#define Nn_ConsumeToken(pScan) ((pScan)->bTokenConsumed = TRUE)
+#define Nn_GetTokenId(pScan)   ((pScan)->nTokenId)
+#define Nn_PeekChar(pScan)     (*(pScan)->pchCur)
+#define Nn_ConsumeChar(pScan)  (++(pScan)->pchCur)
+#define Nn_PeekBinary(pScan)   (*(pScan)->pchCur >= 0 && *(pScan)->pchCur < 32 || *(pScan)->pchCur == 127)
+
+long   Nn_GetTokenValInt (const NN_ASC_SCANNER* pScan)   { return pScan->lTokenVal; }
+double Nn_GetTokenValFloat (const NN_ASC_SCANNER* pScan) { return pScan->dTokenVal; }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-NN_STATUS Nn_OpenAscFileScanner (PCSTR pchFilePath)
+NN_STATUS Nn_OpenAscFileScanner (NN_ASC_SCANNER* pScan, PCSTR pchFilePath)
 {
-	strncpy(g_pchFilePath, pchFilePath, NN_MAX_PATH);
-	g_pchFilePath[NN_MAX_PATH] = '\0';
+	Nn_InitAscScanner(pScan, pchFilePath);
 
-	g_stream = fopen(pchFilePath, "r");
-	if (g_stream == NULL)
+	pScan->stream = fopen(pchFilePath, "r");
+	if (pScan->stream == NULL)
 		return Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't open file '%s'", pchFilePath);
 
-	g_pchLine[0]     = '\0';
-	g_pchCur         = g_pchLine;
-	g_pchToken       = g_pchLine;
-	g_nTokenLen      = 0;
-	g_nTokenId       = NN_TOK_EOL;
-	g_bTokenConsumed = TRUE;
-	g_dTokenVal      = 0.0;
-	g_lTokenVal      = 0;
-	g_nLineNo        = 0;
-	g_nNumErrors     = 0;
-
 	return NN_OK;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-void Nn_CloseAscFileScanner ()
+void Nn_OpenAscStreamScanner (NN_ASC_SCANNER* pScan, NN_ISTREAM* pIStream, PCSTR pchName)
+{
+	Nn_InitAscScanner(pScan, pchName);
+
+	pScan->pIStream = pIStream;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+void Nn_InitAscScanner (NN_ASC_SCANNER* pScan, PCSTR pchFilePath)
+{
+	strncpy(pScan->pchFilePath, pchFilePath, NN_MAX_PATH);
+	pScan->pchFilePath[NN_MAX_PATH] = '\0';
+
+	pScan->stream         = NULL;
+	pScan->pIStream       = NULL;
+	pScan->pchLine[0]     = '\0';
+	pScan->pchCur         = pScan->pchLine;
+	pScan->pchToken       = pScan->pchLine;
+	pScan->nTokenLen      = 0;
+	pScan->nTokenId       = NN_TOK_EOL;
+	pScan->bTokenConsumed = TRUE;
+	pScan->dTokenVal      = 0.0;
+	pScan->lTokenVal      = 0;
+	pScan->nLineNo        = 0;
+	pScan->nNumErrors     = 0;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+void Nn_CloseAscFileScanner (NN_ASC_SCANNER* pScan)
 {
-	fclose(g_stream);
-	g_stream = NULL;
+	fclose(pScan->stream);
+	pScan->stream = NULL;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParsePunctuatorOpt (int ch)
+BOOL Nn_ParsePunctuatorOpt (NN_ASC_SCANNER* pScan, int ch)
 {
-	if (Nn_ScanToken() == NN_TOK_PUNCT && g_pchToken[0] == ch)
+	if (Nn_ScanToken(pScan) == NN_TOK_PUNCT && pScan->pchToken[0] == ch)
 	{
-		Nn_ConsumeToken();
+		Nn_ConsumeToken(pScan);
 		return TRUE;
 	}
 	else
@@ -764,41 +822,41 @@ BOOL Nn_ParsePunctuatorOpt (int ch)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParsePunctuator (int ch)
+BOOL Nn_ParsePunctuator (NN_ASC_SCANNER* pScan, int ch)
 {
-	if (Nn_ScanToken() == NN_TOK_PUNCT && g_pchToken[0] == ch)
+	if (Nn_ScanToken(pScan) == NN_TOK_PUNCT && pScan->pchToken[0] == ch)
 	{
-		Nn_ConsumeToken();
+		Nn_ConsumeToken(pScan);
 		return TRUE;
 	}
 	else
 	{
-		if (Nn_GetTokenId() == NN_TOK_EOL)
+		if (Nn_GetTokenId(pScan) == NN_TOK_EOL)
 		{
-			Nn_AscReadError("'%c' expected, but found %s", 
+			Nn_AscReadError(pScan, "'%c' expected, but found %s", 
 				ch, 
-				Nn_GetTokenName(Nn_GetTokenId()));
+				Nn_GetTokenName(Nn_GetTokenId(pScan)));
 		}
 		else
 		{
 			char szToken[NN_MAX_TOKEN+1];
-			Nn_GetToken(szToken);
-			Nn_AscReadError("'%c' expected, but found %s '%s'", 
+			Nn_GetToken(pScan, szToken);
+			Nn_AscReadError(pScan, "'%c' expected, but found %s '%s'", 
 				ch, 
-				Nn_GetTokenName(Nn_GetTokenId()), 
+				Nn_GetTokenName(Nn_GetTokenId(pScan)), 
 				szToken);
 		}
-		Nn_ConsumeToken();
+		Nn_ConsumeToken(pScan);
 		return FALSE;
 	}
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseTokenOpt (NN_TOKEN nTokenId)
+BOOL Nn_ParseTokenOpt (NN_ASC_SCANNER* pScan, NN_TOKEN nTokenId)
 {
-	if (Nn_ScanToken() == nTokenId)
+	if (Nn_ScanToken(pScan) == nTokenId)
 	{
-		Nn_ConsumeToken();
+		Nn_ConsumeToken(pScan);
 		return TRUE;
 	}
 	else
@@ -806,166 +864,166 @@ BOOL Nn_ParseTokenOpt (NN_TOKEN nTokenId)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ParseToken (NN_TOKEN nTokenId)
+BOOL Nn_ParseToken (NN_ASC_SCANNER* pScan, NN_TOKEN nTokenId)
 {
-	if (Nn_ScanToken() == nTokenId)
+	if (Nn_ScanToken(pScan) == nTokenId)
 	{
-		Nn_ConsumeToken();
+		Nn_ConsumeToken(pScan);
 		return TRUE;
 	}
 	else
 	{
-		if (Nn_GetTokenId() == NN_TOK_EOL)
+		if (Nn_GetTokenId(pScan) == NN_TOK_EOL)
 		{
-			Nn_AscReadError("%s expected, but found %s", 
+			Nn_AscReadError(pScan, "%s expected, but found %s", 
 				Nn_GetTokenName(nTokenId), 
-				Nn_GetTokenName(Nn_GetTokenId()));
+				Nn_GetTokenName(Nn_GetTokenId(pScan)));
 		}
 		else
 		{
 			char szToken[NN_MAX_TOKEN+1];
-			Nn_GetToken(szToken);
-			Nn_AscReadError("%s expected, but found %s '%s'", 
+			Nn_GetToken(pScan, szToken);
+			Nn_AscReadError(pScan, "%s expected, but found %s '%s'", 
 				Nn_GetTokenName(nTokenId), 
-				Nn_GetTokenName(Nn_GetTokenId()), 
+				Nn_GetTokenName(Nn_GetTokenId(pScan)), 
 				szToken);
 		}
-		Nn_ConsumeToken();
+		Nn_ConsumeToken(pScan);
 		return FALSE;
 	}
 }
 
 
 /*////////////////////////////////////////////////////////////////////////////*/
-NN_TOKEN Nn_ScanToken()
+NN_TOKEN Nn_ScanToken(NN_ASC_SCANNER* pScan)
 {
-	if (!g_bTokenConsumed)
-		return g_nTokenId;
+	if (!pScan->bTokenConsumed)
+		return pScan->nTokenId;
 
 	/* Go to the next token... */
-	Nn_ReadChar();
-	g_pchToken  = g_pchCur;
+	Nn_ReadChar(pScan);
+	pScan->pchToken  = pScan->pchCur;
 	/* Initialize the new token string length to zero: */
-	g_nTokenLen = 0;
+	pScan->nTokenLen = 0;
 	/* The next token is not yet consumed */
-	g_bTokenConsumed = FALSE;
+	pScan->bTokenConsumed = FALSE;
 	/* Set the token type to undefined */
-	g_nTokenId  = NN_TOK_EOL;
+	pScan->nTokenId  = NN_TOK_EOL;
 
 	/* Alphabetic or underscore character gives notice of */
 	/* the beginning of a name:                          */
 	/*                                                   */
-	if (isalpha(Nn_PeekChar()) || Nn_PeekChar() == '_')
+	if (isalpha(Nn_PeekChar(pScan)) || Nn_PeekChar(pScan) == '_')
 	{
-		g_nTokenId = NN_TOK_NAME;
+		pScan->nTokenId = NN_TOK_NAME;
 
 		do 
 		{
-			Nn_ConsumeChar();
+			Nn_ConsumeChar(pScan);
 		} 
-		while (isalnum(Nn_PeekChar()) || Nn_PeekChar() == '_');
+		while (isalnum(Nn_PeekChar(pScan)) || Nn_PeekChar(pScan) == '_');
 	}
 
 	/* A digit indicates the beginning of a either an integer */
 	/* or NN_FLOATing point constant                         */
 	/*                                                       */
 	else if (
-		isdigit(Nn_PeekChar()) || 
-		Nn_PeekChar() == '.' || 
-		Nn_PeekChar() == '+' || 
-		Nn_PeekChar() == '-')
+		isdigit(Nn_PeekChar(pScan)) || 
+		Nn_PeekChar(pScan) == '.' || 
+		Nn_PeekChar(pScan) == '+' || 
+		Nn_PeekChar(pScan) == '-')
 	{
 		PSTR pchD, pchL;
 
-		g_dTokenVal = strtod(g_pchCur, &pchD);
-		g_lTokenVal = strtol(g_pchCur, &pchL, 0);
+		pScan->dTokenVal = strtod(pScan->pchCur, &pchD);
+		pScan->lTokenVal = strtol(pScan->pchCur, &pchL, 0);
 
-		if (pchD > g_pchCur && pchD > pchL)
+		if (pchD > pScan->pchCur && pchD > pchL)
 		{
-			g_nTokenId = NN_TOK_FLOAT;
-			g_pchCur   = pchD;
+			pScan->nTokenId = NN_TOK_FLOAT;
+			pScan->pchCur   = pchD;
 		}
-		else if (pchL > g_pchCur && pchL >= pchD)
+		else if (pchL > pScan->pchCur && pchL >= pchD)
 		{
-			g_nTokenId = NN_TOK_INT;
-			g_pchCur   = pchL;
+			pScan->nTokenId = NN_TOK_INT;
+			pScan->pchCur   = pchL;
 		}
 		else
 		{
-			g_nTokenId = NN_TOK_PUNCT;
-			Nn_ConsumeChar();
+			pScan->nTokenId = NN_TOK_PUNCT;
+			Nn_ConsumeChar(pScan);
 		}
 	}
 
 #if 0
 	/* String literal delimitter */
 	/*                          */
-	else if (Nn_PeekChar() == '\"')
+	else if (Nn_PeekChar(pScan) == '\"')
 	{
-		g_nTokenId = NN_TOK_STRING;
-		g_sTokenVal.Empty();
+		pScan->nTokenId = NN_TOK_STRING;
+		pScan->sTokenVal.Empty();
 
 		/* Scan the complete name until the end of file is repched */
 		/* or the next string delimitter is found:                 */
 		for (;;)
 		{
-			Nn_ConsumeChar();
-			g_lTokenVal = Nn_PeekChar();
-			if (g_lTokenVal == '\"')
+			Nn_ConsumeChar(pScan);
+			pScan->lTokenVal = Nn_PeekChar(pScan);
+			if (pScan->lTokenVal == '\"')
 			{
-				Nn_ConsumeChar();
+				Nn_ConsumeChar(pScan);
 				break;
 			}
-			else if (g_lTokenVal == '\0')
+			else if (pScan->lTokenVal == '\0')
 			{
-				Nn_AscReadError("missing string literal delimitter");
+				Nn_AscReadError(pScan, "missing string literal delimitter");
 				break;
 			}
 
-			g_sTokenVal += (TCHAR) g_lTokenVal;
+			pScan->sTokenVal += (TCHAR) pScan->lTokenVal;
 		} 
 	}
 #endif
 
-	else if (Nn_PeekChar() == '\n')
+	else if (Nn_PeekChar(pScan) == '\n')
 	{
-		g_nTokenId = NN_TOK_EOL;
-		Nn_ConsumeChar();
+		pScan->nTokenId = NN_TOK_EOL;
+		Nn_ConsumeChar(pScan);
 	}
 
-	else if (Nn_PeekBinary())
+	else if (Nn_PeekBinary(pScan))
 	{
-		g_nTokenId = NN_TOK_EOL;
+		pScan->nTokenId = NN_TOK_EOL;
 	}
 
 	else
 	{
-		g_nTokenId = NN_TOK_PUNCT;
-		Nn_ConsumeChar();
+		pScan->nTokenId = NN_TOK_PUNCT;
+		Nn_ConsumeChar(pScan);
 	}
 
-	g_nTokenLen = g_pchCur - g_pchToken;
-	return g_nTokenId;
+	pScan->nTokenLen = pScan->pchCur - pScan->pchToken;
+	return pScan->nTokenId;
 }
 
 
 /*////////////////////////////////////////////////////////////////////////////*/
-void Nn_ReadChar()
+void Nn_ReadChar(NN_ASC_SCANNER* pScan)
 {
 	BOOL bComment = FALSE;
 	BOOL bContinue;
 	do 
 	{
 		bContinue = TRUE; 
-		switch (Nn_PeekChar())
+		switch (Nn_PeekChar(pScan))
 		{
 		case '\r':
 		case '\t':
 		case ' ' : 
-			Nn_ConsumeChar();
+			Nn_ConsumeChar(pScan);
 			break;
 		case ';' : 
-			Nn_ConsumeChar();
+			Nn_ConsumeChar(pScan);
 			bComment  = TRUE; 
 			break;
 		case '\n': 
@@ -976,7 +1034,7 @@ void Nn_ReadChar()
 		default:
 			bContinue = bComment;
 			if (bComment)
-				Nn_ConsumeChar();
+				Nn_ConsumeChar(pScan);
 		}
 	}
 	while (bContinue);
@@ -984,30 +1042,36 @@ void Nn_ReadChar()
 
 
 /*////////////////////////////////////////////////////////////////////////////*/
-BOOL Nn_ReadLine () 
+BOOL Nn_ReadLine (NN_ASC_SCANNER* pScan) 
 {
-	g_pchCur = g_pchLine;
-	if (fgets(g_pchLine, NN_MAX_LINE, g_stream) != NULL)
-		g_nLineNo++;
+	char* pchLine;
+
+	pScan->pchCur = pScan->pchLine;
+	if (pScan->pIStream != NULL)
+		pchLine = Nn_IGets(pScan->pchLine, NN_MAX_LINE, pScan->pIStream);
+	else
+		pchLine = fgets(pScan->pchLine, NN_MAX_LINE, pScan->stream);
+	if (pchLine != NULL)
+		pScan->nLineNo++;
 	else
 	{
-		g_pchLine[0] = '\0';
-		if (ferror(g_stream))
-			Nn_Error(NN_FILE_READ_ERROR, NN_ERR_PREFIX "reading from '%s' failed!", g_pchFilePath);
+		pScan->pchLine[0] = '\0';
+		if (pScan->pIStream != NULL ? Nn_IError(pScan->pIStream) : ferror(pScan->stream))
+			Nn_Error(NN_FILE_READ_ERROR, NN_ERR_PREFIX "reading from '%s' failed!", pScan->pchFilePath);
 		return FALSE;
 	}
 	return TRUE;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-PCSTR Nn_GetToken(char szToken[NN_MAX_TOKEN+1])
+PCSTR Nn_GetToken(NN_ASC_SCANNER* pScan, char szToken[NN_MAX_TOKEN+1])
 {
-	if (g_pchToken == NULL || g_nTokenLen == 0)
+	if (pScan->pchToken == NULL || pScan->nTokenLen == 0)
 		szToken[0] = '\0';
 	else
 	{
-		strncpy(szToken, g_pchToken, g_nTokenLen);
-		szToken[g_nTokenLen] = '\0';
+		strncpy(szToken, pScan->pchToken, pScan->nTokenLen);
+		szToken[pScan->nTokenLen] = '\0';
 	}
 	return szToken;
 }
@@ -1032,17 +1096,17 @@ PCSTR Nn_GetTokenName (NN_TOKEN nTokenId)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-NN_STATUS Nn_AscReadError (PCSTR pchFormat, ...)
+NN_STATUS Nn_AscReadError (NN_ASC_SCANNER* pScan, PCSTR pchFormat, ...)
 {
-	static char szBuffer[1024];
+	char szBuffer[1024];
 
 	va_list pArgList;
 	va_start(pArgList, pchFormat);
 	vsprintf(szBuffer, pchFormat, pArgList);
 	va_end(pArgList);
 
-	g_nNumErrors++;
-	return Nn_Error(NN_FILE_READ_ERROR, NN_ERR_PREFIX "%s(%d): %s", g_pchFilePath, g_nLineNo, szBuffer);
+	pScan->nNumErrors++;
+	return Nn_Error(NN_FILE_READ_ERROR, NN_ERR_PREFIX "%s(%d): %s", pScan->pchFilePath, pScan->nLineNo, szBuffer);
 }
 
 
@@ -1055,6 +1119,7 @@ NN_STATUS Nn_AscReadError (PCSTR pchFormat, ...)
 
 NN_STATUS Nn_WriteNetToAscFile(PCSTR pchFilePath, const NN_PNET pNet)
 {
+	FILE*     ostream;
 	NN_STATUS nns;
 
 	assert(pchFilePath != NULL);
@@ -1062,17 +1127,17 @@ NN_STATUS Nn_WriteNetToAscFile(PCSTR pchFilePath, const NN_PNET pNet)
 
 	Nn_ClearError();
 
-	strncpy(g_pchFilePath, pchFilePath, NN_MAX_PATH);
-	g_pchFilePath[NN_MAX_PATH] = '\0';
+	/* A frozen net has no connection structures left to write */
+	if (pNet->bFrozen)
+		return Nn_Error(NN_INCOMPLETE_STRUCTURE, NN_ERR_PREFIX "a frozen net can't be written");
 
-	g_stream = fopen(pchFilePath, "w");
-	if (g_stream != NULL)
+	ostream = fopen(pchFilePath, "w");
+	if (ostream != NULL)
 	{
-		Nn_WriteAscNet(pNet);
+		Nn_WriteAscNet(ostream, pchFilePath, pNet);
 		nns = Nn_GetErrNo();
 
-		fclose(g_stream);
-		g_stream = NULL;
+		fclose(ostream);
 	}
 	else
 		nns = Nn_Error(NN_CANT_OPEN_FILE, 
@@ -1083,39 +1148,40 @@ NN_STATUS Nn_WriteNetToAscFile(PCSTR pchFilePath, const NN_PNET pNet)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
-NN_STATUS Nn_WriteAscNet(const NN_PNET pNet)
+NN_STATUS Nn_WriteAscNet(FILE* ostream, PCSTR pchFilePath, const NN_PNET pNet)
 {
+	char  pchName[256];
 	short iL, iU, iC, iC1, iC2;
 	NN_PLAYER pLayer;
 	NN_PUNIT  pUnit;
 	NN_PCONN  pConn;
 
-	fprintf(g_stream, "; Definition of the neural net\n");
-	fprintf(g_stream, "; \n");
-	fprintf(g_stream, "[ %s ]\n", NN_NAME_NET);
-	fprintf(g_stream, "%s = %d\n", NN_NAME_MAJ_VERSION, pNet->na.anVersion[0]);
-	fprintf(g_stream, "%s = %d\n", NN_NAME_MIN_VERSION, pNet->na.anVersion[1]);
-	fprintf(g_stream, "%s = %d\n", NN_NAME_NUM_LAYERS,  pNet->na.nNumLayers);  
-	fprintf(g_stream, "%s = %d\n", NN_NAME_INP_LAYER,   pNet->na.iInpLayer+1); 
-	fprintf(g_stream, "%s = %d\n", NN_NAME_OUT_LAYER,   pNet->na.iOutLayer+1); 
-	fprintf(g_stream, "%s = %s\n", NN_NAME_PRECISION,   Nn_GetPrintKeyword(&g_tabPrec, pNet->na.nPrecision));  
+	fprintf(ostream, "; Definition of the neural net\n");
+	fprintf(ostream, "; \n");
+	fprintf(ostream, "[ %s ]\n", NN_NAME_NET);
+	fprintf(ostream, "%s = %d\n", NN_NAME_MAJ_VERSION, pNet->na.anVersion[0]);
+	fprintf(ostream, "%s = %d\n", NN_NAME_MIN_VERSION, pNet->na.anVersion[1]);
+	fprintf(ostream, "%s = %d\n", NN_NAME_NUM_LAYERS,  pNet->na.nNumLayers);  
+	fprintf(ostream, "%s = %d\n", NN_NAME_INP_LAYER,   pNet->na.iInpLayer+1); 
+	fprintf(ostream, "%s = %d\n", NN_NAME_OUT_LAYER,   pNet->na.iOutLayer+1); 
+	fprintf(ostream, "%s = %s\n", NN_NAME_PRECISION,   Nn_GetPrintKeyword(&g_tabPrec, pNet->na.nPrecision, pchName));  
 
 	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
 	{
 		pLayer = Nn_GetLayerAt(pNet, iL);
 		
-		fprintf(g_stream, "  \n");
-		fprintf(g_stream, "; Definition of layer %d\n", iL+1);
-		fprintf(g_stream, "; \n");
-		fprintf(g_stream, "[ %s(%d) ]\n", NN_NAME_LAYER, iL+1);
-		fprintf(g_stream, "%s = %d\n", NN_NAME_NUM_UNITS, pLayer->la.nNumUnits);
-		fprintf(g_stream, "%s = %s\n", NN_NAME_INP_FNID,  Nn_GetPrintKeyword(&g_tabInpFn, pLayer->la.nInpFnId)); 
-		fprintf(g_stream, "%s = %s\n", NN_NAME_ACT_FNID,  Nn_GetPrintKeyword(&g_tabActFn, pLayer->la.nActFnId)); 
-		fprintf(g_stream, "%s = %s\n", NN_NAME_OUT_FNID,  Nn_GetPrintKeyword(&g_tabOutFn, pLayer->la.nOutFnId)); 
-		fprintf(g_stream, "%s = %.10g\n", NN_NAME_ACT_SLOPE, pLayer->la.fActSlope);
-		fprintf(g_stream, "%s = %.10g\n", NN_NAME_ACT_THRES, pLayer->la.fActThres);
-		if (ferror(g_stream))
-			return Nn_AscWriteError();
+		fprintf(ostream, "  \n");
+		fprintf(ostream, "; Definition of layer %d\n", iL+1);
+		fprintf(ostream, "; \n");
+		fprintf(ostream, "[ %s(%d) ]\n", NN_NAME_LAYER, iL+1);
+		fprintf(ostream, "%s = %d\n", NN_NAME_NUM_UNITS, pLayer->la.nNumUnits);
+		fprintf(ostream, "%s = %s\n", NN_NAME_INP_FNID,  Nn_GetPrintKeyword(&g_tabInpFn, pLayer->la.nInpFnId, pchName)); 
+		fprintf(ostream, "%s = %s\n", NN_NAME_ACT_FNID,  Nn_GetPrintKeyword(&g_tabActFn, pLayer->la.nActFnId, pchName)); 
+		fprintf(ostream, "%s = %s\n", NN_NAME_OUT_FNID,  Nn_GetPrintKeyword(&g_tabOutFn, pLayer->la.nOutFnId, pchName)); 
+		fprintf(ostream, "%s = %.10g\n", NN_NAME_ACT_SLOPE, pLayer->la.fActSlope);
+		fprintf(ostream, "%s = %.10g\n", NN_NAME_ACT_THRES, pLayer->la.fActThres);
+		if (ferror(ostream))
+			return Nn_AscWriteError(pchFilePath);
 	}
 
 	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
@@ -1126,65 +1192,72 @@ NN_STATUS Nn_WriteAscNet(const NN_PNET pNet)
 		{
 			pUnit = Nn_GetUnitAt(pLayer, iU);
 
-			fprintf(g_stream, "  \n");
-			fprintf(g_stream, "; Definition of unit %d of layer %d\n", iU+1, iL+1);
-			fprintf(g_stream, "; \n");
-			fprintf(g_stream, "[ %s(%d,%d) ]\n", NN_NAME_UNIT, iL+1, iU+1);
-			fprintf(g_stream, "%s = %d\n", NN_NAME_NUM_CONNS,  pUnit->ua.nNumConns);
-			fprintf(g_stream, "%s = %.10g\n", NN_NAME_INP_BIAS,   pUnit->ua.fInpBias);
-			fprintf(g_stream, "%s = %.10g\n", NN_NAME_INP_SCALE,  pUnit->ua.fInpScale);
-			fprintf(g_stream, "%s = %.10g\n", NN_NAME_OUT_BIAS,   pUnit->ua.fOutBias);
-			fprintf(g_stream, "%s = %.10g\n", NN_NAME_OUT_SCALE,  pUnit->ua.fOutScale);
-			if (ferror(g_stream))
-				return Nn_AscWriteError();
+			fprintf(ostream, "  \n");
+			fprintf(ostream, "; Definition of unit %d of layer %d\n", iU+1, iL+1);
+			fprintf(ostream, "; \n");
+			fprintf(ostream, "[ %s(%d,%d) ]\n", NN_NAME_UNIT, iL+1, iU+1);
+			fprintf(ostream, "%s = %d\n", NN_NAME_NUM_CONNS,  pUnit->ua.nNumConns);
+			fprintf(ostream, "%s = %.10g\n", NN_NAME_INP_BIAS,   pUnit->ua.fInpBias);
+			fprintf(ostream, "%s = %.10g\n", NN_NAME_INP_SCALE,  pUnit->ua.fInpScale);
+			fprintf(ostream, "%s = %.10g\n", NN_NAME_OUT_BIAS,   pUnit->ua.fOutBias);
+			fprintf(ostream, "%s = %.10g\n", NN_NAME_OUT_SCALE,  pUnit->ua.fOutScale);
+			if (pUnit->ua.nTrnFnId != NN_FUNC_ZERO || pUnit->ua.nTrnFlags != 0)
+			{
+				fprintf(ostream, "%s = %s\n", NN_NAME_TRN_FNID,   Nn_GetPrintKeyword(&g_tabTrnFn, pUnit->ua.nTrnFnId, pchName));
+				fprintf(ostream, "%s = %d\n", NN_NAME_TRN_FLAGS,  pUnit->ua.nTrnFlags);
+				fprintf(ostream, "%s = %.10g\n", NN_NAME_TRN_MIN,    pUnit->ua.fTrnMin);
+				fprintf(ostream, "%s = %.10g\n", NN_NAME_TRN_MAX,    pUnit->ua.fTrnMax);
+			}
+			if (ferror(ostream))
+				return Nn_AscWriteError(pchFilePath);
 
 			if (pUnit->ua.nNumConns == 0)
-				fprintf(g_stream, "; No incoming connections defined!\n");
+				fprintf(ostream, "; No incoming connections defined!\n");
 			else
 			{
-				fprintf(g_stream, "; Definition of the incoming connections:\n");
-				fprintf(g_stream, "; Form:\n");
-				fprintf(g_stream, "; \t%s(iC) = iL, iU, fW\n", NN_NAME_CONNECTION);
-				fprintf(g_stream, "; with\n");
-				fprintf(g_stream, "; \tiC: Connection index (1...%d)\n", pUnit->ua.nNumConns);
-				fprintf(g_stream, "; \tiL: Source layer index\n");
-				fprintf(g_stream, "; \tiU: Source unit index\n");
-				fprintf(g_stream, "; \tfW: Weight or RBF centre point co-ordinate value\n");
-				fprintf(g_stream, "; \n");
+				fprintf(ostream, "; Definition of the incoming connections:\n");
+				fprintf(ostream, "; Form:\n");
+				fprintf(ostream, "; \t%s(iC) = iL, iU, fW\n", NN_NAME_CONNECTION);
+				fprintf(ostream, "; with\n");
+				fprintf(ostream, "; \tiC: Connection index (1...%d)\n", pUnit->ua.nNumConns);
+				fprintf(ostream, "; \tiL: Source layer index\n");
+				fprintf(ostream, "; \tiU: Source unit index\n");
+				fprintf(ostream, "; \tfW: Weight or RBF centre point co-ordinate value\n");
+				fprintf(ostream, "; \n");
 				for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
 				{
 					pConn = Nn_GetConnAt(pUnit, iC);
-					fprintf(g_stream, "%s(%d) = %d,%d, %.10g\n", 
+					fprintf(ostream, "%s(%d) = %d,%d, %.10g\n", 
 						NN_NAME_CONNECTION, 
 						iC+1, 
 						pConn->ca.iLayer+1, 
 						pConn->ca.iUnit+1, 
 						pConn->ca.fWeight);
-					if (ferror(g_stream))
-						return Nn_AscWriteError();
+					if (ferror(ostream))
+						return Nn_AscWriteError(pchFilePath);
 				}
 
 				if (pUnit->ppfMatrix != NULL)
 				{
-					fprintf(g_stream, "; Definition of the RBF inverse co-variance matrix:\n");
-					fprintf(g_stream, "; Entry form:\n");
-					fprintf(g_stream, "; \t%s(iC1,iC2) = fM\n", NN_NAME_MATRIX);
-					fprintf(g_stream, "; with\n");
-					fprintf(g_stream, "; \tiC1: Connection index (1...%d)\n", pUnit->ua.nNumConns);
-					fprintf(g_stream, "; \tiC2: Connection index (1...%d)\n", pUnit->ua.nNumConns);
-					fprintf(g_stream, "; \tfM:  Matrix entry value\n");
-					fprintf(g_stream, "; \n");
+					fprintf(ostream, "; Definition of the RBF inverse co-variance matrix:\n");
+					fprintf(ostream, "; Entry form:\n");
+					fprintf(ostream, "; \t%s(iC1,iC2) = fM\n", NN_NAME_MATRIX);
+					fprintf(ostream, "; with\n");
+					fprintf(ostream, "; \tiC1: Connection index (1...%d)\n", pUnit->ua.nNumConns);
+					fprintf(ostream, "; \tiC2: Connection index (1...%d)\n", pUnit->ua.nNumConns);
+					fprintf(ostream, "; \tfM:  Matrix entry value\n");
+					fprintf(ostream, "; \n");
 					for (iC1 = 0; iC1 < pUnit->ua.nNumConns; iC1++)
 					{
 						for (iC2 = 0; iC2 < pUnit->ua.nNumConns; iC2++)
 						{
-							fprintf(g_stream, "%s(%d,%d) = %.10g\n", 
+							fprintf(ostream, "%s(%d,%d) = %.10g\n", 
 								NN_NAME_MATRIX, 
 								iC1+1, 
 								iC2+1, 
 								pUnit->ppfMatrix[iC1][iC2]);
-							if (ferror(g_stream))
-								return Nn_AscWriteError();
+							if (ferror(ostream))
+								return Nn_AscWriteError(pchFilePath);
 						}
 					}
 				}
@@ -1197,9 +1270,9 @@ NN_STATUS Nn_WriteAscNet(const NN_PNET pNet)
 
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_AscWriteError ()
+NN_STATUS Nn_AscWriteError (PCSTR pchFilePath)
 {
-	return Nn_Error(NN_FILE_WRITE_ERROR, NN_ERR_PREFIX "can't write to ASCII file '%s'", g_pchFilePath);
+	return Nn_Error(NN_FILE_WRITE_ERROR, NN_ERR_PREFIX "can't write to ASCII file '%s'", pchFilePath);
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
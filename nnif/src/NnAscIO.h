@@ -26,6 +26,10 @@ extern "C" {
 #define NN_NAME_INP_SCALE   "InpScale"    
 #define NN_NAME_OUT_BIAS    "OutBias"     
 #define NN_NAME_OUT_SCALE   "OutScale"    
+#define NN_NAME_TRN_FNID    "TrnFunc"     
+#define NN_NAME_TRN_FLAGS   "TrnFlags"    
+#define NN_NAME_TRN_MIN     "TrnMin"      
+#define NN_NAME_TRN_MAX     "TrnMax"      
 #define NN_NAME_ACTIVATION  "Activation"   
 #define NN_NAME_MATRIX      "M"     
 #define NN_NAME_NUM_UNITS   "NumUnits"    
@@ -89,6 +93,10 @@ typedef enum ENnKeyId
 	NN_KEY_INP_SCALE,  
 	NN_KEY_OUT_BIAS,   
 	NN_KEY_OUT_SCALE,  
+	NN_KEY_TRN_FNID,   
+	NN_KEY_TRN_FLAGS,  
+	NN_KEY_TRN_MIN,    
+	NN_KEY_TRN_MAX,    
 	NN_KEY_ACTIVATION, 
 	NN_KEY_CONNECTION, 
 	NN_KEY_MATRIX
@@ -123,6 +131,32 @@ typedef struct SNnKwTab
 }
 NN_KWTAB;
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* The state of the scanner and parser of an ASCII NNFF file, one per file    */
+/* being read, so several files can be read at once by different threads.     */
+/* The lines are read from the file or, if pIStream is set, from a stream.    */
+typedef struct SNnAscScanner
+{
+	FILE*     stream;
+	struct SNnIStream* pIStream;
+	char      pchFilePath [NN_MAX_PATH+1];
+	char      pchLine [NN_MAX_LINE+1];
+	PCSTR     pchCur;
+	PCSTR     pchToken;
+	int       nTokenLen;
+	NN_TOKEN  nTokenId;
+	BOOL      bTokenConsumed;
+	double    dTokenVal;
+	long      lTokenVal;
+	int       nLineNo;
+	int       nNumErrors;
+	int       nSection;
+	int       nKey;
+	short     iL;
+	short     iU;
+}
+NN_ASC_SCANNER;
+
 
 /*////////////////////////////////////////////////////////////////////////////*/
 NN_STATUS Nn_CreateNetFromAscFile
@@ -133,53 +167,65 @@ NN_STATUS Nn_CreateNetFromAscFile
 	NN_PNET* ppNet
 );
 
-BOOL Nn_ParseNet(NN_PNET* ppNet);
-BOOL Nn_ParseSectionHeader(NN_PNET pNet);
-BOOL Nn_ParseSectionEntry(NN_PNET pNet);
-BOOL Nn_ParseNetSectionEntry(NN_PNET pNet);
-BOOL Nn_ParseLayerSectionEntry(NN_PNET pNet);
-BOOL Nn_ParseUnitSectionEntry(NN_PNET pNet);
-BOOL Nn_ParseConnEntryAssign(const NN_PNET pNet, NN_PUNIT pUnit);
-BOOL Nn_ParseMatrixEntryAssign(const NN_PNET pNet, NN_PUNIT pUnit);
-BOOL Nn_ParseKeywordAssign(const NN_KWTAB* aTab, short* pnFnId);
-BOOL Nn_ParseFloatAssign(NN_FLOAT* pf);
-BOOL Nn_ParseShortAssign(short* ps);
-BOOL Nn_ParseIndexAssign(short sMax, short* ps);
-BOOL Nn_ParseCountAssign(short sMin, short sMax, short* ps);
-BOOL Nn_ParseFloat(NN_FLOAT* pf);
-BOOL Nn_ParseShort(short* ps);
-BOOL Nn_ParseIndex(short sMax, short* ps);
-BOOL Nn_ParseCount(short sMin, short sMax, short* ps);
-
-BOOL Nn_CheckLayerIndex(const NN_PNET pNet, int iL);
-BOOL Nn_CheckUnitIndex(const NN_PLAYER pLayer, int iU);
-BOOL Nn_CheckConnIndex(const NN_PUNIT pUnit, int iC);
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Reads a net from an ASCII NNFF file in a stream (see NnStream.h), without  */
+/* Nn_AssertSemanticIntegrity, which is left to the caller                    */
+NN_STATUS Nn_ReadAscStreamNet
+(
+	struct SNnIStream* pIStream,
+	PCSTR              pchName,
+	NN_PNET*           ppNet
+);
+
+BOOL Nn_ParseNet(NN_ASC_SCANNER* pScan, NN_PNET* ppNet);
+BOOL Nn_ParseSectionHeader(NN_ASC_SCANNER* pScan, NN_PNET pNet);
+BOOL Nn_ParseSectionEntry(NN_ASC_SCANNER* pScan, NN_PNET pNet);
+BOOL Nn_ParseNetSectionEntry(NN_ASC_SCANNER* pScan, NN_PNET pNet);
+BOOL Nn_ParseLayerSectionEntry(NN_ASC_SCANNER* pScan, NN_PNET pNet);
+BOOL Nn_ParseUnitSectionEntry(NN_ASC_SCANNER* pScan, NN_PNET pNet);
+BOOL Nn_ParseConnEntryAssign(NN_ASC_SCANNER* pScan, const NN_PNET pNet, NN_PUNIT pUnit);
+BOOL Nn_ParseMatrixEntryAssign(NN_ASC_SCANNER* pScan, const NN_PNET pNet, NN_PUNIT pUnit);
+BOOL Nn_ParseKeywordAssign(NN_ASC_SCANNER* pScan, const NN_KWTAB* aTab, short* pnFnId);
+BOOL Nn_ParseFloatAssign(NN_ASC_SCANNER* pScan, NN_FLOAT* pf);
+BOOL Nn_ParseShortAssign(NN_ASC_SCANNER* pScan, short* ps);
+BOOL Nn_ParseIndexAssign(NN_ASC_SCANNER* pScan, short sMax, short* ps);
+BOOL Nn_ParseCountAssign(NN_ASC_SCANNER* pScan, short sMin, short sMax, short* ps);
+BOOL Nn_ParseFloat(NN_ASC_SCANNER* pScan, NN_FLOAT* pf);
+BOOL Nn_ParseShort(NN_ASC_SCANNER* pScan, short* ps);
+BOOL Nn_ParseIndex(NN_ASC_SCANNER* pScan, short sMax, short* ps);
+BOOL Nn_ParseCount(NN_ASC_SCANNER* pScan, short sMin, short sMax, short* ps);
+
+BOOL Nn_CheckLayerIndex(NN_ASC_SCANNER* pScan, const NN_PNET pNet, int iL);
+BOOL Nn_CheckUnitIndex(NN_ASC_SCANNER* pScan, const NN_PLAYER pLayer, int iU);
+BOOL Nn_CheckConnIndex(NN_ASC_SCANNER* pScan, const NN_PUNIT pUnit, int iC);
 
 int Nn_FindKeywordIdent(const NN_KWTAB* aKwTab, PCSTR pszName);
 PCSTR Nn_FindKeywordName(const NN_KWTAB* aKwTab, int nKwId);
-PCSTR Nn_GetPrintKeyword(const NN_KWTAB* pTab, int nKwId);
+PCSTR Nn_GetPrintKeyword(const NN_KWTAB* pTab, int nKwId, char pchName[256]);
 int Nn_CompareKw(PCSTR pstr1, PCSTR pstr2);
 
-NN_STATUS Nn_OpenAscFileScanner (PCSTR pchFilePath);
-void Nn_CloseAscFileScanner ();
-BOOL Nn_ParsePunctuatorOpt (int ch);
-BOOL Nn_ParsePunctuator (int ch);
-BOOL Nn_ParseTokenOpt (NN_TOKEN nTokenId);
-BOOL Nn_ParseToken (NN_TOKEN nTokenId);
-NN_TOKEN Nn_ScanToken();
-void Nn_ReadChar();
-BOOL Nn_ReadLine (); 
-PCSTR Nn_GetToken(char szToken[NN_MAX_TOKEN+1]);
+NN_STATUS Nn_OpenAscFileScanner (NN_ASC_SCANNER* pScan, PCSTR pchFilePath);
+void Nn_OpenAscStreamScanner (NN_ASC_SCANNER* pScan, struct SNnIStream* pIStream, PCSTR pchName);
+void Nn_InitAscScanner (NN_ASC_SCANNER* pScan, PCSTR pchFilePath);
+void Nn_CloseAscFileScanner (NN_ASC_SCANNER* pScan);
+BOOL Nn_ParsePunctuatorOpt (NN_ASC_SCANNER* pScan, int ch);
+BOOL Nn_ParsePunctuator (NN_ASC_SCANNER* pScan, int ch);
+BOOL Nn_ParseTokenOpt (NN_ASC_SCANNER* pScan, NN_TOKEN nTokenId);
+BOOL Nn_ParseToken (NN_ASC_SCANNER* pScan, NN_TOKEN nTokenId);
+NN_TOKEN Nn_ScanToken(NN_ASC_SCANNER* pScan);
+void Nn_ReadChar(NN_ASC_SCANNER* pScan);
+BOOL Nn_ReadLine (NN_ASC_SCANNER* pScan); 
+PCSTR Nn_GetToken(NN_ASC_SCANNER* pScan, char szToken[NN_MAX_TOKEN+1]);
 PCSTR Nn_GetTokenName (NN_TOKEN nTokenId); 
 
-NN_STATUS Nn_AscReadError (PCSTR pszFormat, ...);
+NN_STATUS Nn_AscReadError (NN_ASC_SCANNER* pScan, PCSTR pszFormat, ...);
 int Nn_GetNumErrors();
-long Nn_GetTokenValInt();
-double Nn_GetTokenValFloat();
+long Nn_GetTokenValInt(const NN_ASC_SCANNER* pScan);
+double Nn_GetTokenValFloat(const NN_ASC_SCANNER* pScan);
 
 NN_STATUS Nn_WriteNetToAscFile (PCSTR pchFilePath, const NN_PNET pNet);
-NN_STATUS Nn_WriteAscNet  (const NN_PNET pNet);
-NN_STATUS Nn_AscWriteError ();
+NN_STATUS Nn_WriteAscNet  (FILE* ostream, PCSTR pchFilePath, const NN_PNET pNet);
+NN_STATUS Nn_AscWriteError (PCSTR pchFilePath);
 
 #ifdef __cplusplus
 }
@@ -11,10 +11,56 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 #include <assert.h>
 
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
 #include "NnBase.h"
 
+/* Alignment of the connection blocks and matrix rows allocated from an arena */
+#define NN_ITEM_ALIGN   8
+
+/* Rounds a size up to a multiple of the alignment (a power of two) */
+#define NN_ALIGN_UP(n, a)  (((n) + (a) - 1) & ~((size_t)(a) - 1))
+
+/* Size of the header of the default allocator, keeps the alignment of malloc */
+#define NN_ALLOC_HEADER 16
+
+/* Atomic operations on the counters of the default allocator, */
+/* NN_ATOMIC_ADD and NN_ATOMIC_SUB give the new value,         */
+/* NN_ATOMIC_LOAD reads a counter written by other threads,    */
+/* NN_ATOMIC_STORE overwrites it                                */
+#if defined(_MSC_VER) && defined(_WIN64)
+#define NN_ATOMIC_ADD(p, n)     ((size_t) InterlockedExchangeAdd64((volatile LONG64*) (p), (LONG64) (n)) + (n))
+#define NN_ATOMIC_SUB(p, n)     ((size_t) InterlockedExchangeAdd64((volatile LONG64*) (p), -(LONG64) (n)) - (n))
+#define NN_ATOMIC_CAS(p, o, n)  ((size_t) InterlockedCompareExchange64((volatile LONG64*) (p), (LONG64) (n), (LONG64) (o)) == (o))
+#define NN_ATOMIC_LOAD(p)       ((size_t) InterlockedExchangeAdd64((volatile LONG64*) (p), 0))
+#define NN_ATOMIC_STORE(p, n)   InterlockedExchange64((volatile LONG64*) (p), (LONG64) (n))
+#elif defined(_MSC_VER)
+#define NN_ATOMIC_ADD(p, n)     ((size_t) InterlockedExchangeAdd((volatile LONG*) (p), (LONG) (n)) + (n))
+#define NN_ATOMIC_SUB(p, n)     ((size_t) InterlockedExchangeAdd((volatile LONG*) (p), -(LONG) (n)) - (n))
+#define NN_ATOMIC_CAS(p, o, n)  ((size_t) InterlockedCompareExchange((volatile LONG*) (p), (LONG) (n), (LONG) (o)) == (o))
+#define NN_ATOMIC_LOAD(p)       ((size_t) InterlockedExchangeAdd((volatile LONG*) (p), 0))
+#define NN_ATOMIC_STORE(p, n)   InterlockedExchange((volatile LONG*) (p), (LONG) (n))
+#else
+#define NN_ATOMIC_ADD(p, n)     __sync_add_and_fetch((p), (n))
+#define NN_ATOMIC_SUB(p, n)     __sync_sub_and_fetch((p), (n))
+#define NN_ATOMIC_CAS(p, o, n)  __sync_bool_compare_and_swap((p), (o), (n))
+#define NN_ATOMIC_LOAD(p)       __sync_fetch_and_add((p), 0)
+#define NN_ATOMIC_STORE(p, n)   __sync_lock_test_and_set((p), (n))
+#endif
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Module local prototypes:                                                   */
+/*                                                                            */
+
+void   Nn_FreeBlock (NN_PNET pNet, void* pBlock);
+void*  Nn_DefaultAlloc (size_t nSize, void* pUserData);
+void   Nn_DefaultFree (void* pBlock, void* pUserData);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Neural net object (NN_PNET) methods                                        */
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -40,7 +86,7 @@ NN_STATUS Nn_CreateNet (NN_PNET* ppNet)
 
 	assert(ppNet != NULL);
 	
-	pNet = (NN_PNET) calloc(1, sizeof (NN_NET));
+	pNet = (NN_PNET) Nn_Alloc(sizeof (NN_NET));
 	if (pNet == NULL)
 		return Nn_SetOutOfMemoryError();
 
@@ -52,6 +98,17 @@ NN_STATUS Nn_CreateNet (NN_PNET* ppNet)
 	pNet->na.iOutLayer    = -1; /* Means 'not set' */
 	pNet->na.nPrecision   = NN_PREC_DOUBLE;
 	pNet->aLayers         = NULL;
+	pNet->afBatch         = NULL;
+	pNet->aProfile        = NULL;
+	pNet->afConnWeight    = NULL;
+	pNet->anConnSrc16     = NULL;
+	pNet->anConnSrc32     = NULL;
+	pNet->pArena          = NULL;
+	pNet->pArenaBlock     = NULL;
+	pNet->bFrozen         = FALSE;
+	pNet->pView           = NULL;
+	pNet->nViewSize       = 0;
+	pNet->pfnUnmap        = NULL;
 
 	*ppNet = pNet;
 	return NN_OK;
@@ -61,7 +118,8 @@ NN_STATUS Nn_CreateNet (NN_PNET* ppNet)
 /* Function:   Nn_DeleteNet                                                   */
 /* Purpose:    Releases all memory allocated by the neural net object         */
 /* Remarks:    The function deletes also all layers, units and connections    */
-/*             owned by the net object                                        */
+/*             owned by the net object, and releases the view of the mapped   */
+/*             file it refers to                                              */
 /* Returns:    No return value                                                */
 /*////////////////////////////////////////////////////////////////////////////*/
 
@@ -71,7 +129,408 @@ void Nn_DeleteNet (NN_PNET pNet)
 		return;
 	
 	Nn_DeleteLayers(pNet);
-	free(pNet);
+	Nn_DeleteConnTable(pNet);
+	Nn_Free(pNet->afBatch);
+	Nn_Free(pNet->aProfile);
+	Nn_Free(pNet->pArenaBlock);
+	if (pNet->pView != NULL && pNet->pfnUnmap != NULL)
+		pNet->pfnUnmap(pNet->pView, pNet->nViewSize);
+	Nn_Free(pNet);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Net methods concerning the arena                                           */
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CreateArena                                                 */
+/* Purpose:    Creates a single zeroed heap block from which the layers,      */
+/*             units, connections and matrices of the net are allocated       */
+/* Returns:    NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateArena (NN_PNET pNet, size_t nSize)
+{
+	size_t nOffset;
+
+	assert(pNet != NULL);
+	assert(pNet->pArenaBlock == NULL);
+	assert(!Nn_LayersCreated(pNet));
+
+	/* Nothing to do */
+	if (nSize == 0)
+		return NN_OK;
+
+	/* Allocate the block with room to align its start */
+	pNet->pArenaBlock = Nn_Alloc(nSize + NN_ARENA_ALIGN);
+	if (pNet->pArenaBlock == NULL)
+		return Nn_SetOutOfMemoryError();
+
+	nOffset = NN_ARENA_ALIGN - (size_t) pNet->pArenaBlock % NN_ARENA_ALIGN;
+	pNet->pArena     = (PMEM) pNet->pArenaBlock + nOffset;
+	pNet->nArenaSize = nSize;
+	pNet->nArenaUsed = 0;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_IsArenaBlock                                                */
+/* Purpose:    Checks whether a block has been allocated from the arena of    */
+/*             the net                                                        */
+/* Returns:    TRUE if so, FALSE if it is a heap block of its own             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsArenaBlock (const NN_PNET pNet, const void* pBlock)
+{
+	assert(pNet != NULL);
+	return pNet->pArena != NULL &&
+		   (PCMEM) pBlock >= pNet->pArena &&
+		   (PCMEM) pBlock < pNet->pArena + pNet->nArenaSize;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_IsViewBlock                                                 */
+/* Purpose:    Checks whether a block lies in the view of the mapped file the */
+/*             net refers to                                                  */
+/* Returns:    TRUE if so, FALSE otherwise                                    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsViewBlock (const NN_PNET pNet, const void* pBlock)
+{
+	assert(pNet != NULL);
+	return pNet->pView != NULL &&
+		   (PCMEM) pBlock >= pNet->pView &&
+		   (PCMEM) pBlock < pNet->pView + pNet->nViewSize;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_GetLayersArenaSize                                          */
+/* Purpose:    Gets the arena space needed by Nn_CreateLayers                 */
+/* Returns:    The number of bytes                                            */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetLayersArenaSize (short nNumLayers)
+{
+	if (nNumLayers <= 0)
+		return 0;
+	return Nn_GetArenaBlockSize(nNumLayers * sizeof (NN_LAYER), NN_ARENA_ALIGN);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_GetUnitsArenaSize                                           */
+/* Purpose:    Gets the arena space needed by Nn_CreateUnitsIn                */
+/* Returns:    The number of bytes                                            */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetUnitsArenaSize (short nNumUnits)
+{
+	if (nNumUnits <= 0)
+		return 0;
+	return Nn_GetArenaBlockSize(nNumUnits * sizeof (NN_UNIT), NN_ARENA_ALIGN);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_GetConnsArenaSize                                           */
+/* Purpose:    Gets the arena space needed by Nn_CreateConnsIn                */
+/* Returns:    The number of bytes                                            */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetConnsArenaSize (short nNumConns)
+{
+	if (nNumConns <= 0)
+		return 0;
+	return Nn_GetArenaBlockSize(nNumConns * sizeof (NN_CONN), NN_ITEM_ALIGN);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_GetMatrixArenaSize                                          */
+/* Purpose:    Gets the arena space needed by Nn_CreateMatrixIn               */
+/* Returns:    The number of bytes                                            */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetMatrixArenaSize (short nNumConns)
+{
+	if (nNumConns <= 0)
+		return 0;
+	return Nn_GetArenaBlockSize(Nn_GetMatrixSize(nNumConns), NN_ITEM_ALIGN);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_GetArenaBlockSize                                           */
+/* Purpose:    Gets the arena space needed by a block of the given size and   */
+/*             alignment                                                      */
+/* Remarks:    Blocks are placed on multiples of NN_ITEM_ALIGN, so a block    */
+/*             with a larger alignment is preceded by at most nAlign minus    */
+/*             NN_ITEM_ALIGN bytes of padding, whatever the order of the      */
+/*             allocations.                                                   */
+/* Returns:    The number of bytes                                            */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetArenaBlockSize (size_t nSize, size_t nAlign)
+{
+	return NN_ALIGN_UP(nSize, NN_ITEM_ALIGN) + nAlign - NN_ITEM_ALIGN;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_AllocBlock                                                  */
+/* Purpose:    Allocates a zeroed block from the arena of the net, or from    */
+/*             the heap if there is no arena or it is exhausted               */
+/* Returns:    The block, NULL if out of memory                               */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void* Nn_AllocBlock (NN_PNET pNet, size_t nSize, size_t nAlign)
+{
+	size_t nOffset;
+
+	if (pNet != NULL && pNet->pArena != NULL)
+	{
+		nOffset = NN_ALIGN_UP(pNet->nArenaUsed, nAlign);
+		if (nOffset + nSize <= pNet->nArenaSize)
+		{
+			pNet->nArenaUsed = NN_ALIGN_UP(nOffset + nSize, NN_ITEM_ALIGN);
+			return pNet->pArena + nOffset;
+		}
+	}
+	return Nn_Alloc(nSize);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_FreeBlock                                                   */
+/* Purpose:    Releases a block allocated by Nn_AllocBlock                    */
+/* Remarks:    Arena blocks are released with the arena by Nn_DeleteNet, so   */
+/*             is the view of a mapped file                                   */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_FreeBlock (NN_PNET pNet, void* pBlock)
+{
+	if (pBlock != NULL && !Nn_IsArenaBlock(pNet, pBlock) && !Nn_IsViewBlock(pNet, pBlock))
+		Nn_Free(pBlock);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Net methods concerning the compact connections                             */
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CreateConnTable                                             */
+/* Purpose:    Creates the compact connections of the net used by the batch   */
+/*             routines                                                       */
+/* Remarks:    The weights and source unit numbers are held in a single heap  */
+/*             block. The connections must have been validated.               */
+/* Returns:    NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateConnTable (NN_PNET pNet)
+{
+	short     iL, iU, iC;
+	long      nNumUnits, nNumConns, nSrc;
+	size_t    nIndexSize;
+	NN_PLAYER pLayer;
+	NN_PUNIT  pUnit;
+	NN_PCONN  pConn;
+
+	assert(pNet != NULL);
+
+	Nn_DeleteConnTable(pNet);
+	if (!Nn_LayersCreated(pNet))
+		return NN_OK;
+
+	/* Number the units and the connections */
+	nNumUnits = 0;
+	nNumConns = 0;
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		pLayer = pNet->aLayers + iL;
+		pLayer->iFirstUnit = nNumUnits;
+		if (pLayer->aUnits == NULL)
+			continue;
+		nNumUnits += pLayer->la.nNumUnits;
+
+		for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+		{
+			pUnit = pLayer->aUnits + iU;
+			pUnit->iFirstConn = nNumConns;
+			pUnit->iFirstSrc  = nNumConns;
+			if (pUnit->aConns != NULL)
+				nNumConns += pUnit->ua.nNumConns;
+		}
+	}
+
+	/* Nothing to do */
+	if (nNumConns == 0)
+		return NN_OK;
+
+	/* Allocate the weights followed by the source unit numbers */
+	nIndexSize = (nNumUnits <= 65536) ? sizeof (unsigned short) : sizeof (unsigned int);
+	pNet->afConnWeight = (NN_FLOAT*) Nn_Alloc(nNumConns * (sizeof (NN_FLOAT) + nIndexSize));
+	if (pNet->afConnWeight == NULL)
+		return Nn_SetOutOfMemoryError();
+	if (nIndexSize == sizeof (unsigned short))
+		pNet->anConnSrc16 = (unsigned short*) (pNet->afConnWeight + nNumConns);
+	else
+		pNet->anConnSrc32 = (unsigned int*) (pNet->afConnWeight + nNumConns);
+
+	/* Fill in the connections */
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		pLayer = pNet->aLayers + iL;
+		if (pLayer->aUnits == NULL)
+			continue;
+
+		for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+		{
+			pUnit = pLayer->aUnits + iU;
+			if (pUnit->aConns == NULL)
+				continue;
+
+			for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
+			{
+				pConn = pUnit->aConns + iC;
+				nSrc  = pNet->aLayers[pConn->ca.iLayer].iFirstUnit + pConn->ca.iUnit;
+				pNet->afConnWeight[pUnit->iFirstConn + iC] = pConn->ca.fWeight;
+				if (pNet->anConnSrc16 != NULL)
+					pNet->anConnSrc16[pUnit->iFirstConn + iC] = (unsigned short) nSrc;
+				else
+					pNet->anConnSrc32[pUnit->iFirstConn + iC] = (unsigned int) nSrc;
+			}
+		}
+	}
+
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_DeleteConnTable                                             */
+/* Purpose:    Releases the compact connections of the net                    */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_DeleteConnTable (NN_PNET pNet)
+{
+	assert(pNet != NULL);
+
+	Nn_FreeBlock(pNet, pNet->afConnWeight);
+	pNet->afConnWeight = NULL;
+	pNet->anConnSrc16  = NULL;
+	pNet->anConnSrc32  = NULL;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Net methods concerning the frozen image                                    */
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_FreezeNet                                                   */
+/* Purpose:    Replaces the editable structures of a validated net by a       */
+/*             read-only image in a single heap block                         */
+/* Remarks:    The image becomes the arena of the net. It holds the layers,   */
+/*             the units of all layers in one array and the compact           */
+/*             connections, the old structures are released.                  */
+/* Returns:    NN_OK (or zero) for success, an error code otherwise           */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_FreezeNet (NN_PNET pNet)
+{
+	short     iL, iU;
+	long      nNumUnits, nNumConns;
+	size_t    nTableSize;
+	BOOL      bComplete;
+	NN_NET    image;
+	NN_AUNITS aUnits;
+	NN_PLAYER pLayer;
+	NN_PUNIT  pUnit;
+	NN_STATUS nns;
+
+	assert(pNet != NULL);
+
+	/* Nothing to do */
+	if (pNet->bFrozen)
+		return NN_OK;
+
+	/* Count the units and the connections */
+	nNumUnits = 0;
+	nNumConns = 0;
+	bComplete = pNet->aLayers != NULL && pNet->na.iInpLayer >= 0 && pNet->na.iOutLayer >= 0;
+	for (iL = 0; bComplete && iL < pNet->na.nNumLayers; iL++)
+	{
+		pLayer = pNet->aLayers + iL;
+		bComplete = pLayer->aUnits != NULL && pLayer->iFirstUnit == nNumUnits;
+		if (!bComplete)
+			break;
+		nNumUnits += pLayer->la.nNumUnits;
+
+		for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+		{
+			pUnit = pLayer->aUnits + iU;
+			if (pUnit->aConns != NULL)
+				nNumConns += pUnit->ua.nNumConns;
+		}
+	}
+
+	/* The units must have been numbered and the compact connections created */
+	if (!bComplete || nNumUnits == 0 || (nNumConns > 0 && pNet->afConnWeight == NULL))
+		return Nn_Error(NN_INCOMPLETE_STRUCTURE, 
+			NN_ERR_PREFIX "net must be validated by Nn_AssertSemanticIntegrity before it can be frozen");
+
+	nTableSize = 0;
+	if (nNumConns > 0)
+		nTableSize = nNumConns * (sizeof (NN_FLOAT) + 
+			(pNet->anConnSrc16 != NULL ? sizeof (unsigned short) : sizeof (unsigned int)));
+
+	/* Create the image, the sizes are upper bounds, so all blocks fit */
+	memset(&image, 0, sizeof (NN_NET));
+	nns = Nn_CreateArena(&image, Nn_GetLayersArenaSize(pNet->na.nNumLayers) + 
+		Nn_GetArenaBlockSize(nNumUnits * sizeof (NN_UNIT), NN_ARENA_ALIGN) + 
+		Nn_GetArenaBlockSize(nTableSize, NN_ITEM_ALIGN));
+	if (nns != NN_OK)
+		return nns;
+	image.aLayers = (NN_ALAYERS) Nn_AllocBlock(&image, pNet->na.nNumLayers * sizeof (NN_LAYER), NN_ARENA_ALIGN);
+	aUnits = (NN_AUNITS) Nn_AllocBlock(&image, nNumUnits * sizeof (NN_UNIT), NN_ARENA_ALIGN);
+	assert(Nn_IsArenaBlock(&image, image.aLayers));
+	assert(Nn_IsArenaBlock(&image, aUnits));
+
+	/* Copy the layers and units, the units of all layers follow each other */
+	memcpy(image.aLayers, pNet->aLayers, pNet->na.nNumLayers * sizeof (NN_LAYER));
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		pLayer = image.aLayers + iL;
+		memcpy(aUnits + pLayer->iFirstUnit, pLayer->aUnits, pLayer->la.nNumUnits * sizeof (NN_UNIT));
+		pLayer->aUnits = aUnits + pLayer->iFirstUnit;
+
+		/* The connections are replaced by the compact ones. The matrices */
+		/* are not used by the processing routines and are dropped.       */
+		for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+		{
+			pUnit = pLayer->aUnits + iU;
+			pUnit->aConns    = NULL;
+			pUnit->ppfMatrix = NULL;
+		}
+	}
+
+	/* Copy the compact connections */
+	if (nTableSize > 0)
+	{
+		image.afConnWeight = (NN_FLOAT*) Nn_AllocBlock(&image, nTableSize, NN_ITEM_ALIGN);
+		assert(Nn_IsArenaBlock(&image, image.afConnWeight));
+		memcpy(image.afConnWeight, pNet->afConnWeight, nTableSize);
+		if (pNet->anConnSrc16 != NULL)
+			image.anConnSrc16 = (unsigned short*) (image.afConnWeight + nNumConns);
+		else
+			image.anConnSrc32 = (unsigned int*) (image.afConnWeight + nNumConns);
+	}
+
+	/* Release the editable structures and install the image */
+	Nn_DeleteLayers(pNet);
+	Nn_DeleteConnTable(pNet);
+	Nn_Free(pNet->pArenaBlock);
+	pNet->aLayers      = image.aLayers;
+	pNet->afConnWeight = image.afConnWeight;
+	pNet->anConnSrc16  = image.anConnSrc16;
+	pNet->anConnSrc32  = image.anConnSrc32;
+	pNet->pArena       = image.pArena;
+	pNet->nArenaSize   = image.nArenaSize;
+	pNet->nArenaUsed   = image.nArenaUsed;
+	pNet->pArenaBlock  = image.pArenaBlock;
+	pNet->bFrozen      = TRUE;
+	return NN_OK;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -130,7 +589,7 @@ NN_STATUS Nn_CreateLayers (NN_PNET pNet)
 		pNet->na.iOutLayer = (short)(pNet->na.nNumLayers - 1);
 
 	/* Allocate space for the layer structures */
-	pNet->aLayers = (NN_ALAYERS) calloc(pNet->na.nNumLayers, sizeof (NN_LAYER));
+	pNet->aLayers = (NN_ALAYERS) Nn_AllocBlock(pNet, pNet->na.nNumLayers * sizeof (NN_LAYER), NN_ARENA_ALIGN);
 	if (pNet->aLayers == NULL)
 		return Nn_SetOutOfMemoryError();
 
@@ -164,7 +623,9 @@ NN_STATUS Nn_CreateLayers (NN_PNET pNet)
 void Nn_DeleteLayers (NN_PNET pNet)
 {
 	int iL;
+	short iU;
 	NN_PLAYER pLayer;
+	NN_PUNIT  pUnit;
 
 	/* Nothing to do */
 	if (pNet == NULL || pNet->aLayers == NULL)
@@ -175,13 +636,22 @@ void Nn_DeleteLayers (NN_PNET pNet)
 	{
 		/* Get layer address */
 		pLayer = Nn_GetLayerAt(pNet, iL);
-		
-		/* Delete all units of the layer */
-		Nn_DeleteUnits(pLayer);
+		if (pLayer->aUnits == NULL)
+			continue;
+
+		/* Delete all units of the layer, blocks of the arena are */
+		/* released with the arena                                */
+		for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+		{
+			pUnit = Nn_GetUnitAt(pLayer, iU);
+			Nn_FreeBlock(pNet, pUnit->aConns);
+			Nn_FreeBlock(pNet, pUnit->ppfMatrix);
+		}
+		Nn_FreeBlock(pNet, pLayer->aUnits);
 	}
 
 	/* Delete the layers */
-	free(pNet->aLayers);
+	Nn_FreeBlock(pNet, pNet->aLayers);
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -222,6 +692,44 @@ NN_PLAYER Nn_GetOutputLayer(const NN_PNET pNet)
 	return Nn_GetLayerAt(pNet, pNet->na.iOutLayer);
 }
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_HasTransforms                                               */
+/* Purpose:    Checks whether any unit of the input or output layer carries   */
+/*             an I/O transform                                               */
+/* Returns:    TRUE if so, FALSE otherwise                                    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_HasTransforms(const NN_PNET pNet)
+{
+	short     iU;
+	int       i;
+	NN_PLAYER pLayer;
+	NN_PUNIT  pUnit;
+
+	assert(pNet != NULL);
+
+	if (!Nn_LayersCreated(pNet) || pNet->na.iInpLayer < 0 || pNet->na.iOutLayer < 0)
+		return FALSE;
+
+	/* For the input and the output layer */
+	for (i = 0; i < 2; i++)
+	{
+		pLayer = (i == 0) ? Nn_GetInputLayer(pNet) : Nn_GetOutputLayer(pNet);
+		if (!Nn_UnitsCreated(pLayer))
+			continue;
+
+		for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+		{
+			pUnit = Nn_GetUnitAt(pLayer, iU);
+			if ((pUnit->ua.nTrnFnId != NN_FUNC_ZERO && pUnit->ua.nTrnFnId != NN_FUNC_IDENTITY) ||
+				(pUnit->ua.nTrnFlags & NN_TRN_SCALE) != 0)
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 /*/////////////////////////////////////////////////////////////////////*/
 /* Layer object (NN_PLAYER) methods                                    */
 /*/////////////////////////////////////////////////////////////////////*/
@@ -259,6 +767,18 @@ BOOL Nn_UnitsCreated (const NN_PLAYER pLayer)
 /*////////////////////////////////////////////////////////////////////////////*/
 
 NN_STATUS Nn_CreateUnits (NN_PLAYER pLayer)
+{
+	return Nn_CreateUnitsIn(NULL, pLayer);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CreateUnitsIn                                               */
+/* Purpose:    Creates all units of an initialized layer object of the given  */
+/*             net, allocated from the arena of the net if it has one         */
+/* Returns:    NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateUnitsIn (NN_PNET pNet, NN_PLAYER pLayer)
 {
 	short     iU;
 	NN_PUNIT  pUnit;
@@ -271,7 +791,7 @@ NN_STATUS Nn_CreateUnits (NN_PLAYER pLayer)
 		return NN_OK;
 
 	/* Allocate heap space for the units of the layer */
-	pLayer->aUnits = (NN_AUNITS) calloc(pLayer->la.nNumUnits, sizeof (NN_UNIT));
+	pLayer->aUnits = (NN_AUNITS) Nn_AllocBlock(pNet, pLayer->la.nNumUnits * sizeof (NN_UNIT), NN_ARENA_ALIGN);
 	if (pLayer->aUnits == NULL)
 		return Nn_SetOutOfMemoryError();
 
@@ -323,7 +843,7 @@ void Nn_DeleteUnits (NN_PLAYER pLayer)
 	}
 	
 	/* Delete units */
-	free(pLayer->aUnits);
+	Nn_Free(pLayer->aUnits);
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -372,6 +892,18 @@ BOOL Nn_ConnsCreated (const NN_PUNIT pUnit)
 /*////////////////////////////////////////////////////////////////////////////    */
 
 NN_STATUS Nn_CreateConns (NN_PUNIT pUnit)
+{
+	return Nn_CreateConnsIn(NULL, pUnit);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CreateConnsIn                                               */
+/* Purpose:    Creates all connections of an initialized unit object of the   */
+/*             given net, allocated from the arena of the net if it has one   */
+/* Returns:    NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateConnsIn (NN_PNET pNet, NN_PUNIT pUnit)
 {
 	assert(pUnit != NULL);
 	assert(!Nn_ConnsCreated(pUnit));
@@ -381,7 +913,7 @@ NN_STATUS Nn_CreateConns (NN_PUNIT pUnit)
 		return NN_OK;
 
 	/* Allocate heap space for the units of the layer */
-	pUnit->aConns = (NN_ACONNS) calloc(pUnit->ua.nNumConns, sizeof (NN_CONN));
+	pUnit->aConns = (NN_ACONNS) Nn_AllocBlock(pNet, pUnit->ua.nNumConns * sizeof (NN_CONN), NN_ITEM_ALIGN);
 	if (pUnit->aConns == NULL)
 		return Nn_SetOutOfMemoryError();
 
@@ -398,7 +930,7 @@ void Nn_DeleteConns (NN_PUNIT pUnit)
 {
 	if (pUnit == NULL || pUnit->aConns == NULL)
 		return;
-	free(pUnit->aConns);
+	Nn_Free(pUnit->aConns);
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -457,7 +989,21 @@ BOOL Nn_MatrixCreated (const NN_PUNIT pUnit)
 
 NN_STATUS Nn_CreateMatrix (NN_PUNIT pUnit)
 {
-	short iC;
+	return Nn_CreateMatrixIn(NULL, pUnit);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CreateMatrixIn                                              */
+/* Purpose:    Creates the inverse co-variance matrix of an initialized unit  */
+/*             object of the given net, allocated from the arena of the net   */
+/*             if it has one                                                  */
+/* Returns:    NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateMatrixIn (NN_PNET pNet, NN_PUNIT pUnit)
+{
+	short     iC;
+	NN_FLOAT* afElems;
 
 	assert(pUnit != NULL);
 	assert(!Nn_MatrixCreated(pUnit));
@@ -466,21 +1012,18 @@ NN_STATUS Nn_CreateMatrix (NN_PUNIT pUnit)
 	if (pUnit->ua.nNumConns == 0)
 		return NN_OK;
 
-	/* Allocate heap space for the units of the layer */
-	pUnit->ppfMatrix = (NN_FLOAT**) calloc(pUnit->ua.nNumConns, sizeof (NN_FLOAT*));
-	if (pUnit->aConns == NULL)
+	/* Allocate a single block for the row vector and the matrix */
+	pUnit->ppfMatrix = (NN_FLOAT**) Nn_AllocBlock(pNet, Nn_GetMatrixSize(pUnit->ua.nNumConns), NN_ITEM_ALIGN);
+	if (pUnit->ppfMatrix == NULL)
 		return Nn_SetOutOfMemoryError();
 
 	/* Important: Mark that the unit has a matrix! */
 	pUnit->ua.bHasMatrix = TRUE;
 
-	/* Allocate heap space for the matrix */
+	/* The elements follow the row vector, aligned for vector loads */
+	afElems = (NN_FLOAT*) NN_ALIGN_UP((size_t) (pUnit->ppfMatrix + pUnit->ua.nNumConns), NN_ARENA_ALIGN);
 	for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
-	{
-		pUnit->ppfMatrix[iC] = (NN_FLOAT*) calloc(pUnit->ua.nNumConns, sizeof (NN_FLOAT));
-		if (pUnit->ppfMatrix[iC] == NULL)
-			return Nn_SetOutOfMemoryError();
-	}
+		pUnit->ppfMatrix[iC] = afElems + iC * pUnit->ua.nNumConns;
 
 	return NN_OK;
 }
@@ -493,22 +1036,26 @@ NN_STATUS Nn_CreateMatrix (NN_PUNIT pUnit)
 
 void Nn_DeleteMatrix (NN_PUNIT pUnit)
 {
-	short iC;
-
 	/* Nothing to do */
 	if (pUnit == NULL || pUnit->ppfMatrix == NULL)
 		return;
 	
-	/* For all matrix rows */
-	for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
-	{
-		/* Free matrix row */
-		if (pUnit->ppfMatrix[iC] != NULL)
-			free(pUnit->ppfMatrix[iC]);
-	}
+	/* Free the row vector together with the matrix */
+	Nn_Free(pUnit->ppfMatrix);
+}
 
-	/* Free row vector */
-	free(pUnit->ppfMatrix);
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetMatrixSize                                                 */
+/* Purpose:  Gets the size of the block allocated by Nn_CreateMatrix          */
+/* Returns:  The number of bytes, zero if nNumConns is zero                   */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetMatrixSize (short nNumConns)
+{
+	if (nNumConns <= 0)
+		return 0;
+	return nNumConns * sizeof (NN_FLOAT*) + NN_ARENA_ALIGN - NN_ITEM_ALIGN + 
+		   (size_t) nNumConns * nNumConns * sizeof (NN_FLOAT);
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -536,6 +1083,19 @@ NN_FLOAT* Nn_GetMatrixRowAt (NN_PUNIT pUnit, short iC)
 	return pUnit->ppfMatrix[iC];
 }
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetMatrixElems                                                */
+/* Purpose:  Gets all elements of the inverse co-variance matrix of a unit    */
+/* Returns:  The matrix rows one after the other                              */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_FLOAT* Nn_GetMatrixElems (NN_PUNIT pUnit)
+{
+	assert(pUnit != NULL);
+	assert(pUnit->ppfMatrix != NULL);
+	return pUnit->ppfMatrix[0];
+}
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_GetMatrixRowAt                                                */
 /* Purpose:  Gets an element of the inverse co-variance matrix of a unit at a */
@@ -547,8 +1107,8 @@ NN_FLOAT Nn_GetMatrixElemAt (const NN_PUNIT pUnit, short iCRow, short iCCol)
 {
 	assert(pUnit != NULL);
 	assert(pUnit->ppfMatrix != NULL);
-	assert(iCRow > 0 && iCRow < pUnit->ua.nNumConns);
-	assert(iCCol > 0 && iCCol < pUnit->ua.nNumConns);
+	assert(iCRow >= 0 && iCRow < pUnit->ua.nNumConns);
+	assert(iCCol >= 0 && iCCol < pUnit->ua.nNumConns);
 	assert(pUnit->ppfMatrix[iCRow] != NULL);
 	return pUnit->ppfMatrix[iCRow][iCCol];
 }
@@ -564,12 +1124,167 @@ void Nn_SetMatrixElemAt (NN_PUNIT pUnit, short iCRow, short iCCol, NN_FLOAT fM)
 {
 	assert(pUnit != NULL);
 	assert(pUnit->ppfMatrix != NULL);
-	assert(iCRow > 0 && iCRow < pUnit->ua.nNumConns);
-	assert(iCCol > 0 && iCCol < pUnit->ua.nNumConns);
+	assert(iCRow >= 0 && iCRow < pUnit->ua.nNumConns);
+	assert(iCCol >= 0 && iCCol < pUnit->ua.nNumConns);
 	assert(pUnit->ppfMatrix[iCRow] != NULL);
 	pUnit->ppfMatrix[iCRow][iCCol] = fM;
 }
 
+/*/////////////////////////////////////////////////////////////////////*/
+/* Memory allocation functions                                         */
+/*/////////////////////////////////////////////////////////////////////*/
+
+/* Module local allocator */
+static NN_ALLOC_FN g_pfnAlloc    = Nn_DefaultAlloc;
+static NN_FREE_FN  g_pfnFree     = Nn_DefaultFree;
+static void*       g_pAllocData  = NULL;
+
+/* Module local counters of the default allocator */
+static volatile size_t g_nLiveBytes = 0;
+static volatile size_t g_nPeakBytes = 0;
+static volatile size_t g_nNumAllocs = 0;
+static volatile size_t g_nNumFrees  = 0;
+static volatile size_t g_nNumFailed = 0;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_SetAllocator                                                */
+/* Purpose:    Sets the functions used for all heap memory of the library     */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_SetAllocator (NN_ALLOC_FN pfnAlloc, NN_FREE_FN pfnFree, void* pUserData)
+{
+	if (pfnAlloc == NULL || pfnFree == NULL)
+	{
+		pfnAlloc  = Nn_DefaultAlloc;
+		pfnFree   = Nn_DefaultFree;
+		pUserData = NULL;
+	}
+	g_pfnAlloc   = pfnAlloc;
+	g_pfnFree    = pfnFree;
+	g_pAllocData = pUserData;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_Alloc                                                       */
+/* Purpose:    Allocates a zeroed block with the current allocator            */
+/* Returns:    The block, NULL if out of memory                               */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void* Nn_Alloc (size_t nSize)
+{
+	void* pBlock;
+
+	pBlock = g_pfnAlloc(nSize, g_pAllocData);
+	if (pBlock != NULL)
+		memset(pBlock, 0, nSize);
+	return pBlock;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_Free                                                        */
+/* Purpose:    Releases a block allocated by Nn_Alloc                         */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_Free (void* pBlock)
+{
+	if (pBlock != NULL)
+		g_pfnFree(pBlock, g_pAllocData);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_GetAllocStats                                               */
+/* Purpose:    Gets the counters of the default allocator                     */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_GetAllocStats (NN_ALLOC_STATS* pStats)
+{
+	assert(pStats != NULL);
+
+	pStats->nLiveBytes = NN_ATOMIC_LOAD(&g_nLiveBytes);
+	pStats->nPeakBytes = NN_ATOMIC_LOAD(&g_nPeakBytes);
+	pStats->nNumAllocs = NN_ATOMIC_LOAD(&g_nNumAllocs);
+	pStats->nNumFrees  = NN_ATOMIC_LOAD(&g_nNumFrees);
+	pStats->nNumFailed = NN_ATOMIC_LOAD(&g_nNumFailed);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_ResetAllocStats                                             */
+/* Purpose:    Sets the call counters of the default allocator to zero and    */
+/*             the peak to the bytes currently allocated                      */
+/* Remarks:    May be called while other threads allocate, their calls are    */
+/*             then counted either before or after the reset.                 */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_ResetAllocStats (void)
+{
+	size_t nLive, nPeak;
+
+	NN_ATOMIC_STORE(&g_nNumAllocs, 0);
+	NN_ATOMIC_STORE(&g_nNumFrees,  0);
+	NN_ATOMIC_STORE(&g_nNumFailed, 0);
+
+	/* The peak restarts at the live bytes, raised again by allocations meanwhile */
+	NN_ATOMIC_STORE(&g_nPeakBytes, NN_ATOMIC_LOAD(&g_nLiveBytes));
+	nLive = NN_ATOMIC_LOAD(&g_nLiveBytes);
+	nPeak = NN_ATOMIC_LOAD(&g_nPeakBytes);
+	while (nLive > nPeak && !NN_ATOMIC_CAS(&g_nPeakBytes, nPeak, nLive))
+		nPeak = NN_ATOMIC_LOAD(&g_nPeakBytes);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_DefaultAlloc                                                */
+/* Purpose:    The default allocator, malloc with counters                    */
+/* Remarks:    The size of the block is kept in a header in front of it,      */
+/*             NN_ALLOC_HEADER bytes keep the alignment of malloc.            */
+/* Returns:    The block, NULL if out of memory                               */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void* Nn_DefaultAlloc (size_t nSize, void* pUserData)
+{
+	PMEM   pHeader;
+	size_t nLive, nPeak;
+
+	(void) pUserData;
+
+	pHeader = (nSize <= (size_t) -1 - NN_ALLOC_HEADER) ? (PMEM) malloc(nSize + NN_ALLOC_HEADER) : NULL;
+	if (pHeader == NULL)
+	{
+		NN_ATOMIC_ADD(&g_nNumFailed, 1);
+		return NULL;
+	}
+	*(size_t*) pHeader = nSize;
+
+	NN_ATOMIC_ADD(&g_nNumAllocs, 1);
+	nLive = NN_ATOMIC_ADD(&g_nLiveBytes, nSize);
+	nPeak = NN_ATOMIC_LOAD(&g_nPeakBytes);
+	while (nLive > nPeak && !NN_ATOMIC_CAS(&g_nPeakBytes, nPeak, nLive))
+		nPeak = NN_ATOMIC_LOAD(&g_nPeakBytes);
+
+	return pHeader + NN_ALLOC_HEADER;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_DefaultFree                                                 */
+/* Purpose:    Releases a block of the default allocator                      */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_DefaultFree (void* pBlock, void* pUserData)
+{
+	PMEM pHeader;
+
+	(void) pUserData;
+
+	pHeader = (PMEM) pBlock - NN_ALLOC_HEADER;
+	NN_ATOMIC_ADD(&g_nNumFrees, 1);
+	NN_ATOMIC_SUB(&g_nLiveBytes, *(size_t*) pHeader);
+	free(pHeader);
+}
+
 /*/////////////////////////////////////////////////////////////////////*/
 /* Output stream functions                                             */
 /*/////////////////////////////////////////////////////////////////////*/
@@ -618,14 +1333,14 @@ void Nn_Printf (PCSTR pchFormat, ...)
 /* Error functions                                                     */
 /*/////////////////////////////////////////////////////////////////////*/
 
-/* Module local error code (last one) */
-static NN_STATUS g_nErrNo = NN_OK;
+/* Module local error code (last one), per thread */
+static NN_THREAD_LOCAL NN_STATUS g_nErrNo = NN_OK;
 
-/* Module local error message (last one) */
-static char g_pchErrMsg [512];
+/* Module local error message (last one), per thread */
+static NN_THREAD_LOCAL char g_pchErrMsg [512];
 
-/* Module local number of errors */
-static int g_nNumErrors = 0;
+/* Module local number of errors, per thread */
+static NN_THREAD_LOCAL int g_nNumErrors = 0;
 
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function:   Nn_GetErrNo                                                    */
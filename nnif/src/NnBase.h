@@ -15,7 +15,7 @@ extern "C" {
 
 /* Define the current version of NNFF descibed in this header file */
 #define NN_VERSION_MAJOR    1
-#define NN_VERSION_MINOR    3
+#define NN_VERSION_MINOR    4
 
 /* Define the overall floating point type for NNFF */
 /* DO NOT CHANGE WITHOUT CHANGING THE NNFF VERSION NO. */
@@ -45,6 +45,13 @@ extern "C" {
 /* 	#define NDEBUG                                                          */
 /* #endif                                                                   */
 
+/* Storage class of variables with one instance per thread */
+#if defined(_MSC_VER)
+#define NN_THREAD_LOCAL __declspec(thread)
+#else
+#define NN_THREAD_LOCAL __thread
+#endif
+
 /* The basic boolean type */
 typedef int BOOL;
 /* The boolean values */
@@ -189,15 +196,37 @@ typedef struct SNnUnitAttrib
 	short     iUnit;           /* [ 2][ 4] Index of this unit within the layer   */
 	short     nNumConns;       /* [ 2][ 6] Number of incoming connections        */
 	short     bHasMatrix;      /* [ 2][ 8] If not zero, the unit has a matrix    */
-	short     alignment_1[4];  /* [ 8][16] RESERVED                              */
+	short     nTrnFnId;        /* [ 2][10] I/O transform function identifier     */
+	short     nTrnFlags;       /* [ 2][12] I/O transform flags (NN_TRN_...)      */
+	short     alignment_1[2];  /* [ 4][16] RESERVED                              */
 	NN_FLOAT  fInpBias;        /* [ 8][24] Input bias                            */
 	NN_FLOAT  fInpScale;       /* [ 8][32] Input scaling                         */
 	NN_FLOAT  fOutBias;        /* [ 8][40] Output bias                           */
 	NN_FLOAT  fOutScale;       /* [ 8][48] Output scaling                        */
-	NN_FLOAT  alignment_2[2];  /* [16][64] RESERVED                              */
+	NN_FLOAT  fTrnMin;         /* [ 8][56] I/O transform range minimum           */
+	NN_FLOAT  fTrnMax;         /* [ 8][64] I/O transform range maximum           */
 }
 NN_UNIT_ATTRIB;
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* I/O transforms, introduced in version 1.4:                                 */
+/* The units of the input and output layer may carry a transform which is     */
+/* applied by the processing routines (see NnProc.h) to the net input and     */
+/* output vectors. The transform function nTrnFnId is one of NN_FUNC_ZERO     */
+/* (no transform, the default), NN_FUNC_IDENTITY, NN_FUNC_EXPONENTIAL and     */
+/* NN_FUNC_LOGARITHMIC. If NN_TRN_SCALE is set in nTrnFlags, the range        */
+/* [fTrnMin, fTrnMax] is additionally mapped to [0, 1]:                       */
+/*     input  unit:  x' = (f(x) - fTrnMin) / (fTrnMax - fTrnMin)              */
+/*     output unit:  y' = f(y * (fTrnMax - fTrnMin) + fTrnMin)                */
+/* The range refers to the transformed input and to the untransformed output  */
+/* values, respectively.                                                      */
+/* If NN_TRN_RANGE is set, [fTrnMin, fTrnMax] is the training range of the    */
+/* unit. For input units it is used by the range check of the batch routines. */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#define NN_TRN_SCALE   0x0001   /* Apply the min/max range scaling */
+#define NN_TRN_RANGE   0x0002   /* The min/max range is the training range */
+
 #define NN_UNIT_SECTION_SIZE   (sizeof (NN_UNIT_ATTRIB))
 
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -226,6 +255,7 @@ struct SNnNet;    /* The net structure                                        */
 struct SNnLayer;  /* The layer structure                                      */
 struct SNnUnit;   /* The unit structure                                       */
 struct SNnConn;   /* The connection structure                                 */
+struct SNnProfile; /* The profiling counters (see NnProf.h)                   */
 
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Type abbreviations                                                         */
@@ -237,6 +267,9 @@ typedef struct SNnUnit  *  NN_AUNITS;   /* Pointer to array of unit structures *
 typedef struct SNnConn  *  NN_PCONN;    /* Pointer to single connection structure */
 typedef struct SNnConn  *  NN_ACONNS;   /* Pointer to array of connection structures */
 
+/* Releases the view of a file a net refers to (see NN_NET) */
+typedef void (*NN_UNMAP_FN) (PCMEM pView, size_t nViewSize);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Type:    NN_NET                                                            */
 /* Purpose: Structure to reproduce the neural net object in memory.           */
@@ -247,6 +280,21 @@ typedef struct SNnNet
 {
 	NN_NET_ATTRIB    na;        /* Net attributes */
 	NN_ALAYERS       aLayers;   /* Array of layer structures */
+	NN_FLOAT *       afBatch;   /* Work buffer of the batch routines (see NnProc.h) */
+	struct SNnProfile* aProfile; /* Profiling counters per layer (see NnProf.h) */
+	NN_FLOAT *       afConnWeight; /* Compact connections: weights of all units (see Nn_CreateConnTable) */
+	unsigned short * anConnSrc16; /* Compact connections: source unit numbers if the net */
+	                              /* has at most 65536 units, NULL otherwise */
+	unsigned int *   anConnSrc32; /* Compact connections: source unit numbers otherwise */
+	PMEM             pArena;    /* Arena of layers, units, connections and matrices (or NULL) */
+	size_t           nArenaSize; /* Size of the arena in bytes */
+	size_t           nArenaUsed; /* Number of bytes handed out from the arena */
+	void *           pArenaBlock; /* Heap block holding the aligned arena */
+	BOOL             bFrozen;   /* TRUE if the net has been frozen (see Nn_FreezeNet) */
+	PCMEM            pView;     /* Mapped file the compact connections of a frozen net */
+	                            /* point into (see Nn_MapNetFromBinFile), or NULL */
+	size_t           nViewSize; /* Size of the view in bytes */
+	NN_UNMAP_FN      pfnUnmap;  /* Releases the view with the net, or NULL */
 }
 NN_NET;
 
@@ -260,6 +308,9 @@ typedef struct SNnLayer
 {
 	NN_LAYER_ATTRIB  la;        /* Layer attributes */
 	NN_AUNITS        aUnits;    /* Array of layer structures (DIM=nNumUnits) */
+	NN_FLOAT *       afBatchOut; /* Unit outputs of the current batch block, */
+	                             /* points into the work buffer of the net   */
+	long             iFirstUnit; /* Number of the first unit within the net  */
 }
 NN_LAYER;
 
@@ -277,6 +328,11 @@ typedef struct SNnUnit
 	NN_FLOAT         fOut;      /* Current output    */
 	NN_ACONNS        aConns;    /* Array of connections (DIM=nNumConns) */
 	NN_FLOAT **      ppfMatrix; /* Inverse co-variance matrix (DIM=nNumConns^2) */
+	long             iFirstConn; /* Index of the first connection in the compact */
+	                             /* connections of the net                       */
+	long             iFirstSrc;  /* Index of its source unit number, the same as */
+	                             /* iFirstConn unless the weights and source     */
+	                             /* units lie in the view of a mapped file       */
 }
 NN_UNIT;
 
@@ -346,6 +402,130 @@ NN_STATUS Nn_CreateNet (NN_PNET* ppNet);
 
 void Nn_DeleteNet (NN_PNET pNet);
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Net methods concerning the arena                                           */
+
+/* Alignment of the layer, unit and matrix blocks allocated from an arena */
+#define NN_ARENA_ALIGN  64
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CreateArena                                                 */
+/* Purpose:    Creates a single zeroed heap block from which the layers,      */
+/*             units, connections and matrices of the net are allocated       */
+/* Remarks:    Must be called before Nn_CreateLayers. The size is the sum of  */
+/*             the Nn_Get*ArenaSize values of all blocks to be created. If    */
+/*             the arena is exhausted, further blocks are allocated on the    */
+/*             heap, so a size estimated too small costs only speed.          */
+/*             The arena is released by Nn_DeleteNet.                         */
+/* Returns:    NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateArena (NN_PNET pNet, size_t nSize);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_IsArenaBlock                                                */
+/* Purpose:    Checks whether a block has been allocated from the arena of    */
+/*             the net                                                        */
+/* Returns:    TRUE if so, FALSE if it is a heap block of its own             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsArenaBlock (const NN_PNET pNet, const void* pBlock);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_IsViewBlock                                                 */
+/* Purpose:    Checks whether a block lies in the view of the mapped file the */
+/*             net refers to                                                  */
+/* Returns:    TRUE if so, FALSE otherwise                                    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsViewBlock (const NN_PNET pNet, const void* pBlock);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_AllocBlock                                                  */
+/* Purpose:    Allocates a zeroed block from the arena of the net, or from    */
+/*             the heap if there is no arena or it is exhausted               */
+/* Remarks:    The alignment is a power of two up to NN_ARENA_ALIGN.          */
+/* Returns:    The block, NULL if out of memory                               */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void* Nn_AllocBlock (NN_PNET pNet, size_t nSize, size_t nAlign);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_GetArenaBlockSize                                           */
+/* Purpose:    Gets the arena space needed by a block of Nn_AllocBlock        */
+/* Returns:    The number of bytes                                            */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetArenaBlockSize (size_t nSize, size_t nAlign);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_GetLayersArenaSize, Nn_GetUnitsArenaSize,                   */
+/*             Nn_GetConnsArenaSize, Nn_GetMatrixArenaSize                    */
+/* Purpose:    Get the arena space needed by Nn_CreateLayers,                 */
+/*             Nn_CreateUnitsIn, Nn_CreateConnsIn and Nn_CreateMatrixIn,      */
+/*             including alignment                                            */
+/* Returns:    The number of bytes                                            */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetLayersArenaSize (short nNumLayers);
+size_t Nn_GetUnitsArenaSize (short nNumUnits);
+size_t Nn_GetConnsArenaSize (short nNumConns);
+size_t Nn_GetMatrixArenaSize (short nNumConns);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Net methods concerning the compact connections                             */
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CreateConnTable                                             */
+/* Purpose:    Creates the compact connections of the net used by the batch   */
+/*             routines: the weights of all connections in a single array,    */
+/*             unit by unit, and the numbers of their source units, counted   */
+/*             over all layers (16 bit if the net has at most 65536 units,    */
+/*             32 bit otherwise)                                              */
+/* Remarks:    Called by Nn_AssertSemanticIntegrity, which also validates the */
+/*             connections. The connection structures (NN_CONN) remain the    */
+/*             master copy, so Nn_AssertSemanticIntegrity must be called      */
+/*             again after changing them. An existing table is replaced.      */
+/* Returns:    NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateConnTable (NN_PNET pNet);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_DeleteConnTable                                             */
+/* Purpose:    Releases the compact connections of the net                    */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_DeleteConnTable (NN_PNET pNet);
+
+/* Gets the number of the source unit at the index iSrc of the compact      */
+/* connections of a net, iFirstSrc plus the connection of the unit           */
+#define NN_CONN_SRC(pNet, iSrc) \
+	((pNet)->anConnSrc16 != NULL ? (long) (pNet)->anConnSrc16[iSrc] : (long) (pNet)->anConnSrc32[iSrc])
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Net methods concerning the frozen image                                    */
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_FreezeNet                                                   */
+/* Purpose:    Replaces the editable structures of a validated net by a       */
+/*             read-only image in a single heap block                         */
+/* Remarks:    The image holds the layers, the units of all layers in one     */
+/*             array, in the order of the layers, and the compact connections */
+/*             (see Nn_CreateConnTable). The connection structures and the    */
+/*             matrices are released, the units keep their attributes.        */
+/*             All processing routines accept a frozen net, and               */
+/*             Nn_AssertSemanticIntegrity only checks its numbers of input    */
+/*             and output units. The net can no longer be written to a file   */
+/*             or changed, only deleted.                                      */
+/*             Freezing a frozen net does nothing.                            */
+/* Returns:    NN_OK (or zero) for success, NN_INCOMPLETE_STRUCTURE if the    */
+/*             net has not been validated, NN_OUT_OF_MEMORY otherwise         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_FreezeNet (NN_PNET pNet);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Net methods concerning the layer objects (NN_PLAYER);                      */
 
@@ -415,6 +595,15 @@ NN_PLAYER Nn_GetInputLayer(const NN_PNET pNet);
 
 NN_PLAYER Nn_GetOutputLayer(const NN_PNET pNet);
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_HasTransforms                                               */
+/* Purpose:    Checks whether any unit of the input or output layer carries   */
+/*             an I/O transform (see NN_TRN_SCALE)                            */
+/* Returns:    TRUE if so, FALSE otherwise                                    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_HasTransforms(const NN_PNET pNet);
+
 /*/////////////////////////////////////////////////////////////////////*/
 /* Layer object (NN_PLAYER) methods                                    */
 /*/////////////////////////////////////////////////////////////////////*/
@@ -449,11 +638,24 @@ BOOL Nn_UnitsCreated (const NN_PLAYER pLayer);
 
 NN_STATUS Nn_CreateUnits (NN_PLAYER pLayer);
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CreateUnitsIn                                               */
+/* Purpose:    Creates all units of an initialized layer object of the given  */
+/*             net, allocated from the arena of the net if it has one         */
+/* Remarks:    See Nn_CreateUnits. Nn_CreateUnits(pLayer) is equal to         */
+/*             Nn_CreateUnitsIn(NULL, pLayer).                                */
+/* Returns:    NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateUnitsIn (NN_PNET pNet, NN_PLAYER pLayer);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function:   Nn_DeleteUnits                                                 */
 /* Purpose:    Releases all memory allocated by the units of the layer object */
 /* Remarks:    The function deletes also all connections and if present, the  */
-/*             inverse co-variance matrix                                     */
+/*             inverse co-variance matrix.                                    */
+/*             Not for units allocated from an arena, these are released      */
+/*             with the net.                                                  */
 /* Returns:    No return value                                                */
 /*////////////////////////////////////////////////////////////////////////////*/
 
@@ -496,9 +698,20 @@ BOOL Nn_ConnsCreated (const NN_PUNIT pUnit);
 
 NN_STATUS Nn_CreateConns (NN_PUNIT pUnit);
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CreateConnsIn                                               */
+/* Purpose:    Creates all connections of an initialized unit object of the   */
+/*             given net, allocated from the arena of the net if it has one   */
+/* Remarks:    See Nn_CreateConns                                             */
+/* Returns:    NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateConnsIn (NN_PNET pNet, NN_PUNIT pUnit);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_DeleteConns                                                   */
 /* Purpose:  Releases all memory allocated by the connections of the unit object */
+/* Remarks:  Not for connections allocated from an arena                      */
 /* Returns:  No return value                                                    */
 /*////////////////////////////////////////////////////////////////////////////  */
 
@@ -538,19 +751,41 @@ BOOL Nn_MatrixCreated (const NN_PUNIT pUnit);
 /* Remarks:    The number of connections must previously have been set to a value  */
 /*             greater or equal zero. The size of the matrix will be the square of */
 /*             the number of incoming connections.                                 */
+/*             The row vector and the elements are allocated as a single block,    */
+/*             the elements are stored row by row and aligned to NN_ARENA_ALIGN.   */
 /* Returns:    NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise             */
 /*////////////////////////////////////////////////////////////////////////////     */
 
 NN_STATUS Nn_CreateMatrix (NN_PUNIT pUnit);
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CreateMatrixIn                                              */
+/* Purpose:    Creates the inverse co-variance matrix of an initialized unit  */
+/*             object of the given net, allocated from the arena of the net   */
+/*             if it has one                                                  */
+/* Remarks:    See Nn_CreateMatrix                                            */
+/* Returns:    NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateMatrixIn (NN_PNET pNet, NN_PUNIT pUnit);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_DeleteMatrix                                                  */
 /* Purpose:  Releases the memory allocated by the inverse co-variance matrix  */
+/* Remarks:  Not for matrices allocated from an arena                         */
 /* Returns:  No return value                                                  */
 /*////////////////////////////////////////////////////////////////////////////*/
 
 void Nn_DeleteMatrix (NN_PUNIT pUnit);
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetMatrixSize                                                 */
+/* Purpose:  Gets the size of the block allocated by Nn_CreateMatrix          */
+/* Returns:  The number of bytes, zero if nNumConns is zero                   */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetMatrixSize (short nNumConns);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_GetMatrix                                                     */
 /* Purpose:  Gets the inverse co-variance matrix of a unit                    */
@@ -568,6 +803,15 @@ NN_FLOAT** Nn_GetMatrix (NN_PUNIT pUnit);
 
 NN_FLOAT* Nn_GetMatrixRowAt (NN_PUNIT pUnit, short iC);
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetMatrixElems                                                */
+/* Purpose:  Gets all elements of the inverse co-variance matrix of a unit    */
+/* Remarks:  The matrix must have been created.                               */
+/* Returns:  The rows of the matrix, stored one after the other               */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_FLOAT* Nn_GetMatrixElems (NN_PUNIT pUnit);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_GetMatrixRowAt                                                */
 /* Purpose:  Gets an element of the inverse co-variance matrix of a unit at a */
@@ -586,6 +830,82 @@ NN_FLOAT Nn_GetMatrixElemAt (const NN_PUNIT pUnit, short iCRow, short iCCol);
 
 void Nn_SetMatrixElemAt (NN_PUNIT pUnit, short iCRow, short iCCol, NN_FLOAT fM);
 
+/*/////////////////////////////////////////////////////////////////////*/
+/* Memory allocation functions                                         */
+/*/////////////////////////////////////////////////////////////////////*/
+
+/* Allocator hooks, see Nn_SetAllocator */
+typedef void* (*NN_ALLOC_FN) (size_t nSize, void* pUserData);
+typedef void  (*NN_FREE_FN)  (void* pBlock, void* pUserData);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_ALLOC_STATS                                                    */
+/* Purpose: Counters of the default allocator, see Nn_GetAllocStats           */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnAllocStats
+{
+	size_t  nLiveBytes;     /* Bytes currently allocated                    */
+	size_t  nPeakBytes;     /* Maximum of nLiveBytes                        */
+	size_t  nNumAllocs;     /* Number of allocations                        */
+	size_t  nNumFrees;      /* Number of releases                           */
+	size_t  nNumFailed;     /* Number of failed allocations                 */
+}
+NN_ALLOC_STATS;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_SetAllocator                                                */
+/* Purpose:    Sets the functions used for all heap memory of the library:    */
+/*             nets, arenas, work buffers and memory streams                  */
+/* Remarks:    pfnAlloc returns NULL if out of memory, the blocks need not be */
+/*             zeroed and must be aligned for any type (like malloc).         */
+/*             pUserData is passed through to both functions. If pfnAlloc or  */
+/*             pfnFree is NULL, the default allocator (malloc and free, with  */
+/*             counters) is restored. Blocks are always released by the       */
+/*             allocator that was set when they were allocated, so the        */
+/*             allocator shall only be changed while no net exists.           */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_SetAllocator (NN_ALLOC_FN pfnAlloc, NN_FREE_FN pfnFree, void* pUserData);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_Alloc                                                       */
+/* Purpose:    Allocates a zeroed block with the current allocator            */
+/* Returns:    The block, NULL if out of memory                               */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void* Nn_Alloc (size_t nSize);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_Free                                                        */
+/* Purpose:    Releases a block allocated by Nn_Alloc                         */
+/* Remarks:    Does nothing if pBlock is NULL                                 */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_Free (void* pBlock);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_GetAllocStats                                               */
+/* Purpose:    Gets the counters of the default allocator                     */
+/* Remarks:    The counters are maintained for all threads. They stay         */
+/*             unchanged while another allocator is set.                      */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_GetAllocStats (NN_ALLOC_STATS* pStats);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_ResetAllocStats                                             */
+/* Purpose:    Sets the call counters of the default allocator to zero and    */
+/*             the peak to the bytes currently allocated                      */
+/* Remarks:    E.g. to measure the allocations of loading a net               */
+/* Returns:    No return value                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_ResetAllocStats (void);
+
 /*/////////////////////////////////////////////////////////////////////*/
 /* Output stream functions                                             */
 /*/////////////////////////////////////////////////////////////////////*/
@@ -617,9 +937,11 @@ void Nn_Printf (PCSTR pchFormat, ...);
 
 /*/////////////////////////////////////////////////////////////////////*/
 /* Error functions                                                     */
+/* The error code, message and number of errors are kept per thread,   */
+/* so threads loading nets at the same time don't see each other's     */
+/* errors.                                                             */
 /*/////////////////////////////////////////////////////////////////////*/
 
-
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function:   Nn_GetErrNo                                                    */
 /* Purpose:    Gets the error code of the last error                          */
@@ -0,0 +1,1348 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnBin2IO.c                                                    */
+/* Purpose:     Implementation of the binary I/O routines of NNFF 2.0         */
+/* Remarks:     Interface def. in NnBin2IO.h                                  */
+/*              The records are copied from the file before they are used,    */
+/*              so the memory holding the file needs no particular alignment. */
+/*              Only the frozen net of Nn_MapBin2Net uses the weights and     */
+/*              source units in place, if the file is aligned.                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "NnBase.h"
+#include "NnCheck.h"
+#include "NnBin2IO.h"
+#include "utils/endian_order.h"
+#include "utils/lz_pack.h"
+
+/* Rounds a file offset up to the block alignment */
+#define NN_BIN2_ALIGN_UP(n)  (((n) + NN_BIN2_ALIGN - 1) & ~((size_t) NN_BIN2_ALIGN - 1))
+
+/* Size of the source unit numbers */
+#define NN_BIN2_SOURCE_SIZE  (sizeof (NN_BIN2_UINT32))
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Module local prototypes:                                                   */
+/*                                                                            */
+NN_STATUS Nn_GetBin2Header   (PCMEM pMem, size_t nMemSize, NN_BIN2_HEADER* pHdr, BOOL* pbPacked);
+NN_STATUS Nn_ReadBin2Units   (NN_PNET pNet, NN_PLAYER pLayer, PCMEM pMem, const NN_BIN2_HEADER* pHdr, const NN_BIN2_LAYER* pLr, PCMEM pUnpacked);
+NN_STATUS Nn_UnpackBin2Layer (PCMEM pMem, const NN_BIN2_HEADER* pHdr, const NN_BIN2_LAYER* pLr, PMEM pUnpacked, PMEM pPlanes);
+size_t    Nn_GetBin2ArenaSize (PCMEM pMem, const NN_BIN2_HEADER* pHdr, BOOL bPacked);
+size_t    Nn_GetBin2PayloadSize (const NN_BIN2_HEADER* pHdr, const NN_BIN2_LAYER* pLr);
+BOOL      Nn_FitsBin2Packed  (const NN_BIN2_HEADER* pHdr, const NN_BIN2_LAYER* pLr);
+void      Nn_GetBin2Layer    (PCMEM pMem, const NN_BIN2_HEADER* pHdr, short iL, NN_BIN2_LAYER* pLr);
+void      Nn_GetBin2Unit     (PCMEM pMem, const NN_BIN2_LAYER* pLr, short iU, NN_BIN2_UNIT* pUr);
+BOOL      Nn_FitsBin2Block   (const NN_BIN2_HEADER* pHdr, size_t nOffset, size_t nSize);
+BOOL      Nn_GetBin2Source   (const NN_PNET pNet, NN_BIN2_UINT32 nSource, NN_PCONN pConn);
+NN_FLOAT  Nn_GetBin2Elem     (PCMEM pBlock, long iElem, int nPayload);
+void      Nn_PutBin2Elem     (PMEM pBlock, long iElem, NN_FLOAT fElem, int nPayload);
+void      Nn_GetBin2Elems    (PCMEM pBlock, long iElem, long nNumElems, NN_FLOAT* pfElems, int nPayload);
+void      Nn_PutBin2Elems    (PMEM pBlock, long iElem, long nNumElems, const NN_FLOAT* pfElems, int nPayload);
+NN_STATUS Nn_BuildBin2Image  (const NN_PNET pNet, int nPayload, PMEM* ppImage, size_t* pnSize);
+NN_STATUS Nn_PackBin2Image   (PMEM* ppImage, size_t* pnSize);
+NN_STATUS Nn_SetBin2FormatError (PCSTR pchWhat);
+
+void eo_swap_bin2_header(NN_BIN2_HEADER* pHdr);
+void eo_swap_bin2_layer(NN_BIN2_LAYER* pLr);
+void eo_swap_bin2_unit(NN_BIN2_UNIT* pUr);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IsBin2Mem                                                     */
+/* Purpose:  Checks whether a memory block holds a NNFF 2.0 file              */
+/* Returns:  TRUE if it starts with the magic number, FALSE otherwise         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsBin2Mem (PCMEM pMem, size_t nMemSize)
+{
+	assert(pMem != NULL || nMemSize == 0);
+
+	return nMemSize >= 4 && memcmp(pMem, NN_BIN2_MAGIC, 4) == 0;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReadBin2Net                                                   */
+/* Purpose:  Reads a neural net object from a NNFF 2.0 file in memory         */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ReadBin2Net
+(
+	NN_PNET  pNet,
+	PCMEM    pMem,
+	size_t   nMemSize,
+	size_t*  pnBytesRead
+)
+{
+	NN_STATUS       nns;
+	NN_BIN2_HEADER  hdr;
+	NN_BIN2_LAYER   lr;
+	NN_PLAYER       pLayer;
+	PMEM            pUnpacked;
+	size_t          nUnpackedSize, nPlanesSize;
+	BOOL            bPacked;
+	short           iL;
+
+	assert(pNet != NULL);
+	assert(pMem != NULL);
+
+	if (pnBytesRead != NULL)
+		*pnBytesRead = 0;
+
+	/* Check the magic number and read the header */
+	nns = Nn_GetBin2Header(pMem, nMemSize, &hdr, &bPacked);
+	if (nns != NN_OK)
+		return nns;
+
+	/* Copy the net attributes, the version remains the one of NN_NET_ATTRIB */
+	pNet->na.nNumLayers = hdr.nNumLayers;
+	pNet->na.iInpLayer  = hdr.iInpLayer;
+	pNet->na.iOutLayer  = hdr.iOutLayer;
+	pNet->na.nPrecision = hdr.nPrecision;
+
+	/* Size the arena of the net from the records and create it */
+	nns = Nn_CreateArena(pNet, Nn_GetBin2ArenaSize(pMem, &hdr, bPacked));
+	if (nns != NN_OK)
+		return nns;
+
+	/* Create all layers for the neural net object */
+	nns = Nn_CreateLayers(pNet);
+	if (nns != NN_OK)
+		return nns;
+
+	/* Read all layers and create their units, the source units of the */
+	/* connections are resolved with the number of units of all layers */
+	nUnpackedSize = 0;
+	nPlanesSize = 0;
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		Nn_GetBin2Layer(pMem, &hdr, iL, &lr);
+		if (lr.nNumUnits < 0)
+			return Nn_SetBin2FormatError("layer record");
+
+		/* A single buffer holds the unpacked payload of any layer, */
+		/* and the byte planes of any filtered layer                 */
+		if (bPacked)
+		{
+			if (!Nn_FitsBin2Packed(&hdr, &lr))
+				return Nn_SetBin2FormatError("packed payload");
+			if (nUnpackedSize < Nn_GetBin2PayloadSize(&hdr, &lr))
+				nUnpackedSize = Nn_GetBin2PayloadSize(&hdr, &lr);
+			if (lr.nFilter != NN_BIN2_FILTER_NONE && nPlanesSize < Nn_GetBin2PayloadSize(&hdr, &lr))
+				nPlanesSize = Nn_GetBin2PayloadSize(&hdr, &lr);
+		}
+
+		pLayer = Nn_GetLayerAt(pNet, iL);
+		pLayer->la.iLayer    = lr.iLayer;
+		pLayer->la.nNumUnits = lr.nNumUnits;
+		pLayer->la.nInpFnId  = lr.nInpFnId;
+		pLayer->la.nActFnId  = lr.nActFnId;
+		pLayer->la.nOutFnId  = lr.nOutFnId;
+		pLayer->la.fActSlope = lr.fActSlope;
+		pLayer->la.fActThres = lr.fActThres;
+
+		nns = Nn_CreateUnitsIn(pNet, pLayer);
+		if (nns != NN_OK)
+			return nns;
+	}
+
+	/* The planes are no larger than the payload */
+	pUnpacked = NULL;
+	if (nUnpackedSize > 0)
+	{
+		pUnpacked = nUnpackedSize <= ((size_t) -1) / 2 ? (PMEM) Nn_Alloc(nUnpackedSize + nPlanesSize) : NULL;
+		if (pUnpacked == NULL)
+			return Nn_SetOutOfMemoryError();
+	}
+
+	/* Read the units of all layers with their connections and matrices */
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		Nn_GetBin2Layer(pMem, &hdr, iL, &lr);
+		if (bPacked)
+		{
+			nns = Nn_UnpackBin2Layer(pMem, &hdr, &lr, pUnpacked, pUnpacked + nUnpackedSize);
+			if (nns != NN_OK)
+				break;
+		}
+		nns = Nn_ReadBin2Units(pNet, Nn_GetLayerAt(pNet, iL), pMem, &hdr, &lr, bPacked ? pUnpacked : NULL);
+		if (nns != NN_OK)
+			break;
+	}
+
+	Nn_Free(pUnpacked);
+	if (nns != NN_OK)
+		return nns;
+
+	if (pnBytesRead != NULL)
+		*pnBytesRead = hdr.nFileSize;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_MapBin2Net                                                    */
+/* Purpose:  Builds a frozen net from a NNFF 2.0 file in memory, the weights  */
+/*           and source units of the compact connections are used in place    */
+/* Remarks:  The blocks are used in place if they have the type and byte      */
+/*           order of the processing routines: little-endian source units,    */
+/*           and double weights which are not packed. Otherwise they are      */
+/*           converted into the arena of the net. The biases are copied into  */
+/*           the units, where the processing routines take them from.         */
+/*           A packed layer is unpacked straight into the weights of the      */
+/*           arena, its biases and matrices spill over into those of the      */
+/*           next layers. Only the byte planes of a filtered layer need a     */
+/*           buffer of their own.                                             */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_MapBin2Net
+(
+	NN_PNET  pNet,
+	PCMEM    pMem,
+	size_t   nMemSize
+)
+{
+	NN_STATUS       nns;
+	NN_BIN2_HEADER  hdr;
+	NN_BIN2_LAYER   lr;
+	NN_BIN2_UNIT    ur;
+	NN_BIN2_UINT32  nSource;
+	NN_PLAYER       pLayer;
+	NN_PUNIT        pUnit;
+	NN_AUNITS       aUnits;
+	NN_FLOAT*       afWeight;
+	unsigned int*   anSource;
+	PCMEM           pWeights, pBias;
+	PMEM            pPlanes;
+	size_t          nPayload, nLayerSize, nWeightsSize, nPlanesSize, nArenaSize;
+	long            nNumUnits, nNumConns, iFirstConn, iConn;
+	BOOL            bPacked, bViewWeights, bViewSources;
+	short           iL, iU;
+
+	assert(pNet != NULL);
+	assert(pMem != NULL);
+
+	nns = Nn_GetBin2Header(pMem, nMemSize, &hdr, &bPacked);
+	if (nns != NN_OK)
+		return nns;
+	nPayload = (size_t) hdr.nPayload;
+
+	/* The blocks are aligned within the file, so they are in memory */
+	/* if the file is                                                */
+	bViewSources = eo_endian_order() == LITTLE_ENDIAN && (size_t) pMem % NN_BIN2_ALIGN == 0;
+	bViewWeights = bViewSources && !bPacked && hdr.nPayload == NN_PREC_DOUBLE;
+
+	/* Check the blocks of all layers and count the units and connections. */
+	/* The unit records and the source units of all layers fit the file,   */
+	/* so a corrupt record can't size the arena beyond the file.           */
+	nNumUnits = 0;
+	nNumConns = 0;
+	nWeightsSize = 0;
+	nPlanesSize = 0;
+	for (iL = 0; iL < hdr.nNumLayers; iL++)
+	{
+		Nn_GetBin2Layer(pMem, &hdr, iL, &lr);
+		if (lr.nNumUnits < 0 ||
+			(size_t) lr.nNumUnits > hdr.nFileSize / sizeof (NN_BIN2_UNIT) - nNumUnits ||
+			!Nn_FitsBin2Block(&hdr, lr.nUnitsOffset, lr.nNumUnits * sizeof (NN_BIN2_UNIT)))
+			return Nn_SetBin2FormatError("unit block");
+		if (lr.nNumConns > hdr.nFileSize / NN_BIN2_SOURCE_SIZE - nNumConns ||
+			!Nn_FitsBin2Block(&hdr, lr.nSourcesOffset, lr.nNumConns * NN_BIN2_SOURCE_SIZE))
+			return Nn_SetBin2FormatError("connection block");
+
+		/* The payload of a packed layer is unpacked at its weights */
+		if (bPacked)
+		{
+			if (!Nn_FitsBin2Packed(&hdr, &lr))
+				return Nn_SetBin2FormatError("packed payload");
+			nLayerSize = Nn_GetBin2PayloadSize(&hdr, &lr);
+			if (lr.nFilter != NN_BIN2_FILTER_NONE && nPlanesSize < nLayerSize)
+				nPlanesSize = nLayerSize;
+			if (nLayerSize < lr.nNumConns * sizeof (NN_FLOAT))
+				nLayerSize = lr.nNumConns * sizeof (NN_FLOAT);
+			if (nLayerSize > ((size_t) -1) / 2 - nNumConns * sizeof (NN_FLOAT))
+				return Nn_SetOutOfMemoryError();
+			if (nWeightsSize < nNumConns * sizeof (NN_FLOAT) + nLayerSize)
+				nWeightsSize = nNumConns * sizeof (NN_FLOAT) + nLayerSize;
+		}
+		else
+		{
+			if (!Nn_FitsBin2Block(&hdr, lr.nBiasOffset, lr.nNumUnits * nPayload))
+				return Nn_SetBin2FormatError("unit block");
+			if (!Nn_FitsBin2Block(&hdr, lr.nWeightsOffset, lr.nNumConns * nPayload))
+				return Nn_SetBin2FormatError("connection block");
+		}
+
+		nNumUnits += lr.nNumUnits;
+		nNumConns += (long) lr.nNumConns;
+	}
+	if (!bPacked)
+		nWeightsSize = nNumConns * sizeof (NN_FLOAT);
+
+	/* The arena holds the layers, the units of all layers in one array */
+	/* and the weights and source units not used in place               */
+	nArenaSize = Nn_GetLayersArenaSize(hdr.nNumLayers) +
+		Nn_GetArenaBlockSize(nNumUnits * sizeof (NN_UNIT), NN_ARENA_ALIGN);
+	if (!bViewWeights)
+		nArenaSize += Nn_GetArenaBlockSize(nWeightsSize, NN_ARENA_ALIGN);
+	if (!bViewSources)
+		nArenaSize += Nn_GetArenaBlockSize(nNumConns * sizeof (unsigned int), NN_ARENA_ALIGN);
+
+	pNet->na.nNumLayers = hdr.nNumLayers;
+	pNet->na.iInpLayer  = hdr.iInpLayer;
+	pNet->na.iOutLayer  = hdr.iOutLayer;
+	pNet->na.nPrecision = hdr.nPrecision;
+
+	nns = Nn_CreateArena(pNet, nArenaSize);
+	if (nns != NN_OK)
+		return nns;
+	nns = Nn_CreateLayers(pNet);
+	if (nns != NN_OK)
+		return nns;
+
+	/* Set and check the attributes of the layers and the net */
+	nNumUnits = 0;
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		Nn_GetBin2Layer(pMem, &hdr, iL, &lr);
+
+		pLayer = Nn_GetLayerAt(pNet, iL);
+		pLayer->la.iLayer    = iL;
+		pLayer->la.nNumUnits = lr.nNumUnits;
+		pLayer->la.nInpFnId  = lr.nInpFnId;
+		pLayer->la.nActFnId  = lr.nActFnId;
+		pLayer->la.nOutFnId  = lr.nOutFnId;
+		pLayer->la.fActSlope = lr.fActSlope;
+		pLayer->la.fActThres = lr.fActThres;
+		pLayer->iFirstUnit   = nNumUnits;
+		nNumUnits += lr.nNumUnits;
+
+		nns = Nn_CheckLayerAttrib(pNet, iL);
+		if (nns != NN_OK)
+			return nns;
+	}
+	nns = Nn_CheckNetAttrib(pNet, -1, -1);
+	if (nns != NN_OK)
+		return nns;
+
+	/* The blocks fit the arena, it has been sized for them */
+	aUnits   = (NN_AUNITS) Nn_AllocBlock(pNet, nNumUnits * sizeof (NN_UNIT), NN_ARENA_ALIGN);
+	afWeight = (NN_FLOAT*) pMem;
+	anSource = (unsigned int*) pMem;
+	if (nWeightsSize > 0 && !bViewWeights)
+		afWeight = (NN_FLOAT*) Nn_AllocBlock(pNet, nWeightsSize, NN_ARENA_ALIGN);
+	if (nNumConns > 0 && !bViewSources)
+		anSource = (unsigned int*) Nn_AllocBlock(pNet, nNumConns * sizeof (unsigned int), NN_ARENA_ALIGN);
+	assert(Nn_IsArenaBlock(pNet, aUnits));
+	assert(bViewWeights || nWeightsSize == 0 || Nn_IsArenaBlock(pNet, afWeight));
+	assert(bViewSources || nNumConns == 0 || Nn_IsArenaBlock(pNet, anSource));
+
+	pPlanes = NULL;
+	if (nPlanesSize > 0)
+	{
+		pPlanes = (PMEM) Nn_Alloc(nPlanesSize);
+		if (pPlanes == NULL)
+			return Nn_SetOutOfMemoryError();
+	}
+
+	/* Read the units of all layers, the connections of a unit follow */
+	/* those of the previous units                                    */
+	iFirstConn = 0;
+	for (iL = 0; iL < pNet->na.nNumLayers && nns == NN_OK; iL++)
+	{
+		Nn_GetBin2Layer(pMem, &hdr, iL, &lr);
+		pLayer = Nn_GetLayerAt(pNet, iL);
+		pLayer->aUnits = aUnits + pLayer->iFirstUnit;
+
+		if (bPacked)
+		{
+			nns = Nn_UnpackBin2Layer(pMem, &hdr, &lr, (PMEM) (afWeight + iFirstConn), pPlanes);
+			if (nns != NN_OK)
+				break;
+			pWeights = (PCMEM) (afWeight + iFirstConn);
+			pBias    = pWeights + lr.nNumConns * nPayload;
+		}
+		else
+		{
+			pWeights = pMem + lr.nWeightsOffset;
+			pBias    = pMem + lr.nBiasOffset;
+		}
+
+		iConn = 0;
+		for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+		{
+			Nn_GetBin2Unit(pMem, &lr, iU, &ur);
+
+			pUnit = Nn_GetUnitAt(pLayer, iU);
+			pUnit->ua.iLayer     = iL;
+			pUnit->ua.iUnit      = iU;
+			pUnit->ua.nNumConns  = ur.nNumConns;
+			pUnit->ua.bHasMatrix = (short) (ur.bHasMatrix != 0);
+			pUnit->ua.nTrnFnId   = ur.nTrnFnId;
+			pUnit->ua.nTrnFlags  = ur.nTrnFlags;
+			pUnit->ua.fInpBias   = Nn_GetBin2Elem(pBias, iU, (int) nPayload);
+			pUnit->ua.fInpScale  = ur.fInpScale;
+			pUnit->ua.fOutBias   = ur.fOutBias;
+			pUnit->ua.fOutScale  = ur.fOutScale;
+			pUnit->ua.fTrnMin    = ur.fTrnMin;
+			pUnit->ua.fTrnMax    = ur.fTrnMax;
+
+			nns = Nn_CheckUnitAttrib(pNet, iL, iU);
+			if (nns != NN_OK)
+				break;
+			if ((NN_BIN2_UINT32) (iConn + ur.nNumConns) > lr.nNumConns)
+			{
+				nns = Nn_SetBin2FormatError("number of connections");
+				break;
+			}
+
+			pUnit->iFirstConn = bViewWeights ? (long) (lr.nWeightsOffset / sizeof (NN_FLOAT)) + iConn : iFirstConn + iConn;
+			pUnit->iFirstSrc  = bViewSources ? (long) (lr.nSourcesOffset / NN_BIN2_SOURCE_SIZE) + iConn : iFirstConn + iConn;
+			iConn += ur.nNumConns;
+		}
+		if (nns == NN_OK && (NN_BIN2_UINT32) iConn != lr.nNumConns)
+			nns = Nn_SetBin2FormatError("number of connections");
+
+		/* Weights not used in place are converted, unpacked ones in */
+		/* place after their biases have been read                   */
+		if (nns == NN_OK && !bViewWeights)
+			Nn_GetBin2Elems(pWeights, 0, (long) lr.nNumConns, afWeight + iFirstConn, (int) nPayload);
+
+		/* Check the source units, convert those not used in place */
+		for (iConn = 0; iConn < (long) lr.nNumConns && nns == NN_OK; iConn++)
+		{
+			memcpy(&nSource, pMem + lr.nSourcesOffset + iConn * NN_BIN2_SOURCE_SIZE, NN_BIN2_SOURCE_SIZE);
+			if (eo_endian_order() != LITTLE_ENDIAN)
+				eo_swap_int_n((int*) &nSource, 1);
+			if (nSource >= (NN_BIN2_UINT32) nNumUnits)
+				nns = Nn_SetBin2FormatError("source unit");
+			else if (!bViewSources)
+				anSource[iFirstConn + iConn] = nSource;
+		}
+
+		iFirstConn += (long) lr.nNumConns;
+	}
+
+	Nn_Free(pPlanes);
+	if (nns != NN_OK)
+		return nns;
+
+	/* The net refers to the file from now on, if it uses blocks in place */
+	if (nNumConns > 0)
+	{
+		pNet->afConnWeight = afWeight;
+		pNet->anConnSrc32  = anSource;
+		if (bViewSources)
+		{
+			pNet->pView     = pMem;
+			pNet->nViewSize = nMemSize;
+		}
+	}
+	pNet->bFrozen = TRUE;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBin2Header                                                 */
+/* Purpose:  Copies the header from the file and checks it                    */
+/* Remarks:  The flag NN_BIN2_PACKED is removed from the payload type, which  */
+/*           is used as the size of the elements from then on.                */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_GetBin2Header (PCMEM pMem, size_t nMemSize, NN_BIN2_HEADER* pHdr, BOOL* pbPacked)
+{
+	if (!Nn_IsBin2Mem(pMem, nMemSize))
+		return Nn_SetBin2FormatError("magic number");
+	if (nMemSize < sizeof (NN_BIN2_HEADER))
+		return Nn_SetFileReadError();
+	memcpy(pHdr, pMem, sizeof (NN_BIN2_HEADER));
+	if (eo_endian_order() != LITTLE_ENDIAN)
+		eo_swap_bin2_header(pHdr);
+
+	/* Minor versions only add to the reserved fields */
+	if (pHdr->anVersion[0] != NN_BIN2_VERSION_MAJOR)
+		return Nn_Error(NN_INVALID_FILE_FORMAT, NN_ERR_PREFIX "unsupported NNFF version %d.%d",
+						pHdr->anVersion[0], pHdr->anVersion[1]);
+	/* A truncated file */
+	if (pHdr->nFileSize > nMemSize)
+		return Nn_SetFileReadError();
+	*pbPacked = (pHdr->nPayload & NN_BIN2_PACKED) != 0;
+	pHdr->nPayload = (NN_BIN2_INT16) (pHdr->nPayload & ~NN_BIN2_PACKED);
+	if (pHdr->nPayload != NN_PREC_SINGLE && pHdr->nPayload != NN_PREC_DOUBLE)
+		return Nn_SetBin2FormatError("payload type");
+	if (pHdr->nNumLayers <= 0 ||
+		!Nn_FitsBin2Block(pHdr, pHdr->nLayersOffset, pHdr->nNumLayers * sizeof (NN_BIN2_LAYER)))
+		return Nn_SetBin2FormatError("layer records");
+
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReadBin2Units                                                 */
+/* Purpose:  Reads the units of a layer with their connections and matrices   */
+/*           from the blocks of the layer                                     */
+/* Remarks:  The weights, biases and matrices of a packed layer are taken     */
+/*           from its payload unpacked by Nn_UnpackBin2Layer.                 */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ReadBin2Units
+(
+	NN_PNET                pNet,
+	NN_PLAYER              pLayer,
+	PCMEM                  pMem,
+	const NN_BIN2_HEADER*  pHdr,
+	const NN_BIN2_LAYER*   pLr,
+	PCMEM                  pUnpacked
+)
+{
+	NN_STATUS       nns;
+	PCMEM           pWeights, pBias, pMatrices;
+	NN_BIN2_UNIT    ur;
+	NN_BIN2_UINT32  nSource;
+	NN_PUNIT        pUnit;
+	NN_PCONN        pConn;
+	NN_FLOAT*       pfElems;
+	size_t          nPayload;
+	long            iConn, iMatrixElem, nNumElems;
+	short           iU, iC;
+
+	nPayload = (size_t) pHdr->nPayload;
+
+	/* Check the blocks of the layer, the packed payload has been */
+	/* checked by Nn_FitsBin2Packed                               */
+	if (pLayer->la.nNumUnits > 0 &&
+		(!Nn_FitsBin2Block(pHdr, pLr->nUnitsOffset, pLayer->la.nNumUnits * sizeof (NN_BIN2_UNIT)) ||
+		 (pUnpacked == NULL && !Nn_FitsBin2Block(pHdr, pLr->nBiasOffset, pLayer->la.nNumUnits * nPayload))))
+		return Nn_SetBin2FormatError("unit block");
+	if (pLr->nNumConns > 0 &&
+		((pUnpacked == NULL && !Nn_FitsBin2Block(pHdr, pLr->nWeightsOffset, pLr->nNumConns * nPayload)) ||
+		 !Nn_FitsBin2Block(pHdr, pLr->nSourcesOffset, pLr->nNumConns * NN_BIN2_SOURCE_SIZE)))
+		return Nn_SetBin2FormatError("connection block");
+
+	/* The unpacked payload holds the weights, biases and matrices one */
+	/* after the other                                                 */
+	if (pUnpacked == NULL)
+	{
+		pWeights  = pMem + pLr->nWeightsOffset;
+		pBias     = pMem + pLr->nBiasOffset;
+		pMatrices = pMem + pLr->nMatrixOffset;
+	}
+	else
+	{
+		pWeights  = pUnpacked;
+		pBias     = pWeights + pLr->nNumConns * nPayload;
+		pMatrices = pBias + pLayer->la.nNumUnits * nPayload;
+	}
+
+	iConn = 0;
+	iMatrixElem = 0;
+
+	/* For all units of the layer */
+	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+	{
+		Nn_GetBin2Unit(pMem, pLr, iU, &ur);
+
+		pUnit = Nn_GetUnitAt(pLayer, iU);
+		pUnit->ua.iLayer     = ur.iLayer;
+		pUnit->ua.iUnit      = ur.iUnit;
+		pUnit->ua.nNumConns  = ur.nNumConns;
+		pUnit->ua.bHasMatrix = ur.bHasMatrix;
+		pUnit->ua.nTrnFnId   = ur.nTrnFnId;
+		pUnit->ua.nTrnFlags  = ur.nTrnFlags;
+		pUnit->ua.fInpBias   = Nn_GetBin2Elem(pBias, iU, (int) nPayload);
+		pUnit->ua.fInpScale  = ur.fInpScale;
+		pUnit->ua.fOutBias   = ur.fOutBias;
+		pUnit->ua.fOutScale  = ur.fOutScale;
+		pUnit->ua.fTrnMin    = ur.fTrnMin;
+		pUnit->ua.fTrnMax    = ur.fTrnMax;
+
+		if (ur.nNumConns <= 0)
+			continue;
+
+		/* The connections of the unit follow those of the previous units */
+		if ((NN_BIN2_UINT32) (iConn + ur.nNumConns) > pLr->nNumConns)
+			return Nn_SetBin2FormatError("number of connections");
+
+		nns = Nn_CreateConnsIn(pNet, pUnit);
+		if (nns != NN_OK)
+			return nns;
+
+		for (iC = 0; iC < ur.nNumConns; iC++, iConn++)
+		{
+			pConn = Nn_GetConnAt(pUnit, iC);
+			pConn->ca.fWeight = Nn_GetBin2Elem(pWeights, iConn, (int) nPayload);
+
+			memcpy(&nSource, pMem + pLr->nSourcesOffset + iConn * NN_BIN2_SOURCE_SIZE, NN_BIN2_SOURCE_SIZE);
+			if (eo_endian_order() != LITTLE_ENDIAN)
+				eo_swap_int_n((int*) &nSource, 1);
+			if (!Nn_GetBin2Source(pNet, nSource, pConn))
+				return Nn_SetBin2FormatError("source unit");
+		}
+
+		if (!ur.bHasMatrix)
+			continue;
+
+		/* The matrices of the layer are stored one after the other */
+		nNumElems = (long) ur.nNumConns * ur.nNumConns;
+		if (pUnpacked != NULL
+			? (NN_BIN2_UINT32) (iMatrixElem + nNumElems) > pLr->nMatrixElems
+			: pLr->nMatrixOffset == 0 ||
+			  !Nn_FitsBin2Block(pHdr, pLr->nMatrixOffset, (iMatrixElem + nNumElems) * nPayload))
+			return Nn_SetBin2FormatError("matrix block");
+
+		nns = Nn_CreateMatrixIn(pNet, pUnit);
+		if (nns != NN_OK)
+			return nns;
+
+		pfElems = Nn_GetMatrixElems(pUnit);
+		Nn_GetBin2Elems(pMatrices, iMatrixElem, nNumElems, pfElems, (int) nPayload);
+		iMatrixElem += nNumElems;
+	}
+
+	if ((NN_BIN2_UINT32) iConn != pLr->nNumConns)
+		return Nn_SetBin2FormatError("number of connections");
+
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_UnpackBin2Layer                                               */
+/* Purpose:  Unpacks the payload of a layer of a packed file                  */
+/* Remarks:  The layer must have been checked by Nn_FitsBin2Packed, and       */
+/*           pUnpacked must hold its payload. The payload filtered into byte  */
+/*           planes is unpacked into pPlanes and joined from there, pPlanes   */
+/*           is only used then.                                               */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_UnpackBin2Layer (PCMEM pMem, const NN_BIN2_HEADER* pHdr, const NN_BIN2_LAYER* pLr, PMEM pUnpacked, PMEM pPlanes)
+{
+	size_t  nSize;
+
+	nSize = Nn_GetBin2PayloadSize(pHdr, pLr);
+	if (nSize == 0)
+		return NN_OK;
+
+	if (lzp_unpack(pLr->nFilter == NN_BIN2_FILTER_NONE ? pUnpacked : pPlanes, nSize,
+				   pMem + pLr->nWeightsOffset, pLr->nPackedSize) != 0)
+		return Nn_SetBin2FormatError("packed payload");
+
+	if (pLr->nFilter == NN_BIN2_FILTER_DELTA)
+		lzp_undelta(pPlanes, nSize);
+	if (pLr->nFilter != NN_BIN2_FILTER_NONE)
+		lzp_unshuffle(pUnpacked, pPlanes, nSize / pHdr->nPayload, pHdr->nPayload);
+
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBin2ArenaSize                                              */
+/* Purpose:  Gets the arena size of the net from the layer and unit records   */
+/* Remarks:  Records outside of the file are skipped, they are reported by    */
+/*           the reading routines. So are the connections and matrices which  */
+/*           don't fit the blocks of their layer, or the largest payload the  */
+/*           packed block of the layer can unpack to.                         */
+/* Returns:  The number of bytes                                              */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetBin2ArenaSize (PCMEM pMem, const NN_BIN2_HEADER* pHdr, BOOL bPacked)
+{
+	NN_BIN2_LAYER  lr;
+	NN_BIN2_UNIT   ur;
+	size_t         nSize, nNumElems;
+	long           nConnsLeft, nElemsLeft;
+	short          iL, iU;
+
+	nSize = Nn_GetLayersArenaSize(pHdr->nNumLayers);
+
+	for (iL = 0; iL < pHdr->nNumLayers; iL++)
+	{
+		Nn_GetBin2Layer(pMem, pHdr, iL, &lr);
+		if (lr.nNumUnits <= 0 ||
+			!Nn_FitsBin2Block(pHdr, lr.nUnitsOffset, lr.nNumUnits * sizeof (NN_BIN2_UNIT)))
+			continue;
+
+		/* The connections and matrix elements are limited by the blocks */
+		/* of the layer, so a corrupt unit record can't size the arena    */
+		/* beyond the size of the file (or what it can unpack to)         */
+		if (bPacked)
+		{
+			nConnsLeft = Nn_FitsBin2Packed(pHdr, &lr) ? (long) lr.nNumConns : 0;
+			nElemsLeft = Nn_FitsBin2Packed(pHdr, &lr) ? (long) lr.nMatrixElems : 0;
+		}
+		else
+		{
+			nConnsLeft = Nn_FitsBin2Block(pHdr, lr.nWeightsOffset, lr.nNumConns * (size_t) pHdr->nPayload)
+					   ? (long) lr.nNumConns : 0;
+			nElemsLeft = lr.nMatrixOffset > 0 && lr.nMatrixOffset < pHdr->nFileSize
+					   ? (long) ((pHdr->nFileSize - lr.nMatrixOffset) / pHdr->nPayload) : 0;
+		}
+
+		nSize += Nn_GetUnitsArenaSize(lr.nNumUnits);
+		for (iU = 0; iU < lr.nNumUnits; iU++)
+		{
+			Nn_GetBin2Unit(pMem, &lr, iU, &ur);
+			if (ur.nNumConns <= 0 || ur.nNumConns > nConnsLeft)
+				continue;
+			nConnsLeft -= ur.nNumConns;
+			nSize += Nn_GetConnsArenaSize(ur.nNumConns);
+
+			nNumElems = (size_t) ur.nNumConns * ur.nNumConns;
+			if (ur.bHasMatrix && (long) nNumElems <= nElemsLeft)
+			{
+				nElemsLeft -= (long) nNumElems;
+				nSize += Nn_GetMatrixArenaSize(ur.nNumConns);
+			}
+		}
+	}
+
+	return nSize;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBin2Layer                                                  */
+/* Purpose:  Copies a layer record from the file                              */
+/* Remarks:  The records must have been checked by Nn_FitsBin2Block.          */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_GetBin2Layer (PCMEM pMem, const NN_BIN2_HEADER* pHdr, short iL, NN_BIN2_LAYER* pLr)
+{
+	memcpy(pLr, pMem + pHdr->nLayersOffset + iL * sizeof (NN_BIN2_LAYER), sizeof (NN_BIN2_LAYER));
+	if (eo_endian_order() != LITTLE_ENDIAN)
+		eo_swap_bin2_layer(pLr);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBin2Unit                                                   */
+/* Purpose:  Copies a unit record from the file                               */
+/* Remarks:  The records must have been checked by Nn_FitsBin2Block.          */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_GetBin2Unit (PCMEM pMem, const NN_BIN2_LAYER* pLr, short iU, NN_BIN2_UNIT* pUr)
+{
+	memcpy(pUr, pMem + pLr->nUnitsOffset + iU * sizeof (NN_BIN2_UNIT), sizeof (NN_BIN2_UNIT));
+	if (eo_endian_order() != LITTLE_ENDIAN)
+		eo_swap_bin2_unit(pUr);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_FitsBin2Block                                                 */
+/* Purpose:  Checks that a block is aligned and lies within the file          */
+/* Returns:  TRUE if so, FALSE otherwise                                      */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_FitsBin2Block (const NN_BIN2_HEADER* pHdr, size_t nOffset, size_t nSize)
+{
+	return nOffset % NN_BIN2_ALIGN == 0 &&
+		   nOffset <= pHdr->nFileSize &&
+		   nSize <= pHdr->nFileSize - nOffset;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBin2PayloadSize                                            */
+/* Purpose:  Gets the size of the weights, biases and matrices of a layer     */
+/* Remarks:  The size of a packed layer must have been checked by             */
+/*           Nn_FitsBin2Packed.                                               */
+/* Returns:  The number of bytes                                              */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetBin2PayloadSize (const NN_BIN2_HEADER* pHdr, const NN_BIN2_LAYER* pLr)
+{
+	return ((size_t) pLr->nNumConns + (size_t) pLr->nNumUnits + (size_t) pLr->nMatrixElems) * pHdr->nPayload;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_FitsBin2Packed                                                */
+/* Purpose:  Checks the packed payload of a layer: the block lies within the  */
+/*           file, the filter is known and the payload is no larger than the  */
+/*           block can unpack to                                              */
+/* Returns:  TRUE if so, FALSE otherwise                                      */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_FitsBin2Packed (const NN_BIN2_HEADER* pHdr, const NN_BIN2_LAYER* pLr)
+{
+	size_t  nMaxElems;
+
+	if (pLr->nNumUnits < 0 ||
+		pLr->nFilter < NN_BIN2_FILTER_NONE || pLr->nFilter > NN_BIN2_FILTER_DELTA)
+		return FALSE;
+
+	/* The sum of the elements can't overflow */
+	nMaxElems = lzp_max_size(pLr->nPackedSize) / pHdr->nPayload;
+	if (pLr->nNumConns > nMaxElems ||
+		(size_t) pLr->nNumUnits > nMaxElems - pLr->nNumConns ||
+		pLr->nMatrixElems > nMaxElems - pLr->nNumConns - pLr->nNumUnits)
+		return FALSE;
+
+	return Nn_GetBin2PayloadSize(pHdr, pLr) == 0 ||
+		   (pLr->nWeightsOffset > 0 && Nn_FitsBin2Block(pHdr, pLr->nWeightsOffset, pLr->nPackedSize));
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBin2Source                                                 */
+/* Purpose:  Sets the source layer and unit of a connection from the number   */
+/*           of the source unit, counted over all layers                      */
+/* Returns:  TRUE for success, FALSE if there is no such unit                 */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_GetBin2Source (const NN_PNET pNet, NN_BIN2_UINT32 nSource, NN_PCONN pConn)
+{
+	NN_PLAYER  pLayer;
+	short      iL;
+
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		pLayer = Nn_GetLayerAt(pNet, iL);
+		if (nSource < (NN_BIN2_UINT32) pLayer->la.nNumUnits)
+		{
+			pConn->ca.iLayer = iL;
+			pConn->ca.iUnit  = (short) nSource;
+			return TRUE;
+		}
+		nSource -= pLayer->la.nNumUnits;
+	}
+
+	return FALSE;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBin2Elem                                                   */
+/* Purpose:  Gets an element of a weight, bias or matrix block                */
+/* Returns:  The element                                                      */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_FLOAT Nn_GetBin2Elem (PCMEM pBlock, long iElem, int nPayload)
+{
+	float   fSingle;
+	double  fDouble;
+
+	if (nPayload == NN_PREC_SINGLE)
+	{
+		memcpy(&fSingle, pBlock + iElem * sizeof (float), sizeof (float));
+		if (eo_endian_order() != LITTLE_ENDIAN)
+			eo_swap_float_n(&fSingle, 1);
+		return (NN_FLOAT) fSingle;
+	}
+
+	memcpy(&fDouble, pBlock + iElem * sizeof (double), sizeof (double));
+	if (eo_endian_order() != LITTLE_ENDIAN)
+		eo_swap_double_n(&fDouble, 1);
+	return (NN_FLOAT) fDouble;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_PutBin2Elem                                                   */
+/* Purpose:  Sets an element of a weight, bias or matrix block                */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_PutBin2Elem (PMEM pBlock, long iElem, NN_FLOAT fElem, int nPayload)
+{
+	float   fSingle;
+	double  fDouble;
+
+	if (nPayload == NN_PREC_SINGLE)
+	{
+		fSingle = (float) fElem;
+		if (eo_endian_order() != LITTLE_ENDIAN)
+			eo_swap_float_n(&fSingle, 1);
+		memcpy(pBlock + iElem * sizeof (float), &fSingle, sizeof (float));
+		return;
+	}
+
+	fDouble = (double) fElem;
+	if (eo_endian_order() != LITTLE_ENDIAN)
+		eo_swap_double_n(&fDouble, 1);
+	memcpy(pBlock + iElem * sizeof (double), &fDouble, sizeof (double));
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBin2Elems                                                  */
+/* Purpose:  Gets a run of elements of a weight, bias or matrix block         */
+/* Remarks:  Double elements are swapped while copying, in one call. The      */
+/*           elements may be converted in place, pfElems being the first      */
+/*           element of the run: single ones are widened from the last one.   */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_GetBin2Elems (PCMEM pBlock, long iElem, long nNumElems, NN_FLOAT* pfElems, int nPayload)
+{
+	long  iE;
+
+	if (nPayload == NN_PREC_SINGLE)
+	{
+		for (iE = nNumElems - 1; iE >= 0; iE--)
+			pfElems[iE] = Nn_GetBin2Elem(pBlock, iElem + iE, nPayload);
+		return;
+	}
+
+	if (eo_endian_order() != LITTLE_ENDIAN)
+		eo_copy_swap_double_n(pfElems, pBlock + iElem * sizeof (double), (int) nNumElems);
+	else if ((PCMEM) pfElems != pBlock + iElem * sizeof (double))
+		memcpy(pfElems, pBlock + iElem * sizeof (double), nNumElems * sizeof (double));
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_PutBin2Elems                                                  */
+/* Purpose:  Sets a run of elements of a weight, bias or matrix block         */
+/* Remarks:  Double elements are swapped while copying, in one call.          */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_PutBin2Elems (PMEM pBlock, long iElem, long nNumElems, const NN_FLOAT* pfElems, int nPayload)
+{
+	long  iE;
+
+	if (nPayload == NN_PREC_SINGLE)
+	{
+		for (iE = 0; iE < nNumElems; iE++)
+			Nn_PutBin2Elem(pBlock, iElem + iE, pfElems[iE], nPayload);
+		return;
+	}
+
+	if (eo_endian_order() != LITTLE_ENDIAN)
+		eo_copy_swap_double_n((double*) (pBlock + iElem * sizeof (double)), pfElems, (int) nNumElems);
+	else
+		memcpy(pBlock + iElem * sizeof (double), pfElems, nNumElems * sizeof (double));
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_SetBin2FormatError                                            */
+/* Purpose:  Sets the error for an invalid part of a NNFF 2.0 file            */
+/* Returns:  NN_INVALID_FILE_FORMAT                                           */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_SetBin2FormatError (PCSTR pchWhat)
+{
+	return Nn_Error(NN_INVALID_FILE_FORMAT, NN_ERR_PREFIX "invalid %s in NNFF 2.0 file", pchWhat);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_WriteNetToBin2File                                            */
+/* Purpose:  Writes a neural net object to a NNFF 2.0 file                    */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_WriteNetToBin2File (PCSTR pchFilePath, const NN_PNET pNet, int nPayload)
+{
+	NN_STATUS  nns;
+	PMEM       pImage;
+	size_t     nSize;
+	FILE*      ostream;
+
+	assert(pchFilePath != NULL);
+	assert(pNet != NULL);
+	assert((nPayload & ~NN_BIN2_PACKED) == NN_PREC_SINGLE || (nPayload & ~NN_BIN2_PACKED) == NN_PREC_DOUBLE);
+
+	/* Set the global error code to NN_OF (or zero) */
+	Nn_ClearError();
+
+	/* A frozen net has no connection structures left to write */
+	if (pNet->bFrozen)
+		return Nn_Error(NN_INCOMPLETE_STRUCTURE, NN_ERR_PREFIX "a frozen net can't be written");
+
+	nns = Nn_BuildBin2Image(pNet, nPayload & ~NN_BIN2_PACKED, &pImage, &nSize);
+	if (nns == NN_OK && (nPayload & NN_BIN2_PACKED) != 0)
+		nns = Nn_PackBin2Image(&pImage, &nSize);
+	if (nns != NN_OK)
+		return nns;
+
+	ostream = fopen(pchFilePath, "wb");
+	if (ostream != NULL)
+	{
+		if (fwrite(pImage, nSize, 1, ostream) != 1)
+			nns = Nn_SetFileWriteError();
+		if (fclose(ostream) != 0 && nns == NN_OK)
+			nns = Nn_SetFileWriteError();
+	}
+	else
+		nns = Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't open binary file '%s' for write", pchFilePath);
+
+	Nn_Free(pImage);
+	return nns;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_BuildBin2Image                                                */
+/* Purpose:  Builds the NNFF 2.0 file of a net in a zeroed heap block         */
+/* Remarks:  The first pass lays out the blocks in the layer records, the     */
+/*           second one fills them.                                           */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_BuildBin2Image (const NN_PNET pNet, int nPayload, PMEM* ppImage, size_t* pnSize)
+{
+	NN_BIN2_HEADER   hdr;
+	NN_BIN2_LAYER*   aLr;
+	NN_BIN2_LAYER    lr;
+	NN_BIN2_UNIT     ur;
+	NN_BIN2_UINT32   nSource;
+	NN_BIN2_UINT32*  anFirstUnit;
+	NN_PLAYER        pLayer;
+	NN_PUNIT         pUnit;
+	NN_PCONN         pConn;
+	PMEM             pImage;
+	size_t           nSize;
+	long             nNumConns, nNumElems, iConn, iMatrixElem;
+	short            iL, iU, iC;
+
+	assert(pNet != NULL);
+
+	*ppImage = NULL;
+	*pnSize  = 0;
+
+	if (!Nn_LayersCreated(pNet) || pNet->na.nNumLayers <= 0)
+		return Nn_Error(NN_INCOMPLETE_STRUCTURE, NN_ERR_PREFIX "the net has no layers");
+
+	aLr = (NN_BIN2_LAYER*) Nn_Alloc(pNet->na.nNumLayers * sizeof (NN_BIN2_LAYER));
+	anFirstUnit = (NN_BIN2_UINT32*) Nn_Alloc(pNet->na.nNumLayers * sizeof (NN_BIN2_UINT32));
+	if (aLr == NULL || anFirstUnit == NULL)
+	{
+		Nn_Free(aLr);
+		Nn_Free(anFirstUnit);
+		return Nn_SetOutOfMemoryError();
+	}
+
+	memset(&hdr, 0, sizeof (NN_BIN2_HEADER));
+	memcpy(hdr.achMagic, NN_BIN2_MAGIC, 4);
+	hdr.anVersion[0]  = NN_BIN2_VERSION_MAJOR;
+	hdr.anVersion[1]  = NN_BIN2_VERSION_MINOR;
+	hdr.nNumLayers    = pNet->na.nNumLayers;
+	hdr.iInpLayer     = pNet->na.iInpLayer;
+	hdr.iOutLayer     = pNet->na.iOutLayer;
+	hdr.nPrecision    = pNet->na.nPrecision;
+	hdr.nPayload      = (NN_BIN2_INT16) nPayload;
+	hdr.nLayersOffset = (NN_BIN2_UINT32) NN_BIN2_ALIGN_UP(sizeof (NN_BIN2_HEADER));
+
+	/* First pass: lay out the blocks of all layers */
+	nSize = hdr.nLayersOffset + NN_BIN2_ALIGN_UP(pNet->na.nNumLayers * sizeof (NN_BIN2_LAYER));
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		pLayer = Nn_GetLayerAt(pNet, iL);
+		anFirstUnit[iL] = hdr.nNumUnits;
+
+		nNumConns = 0;
+		nNumElems = 0;
+		for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+		{
+			pUnit = Nn_GetUnitAt(pLayer, iU);
+			if (pUnit->ua.nNumConns <= 0 || pUnit->aConns == NULL)
+				continue;
+			nNumConns += pUnit->ua.nNumConns;
+			if (pUnit->ppfMatrix != NULL)
+				nNumElems += (long) pUnit->ua.nNumConns * pUnit->ua.nNumConns;
+		}
+
+		memset(&aLr[iL], 0, sizeof (NN_BIN2_LAYER));
+		aLr[iL].iLayer    = pLayer->la.iLayer;
+		aLr[iL].nNumUnits = pLayer->la.nNumUnits;
+		aLr[iL].nInpFnId  = pLayer->la.nInpFnId;
+		aLr[iL].nActFnId  = pLayer->la.nActFnId;
+		aLr[iL].nOutFnId  = pLayer->la.nOutFnId;
+		aLr[iL].fActSlope = pLayer->la.fActSlope;
+		aLr[iL].fActThres = pLayer->la.fActThres;
+		aLr[iL].nNumConns = (NN_BIN2_UINT32) nNumConns;
+		aLr[iL].nMatrixElems = (NN_BIN2_UINT32) nNumElems;
+		if (pLayer->la.nNumUnits > 0)
+		{
+			aLr[iL].nUnitsOffset = (NN_BIN2_UINT32) nSize;
+			nSize += NN_BIN2_ALIGN_UP(pLayer->la.nNumUnits * sizeof (NN_BIN2_UNIT));
+		}
+		if (nNumConns > 0)
+		{
+			aLr[iL].nWeightsOffset = (NN_BIN2_UINT32) nSize;
+			nSize += NN_BIN2_ALIGN_UP(nNumConns * nPayload);
+			aLr[iL].nSourcesOffset = (NN_BIN2_UINT32) nSize;
+			nSize += NN_BIN2_ALIGN_UP(nNumConns * NN_BIN2_SOURCE_SIZE);
+		}
+		if (pLayer->la.nNumUnits > 0)
+		{
+			aLr[iL].nBiasOffset = (NN_BIN2_UINT32) nSize;
+			nSize += NN_BIN2_ALIGN_UP(pLayer->la.nNumUnits * nPayload);
+		}
+		if (nNumElems > 0)
+		{
+			aLr[iL].nMatrixOffset = (NN_BIN2_UINT32) nSize;
+			nSize += NN_BIN2_ALIGN_UP(nNumElems * nPayload);
+		}
+
+		hdr.nNumUnits += (NN_BIN2_UINT32) (pLayer->la.nNumUnits > 0 ? pLayer->la.nNumUnits : 0);
+		hdr.nNumConns += (NN_BIN2_UINT32) nNumConns;
+	}
+	hdr.nFileSize = (NN_BIN2_UINT32) nSize;
+
+	/* The offsets are 32 bit */
+	if ((size_t) hdr.nFileSize != nSize)
+	{
+		Nn_Free(aLr);
+		Nn_Free(anFirstUnit);
+		return Nn_Error(NN_INVALID_ATTRIBUTE, NN_ERR_PREFIX "the net is too large for NNFF 2.0");
+	}
+
+	pImage = (PMEM) Nn_Alloc(nSize);
+	if (pImage == NULL)
+	{
+		Nn_Free(aLr);
+		Nn_Free(anFirstUnit);
+		return Nn_SetOutOfMemoryError();
+	}
+
+	/* Second pass: fill the blocks */
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		pLayer = Nn_GetLayerAt(pNet, iL);
+
+		iConn = 0;
+		iMatrixElem = 0;
+		for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+		{
+			pUnit = Nn_GetUnitAt(pLayer, iU);
+
+			memset(&ur, 0, sizeof (NN_BIN2_UNIT));
+			ur.iLayer     = pUnit->ua.iLayer;
+			ur.iUnit      = pUnit->ua.iUnit;
+			ur.nNumConns  = (NN_BIN2_INT16) (pUnit->aConns != NULL ? pUnit->ua.nNumConns : 0);
+			ur.bHasMatrix = (NN_BIN2_INT16) (ur.nNumConns > 0 && pUnit->ppfMatrix != NULL);
+			ur.nTrnFnId   = pUnit->ua.nTrnFnId;
+			ur.nTrnFlags  = pUnit->ua.nTrnFlags;
+			ur.fInpScale  = pUnit->ua.fInpScale;
+			ur.fOutBias   = pUnit->ua.fOutBias;
+			ur.fOutScale  = pUnit->ua.fOutScale;
+			ur.fTrnMin    = pUnit->ua.fTrnMin;
+			ur.fTrnMax    = pUnit->ua.fTrnMax;
+			if (eo_endian_order() != LITTLE_ENDIAN)
+				eo_swap_bin2_unit(&ur);
+			memcpy(pImage + aLr[iL].nUnitsOffset + iU * sizeof (NN_BIN2_UNIT), &ur, sizeof (NN_BIN2_UNIT));
+
+			Nn_PutBin2Elem(pImage + aLr[iL].nBiasOffset, iU, pUnit->ua.fInpBias, nPayload);
+
+			if (pUnit->ua.nNumConns <= 0 || pUnit->aConns == NULL)
+				continue;
+
+			for (iC = 0; iC < pUnit->ua.nNumConns; iC++, iConn++)
+			{
+				pConn = Nn_GetConnAt(pUnit, iC);
+				if (pConn->ca.iLayer < 0 || pConn->ca.iLayer >= pNet->na.nNumLayers ||
+					pConn->ca.iUnit < 0 || pConn->ca.iUnit >= Nn_GetLayerAt(pNet, pConn->ca.iLayer)->la.nNumUnits)
+				{
+					Nn_Free(pImage);
+					Nn_Free(aLr);
+					Nn_Free(anFirstUnit);
+					return Nn_Error(NN_INCONSITENT_NET, NN_ERR_PREFIX "invalid source unit of a connection");
+				}
+
+				Nn_PutBin2Elem(pImage + aLr[iL].nWeightsOffset, iConn, pConn->ca.fWeight, nPayload);
+
+				nSource = anFirstUnit[pConn->ca.iLayer] + pConn->ca.iUnit;
+				if (eo_endian_order() != LITTLE_ENDIAN)
+					eo_swap_int_n((int*) &nSource, 1);
+				memcpy(pImage + aLr[iL].nSourcesOffset + iConn * NN_BIN2_SOURCE_SIZE, &nSource, NN_BIN2_SOURCE_SIZE);
+			}
+
+			if (pUnit->ppfMatrix == NULL)
+				continue;
+
+			nNumElems = (long) pUnit->ua.nNumConns * pUnit->ua.nNumConns;
+			Nn_PutBin2Elems(pImage + aLr[iL].nMatrixOffset, iMatrixElem, nNumElems,
+							Nn_GetMatrixElems(pUnit), nPayload);
+			iMatrixElem += nNumElems;
+		}
+
+		lr = aLr[iL];
+		if (eo_endian_order() != LITTLE_ENDIAN)
+			eo_swap_bin2_layer(&lr);
+		memcpy(pImage + hdr.nLayersOffset + iL * sizeof (NN_BIN2_LAYER), &lr, sizeof (NN_BIN2_LAYER));
+	}
+
+	if (eo_endian_order() != LITTLE_ENDIAN)
+		eo_swap_bin2_header(&hdr);
+	memcpy(pImage, &hdr, sizeof (NN_BIN2_HEADER));
+
+	Nn_Free(aLr);
+	Nn_Free(anFirstUnit);
+
+	*ppImage = pImage;
+	*pnSize  = nSize;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_PackBin2Image                                                 */
+/* Purpose:  Replaces a NNFF 2.0 file built by Nn_BuildBin2Image by the file  */
+/*           with packed layers                                               */
+/* Remarks:  The weights, biases and matrices of each layer are packed as     */
+/*           they are, in byte planes and as differences of the byte planes,  */
+/*           the smallest block is kept.                                      */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_PackBin2Image (PMEM* ppImage, size_t* pnSize)
+{
+	NN_BIN2_HEADER  hdr;
+	NN_BIN2_LAYER   lr;
+	PCMEM           pImage;
+	PMEM            pPacked;
+	PMEM            pBuffer;
+	PMEM            pPayload;
+	PMEM            pPlanes;
+	PMEM            pBest;
+	PMEM            pTry;
+	PMEM            pSwap;
+	size_t          nSize, nMaxSize, nMaxPayload, nPayloadSize, nElems, nBest, nTry, nOffset;
+	short           iL;
+
+	pImage = *ppImage;
+	memcpy(&hdr, pImage, sizeof (NN_BIN2_HEADER));
+	if (eo_endian_order() != LITTLE_ENDIAN)
+		eo_swap_bin2_header(&hdr);
+
+	/* Size the packed file for payloads which don't pack */
+	nSize = hdr.nLayersOffset + NN_BIN2_ALIGN_UP(hdr.nNumLayers * sizeof (NN_BIN2_LAYER));
+	nMaxSize = nSize;
+	nMaxPayload = 0;
+	for (iL = 0; iL < hdr.nNumLayers; iL++)
+	{
+		Nn_GetBin2Layer(pImage, &hdr, iL, &lr);
+		nPayloadSize = Nn_GetBin2PayloadSize(&hdr, &lr);
+		if (nMaxPayload < nPayloadSize)
+			nMaxPayload = nPayloadSize;
+		nMaxSize += NN_BIN2_ALIGN_UP(lr.nNumUnits * sizeof (NN_BIN2_UNIT)) +
+					NN_BIN2_ALIGN_UP(lzp_bound(nPayloadSize)) +
+					NN_BIN2_ALIGN_UP(lr.nNumConns * NN_BIN2_SOURCE_SIZE);
+	}
+
+	pPacked = (PMEM) Nn_Alloc(nMaxSize);
+	pBuffer = (PMEM) Nn_Alloc(2 * nMaxPayload + 2 * lzp_bound(nMaxPayload));
+	if (pPacked == NULL || pBuffer == NULL)
+	{
+		Nn_Free(pPacked);
+		Nn_Free(pBuffer);
+		return Nn_SetOutOfMemoryError();
+	}
+	pPayload = pBuffer;
+	pPlanes  = pPayload + nMaxPayload;
+	pBest    = pPlanes + nMaxPayload;
+	pTry     = pBest + lzp_bound(nMaxPayload);
+
+	for (iL = 0; iL < hdr.nNumLayers; iL++)
+	{
+		Nn_GetBin2Layer(pImage, &hdr, iL, &lr);
+
+		if (lr.nNumUnits > 0)
+		{
+			memcpy(pPacked + nSize, pImage + lr.nUnitsOffset, lr.nNumUnits * sizeof (NN_BIN2_UNIT));
+			lr.nUnitsOffset = (NN_BIN2_UINT32) nSize;
+			nSize += NN_BIN2_ALIGN_UP(lr.nNumUnits * sizeof (NN_BIN2_UNIT));
+		}
+
+		/* Join the weights, biases and matrices */
+		nOffset = 0;
+		if (lr.nNumConns > 0)
+			memcpy(pPayload, pImage + lr.nWeightsOffset, lr.nNumConns * (size_t) hdr.nPayload);
+		nOffset += lr.nNumConns * (size_t) hdr.nPayload;
+		if (lr.nNumUnits > 0)
+			memcpy(pPayload + nOffset, pImage + lr.nBiasOffset, lr.nNumUnits * (size_t) hdr.nPayload);
+		nOffset += lr.nNumUnits * (size_t) hdr.nPayload;
+		if (lr.nMatrixElems > 0)
+			memcpy(pPayload + nOffset, pImage + lr.nMatrixOffset, lr.nMatrixElems * (size_t) hdr.nPayload);
+		nPayloadSize = Nn_GetBin2PayloadSize(&hdr, &lr);
+
+		lr.nFilter        = NN_BIN2_FILTER_NONE;
+		lr.nPackedSize    = 0;
+		lr.nWeightsOffset = 0;
+		lr.nBiasOffset    = 0;
+		lr.nMatrixOffset  = 0;
+		if (nPayloadSize > 0)
+		{
+			/* Try the filters, the first one wins a tie */
+			nElems = nPayloadSize / hdr.nPayload;
+			nBest = lzp_pack(pBest, lzp_bound(nPayloadSize), pPayload, nPayloadSize);
+
+			lzp_shuffle(pPlanes, pPayload, nElems, hdr.nPayload);
+			nTry = lzp_pack(pTry, lzp_bound(nPayloadSize), pPlanes, nPayloadSize);
+			if (nTry < nBest)
+			{
+				pSwap = pBest;
+				pBest = pTry;
+				pTry  = pSwap;
+				nBest = nTry;
+				lr.nFilter = NN_BIN2_FILTER_PLANES;
+			}
+
+			lzp_delta(pPlanes, nPayloadSize);
+			nTry = lzp_pack(pTry, lzp_bound(nPayloadSize), pPlanes, nPayloadSize);
+			if (nTry < nBest)
+			{
+				pSwap = pBest;
+				pBest = pTry;
+				pTry  = pSwap;
+				nBest = nTry;
+				lr.nFilter = NN_BIN2_FILTER_DELTA;
+			}
+
+			memcpy(pPacked + nSize, pBest, nBest);
+			lr.nWeightsOffset = (NN_BIN2_UINT32) nSize;
+			lr.nPackedSize    = (NN_BIN2_UINT32) nBest;
+			nSize += NN_BIN2_ALIGN_UP(nBest);
+		}
+
+		if (lr.nNumConns > 0)
+		{
+			memcpy(pPacked + nSize, pImage + lr.nSourcesOffset, lr.nNumConns * NN_BIN2_SOURCE_SIZE);
+			lr.nSourcesOffset = (NN_BIN2_UINT32) nSize;
+			nSize += NN_BIN2_ALIGN_UP(lr.nNumConns * NN_BIN2_SOURCE_SIZE);
+		}
+
+		if (eo_endian_order() != LITTLE_ENDIAN)
+			eo_swap_bin2_layer(&lr);
+		memcpy(pPacked + hdr.nLayersOffset + iL * sizeof (NN_BIN2_LAYER), &lr, sizeof (NN_BIN2_LAYER));
+	}
+
+	hdr.nPayload  = (NN_BIN2_INT16) (hdr.nPayload | NN_BIN2_PACKED);
+	hdr.nFileSize = (NN_BIN2_UINT32) nSize;
+	if (eo_endian_order() != LITTLE_ENDIAN)
+		eo_swap_bin2_header(&hdr);
+	memcpy(pPacked, &hdr, sizeof (NN_BIN2_HEADER));
+
+	Nn_Free(pBuffer);
+	Nn_Free(*ppImage);
+
+	*ppImage = pPacked;
+	*pnSize  = nSize;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+
+/* The fields of the same type are contiguous in the records                  */
+
+void eo_swap_bin2_header(NN_BIN2_HEADER* pHdr)
+{
+	eo_swap_short_n(pHdr->anVersion, 2);
+	eo_swap_int_n((int*) &(pHdr->nFileSize), 1);
+	eo_swap_short_n(&(pHdr->nNumLayers), 5);
+	eo_swap_int_n((int*) &(pHdr->nNumUnits), 3);
+}
+
+void eo_swap_bin2_layer(NN_BIN2_LAYER* pLr)
+{
+	eo_swap_short_n(&(pLr->iLayer), 6);
+	eo_swap_double_n(&(pLr->fActSlope), 2);
+	eo_swap_int_n((int*) &(pLr->nUnitsOffset), 8);
+}
+
+void eo_swap_bin2_unit(NN_BIN2_UNIT* pUr)
+{
+	eo_swap_short_n(&(pUr->iLayer), 6);
+	eo_swap_double_n(&(pUr->fInpScale), 5);
+}
+
+/* EOF ///////////////////////////////////////////////////////////////////////*/
+
@@ -0,0 +1,228 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnBin2IO.h                                                    */
+/* Purpose:     Interface def. file for the binary I/O routines of NNFF 2.0   */
+/* Remarks:     Implemented in NnBin2IO.c                                     */
+/*              NNFF 2.0 is the successor of the binary NNFF 1.x format. It   */
+/*              uses fixed-width fields in little-endian byte order and keeps */
+/*              the connections of a layer in contiguous blocks:              */
+/*                                                                            */
+/*                header              NN_BIN2_HEADER, 64 bytes                */
+/*                layer records       NN_BIN2_LAYER, 64 bytes per layer       */
+/*                for each layer:                                             */
+/*                  unit records      NN_BIN2_UNIT, 64 bytes per unit         */
+/*                  weight matrix     the weights of the connections of all   */
+/*                                    units, unit by unit (one row per unit   */
+/*                                    if all units have the same number of    */
+/*                                    connections)                            */
+/*                  source units      the numbers of the source units of the  */
+/*                                    connections, counted over all layers,   */
+/*                                    unsigned 32 bit                         */
+/*                  bias vector       the input bias of each unit             */
+/*                  matrices          the inverse co-variance matrices of the */
+/*                                    units having one, row by row (if any)   */
+/*                                                                            */
+/*              All blocks start at a multiple of NN_BIN2_ALIGN from the      */
+/*              beginning of the file, gaps are zero. The weights, biases and */
+/*              matrices are stored in the payload type of the file, double   */
+/*              or float (NN_PREC_DOUBLE or NN_PREC_SINGLE). The weights and  */
+/*              source units are in the order of the compact connections of   */
+/*              the net (see Nn_CreateConnTable).                             */
+/*              If the payload type has the flag NN_BIN2_PACKED (since 2.1),  */
+/*              the weights, biases and matrices of each layer are packed     */
+/*              together into a single block instead (see NN_BIN2_LAYER):     */
+/*                                                                            */
+/*                for each layer:                                             */
+/*                  unit records      as above                                */
+/*                  packed payload    the weights, biases and matrices, one   */
+/*                                    after the other, filtered and packed by */
+/*                                    the codec of utils/lz_pack.h            */
+/*                  source units      as above                                */
+/*                                                                            */
+/*              A 2.0 reader refuses a packed file for its payload type.      */
+/*              Files of both versions are read by Nn_CreateNetFromBinFile,   */
+/*              Nn_MapNetFromBinFile and Nn_CreateNetFromMemFile.             */
+/*              Nn_ReadBin2Net copies the blocks element by element into the  */
+/*              connections of an editable net. Only the frozen net of        */
+/*              Nn_MapBin2Net can use the weights and source units in place.  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The magic number at the beginning of the file */
+#define NN_BIN2_MAGIC          "NNFF"
+
+/* The version of the format described in this header file */
+#define NN_BIN2_VERSION_MAJOR  2
+#define NN_BIN2_VERSION_MINOR  1
+
+/* Alignment of all blocks within the file */
+#define NN_BIN2_ALIGN          64
+
+/* Flag of the payload type of a file with packed layers */
+#define NN_BIN2_PACKED         0x100
+
+/* The filters of a packed payload, applied before packing */
+#define NN_BIN2_FILTER_NONE    0   /* The elements as they are            */
+#define NN_BIN2_FILTER_PLANES  1   /* The byte planes of the elements     */
+#define NN_BIN2_FILTER_DELTA   2   /* The differences of the byte planes  */
+
+/* The fixed-width field types */
+typedef short          NN_BIN2_INT16;
+typedef unsigned int   NN_BIN2_UINT32;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_BIN2_HEADER                                                    */
+/* Purpose: The header of a NNFF 2.0 file                                     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnBin2Header
+{                                  /* Siz Sum */
+	char            achMagic[4];   /* [ 4][ 4] NN_BIN2_MAGIC                  */
+	NN_BIN2_INT16   anVersion[2];  /* [ 4][ 8] Major and minor format version */
+	NN_BIN2_UINT32  nFileSize;     /* [ 4][12] Size of the file in bytes      */
+	NN_BIN2_INT16   nNumLayers;    /* [ 2][14] Number of layers               */
+	NN_BIN2_INT16   iInpLayer;     /* [ 2][16] Index of the input layer       */
+	NN_BIN2_INT16   iOutLayer;     /* [ 2][18] Index of the output layer      */
+	NN_BIN2_INT16   nPrecision;    /* [ 2][20] Internal calculation precision */
+	NN_BIN2_INT16   nPayload;      /* [ 2][22] Payload type (NN_PREC_...)     */
+	NN_BIN2_INT16   reserved_1;    /* [ 2][24] RESERVED                       */
+	NN_BIN2_UINT32  nNumUnits;     /* [ 4][28] Number of units of all layers  */
+	NN_BIN2_UINT32  nNumConns;     /* [ 4][32] Number of all connections      */
+	NN_BIN2_UINT32  nLayersOffset; /* [ 4][36] Offset of the layer records    */
+	NN_BIN2_UINT32  reserved_2[7]; /* [28][64] RESERVED                       */
+}
+NN_BIN2_HEADER;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_BIN2_LAYER                                                     */
+/* Purpose: The record of a layer in a NNFF 2.0 file                          */
+/* Remarks: The offsets count from the beginning of the file, the offset of   */
+/*          an empty block is 0. In a packed file nWeightsOffset is the       */
+/*          offset of the packed payload, the offsets of the bias vector and  */
+/*          the matrices are 0.                                               */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnBin2Layer
+{                                   /* Siz Sum */
+	NN_BIN2_INT16   iLayer;         /* [ 2][ 2] Index of this layer            */
+	NN_BIN2_INT16   nNumUnits;      /* [ 2][ 4] Number of units                */
+	NN_BIN2_INT16   nInpFnId;       /* [ 2][ 6] Input function identifier      */
+	NN_BIN2_INT16   nActFnId;       /* [ 2][ 8] Activation function identifier */
+	NN_BIN2_INT16   nOutFnId;       /* [ 2][10] Output function identifier     */
+	NN_BIN2_INT16   nFilter;        /* [ 2][12] Filter of the packed payload   */
+	NN_BIN2_INT16   reserved_1[2];  /* [ 4][16] RESERVED                       */
+	double          fActSlope;      /* [ 8][24] Activation slope               */
+	double          fActThres;      /* [ 8][32] Activation threshold           */
+	NN_BIN2_UINT32  nUnitsOffset;   /* [ 4][36] Offset of the unit records     */
+	NN_BIN2_UINT32  nNumConns;      /* [ 4][40] Connections of all units       */
+	NN_BIN2_UINT32  nWeightsOffset; /* [ 4][44] Offset of the weight matrix    */
+	NN_BIN2_UINT32  nSourcesOffset; /* [ 4][48] Offset of the source units     */
+	NN_BIN2_UINT32  nBiasOffset;    /* [ 4][52] Offset of the bias vector      */
+	NN_BIN2_UINT32  nMatrixOffset;  /* [ 4][56] Offset of the matrices, or 0   */
+	NN_BIN2_UINT32  nPackedSize;    /* [ 4][60] Size of the packed payload     */
+	NN_BIN2_UINT32  nMatrixElems;   /* [ 4][64] Matrix elements of all units   */
+}
+NN_BIN2_LAYER;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_BIN2_UNIT                                                      */
+/* Purpose: The record of a unit in a NNFF 2.0 file                           */
+/* Remarks: Same as NN_UNIT_ATTRIB, but the input bias is in the bias vector  */
+/*          of the layer.                                                     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnBin2Unit
+{                                  /* Siz Sum */
+	NN_BIN2_INT16   iLayer;        /* [ 2][ 2] Index of the owning layer      */
+	NN_BIN2_INT16   iUnit;         /* [ 2][ 4] Index of this unit             */
+	NN_BIN2_INT16   nNumConns;     /* [ 2][ 6] Number of incoming connections */
+	NN_BIN2_INT16   bHasMatrix;    /* [ 2][ 8] If not zero, unit has a matrix */
+	NN_BIN2_INT16   nTrnFnId;      /* [ 2][10] I/O transform function id.     */
+	NN_BIN2_INT16   nTrnFlags;     /* [ 2][12] I/O transform flags            */
+	NN_BIN2_INT16   reserved_1[2]; /* [ 4][16] RESERVED                       */
+	double          fInpScale;     /* [ 8][24] Input scaling                  */
+	double          fOutBias;      /* [ 8][32] Output bias                    */
+	double          fOutScale;     /* [ 8][40] Output scaling                 */
+	double          fTrnMin;       /* [ 8][48] I/O transform range minimum    */
+	double          fTrnMax;       /* [ 8][56] I/O transform range maximum    */
+	double          reserved_2;    /* [ 8][64] RESERVED                       */
+}
+NN_BIN2_UNIT;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IsBin2Mem                                                     */
+/* Purpose:  Checks whether a memory block holds a NNFF 2.0 file              */
+/* Returns:  TRUE if it starts with the magic number, FALSE otherwise         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsBin2Mem (PCMEM pMem, size_t nMemSize);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReadBin2Net                                                   */
+/* Purpose:  Reads a neural net object from a NNFF 2.0 file in memory         */
+/* Remarks:  The net must have been created by Nn_CreateNet and nothing else. */
+/*           The function does not call Nn_AssertSemanticIntegrity, this is   */
+/*           left to the loading routines calling it. A file of a newer minor */
+/*           version is read as far as known. The weights, biases and         */
+/*           matrices are converted into the connections and units of the     */
+/*           net, the memory block is no longer needed on return.             */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ReadBin2Net
+(
+	NN_PNET  pNet,         /* The empty neural net object          */
+	PCMEM    pMem,         /* The file in memory                   */
+	size_t   nMemSize,     /* Size (in bytes) of the memory block  */
+	size_t*  pnBytesRead   /* Number of bytes read (can be NULL)   */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_MapBin2Net                                                    */
+/* Purpose:  Builds a frozen net (see Nn_FreezeNet) from a NNFF 2.0 file in   */
+/*           memory which stays valid as long as the net                      */
+/* Remarks:  The net must have been created by Nn_CreateNet and nothing else. */
+/*           The weights and source units of the compact connections are      */
+/*           used in place if the file is aligned to NN_BIN2_ALIGN and has    */
+/*           the type and byte order of the processing routines: double       */
+/*           weights which are not packed, on a little-endian platform. Then  */
+/*           pView of the net is set to pMem, otherwise the blocks are        */
+/*           converted into the arena of the net and pView is NULL. The       */
+/*           biases are copied into the units, the matrices are not read.     */
+/*           The attributes are checked as by Nn_AssertSemanticIntegrity,     */
+/*           which then only checks the numbers of input and output units.    */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_MapBin2Net
+(
+	NN_PNET  pNet,         /* The empty neural net object          */
+	PCMEM    pMem,         /* The file in memory                   */
+	size_t   nMemSize      /* Size (in bytes) of the memory block  */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_WriteNetToBin2File                                            */
+/* Purpose:  Writes a neural net object to a NNFF 2.0 file                    */
+/* Remarks:  nPayload gives the type of the weights, biases and matrices,     */
+/*           NN_PREC_SINGLE rounds them to float. With NN_BIN2_PACKED added,  */
+/*           the payload of each layer is packed with the filter giving the   */
+/*           smallest block. The file is built in memory and written at once. */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_WriteNetToBin2File
+(
+	PCSTR          pchFilePath,  /* Path to the NNFF 2.0 file            */
+	const NN_PNET  pNet,         /* The neural net object to be written  */
+	int            nPayload      /* Payload type of the file             */
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+/* EOF ///////////////////////////////////////////////////////////////////////*/
+
@@ -15,29 +15,91 @@
 
 #include "NnBase.h"
 #include "NnCheck.h"
+#include "NnProf.h"
+#include "NnTrace.h"
 #include "NnBinIO.h"
+#include "NnBin2IO.h"
+#include "NnStream.h"
 #include "utils/endian_order.h"
 
+#if defined(_MSC_VER)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_BIN_READER                                                     */
+/* Purpose: The state of reading a NNFF file                                  */
+/* Remarks: The view is the mapped file (see Nn_MapNetFromBinFile) or a copy  */
+/*          of it in a heap block (see Nn_CreateNetFromBinFile), so a file is */
+/*          read in one call. The section header fields have 4 bytes as       */
+/*          defined by NNFF 1.x, 8 bytes in files written by former versions  */
+/*          of this module on platforms with a 64 bit long (see               */
+/*          Nn_GetBinFieldSize). Each load has its own reader on the stack,   */
+/*          so several threads can read nets at once.                         */
+/*          A file in a stream (see Nn_ReadBinStreamNet) has no view, its     */
+/*          sections are taken from the buffer of the stream one by one, so   */
+/*          it is read in a single pass.                                      */
 /*////////////////////////////////////////////////////////////////////////////*/
-/* Module local binary I/O stream                                             */
-static FILE* g_stream = NULL;
+
+typedef struct SNnBinReader
+{
+	PCMEM        pMap;        /* The view of the file                   */
+	size_t       nMapSize;    /* Size of the view in bytes              */
+	size_t       nMapPos;     /* Current position within the view       */
+	BOOL         bMapError;   /* Set by reading beyond the end          */
+	BOOL         bMapHeap;    /* If TRUE, the view is a heap block      */
+	size_t       nFieldSize;  /* Size of the section header fields      */
+	NN_ISTREAM*  pIStream;    /* The stream instead of a view, or NULL  */
+}
+NN_BIN_READER;
+
+/* Whether the reader has a view or a stream */
+#define NN_BIN_READER_OPEN(pReader)  ((pReader)->pMap != NULL || (pReader)->pIStream != NULL)
+
+/* The value of a big-endian 32 bit integer, and of a section ID (e.g.        */
+/* NN_NET_SECTION_ID) in a section header                                     */
+#define NN_BIN_INT32(pb)  ((long) (((unsigned long) ((const unsigned char*) (pb))[0] << 24) | \
+                                   ((unsigned long) ((const unsigned char*) (pb))[1] << 16) | \
+                                   ((unsigned long) ((const unsigned char*) (pb))[2] <<  8) | \
+                                   ((unsigned long) ((const unsigned char*) (pb))[3])))
+#define NN_BIN_ID(pchID)  NN_BIN_INT32(pchID)
 
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Module local prototypes:                                                   */
 /*                                                                            */
-NN_STATUS Nn_ReadBinHeader  (long* pnSectionID, long* pnSectionSize);
-NN_STATUS Nn_ReadBinNet     (NN_PNET   pNet);
-NN_STATUS Nn_ReadBinLayer   (NN_PLAYER pLayer);
-NN_STATUS Nn_ReadBinUnit    (NN_PUNIT  pUnit);
-NN_STATUS Nn_ReadBinConns   (NN_PUNIT  pUnit);
-NN_STATUS Nn_ReadBinMatrix  (NN_PUNIT  pUnit);
-
-NN_STATUS Nn_WriteBinHeader (long nSectionID, long nSectionSize);
-NN_STATUS Nn_WriteBinNet    (const NN_PNET   pNet);
-NN_STATUS Nn_WriteBinLayer  (const NN_PLAYER pLayer);
-NN_STATUS Nn_WriteBinUnit   (const NN_PUNIT  pUnit);
-NN_STATUS Nn_WriteBinConns  (const NN_PUNIT  pUnit);
-NN_STATUS Nn_WriteBinMatrix (const NN_PUNIT  pUnit);
+NN_STATUS Nn_ReadBinHeader  (NN_BIN_READER* pReader, long* pnSectionID, long* pnSectionSize);
+NN_STATUS Nn_ReadBinNet     (NN_BIN_READER* pReader, NN_PNET   pNet);
+NN_STATUS Nn_ReadBinLayer   (NN_BIN_READER* pReader, NN_PNET pNet, NN_PLAYER pLayer);
+NN_STATUS Nn_ReadBinUnit    (NN_BIN_READER* pReader, NN_PNET pNet, NN_PUNIT  pUnit);
+NN_STATUS Nn_ReadBinConns   (NN_BIN_READER* pReader, NN_PNET pNet, NN_PUNIT  pUnit);
+NN_STATUS Nn_ReadBinMatrix  (NN_BIN_READER* pReader, NN_PNET pNet, NN_PUNIT  pUnit);
+size_t    Nn_GetBinArenaSize (NN_BIN_READER* pReader, const NN_PNET pNet);
+BOOL      Nn_ScanBinSection (NN_BIN_READER* pReader, long nSectionID, long nSectionSize, void* pAttrib, long nSkipSize);
+BOOL      Nn_ReadBinFields  (NN_BIN_READER* pReader, long* pnSectionID, long* pnSectionSize);
+size_t    Nn_GetBinFieldSize (NN_BIN_READER* pReader);
+size_t    Nn_GetBinBlockLimit (const NN_BIN_READER* pReader);
+PCMEM     Nn_BinReadBlock (NN_BIN_READER* pReader, size_t nSize);
+BOOL      Nn_BinRead  (NN_BIN_READER* pReader, void* pBuf, size_t nSize);
+BOOL      Nn_BinSeek  (NN_BIN_READER* pReader, long nPos, int nOrigin);
+long      Nn_BinTell  (const NN_BIN_READER* pReader);
+BOOL      Nn_BinError (const NN_BIN_READER* pReader);
+NN_STATUS Nn_LoadBinFile  (NN_BIN_READER* pReader, PCSTR pchFilePath);
+NN_STATUS Nn_MapBinFile   (NN_BIN_READER* pReader, PCSTR pchFilePath);
+void      Nn_UnmapBinFile (NN_BIN_READER* pReader);
+void      Nn_UnmapView    (PCMEM pView, size_t nViewSize);
+BOOL      Nn_IsBin2File   (NN_BIN_READER* pReader);
+
+NN_STATUS Nn_WriteBinHeader (FILE* ostream, long nSectionID, long nSectionSize);
+NN_STATUS Nn_WriteBinNet    (FILE* ostream, const NN_PNET   pNet);
+NN_STATUS Nn_WriteBinLayer  (FILE* ostream, const NN_PLAYER pLayer);
+NN_STATUS Nn_WriteBinUnit   (FILE* ostream, const NN_PUNIT  pUnit);
+NN_STATUS Nn_WriteBinConns  (FILE* ostream, const NN_PUNIT  pUnit);
+NN_STATUS Nn_WriteBinMatrix (FILE* ostream, const NN_PUNIT  pUnit);
 
 void eo_swap_net_attrib(NN_NET_ATTRIB* pna);
 void eo_swap_layer_attrib(NN_LAYER_ATTRIB* pla); 
@@ -60,11 +122,17 @@ NN_STATUS Nn_CreateNetFromBinFile
 	NN_PNET* ppNet          /* The resulting neural net object             */
 )
 {
-	NN_STATUS  nns;
+	NN_STATUS      nns;
+	NN_BIN_READER  reader;
+	double         dTraceStart;
+	NN_HWPROF_DECL(hwSample)
 	
 	assert(pchFilePath != NULL);
 	assert(ppNet != NULL);
 
+	NN_HWPROF_START(hwSample)
+	dTraceStart = Nn_GetTraceTime();
+
 	/* Set the global error code to NN_OF (or zero) */
 	Nn_ClearError();
 	/* Create an empty neural net object */
@@ -72,26 +140,111 @@ NN_STATUS Nn_CreateNetFromBinFile
 	/* If there was enough memory */
 	if (nns == NN_OK)
 	{
-		/* Open the NNFF file in binary mode and save its handle global */
-		g_stream = fopen(pchFilePath, "rb");
-		/* If it can be opened */
-		if (g_stream != NULL)
+		/* Read the NNFF file at once into the view of the reader */
+		nns = Nn_LoadBinFile(&reader, pchFilePath);
+		if (nns == NN_OK)
 		{
-			/* Read the neural net object from the open file */
-			nns = Nn_ReadBinNet(*ppNet);
-			/* Close the NNFF file */
-			fclose(g_stream);
-			g_stream = NULL;
+			/* Read the neural net object from the view, */
+			/* NNFF 2.0 or 1.x                           */
+			if (Nn_IsBin2File(&reader))
+				nns = Nn_ReadBin2Net(*ppNet, reader.pMap, reader.nMapSize, NULL);
+			else
+				nns = Nn_ReadBinNet(&reader, *ppNet);
+			/* Release the view */
+			Nn_UnmapBinFile(&reader);
+		}
+	}
+
+	/* If the neural net object was read successfully */
+	if (nns == NN_OK)
+	{
+		/* Check and, if necessary, correct its internal semantic integrity */
+		nns = Nn_AssertSemanticIntegrity(*ppNet, nNumInpUnits, nNumOutUnits);
+		/* The counters are reset by the check, so count afterwards */
+		if (nns == NN_OK)
+		{
+			NN_HWPROF_STOP(*ppNet, NN_PROF_LOAD, 0, hwSample)
+		}
+	}
+	/* If the net was not read successfully */
+	else
+	{
+		/* Realease the object instance */
+		Nn_DeleteNet(*ppNet);
+		*ppNet = NULL;
+	}
+
+	Nn_AddTraceSpan("nnif", "load", dTraceStart, -1);
+	return nns;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_MapNetFromBinFile                                             */
+/* Purpose:  Reads a neural net object from a memory mapped binary NNFF file  */
+/* Remarks:  Same as Nn_CreateNetFromBinFile, but the sections are taken      */
+/*           directly from the mapped file instead of a copy of the file.     */
+/*           A truncated file is reported as a read error. A NNFF 2.0 file    */
+/*           gives a frozen net, see Nn_MapBin2Net.                           */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_MapNetFromBinFile
+(
+	PCSTR    pchFilePath,   /* Complete path and filename for the NNFF file */
+	int      nNumInpUnits,  /* Number of input units                       */
+	int      nNumOutUnits,  /* Number of output units                      */
+	NN_PNET* ppNet          /* The resulting neural net object             */
+)
+{
+	NN_STATUS      nns;
+	NN_BIN_READER  reader;
+	double         dTraceStart;
+	NN_HWPROF_DECL(hwSample)
+	
+	assert(pchFilePath != NULL);
+	assert(ppNet != NULL);
+
+	NN_HWPROF_START(hwSample)
+	dTraceStart = Nn_GetTraceTime();
+
+	/* Set the global error code to NN_OF (or zero) */
+	Nn_ClearError();
+	/* Create an empty neural net object */
+	nns = Nn_CreateNet(ppNet);
+	/* If there was enough memory */
+	if (nns == NN_OK)
+	{
+		/* Map the NNFF file into the view of the reader */
+		nns = Nn_MapBinFile(&reader, pchFilePath);
+		if (nns == NN_OK)
+		{
+			/* Read the neural net object from the mapped file, NNFF 2.0 */
+			/* as a frozen net which may use the mapped blocks in place, */
+			/* 1.x as an editable net                                    */
+			if (Nn_IsBin2File(&reader))
+				nns = Nn_MapBin2Net(*ppNet, reader.pMap, reader.nMapSize);
+			else
+				nns = Nn_ReadBinNet(&reader, *ppNet);
+			/* The net keeps the mapping if it refers to it, */
+			/* otherwise the NNFF file is unmapped           */
+			if (nns == NN_OK && (*ppNet)->pView != NULL)
+				(*ppNet)->pfnUnmap = Nn_UnmapView;
+			else
+				Nn_UnmapBinFile(&reader);
 		}
-		/* If the NNFF file could'nt be opened */
-		else
-			nns = Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't open binary file '%s' for read", pchFilePath);
 	}
 
 	/* If the neural net object was read successfully */
 	if (nns == NN_OK)
+	{
 		/* Check and, if necessary, correct its internal semantic integrity */
 		nns = Nn_AssertSemanticIntegrity(*ppNet, nNumInpUnits, nNumOutUnits);
+		/* The counters are reset by the check, so count afterwards */
+		if (nns == NN_OK)
+		{
+			NN_HWPROF_STOP(*ppNet, NN_PROF_LOAD, 0, hwSample)
+		}
+	}
 	/* If the net was not read successfully */
 	else
 	{
@@ -100,9 +253,35 @@ NN_STATUS Nn_CreateNetFromBinFile
 		*ppNet = NULL;
 	}
 
+	Nn_AddTraceSpan("nnif", "map", dTraceStart, -1);
 	return nns;
 }
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReadBinStreamNet                                              */
+/* Purpose:  Reads a neural net object from a binary NNFF 1.x file in a       */
+/*           stream                                                           */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ReadBinStreamNet (NN_PNET pNet, NN_ISTREAM* pIStream)
+{
+	NN_BIN_READER  reader;
+
+	assert(pNet != NULL);
+	assert(pIStream != NULL);
+
+	reader.pMap       = NULL;
+	reader.nMapSize   = 0;
+	reader.nMapPos    = 0;
+	reader.bMapError  = FALSE;
+	reader.bMapHeap   = FALSE;
+	reader.nFieldSize = 4;
+	reader.pIStream   = pIStream;
+
+	return Nn_ReadBinNet(&reader, pNet);
+}
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_ReadBinHeader                                                 */
 /* Purpose:  Reads a section header to identify the following section in NNFF */
@@ -111,40 +290,215 @@ NN_STATUS Nn_CreateNetFromBinFile
 
 NN_STATUS Nn_ReadBinHeader 
 (
-	long* pnSectionID,   /* Section ID (4 byte code, 4th is zero) */
-	long* pnSectionSize  /* Size of the following section (4 byte integer) */
+	NN_BIN_READER* pReader,       /* The reader of the NNFF file */
+	long*          pnSectionID,   /* Section ID (4 byte code, 4th is zero) */
+	long*          pnSectionSize  /* Size of the following section (4 byte integer) */
 )
 {
 	assert(pnSectionID != NULL);
 	assert(pnSectionSize != NULL);
-	assert(g_stream != NULL);
-
-	/* Read the section identifier (4 bytes) */
-	fread(pnSectionID,   sizeof (long), 1, g_stream);
-	if (eo_endian_order() != BIG_ENDIAN) 
-		eo_swap_long_n(pnSectionID, 1);
+	assert(NN_BIN_READER_OPEN(pReader));
 
-	if (ferror(g_stream))
-		return Nn_SetFileReadError();
-	
-	/* Read the section size (4 bytes) */
-	fread(pnSectionSize, sizeof (long), 1, g_stream);
-	if (eo_endian_order() != BIG_ENDIAN) 
-		eo_swap_long_n(pnSectionSize, 1);
-
-	if (ferror(g_stream))
+	/* Read the section identifier and size (4 bytes each) */
+	if (!Nn_ReadBinFields(pReader, pnSectionID, pnSectionSize))
 		return Nn_SetFileReadError();
 
 	return NN_OK;
 }
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReadBinFields                                                 */
+/* Purpose:  Reads the fields of a section header, big-endian 32 bit integers */
+/* Remarks:  Of 8 byte fields the low 4 bytes are taken. The section ID in    */
+/*           such a field was written in the byte order of the host, so its   */
+/*           bytes are reversed.                                              */
+/* Returns:  TRUE if the fields have been read completely                     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_ReadBinFields (NN_BIN_READER* pReader, long* pnSectionID, long* pnSectionSize)
+{
+	const unsigned char* pbID;
+	unsigned char        abID[4];
+
+	pbID = (const unsigned char*) Nn_BinReadBlock(pReader, 2 * pReader->nFieldSize);
+	if (pbID == NULL)
+		return FALSE;
+	pbID += pReader->nFieldSize - 4;
+
+	if (pReader->nFieldSize == 4)
+		*pnSectionID = NN_BIN_INT32(pbID);
+	else
+	{
+		abID[0] = pbID[3];
+		abID[1] = pbID[2];
+		abID[2] = pbID[1];
+		abID[3] = pbID[0];
+		*pnSectionID = NN_BIN_INT32(abID);
+	}
+	*pnSectionSize = NN_BIN_INT32(pbID + pReader->nFieldSize);
+	return TRUE;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBinFieldSize                                               */
+/* Purpose:  Determines the size of the section header fields from the        */
+/*           header of the net section at the beginning of the view           */
+/* Remarks:  Former versions of this module wrote a long for each field, on   */
+/*           little-endian platforms with a 64 bit long the 8 bytes of the    */
+/*           net section ID end with "\0TEN".                                 */
+/* Returns:  8 for such a file, 4 otherwise                                   */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetBinFieldSize (NN_BIN_READER* pReader)
+{
+	PCMEM  pHeader;
+	size_t nSize;
+
+	if (pReader->pIStream != NULL)
+		nSize = Nn_IPeek(pReader->pIStream, &pHeader, 8);
+	else
+	{
+		pHeader = pReader->pMap;
+		nSize   = pReader->nMapSize;
+	}
+
+	if (nSize >= 8 && memcmp(pHeader + 4, "\0TEN", 4) == 0)
+		return 8;
+	return 4;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBinBlockLimit                                              */
+/* Purpose:  Gets the size of the largest block Nn_BinReadBlock can take      */
+/* Remarks:  The blocks of a stream are limited by its buffer, large sections */
+/*           are read in several blocks.                                      */
+/* Returns:  The number of bytes                                              */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetBinBlockLimit (const NN_BIN_READER* pReader)
+{
+	if (pReader->pIStream != NULL)
+		return pReader->pIStream->nBufSize;
+	return pReader->nMapSize;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBinArenaSize                                               */
+/* Purpose:  Determines the arena size of the net in a first pass over the    */
+/*           layer and unit sections following the net section                */
+/* Remarks:  Only the section headers and attributes are read, the stream is  */
+/*           rewound afterwards. Errors are reported by the second pass,      */
+/*           which reads the net.                                             */
+/* Returns:  The arena size in bytes, zero if the sections are not valid      */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetBinArenaSize (NN_BIN_READER* pReader, const NN_PNET pNet)
+{
+	NN_LAYER_ATTRIB la;
+	NN_UNIT_ATTRIB  ua;
+	size_t          nSize;
+	long            nPos;
+	long            nNumUnits, iU;
+	short           iL;
+
+	assert(pNet != NULL);
+	assert(pReader->pMap != NULL);
+
+	nPos = Nn_BinTell(pReader);
+	if (nPos < 0)
+		return 0;
+	nSize = Nn_GetLayersArenaSize(pNet->na.nNumLayers);
+	nNumUnits = 0;
+
+	/* For all layer sections */
+	for (iL = 0; iL < pNet->na.nNumLayers && nSize > 0; iL++)
+	{
+		if (Nn_ScanBinSection(pReader, NN_BIN_ID(NN_LAYER_SECTION_ID), NN_LAYER_SECTION_SIZE, &la, 0))
+		{
+			if (eo_endian_order() != BIG_ENDIAN) 
+				eo_swap_layer_attrib(&la);
+			nSize += Nn_GetUnitsArenaSize(la.nNumUnits);
+			if (la.nNumUnits > 0)
+				nNumUnits += la.nNumUnits;
+		}
+		else
+			nSize = 0;
+	}
+
+	/* For all unit sections, each followed by its connections and matrix */
+	for (iU = 0; iU < nNumUnits && nSize > 0; iU++)
+	{
+		if (!Nn_ScanBinSection(pReader, NN_BIN_ID(NN_UNIT_SECTION_ID), NN_UNIT_SECTION_SIZE, &ua, 0))
+		{
+			nSize = 0;
+			break;
+		}
+		if (eo_endian_order() != BIG_ENDIAN) 
+			eo_swap_unit_attrib(&ua);
+		if (ua.nNumConns <= 0)
+			continue;
+
+		nSize += Nn_GetConnsArenaSize(ua.nNumConns);
+		if (!Nn_ScanBinSection(pReader, NN_BIN_ID(NN_CONN_SECTION_ID), NN_CONN_ENTRY_SIZE, NULL,
+								(long) ua.nNumConns * NN_CONN_ENTRY_SIZE))
+			nSize = 0;
+		else if (ua.bHasMatrix)
+		{
+			nSize += Nn_GetMatrixArenaSize(ua.nNumConns);
+			if (!Nn_ScanBinSection(pReader, NN_BIN_ID(NN_MATRIX_SECTION_ID), NN_MATRIX_ENTRY_SIZE, NULL,
+									(long) ua.nNumConns * ua.nNumConns * NN_MATRIX_ENTRY_SIZE))
+				nSize = 0;
+		}
+	}
+
+	/* Rewind to the layer sections */
+	Nn_BinSeek(pReader, nPos, SEEK_SET);
+	return nSize;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ScanBinSection                                                */
+/* Purpose:  Reads a section header from the NNFF file and then either the    */
+/*           section attributes or skips the given number of bytes            */
+/* Remarks:  Used by the first pass, no error is set.                         */
+/* Returns:  TRUE if the header matches and the section could be read         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_ScanBinSection
+(
+	NN_BIN_READER* pReader,      /* The reader of the NNFF file                */
+	long           nSectionID,   /* Expected section ID                        */
+	long           nSectionSize, /* Expected section size                      */
+	void*          pAttrib,      /* Receives the section attributes or NULL    */
+	long           nSkipSize     /* Number of bytes to skip if pAttrib is NULL */
+)
+{
+	long nID, nSize;
+
+	/* Read the section header */
+	if (!Nn_ReadBinFields(pReader, &nID, &nSize))
+		return FALSE;
+	if (nID != nSectionID || nSize != nSectionSize)
+		return FALSE;
+
+	if (pAttrib != NULL)
+	{
+		if (!Nn_BinRead(pReader, pAttrib, nSectionSize))
+			return FALSE;
+	}
+	else if (nSkipSize > 0 && !Nn_BinSeek(pReader, nSkipSize, SEEK_CUR))
+		return FALSE;
+
+	return TRUE;
+}
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_ReadBinNet                                                    */
 /* Purpose:  Reads the complete neural net from the open NNFF file            */
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_ReadBinNet (NN_PNET pNet)
+NN_STATUS Nn_ReadBinNet (NN_BIN_READER* pReader, NN_PNET pNet)
 {
 	NN_STATUS  nns;
 	short      iL, iU;
@@ -153,15 +507,18 @@ NN_STATUS Nn_ReadBinNet (NN_PNET pNet)
 	long       nSectionID, nSectionSize;
 
 	assert(pNet != NULL);
-	assert(g_stream != NULL);
+	assert(NN_BIN_READER_OPEN(pReader));
+
+	/* The header fields of all sections have the size of the first one */
+	pReader->nFieldSize = Nn_GetBinFieldSize(pReader);
 
 	/* Read the neural net section header */
-	nns = Nn_ReadBinHeader(&nSectionID, &nSectionSize);
+	nns = Nn_ReadBinHeader(pReader, &nSectionID, &nSectionSize);
 	if (nns != NN_OK)
 		return nns;
 
 	/* If the identifier does not match: error */
-	if (nSectionID != *(long*)NN_NET_SECTION_ID)
+	if (nSectionID != NN_BIN_ID(NN_NET_SECTION_ID))
 		return Nn_SetInvalidSectionIDError();
 		
 	/* If the size is not correct: error */
@@ -169,13 +526,22 @@ NN_STATUS Nn_ReadBinNet (NN_PNET pNet)
 		return Nn_SetInvalidSectionSizeError();
 
 	/* Read the complete neural net section */
-	fread(&pNet->na, NN_NET_SECTION_SIZE, 1, g_stream);
+	Nn_BinRead(pReader, &pNet->na, NN_NET_SECTION_SIZE);
 	if (eo_endian_order() != BIG_ENDIAN) 
 		eo_swap_net_attrib(&pNet->na);
 
-	if (ferror(g_stream))
+	if (Nn_BinError(pReader))
 		return Nn_SetFileReadError();
 
+	/* Size the arena of the net in a first pass and create it. A stream */
+	/* can't be rewound, its net is allocated block by block.            */
+	if (pReader->pIStream == NULL)
+	{
+		nns = Nn_CreateArena(pNet, Nn_GetBinArenaSize(pReader, pNet));
+		if (nns != NN_OK)
+			return nns;
+	}
+
 	/* Create all layers for the neural net object */
 	nns = Nn_CreateLayers(pNet);
 	if (nns != NN_OK)
@@ -187,7 +553,7 @@ NN_STATUS Nn_ReadBinNet (NN_PNET pNet)
 		/* Get the layer at the given position */
 		pLayer = Nn_GetLayerAt(pNet, iL);
 		/* Read the layer from the NNFF file */
-		nns = Nn_ReadBinLayer(pLayer);
+		nns = Nn_ReadBinLayer(pReader, pNet, pLayer);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -203,7 +569,7 @@ NN_STATUS Nn_ReadBinNet (NN_PNET pNet)
 			/* Get the unit at the given position */
 			pUnit = Nn_GetUnitAt(pLayer, iU);
 			/* Read the unit from the NNFF file */
-			nns = Nn_ReadBinUnit(pUnit);
+			nns = Nn_ReadBinUnit(pReader, pNet, pUnit);
 			if (nns != NN_OK)
 				return nns;
 		}
@@ -218,21 +584,22 @@ NN_STATUS Nn_ReadBinNet (NN_PNET pNet)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_ReadBinLayer (NN_PLAYER pLayer)
+NN_STATUS Nn_ReadBinLayer (NN_BIN_READER* pReader, NN_PNET pNet, NN_PLAYER pLayer)
 {
 	NN_STATUS nns;
 	long nSectionID, nSectionSize;
 	
+	assert(pNet != NULL);
 	assert(pLayer != NULL);
-	assert(g_stream != NULL);
+	assert(NN_BIN_READER_OPEN(pReader));
 
 	/* Read the layer section header */
-	nns = Nn_ReadBinHeader(&nSectionID, &nSectionSize);
+	nns = Nn_ReadBinHeader(pReader, &nSectionID, &nSectionSize);
 	if (nns != NN_OK)
 		return nns;
 
 	/* If the identifier does not match: error */
-	if (nSectionID != *(long*)NN_LAYER_SECTION_ID)
+	if (nSectionID != NN_BIN_ID(NN_LAYER_SECTION_ID))
 		return Nn_SetInvalidSectionIDError();
 		
 	/* If the size is not correct: error */
@@ -240,18 +607,18 @@ NN_STATUS Nn_ReadBinLayer (NN_PLAYER pLayer)
 		return Nn_SetInvalidSectionSizeError();
 
 	/* Read the complete layer section from the file */
-	fread(&pLayer->la, NN_LAYER_SECTION_SIZE, 1, g_stream);
+	Nn_BinRead(pReader, &pLayer->la, NN_LAYER_SECTION_SIZE);
 	if (eo_endian_order() != BIG_ENDIAN) 
 		eo_swap_layer_attrib(&pLayer->la);
 
-	if (ferror(g_stream))
+	if (Nn_BinError(pReader))
 		return Nn_SetFileReadError();
 
 	nns = NN_OK;
 
 	/* If the layer has units, create them */
 	if (pLayer->la.nNumUnits > 0)
-		nns = Nn_CreateUnits(pLayer);
+		nns = Nn_CreateUnitsIn(pNet, pLayer);
 	
 	return nns;
 }
@@ -262,21 +629,22 @@ NN_STATUS Nn_ReadBinLayer (NN_PLAYER pLayer)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_ReadBinUnit (NN_PUNIT  pUnit)
+NN_STATUS Nn_ReadBinUnit (NN_BIN_READER* pReader, NN_PNET pNet, NN_PUNIT  pUnit)
 {
 	NN_STATUS nns;
 	long      nSectionID, nSectionSize;
 	
+	assert(pNet != NULL);
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(NN_BIN_READER_OPEN(pReader));
 
 	/* Read the unit section header */
-	nns = Nn_ReadBinHeader(&nSectionID, &nSectionSize);
+	nns = Nn_ReadBinHeader(pReader, &nSectionID, &nSectionSize);
 	if (nns != NN_OK)
 		return nns;
 
 	/* If the identifier does not match: error */
-	if (nSectionID != *(long*)NN_UNIT_SECTION_ID)
+	if (nSectionID != NN_BIN_ID(NN_UNIT_SECTION_ID))
 		return Nn_SetInvalidSectionIDError();
 		
 	/* If the size is not correct: error */
@@ -284,17 +652,17 @@ NN_STATUS Nn_ReadBinUnit (NN_PUNIT  pUnit)
 		return Nn_SetInvalidSectionSizeError();
 
 	/* Read the complete unit section from the NNFF file */
-	fread(&pUnit->ua, NN_UNIT_SECTION_SIZE, 1, g_stream);
+	Nn_BinRead(pReader, &pUnit->ua, NN_UNIT_SECTION_SIZE);
         if (eo_endian_order() != BIG_ENDIAN) 
 		eo_swap_unit_attrib(&pUnit->ua);
 
-	if (ferror(g_stream))
+	if (Nn_BinError(pReader))
 		return Nn_SetFileReadError();
 
 	/* If the units has incomming connections */
 	if (pUnit->ua.nNumConns > 0)
 	{
-		nns = Nn_ReadBinConns(pUnit);
+		nns = Nn_ReadBinConns(pReader, pNet, pUnit);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -302,7 +670,7 @@ NN_STATUS Nn_ReadBinUnit (NN_PUNIT  pUnit)
 	/* If the unit has a matrix definition */
 	if (pUnit->ua.nNumConns > 0 && pUnit->ua.bHasMatrix)
 	{
-		nns = Nn_ReadBinMatrix(pUnit);
+		nns = Nn_ReadBinMatrix(pReader, pNet, pUnit);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -317,23 +685,26 @@ NN_STATUS Nn_ReadBinUnit (NN_PUNIT  pUnit)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_ReadBinConns (NN_PUNIT  pUnit)
+NN_STATUS Nn_ReadBinConns (NN_BIN_READER* pReader, NN_PNET pNet, NN_PUNIT  pUnit)
 {
 	NN_STATUS nns;
 	NN_PCONN  pConn;
-	short     iC;
+	PCMEM     pEntries;
+	short     iC, iChunk, nChunk;
+	size_t    nLimit;
 	long      nSectionID, nSectionSize;
 	
+	assert(pNet != NULL);
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(NN_BIN_READER_OPEN(pReader));
 
 	/* Read the connection section header */
-	nns = Nn_ReadBinHeader(&nSectionID, &nSectionSize);
+	nns = Nn_ReadBinHeader(pReader, &nSectionID, &nSectionSize);
 	if (nns != NN_OK)
 		return nns;
 
 	/* If the identifier does not match: error */
-	if (nSectionID != *(long*)NN_CONN_SECTION_ID)
+	if (nSectionID != NN_BIN_ID(NN_CONN_SECTION_ID))
 		return Nn_SetInvalidSectionIDError();
 		
 	/* If the size is not correct: error */
@@ -341,25 +712,32 @@ NN_STATUS Nn_ReadBinConns (NN_PUNIT  pUnit)
 		return Nn_SetInvalidSectionSizeError();
 
 	/* Create the connections */
-	nns = Nn_CreateConns(pUnit);
+	nns = Nn_CreateConnsIn(pNet, pUnit);
 	if (nns != NN_OK)
 		return nns;
 
-	/* Read all connections from the NNFF file */
-	for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
+	/* Take all connections from the NNFF file at once, or in chunks */
+	/* limited by the buffer of a stream                             */
+	nLimit = Nn_GetBinBlockLimit(pReader) / NN_CONN_ENTRY_SIZE;
+	nChunk = nLimit < (size_t) pUnit->ua.nNumConns ? (short) nLimit : pUnit->ua.nNumConns;
+	for (iC = 0; iC < pUnit->ua.nNumConns; )
 	{
-		/* Get the connection at the given position */
-		pConn = Nn_GetConnAt(pUnit, iC);
-
-		/* Read the connection from the NNF file */
-		fread(&pConn->ca,
-			  NN_CONN_ENTRY_SIZE, 
-			  1, 
-			  g_stream);
-		if (eo_endian_order() != BIG_ENDIAN) 
-			eo_swap_conn_attrib(&pConn->ca);
-		if (ferror(g_stream))
+		if (nChunk > pUnit->ua.nNumConns - iC)
+			nChunk = pUnit->ua.nNumConns - iC;
+		pEntries = nChunk > 0 ? Nn_BinReadBlock(pReader, (size_t) nChunk * NN_CONN_ENTRY_SIZE) : NULL;
+		if (pEntries == NULL)
 			return Nn_SetFileReadError();
+
+		for (iChunk = 0; iChunk < nChunk; iChunk++, iC++)
+		{
+			/* Get the connection at the given position */
+			pConn = Nn_GetConnAt(pUnit, iC);
+
+			/* Copy the connection from the NNF file */
+			memcpy(&pConn->ca, pEntries + iChunk * NN_CONN_ENTRY_SIZE, NN_CONN_ENTRY_SIZE);
+			if (eo_endian_order() != BIG_ENDIAN) 
+				eo_swap_conn_attrib(&pConn->ca);
+		}
 	}
 
 	/* Fine */
@@ -372,23 +750,26 @@ NN_STATUS Nn_ReadBinConns (NN_PUNIT  pUnit)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise              */
 /*//////////////////////////////////////////////////////////////////////////// */
 
-NN_STATUS Nn_ReadBinMatrix (NN_PUNIT pUnit)
+NN_STATUS Nn_ReadBinMatrix (NN_BIN_READER* pReader, NN_PNET pNet, NN_PUNIT pUnit)
 {
 	NN_STATUS nns;
-	NN_FLOAT* pfRow;
-	short     iC;
+	NN_FLOAT* pfElems;
+	PCMEM     pBlock;
+	long      nElems, iElem, nChunk;
+	size_t    nLimit;
 	long      nSectionID, nSectionSize;
 	
+	assert(pNet != NULL);
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(NN_BIN_READER_OPEN(pReader));
 
 	/* Read the connection section header */
-	nns = Nn_ReadBinHeader(&nSectionID, &nSectionSize);
+	nns = Nn_ReadBinHeader(pReader, &nSectionID, &nSectionSize);
 	if (nns != NN_OK)
 		return nns;
 
 	/* If the identifier does not match: error */
-	if (nSectionID != *(long*)NN_MATRIX_SECTION_ID)
+	if (nSectionID != NN_BIN_ID(NN_MATRIX_SECTION_ID))
 		return Nn_SetInvalidSectionIDError();
 		
 	/* If the size is not correct: error */
@@ -396,32 +777,306 @@ NN_STATUS Nn_ReadBinMatrix (NN_PUNIT pUnit)
 		return Nn_SetInvalidSectionSizeError();
 
 	/* Create the matrix */
-	nns = Nn_CreateMatrix(pUnit);
+	nns = Nn_CreateMatrixIn(pNet, pUnit);
 	if (nns != NN_OK)
 		return nns;
 
-	/* Read all matrix rows from the NNFF file */
-	for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
+	/* Take all matrix rows from the NNFF file at once, they are contiguous, */
+	/* or in chunks limited by the buffer of a stream, and swap them while   */
+	/* copying */
+	nElems  = (long) pUnit->ua.nNumConns * pUnit->ua.nNumConns;
+	nLimit  = Nn_GetBinBlockLimit(pReader) / NN_MATRIX_ENTRY_SIZE;
+	nChunk  = nLimit < (size_t) nElems ? (long) nLimit : nElems;
+	pfElems = Nn_GetMatrixElems(pUnit);
+	for (iElem = 0; iElem < nElems; iElem += nChunk)
 	{
-		/* Get the matrix row at the given row position */
-		pfRow = Nn_GetMatrixRowAt(pUnit, iC);
-
-		/* Read the row */
-		fread(pfRow, 
-			  NN_MATRIX_ENTRY_SIZE * pUnit->ua.nNumConns,
-			  1,
-			  g_stream);
-		if (eo_endian_order() != BIG_ENDIAN) 
-			eo_swap_double_n(pfRow, pUnit->ua.nNumConns);
-
-		if (ferror(g_stream))
+		if (nChunk > nElems - iElem)
+			nChunk = nElems - iElem;
+		pBlock = nChunk > 0 ? Nn_BinReadBlock(pReader, NN_MATRIX_ENTRY_SIZE * (size_t) nChunk) : NULL;
+		if (pBlock == NULL)
 			return Nn_SetFileReadError();
+		if (eo_endian_order() != BIG_ENDIAN) 
+			eo_copy_swap_double_n(pfElems + iElem, pBlock, nChunk);
+		else
+			memcpy(pfElems + iElem, pBlock, NN_MATRIX_ENTRY_SIZE * nChunk);
 	}
 
 	/* Fine */
 	return NN_OK;
 }
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_BinReadBlock                                                  */
+/* Purpose:  Takes a block of bytes from the view of the NNFF file            */
+/* Remarks:  Reading beyond the end of the file sets the error flag. The      */
+/*           block is not aligned. The block of a stream is valid up to the   */
+/*           next read and limited by Nn_GetBinBlockLimit.                    */
+/* Returns:  The block within the view, NULL if beyond the end of the file    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+PCMEM Nn_BinReadBlock (NN_BIN_READER* pReader, size_t nSize)
+{
+	PCMEM pBlock;
+
+	assert(NN_BIN_READER_OPEN(pReader));
+
+	if (pReader->pIStream != NULL)
+	{
+		pBlock = Nn_IReadBlock(pReader->pIStream, nSize);
+		if (pBlock == NULL)
+			pReader->bMapError = TRUE;
+		return pBlock;
+	}
+
+	if (nSize > pReader->nMapSize - pReader->nMapPos)
+	{
+		pReader->nMapPos   = pReader->nMapSize;
+		pReader->bMapError = TRUE;
+		return NULL;
+	}
+	pBlock = pReader->pMap + pReader->nMapPos;
+	pReader->nMapPos += nSize;
+	return pBlock;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_BinRead                                                       */
+/* Purpose:  Reads a single item from the NNFF file, 'fread' equivalent for   */
+/*           the view of the file                                             */
+/* Remarks:  Reading beyond the end of the file sets the error flag.          */
+/* Returns:  TRUE if the item has been read completely                        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_BinRead (NN_BIN_READER* pReader, void* pBuf, size_t nSize)
+{
+	PCMEM pBlock;
+
+	pBlock = Nn_BinReadBlock(pReader, nSize);
+	if (pBlock == NULL)
+		return FALSE;
+	memcpy(pBuf, pBlock, nSize);
+	return TRUE;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_BinSeek                                                       */
+/* Purpose:  Sets the position in the NNFF file, 'fseek' equivalent for the   */
+/*           view of the file (SEEK_SET and SEEK_CUR only)                    */
+/* Returns:  TRUE for success                                                 */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_BinSeek (NN_BIN_READER* pReader, long nPos, int nOrigin)
+{
+	assert(pReader->pMap != NULL);
+	assert(nOrigin == SEEK_SET || nOrigin == SEEK_CUR);
+
+	if (nOrigin == SEEK_CUR)
+	{
+		if (nPos > 0 && (size_t) nPos > pReader->nMapSize - pReader->nMapPos)
+			return FALSE;
+		if (nPos < 0 && (size_t) -nPos > pReader->nMapPos)
+			return FALSE;
+		pReader->nMapPos += nPos;
+	}
+	else
+	{
+		if (nPos < 0 || (size_t) nPos > pReader->nMapSize)
+			return FALSE;
+		pReader->nMapPos = (size_t) nPos;
+	}
+	return TRUE;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_BinTell                                                       */
+/* Purpose:  Gets the position in the NNFF file, 'ftell' equivalent           */
+/* Returns:  The position, -1 on error                                        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+long Nn_BinTell (const NN_BIN_READER* pReader)
+{
+	assert(pReader->pMap != NULL);
+	return (long) pReader->nMapPos;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_BinError                                                      */
+/* Purpose:  Checks the error flag of the NNFF file, 'ferror' equivalent      */
+/* Returns:  TRUE if an error occured                                         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_BinError (const NN_BIN_READER* pReader)
+{
+	assert(NN_BIN_READER_OPEN(pReader));
+	return pReader->bMapError;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_LoadBinFile                                                   */
+/* Purpose:  Reads a NNFF file at once into a heap block, the view of the     */
+/*           reader                                                           */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_LoadBinFile (NN_BIN_READER* pReader, PCSTR pchFilePath)
+{
+	FILE*  pFile;
+	PMEM   pMem;
+	long   nSize;
+
+	pFile = fopen(pchFilePath, "rb");
+	if (pFile == NULL)
+		return Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't open binary file '%s' for read", pchFilePath);
+
+	if (fseek(pFile, 0, SEEK_END) != 0 || (nSize = ftell(pFile)) < 0 ||
+		fseek(pFile, 0, SEEK_SET) != 0)
+	{
+		fclose(pFile);
+		return Nn_SetFileReadError();
+	}
+
+	/* An empty file is reported by the reading routines */
+	pMem = (PMEM) Nn_Alloc(nSize > 0 ? (size_t) nSize : 1);
+	if (pMem == NULL)
+	{
+		fclose(pFile);
+		return Nn_SetOutOfMemoryError();
+	}
+	if (nSize > 0 && fread(pMem, (size_t) nSize, 1, pFile) != 1)
+	{
+		Nn_Free(pMem);
+		fclose(pFile);
+		return Nn_SetFileReadError();
+	}
+	fclose(pFile);
+
+	pReader->pMap       = pMem;
+	pReader->nMapSize   = (size_t) nSize;
+	pReader->nMapPos    = 0;
+	pReader->bMapError  = FALSE;
+	pReader->bMapHeap   = TRUE;
+	pReader->nFieldSize = 4;
+	pReader->pIStream   = NULL;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_MapBinFile                                                    */
+/* Purpose:  Maps a NNFF file read-only into memory, the view of the reader   */
+/* Returns:  NN_OK (or zero) for success, NN_CANT_OPEN_FILE otherwise         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_MapBinFile (NN_BIN_READER* pReader, PCSTR pchFilePath)
+{
+#if defined(_MSC_VER)
+	HANDLE        hFile, hMapping;
+	LARGE_INTEGER nFileSize;
+	PCMEM         pMap;
+
+	pMap  = NULL;
+	hFile = CreateFileA(pchFilePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		if (GetFileSizeEx(hFile, &nFileSize) && nFileSize.QuadPart > 0)
+		{
+			hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (hMapping != NULL)
+			{
+				/* The view keeps the mapping alive */
+				pMap = (PCMEM) MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+				CloseHandle(hMapping);
+			}
+		}
+		CloseHandle(hFile);
+	}
+	if (pMap == NULL)
+		return Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't map binary file '%s' for read", pchFilePath);
+	pReader->nMapSize = (size_t) nFileSize.QuadPart;
+#else
+	int         hFile;
+	struct stat fileStat;
+	void*       pMap;
+
+	pMap  = MAP_FAILED;
+	hFile = open(pchFilePath, O_RDONLY);
+	if (hFile >= 0)
+	{
+		if (fstat(hFile, &fileStat) == 0 && fileStat.st_size > 0)
+		{
+			/* The mapping stays valid after closing the file */
+			pMap = mmap(NULL, (size_t) fileStat.st_size, PROT_READ, MAP_PRIVATE, hFile, 0);
+		}
+		close(hFile);
+	}
+	if (pMap == MAP_FAILED)
+		return Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't map binary file '%s' for read", pchFilePath);
+	pReader->nMapSize = (size_t) fileStat.st_size;
+#endif
+
+	pReader->pMap       = (PCMEM) pMap;
+	pReader->nMapPos    = 0;
+	pReader->bMapError  = FALSE;
+	pReader->bMapHeap   = FALSE;
+	pReader->nFieldSize = 4;
+	pReader->pIStream   = NULL;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_UnmapBinFile                                                  */
+/* Purpose:  Releases the view of the NNFF file, unmaps the file mapped by    */
+/*           Nn_MapBinFile or frees the block read by Nn_LoadBinFile          */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_UnmapBinFile (NN_BIN_READER* pReader)
+{
+	assert(pReader->pMap != NULL);
+
+	if (pReader->bMapHeap)
+		Nn_Free((PMEM) pReader->pMap);
+	else
+		Nn_UnmapView(pReader->pMap, pReader->nMapSize);
+	pReader->pMap     = NULL;
+	pReader->nMapSize = 0;
+	pReader->nMapPos  = 0;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_UnmapView                                                     */
+/* Purpose:  Unmaps a file mapped by Nn_MapBinFile                            */
+/* Remarks:  Also releases the view a net built by Nn_MapBin2Net refers to    */
+/*           (see Nn_MapNetFromBinFile).                                      */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_UnmapView (PCMEM pView, size_t nViewSize)
+{
+#if defined(_MSC_VER)
+	UnmapViewOfFile(pView);
+#else
+	munmap((void*) pView, nViewSize);
+#endif
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IsBin2File                                                    */
+/* Purpose:  Checks whether the NNFF file in the view is of version 2.0       */
+/* Remarks:  The file is rewound to its beginning.                            */
+/* Returns:  TRUE if it starts with the NNFF 2.0 magic number                 */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsBin2File (NN_BIN_READER* pReader)
+{
+	unsigned char achMagic[4];
+	BOOL          bIsBin2;
+
+	bIsBin2 = Nn_BinRead(pReader, achMagic, sizeof (achMagic)) && Nn_IsBin2Mem(achMagic, sizeof (achMagic));
+	pReader->bMapError = FALSE;
+	Nn_BinSeek(pReader, 0, SEEK_SET);
+	return bIsBin2;
+}
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_WriteNetToBinFile                                             */
 /* Purpose:  Writes a neural net object to a binary NNFF file                 */
@@ -431,6 +1086,7 @@ NN_STATUS Nn_ReadBinMatrix (NN_PUNIT pUnit)
 NN_STATUS Nn_WriteNetToBinFile (const char* pchFilePath, const NN_PNET pNet)
 {
 	NN_STATUS  nns;
+	FILE*      ostream;
 
 	assert(pchFilePath != NULL);
 	assert(pNet != NULL);
@@ -438,14 +1094,17 @@ NN_STATUS Nn_WriteNetToBinFile (const char* pchFilePath, const NN_PNET pNet)
 	/* Set the global error code to NN_OF (or zero) */
 	Nn_ClearError();
 
+	/* A frozen net has no connection structures left to write */
+	if (pNet->bFrozen)
+		return Nn_Error(NN_INCOMPLETE_STRUCTURE, NN_ERR_PREFIX "a frozen net can't be written");
+
 	/* Open the NNFF file in binary mode for write */
-	g_stream = fopen(pchFilePath, "wb");
-	if (g_stream != NULL)
+	ostream = fopen(pchFilePath, "wb");
+	if (ostream != NULL)
 	{
 		/* Write the neural net object to the file */
-		nns = Nn_WriteBinNet(pNet);
-		fclose(g_stream);
-		g_stream = NULL;
+		nns = Nn_WriteBinNet(ostream, pNet);
+		fclose(ostream);
 	}
 	else
 		nns = Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't open binary file '%s' for write", pchFilePath);
@@ -459,22 +1118,25 @@ NN_STATUS Nn_WriteNetToBinFile (const char* pchFilePath, const NN_PNET pNet)
 /* Returns:  NN_OK (or zero) for success, NN_FILE_WRITE_ERROR otherwise       */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteBinHeader (long nSectionID, long nSectionSize)
+NN_STATUS Nn_WriteBinHeader (FILE* ostream, long nSectionID, long nSectionSize)
 {
-        assert(g_stream != NULL);
-
-	/* Write the section identifier (4 bytes) */
-        if (eo_endian_order() != BIG_ENDIAN)
-		eo_swap_long_n(&nSectionID, 1); 
-	fwrite(&nSectionID, sizeof (long), 1, g_stream);
-	if (ferror(g_stream))
-		return Nn_SetFileWriteError();
-
-	/* Write the section size (4 bytes) */
-        if (eo_endian_order() != BIG_ENDIAN)
-		eo_swap_long_n(&nSectionSize, 1); 
-	fwrite(&nSectionSize, sizeof (long), 1, g_stream);
-	if (ferror(g_stream))
+	unsigned char abHeader[8];
+
+	assert(ostream != NULL);
+
+	/* The section identifier and size, big-endian 32 bit integers */
+	abHeader[0] = (unsigned char) (nSectionID >> 24);
+	abHeader[1] = (unsigned char) (nSectionID >> 16);
+	abHeader[2] = (unsigned char) (nSectionID >>  8);
+	abHeader[3] = (unsigned char)  nSectionID;
+	abHeader[4] = (unsigned char) (nSectionSize >> 24);
+	abHeader[5] = (unsigned char) (nSectionSize >> 16);
+	abHeader[6] = (unsigned char) (nSectionSize >>  8);
+	abHeader[7] = (unsigned char)  nSectionSize;
+
+	/* Write the section header (2 x 4 bytes) */
+	fwrite(abHeader, sizeof (abHeader), 1, ostream);
+	if (ferror(ostream))
 		return Nn_SetFileWriteError();
 	
 	return NN_OK;
@@ -486,7 +1148,7 @@ NN_STATUS Nn_WriteBinHeader (long nSectionID, long nSectionSize)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteBinNet (const NN_PNET pNet)
+NN_STATUS Nn_WriteBinNet (FILE* ostream, const NN_PNET pNet)
 {
 	NN_STATUS  nns;
 	short      iL, iU;
@@ -495,10 +1157,10 @@ NN_STATUS Nn_WriteBinNet (const NN_PNET pNet)
         NN_NET_ATTRIB na;
 	
 	assert(pNet != NULL);
-	assert(g_stream != NULL);
+	assert(ostream != NULL);
 
 	/* Write the net header */
-	nns = Nn_WriteBinHeader(*(long*)NN_NET_SECTION_ID, NN_NET_SECTION_SIZE);
+	nns = Nn_WriteBinHeader(ostream, NN_BIN_ID(NN_NET_SECTION_ID), NN_NET_SECTION_SIZE);
 	if (nns != NN_OK)
 		return nns;
 	
@@ -506,8 +1168,8 @@ NN_STATUS Nn_WriteBinNet (const NN_PNET pNet)
         na = pNet->na;
         if (eo_endian_order() != BIG_ENDIAN) 
 		eo_swap_net_attrib(&na);
-	fwrite(&na, NN_NET_SECTION_SIZE, 1, g_stream);
-	if (ferror(g_stream))
+	fwrite(&na, NN_NET_SECTION_SIZE, 1, ostream);
+	if (ferror(ostream))
 		return Nn_SetFileWriteError();
 	
 	/* Write all layer sections to the NNFF file */
@@ -517,7 +1179,7 @@ NN_STATUS Nn_WriteBinNet (const NN_PNET pNet)
 		/* Get the layer at the given position */
 		pLayer = Nn_GetLayerAt(pNet, iL);
 		/* Write the layer section */
-		nns = Nn_WriteBinLayer(pLayer);
+		nns = Nn_WriteBinLayer(ostream, pLayer);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -534,7 +1196,7 @@ NN_STATUS Nn_WriteBinNet (const NN_PNET pNet)
 			/* Get the unit at the given position */
 			pUnit = Nn_GetUnitAt(pLayer, iU);
 			/* Write unit section */
-			nns = Nn_WriteBinUnit(pUnit);
+			nns = Nn_WriteBinUnit(ostream, pUnit);
 			if (nns != NN_OK)
 				return nns;
 		}
@@ -549,16 +1211,16 @@ NN_STATUS Nn_WriteBinNet (const NN_PNET pNet)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteBinLayer (const NN_PLAYER pLayer)
+NN_STATUS Nn_WriteBinLayer (FILE* ostream, const NN_PLAYER pLayer)
 {
 	NN_LAYER_ATTRIB la;
 	NN_STATUS nns;
 
 	assert(pLayer != NULL);
-	assert(g_stream != NULL);
+	assert(ostream != NULL);
 
 	/* Write the layer section header to the NNFF file */
-	nns = Nn_WriteBinHeader(*(long*)NN_LAYER_SECTION_ID, NN_LAYER_SECTION_SIZE);
+	nns = Nn_WriteBinHeader(ostream, NN_BIN_ID(NN_LAYER_SECTION_ID), NN_LAYER_SECTION_SIZE);
 	if (nns != NN_OK)
 		return nns;
 	
@@ -566,8 +1228,8 @@ NN_STATUS Nn_WriteBinLayer (const NN_PLAYER pLayer)
         la = pLayer->la;
         if (eo_endian_order() != BIG_ENDIAN) 
 		eo_swap_layer_attrib(&la);
-	fwrite(&la, NN_LAYER_SECTION_SIZE, 1, g_stream);
-	if (ferror(g_stream))
+	fwrite(&la, NN_LAYER_SECTION_SIZE, 1, ostream);
+	if (ferror(ostream))
 		return Nn_SetFileWriteError();
 
 	return NN_OK;
@@ -580,16 +1242,16 @@ NN_STATUS Nn_WriteBinLayer (const NN_PLAYER pLayer)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteBinUnit  (const NN_PUNIT pUnit)
+NN_STATUS Nn_WriteBinUnit  (FILE* ostream, const NN_PUNIT pUnit)
 {
         NN_UNIT_ATTRIB ua;
 	NN_STATUS nns;
 
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(ostream != NULL);
 
 	/* Write the unit section header to the NNFF file */
-	nns = Nn_WriteBinHeader(*(long*)NN_UNIT_SECTION_ID, NN_UNIT_SECTION_SIZE);
+	nns = Nn_WriteBinHeader(ostream, NN_BIN_ID(NN_UNIT_SECTION_ID), NN_UNIT_SECTION_SIZE);
 	if (nns != NN_OK)
 		return nns;
 
@@ -597,15 +1259,15 @@ NN_STATUS Nn_WriteBinUnit  (const NN_PUNIT pUnit)
 	ua = pUnit->ua;
 	if (eo_endian_order() != BIG_ENDIAN) 
 		eo_swap_unit_attrib(&ua);
-	fwrite(&ua, NN_UNIT_SECTION_SIZE, 1, g_stream);
-	if (ferror(g_stream))
+	fwrite(&ua, NN_UNIT_SECTION_SIZE, 1, ostream);
+	if (ferror(ostream))
 		return Nn_SetFileWriteError();
 
 	/* If the unit has incoming connections */
 	if (pUnit->ua.nNumConns > 0 && pUnit->aConns != NULL)
 	{
 		/* Write all connections directly after the unit section: */
-		nns =  Nn_WriteBinConns(pUnit);
+		nns =  Nn_WriteBinConns(ostream, pUnit);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -614,7 +1276,7 @@ NN_STATUS Nn_WriteBinUnit  (const NN_PUNIT pUnit)
 	if (pUnit->ua.nNumConns > 0 && pUnit->ppfMatrix != NULL)
 	{
 		/* Write the matrix definitiondirectly after the connection section: */
-		nns =  Nn_WriteBinMatrix(pUnit);
+		nns =  Nn_WriteBinMatrix(ostream, pUnit);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -628,7 +1290,7 @@ NN_STATUS Nn_WriteBinUnit  (const NN_PUNIT pUnit)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteBinConns (const NN_PUNIT pUnit)
+NN_STATUS Nn_WriteBinConns (FILE* ostream, const NN_PUNIT pUnit)
 {
 	NN_CONN_ATTRIB ca;
 	NN_STATUS nns;
@@ -636,10 +1298,10 @@ NN_STATUS Nn_WriteBinConns (const NN_PUNIT pUnit)
 	short     iC;
 
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(ostream != NULL);
 
 	/* Write the connection section header to the NNFF file */
-	nns = Nn_WriteBinHeader(*(long*)NN_CONN_SECTION_ID, NN_CONN_ENTRY_SIZE);
+	nns = Nn_WriteBinHeader(ostream, NN_BIN_ID(NN_CONN_SECTION_ID), NN_CONN_ENTRY_SIZE);
 	if (nns != NN_OK)
 		return nns;
 
@@ -657,8 +1319,8 @@ NN_STATUS Nn_WriteBinConns (const NN_PUNIT pUnit)
 		fwrite(&ca, 
 			   NN_CONN_ENTRY_SIZE, 
 			   1, 
-			   g_stream);
-		if (ferror(g_stream))
+			   ostream);
+		if (ferror(ostream))
 			return Nn_SetFileWriteError();
 	}
 
@@ -671,7 +1333,7 @@ NN_STATUS Nn_WriteBinConns (const NN_PUNIT pUnit)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteBinMatrix  (const NN_PUNIT pUnit)
+NN_STATUS Nn_WriteBinMatrix  (FILE* ostream, const NN_PUNIT pUnit)
 {
 	NN_STATUS nns;
 	NN_FLOAT* pfRow;
@@ -682,15 +1344,17 @@ NN_STATUS Nn_WriteBinMatrix  (const NN_PUNIT pUnit)
         
 
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(ostream != NULL);
 
 	/* Write the unit section header to the NNFF file */
-	nns = Nn_WriteBinHeader(*(long*)NN_MATRIX_SECTION_ID, NN_MATRIX_ENTRY_SIZE);
+	nns = Nn_WriteBinHeader(ostream, NN_BIN_ID(NN_MATRIX_SECTION_ID), NN_MATRIX_ENTRY_SIZE);
 	if (nns != NN_OK)
 		return nns;
 
 	nBuf  = pUnit->ua.nNumConns * NN_MATRIX_ENTRY_SIZE;
-	pfBuf = malloc(nBuf);
+	pfBuf = (NN_FLOAT*) Nn_Alloc(nBuf);
+	if (pfBuf == NULL)
+		return Nn_SetOutOfMemoryError();
 
 	/* Write the matrix row by row directly after the connections */
 	/* For all matrix rows (the size of the matrix is pUnit->ua.nNumConns ^ 2) */
@@ -701,62 +1365,56 @@ NN_STATUS Nn_WriteBinMatrix  (const NN_PUNIT pUnit)
 
 
 		/* Write the row to the NNFF file */
-		memcpy(pfBuf, pfRow, nBuf);
 		if (eo_endian_order() != BIG_ENDIAN) 
-			eo_swap_double_n(pfBuf, pUnit->ua.nNumConns);
+			eo_copy_swap_double_n(pfBuf, pfRow, pUnit->ua.nNumConns);
+		else
+			memcpy(pfBuf, pfRow, nBuf);
 		fwrite(pfBuf, 
 			   NN_MATRIX_ENTRY_SIZE * pUnit->ua.nNumConns,
 			   1,
-			   g_stream);
-		if (ferror(g_stream))
+			   ostream);
+		if (ferror(ostream))
 		{
-			free(pfBuf);
+			Nn_Free(pfBuf);
 			return Nn_SetFileReadError();
 		}
 	}
 
-	free(pfBuf);
+	Nn_Free(pfBuf);
 	return NN_OK;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
 
+/* The fields of the same type are contiguous in the attribute structures     */
+/* (see NnBase.h), so they are swapped as arrays                              */
+
 void eo_swap_net_attrib(NN_NET_ATTRIB* pna)
 {
-	eo_swap_short_n(pna->anVersion, 2);
-	eo_swap_short_n(&(pna->nNumLayers), 1);
-	eo_swap_short_n(&(pna->iInpLayer), 1);
-	eo_swap_short_n(&(pna->iOutLayer), 1);
-	eo_swap_short_n(&(pna->nPrecision), 1);
+	/* anVersion[2], nNumLayers, iInpLayer, iOutLayer, nPrecision */
+	eo_swap_short_n(pna->anVersion, 6);
 }
 
 void eo_swap_layer_attrib(NN_LAYER_ATTRIB* pla) 
 {
-	eo_swap_short_n(&(pla->iLayer), 1);
-	eo_swap_short_n(&(pla->nNumUnits), 1);
-	eo_swap_short_n(&(pla->nInpFnId), 1);
-	eo_swap_short_n(&(pla->nActFnId), 1);
-	eo_swap_short_n(&(pla->nOutFnId), 1);
-	eo_swap_double_n(&(pla->fActSlope), 1);
-	eo_swap_double_n(&(pla->fActThres), 1);
+	/* iLayer, nNumUnits, nInpFnId, nActFnId, nOutFnId */
+	eo_swap_short_n(&(pla->iLayer), 5);
+	/* fActSlope, fActThres */
+	eo_swap_double_n(&(pla->fActSlope), 2);
 }
 
 void eo_swap_unit_attrib(NN_UNIT_ATTRIB* pua) 
 {
-	eo_swap_short_n(&(pua->iLayer), 1);
-	eo_swap_short_n(&(pua->iUnit), 1);
-	eo_swap_short_n(&(pua->nNumConns), 1);
-	eo_swap_short_n(&(pua->bHasMatrix), 1);
-	eo_swap_double_n(&(pua->fInpBias), 1);
-	eo_swap_double_n(&(pua->fInpScale), 1);
-	eo_swap_double_n(&(pua->fOutBias), 1);
-	eo_swap_double_n(&(pua->fOutScale), 1);
+	/* iLayer, iUnit, nNumConns, bHasMatrix, nTrnFnId, nTrnFlags */
+	eo_swap_short_n(&(pua->iLayer), 6);
+	/* fInpBias, fInpScale, fOutBias, fOutScale, fTrnMin, fTrnMax */
+	eo_swap_double_n(&(pua->fInpBias), 6);
 }
 
 void eo_swap_conn_attrib(NN_CONN_ATTRIB* pca) 
 {
-	eo_swap_short_n(&(pca->iLayer), 1);
-	eo_swap_short_n(&(pca->iUnit), 1);
+	/* iLayer, iUnit */
+	eo_swap_short_n(&(pca->iLayer), 2);
 	eo_swap_double_n(&(pca->fWeight), 1);
 }
 
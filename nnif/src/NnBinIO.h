@@ -12,11 +12,14 @@
 extern "C" {
 #endif
 
+/* The input stream of Nn_ReadBinStreamNet, see NnStream.h */
+struct SNnIStream;
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_CreateNetFromBinFile                                          */
 /* Purpose:  Reads a neural net object from a binary NNFF file.               */
 /* Remarks:  The function calls Nn_AssertSemanticIntegrity if the net object  */
-/*           was succesfully read in.                                         */
+/*           was succesfully read in. NNFF 1.x and 2.0 files are read.        */
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
@@ -28,6 +31,44 @@ NN_STATUS Nn_CreateNetFromBinFile
 	NN_PNET* ppNet         /* The created neural net object */
 );
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_MapNetFromBinFile                                             */
+/* Purpose:  Reads a neural net object from a memory mapped binary NNFF file  */
+/* Remarks:  Same as Nn_CreateNetFromBinFile, but the file is mapped into     */
+/*           memory (mmap, MapViewOfFile) and the sections are taken from the */
+/*           mapping instead of being read one by one. A NNFF 2.0 file gives  */
+/*           a frozen net (see Nn_FreezeNet) whose weights and source units   */
+/*           are the blocks of the mapped file where they can be used in      */
+/*           place (see Nn_MapBin2Net), the net then keeps the mapping until  */
+/*           Nn_DeleteNet. Otherwise the mapping is released on return.       */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_MapNetFromBinFile
+(
+	PCSTR    pchFilePath,  /* Path to the binary NNFF file */
+	int      nNumInpUnits, /* Size of the input vector    */
+	int      nNumOutUnits, /* Size of the output vector   */
+	NN_PNET* ppNet         /* The created neural net object */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReadBinStreamNet                                              */
+/* Purpose:  Reads a neural net object from a binary NNFF 1.x file in a       */
+/*           stream (see NnStream.h)                                          */
+/* Remarks:  The net must have been created by Nn_CreateNet and nothing else. */
+/*           The sections are read in a single pass, so the net is allocated  */
+/*           without an arena. The function does not call                     */
+/*           Nn_AssertSemanticIntegrity, this is left to the caller.          */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ReadBinStreamNet
+(
+	NN_PNET             pNet,      /* The empty neural net object  */
+	struct SNnIStream*  pIStream   /* The stream of the NNFF file  */
+);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_WriteBinFile                                                  */
 /* Purpose:  Writes a neural net object to a binary NNFF file                 */
@@ -9,6 +9,7 @@
 /*////////////////////////////////////////////////////////////////////////////*/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 
 #include "NnBase.h"
@@ -39,8 +40,129 @@ NN_STATUS Nn_AssertSemanticIntegrity
 	NN_PLAYER pLayer, pSrcLayer;
 	NN_PUNIT  pUnit;
 	NN_PCONN  pConn;
-	BOOL      bRbf;
+	NN_STATUS nns;
+
+	assert(pNet != NULL);
+
+	/* A frozen net has been validated and can't have changed (see Nn_FreezeNet), */
+	/* so only the numbers of input and output units are checked                  */
+	if (pNet->bFrozen)
+		return Nn_CheckNetAttrib(pNet, nNumInpUnits, nNumOutUnits);
+
+	/* The structure of the net may have changed, so release the work buffer */
+	/* of the batch routines. It is re-allocated with the next batch call.   */
+	if (pNet->afBatch != NULL)
+	{
+		Nn_Free(pNet->afBatch);
+		pNet->afBatch = NULL;
+	}
+
+	/* The same applies to the profiling counters */
+	if (pNet->aProfile != NULL)
+	{
+		Nn_Free(pNet->aProfile);
+		pNet->aProfile = NULL;
+	}
+
+	/* and to the compact connections, which are re-created at the end */
+	Nn_DeleteConnTable(pNet);
+
+	/* Check the net attributes */
+	nns = Nn_CheckNetAttrib(pNet, nNumInpUnits, nNumOutUnits);
+	if (nns != NN_OK)
+		return nns;
+
+	/* Check all layers of the net: */
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		/* Get layer */
+		pLayer = Nn_GetLayerAt(pNet, iL);
+
+		/* Set layer ID */
+		pLayer->la.iLayer = iL; 
+
+		/* Check the layer attributes */
+		nns = Nn_CheckLayerAttrib(pNet, iL);
+		if (nns != NN_OK)
+			return nns;
+
+		/* Check unit array */
+		if (pLayer->aUnits == NULL)
+			return Nn_Error(NN_INCOMPLETE_STRUCTURE, 
+				NN_ERR_PREFIX "L[%d]: no units defined", 
+				iL);
+
+		/* Check all units of the layer: */
+		for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+		{
+			/* Get unit */
+			pUnit = Nn_GetUnitAt(pLayer, iU);
+
+			/* Set layer and unit ID */
+			pUnit->ua.iLayer     = iL; 
+			pUnit->ua.iUnit      = iU;
+
+			/* Mark that a matrix is existing */
+			pUnit->ua.bHasMatrix = (short)(pUnit->ppfMatrix != NULL);
+
+			/* Check the unit attributes */
+			nns = Nn_CheckUnitAttrib(pNet, iL, iU);
+			if (nns != NN_OK)
+				return nns;
+
+			/* Check connection array */
+			if (pUnit->ua.nNumConns > 0 && pUnit->aConns == NULL)
+				return Nn_Error(NN_INCOMPLETE_STRUCTURE, 
+					NN_ERR_PREFIX "U[%i][%i]: no connections defined", 
+					iL, iU);
 
+			/* Check all incoming connections of the unit */
+			for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
+			{
+				/* Get connection */
+				pConn = Nn_GetConnAt(pUnit, iC);
+
+				/* Check source layer index: */
+				if (pConn->ca.iLayer < 0 || pConn->ca.iLayer >= pNet->na.nNumLayers)
+					return Nn_Error(NN_INCONSITENT_NET, 
+						NN_ERR_PREFIX "C[%d][%d][%d]: invalid layer index %d (should be >= 0 and < %d)", 
+						iL, iU, iC, pNet->na.nNumLayers);
+
+				/* Get source layer */
+				pSrcLayer = Nn_GetLayerAt(pNet, pConn->ca.iLayer);
+
+				/* Check source unit index: */
+				if (pConn->ca.iUnit < 0 || pConn->ca.iUnit >= pSrcLayer->la.nNumUnits)
+					return Nn_Error(NN_INCONSITENT_NET, 
+						NN_ERR_PREFIX "C[%d][%d][%d]: invalid unit index %d (should be >= 0 and < %d)", 
+						iL, iU, iC, pSrcLayer->la.nNumUnits);
+
+				/* Set the source unit of the connection */
+				pConn->pUnit = Nn_GetUnitAt(pSrcLayer, pConn->ca.iUnit);
+			}
+		}
+	}
+
+	/* Create the compact connections of the batch routines */
+	return Nn_CreateConnTable(pNet);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CheckNetAttrib                                              */
+/* Purpose:    Checks the net attributes and the numbers of input and output  */
+/*             units                                                          */
+/* Remarks:    The input and output layer are set to the first and the last   */
+/*             layer if they are not set (-1). The layers must exist.         */
+/* Returns:    NN_OK if the attributes are valid, an error code otherwise     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CheckNetAttrib
+(
+	NN_PNET pNet, 
+	int     nNumInpUnits,
+	int     nNumOutUnits
+)
+{
 	assert(pNet != NULL);
 
 	/* Check number of layers */
@@ -97,140 +219,159 @@ NN_STATUS Nn_AssertSemanticIntegrity
 			NN_ERR_PREFIX "invalid precision: %d");
 	}
 
-	/* Check all layers of the net: */
-	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
-	{
-		/* Get layer */
-		pLayer = Nn_GetLayerAt(pNet, iL);
+	return NN_OK;
+}
 
-		/* Set layer ID */
-		pLayer->la.iLayer = iL; 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CheckLayerAttrib                                            */
+/* Purpose:    Checks the attributes of a layer                               */
+/* Returns:    NN_OK if the attributes are valid, an error code otherwise     */
+/*////////////////////////////////////////////////////////////////////////////*/
 
-		/* Check number of units */
-		if (pLayer->la.nNumUnits <= 0)
-			return Nn_Error(NN_INVALID_ATTRIBUTE, 
-				NN_ERR_PREFIX "L[%d]: invalid number of units: %d (should be > 0)", 
-				iL, pLayer->la.nNumUnits);
+NN_STATUS Nn_CheckLayerAttrib (const NN_PNET pNet, short iL)
+{
+	NN_PLAYER pLayer;
 
-		/* Check unit array */
-		if (pLayer->aUnits == NULL)
-			return Nn_Error(NN_INCOMPLETE_STRUCTURE, 
-				NN_ERR_PREFIX "L[%d]: no units defined", 
-				iL);
+	assert(pNet != NULL);
 
-		/* Check input function identifier: */
-		switch (pLayer->la.nInpFnId)
-		{
-		/* List all valid input functions here... */
-		case NN_FUNC_ZERO:
-		case NN_FUNC_SUM_1:
-		case NN_FUNC_SUM_2:
-			break;
-		default:
-			return Nn_Error(NN_INVALID_ATTRIBUTE, 
-				NN_ERR_PREFIX "L[%d]: invalid input function ID %d", 
-				iL, pLayer->la.nInpFnId);
-		}
+	/* Get layer */
+	pLayer = Nn_GetLayerAt(pNet, iL);
 
-		/* Check activation function identifier: */
-		switch (pLayer->la.nActFnId)
-		{
-		/* List all valid activation functions here... */
-		case NN_FUNC_IDENTITY:
-		case NN_FUNC_THRESHOLD:
-		case NN_FUNC_LINEAR:
-		case NN_FUNC_SEMILINEAR:
-		case NN_FUNC_SIGMOID_1:
-		case NN_FUNC_SIGMOID_2:
-		case NN_FUNC_RBF_1:
-		case NN_FUNC_RBF_2:
-			break;
-		default:
-			return Nn_Error(NN_INVALID_ATTRIBUTE, 
-				NN_ERR_PREFIX "L[%d]: invalid activation function ID %d", 
-				iL, pLayer->la.nActFnId);
-		}
+	/* Check number of units */
+	if (pLayer->la.nNumUnits <= 0)
+		return Nn_Error(NN_INVALID_ATTRIBUTE, 
+			NN_ERR_PREFIX "L[%d]: invalid number of units: %d (should be > 0)", 
+			iL, pLayer->la.nNumUnits);
 
-		/* Check output function identifier: */
-		switch (pLayer->la.nOutFnId)
-		{
-		/* List all valid output functions here... */
-		case NN_FUNC_IDENTITY:
-		case NN_FUNC_LINEAR:
-		case NN_FUNC_QUADRATIC:
-		case NN_FUNC_EXPONENTIAL:
-			break;
-		default:
-			return Nn_Error(NN_INVALID_ATTRIBUTE, 
-				NN_ERR_PREFIX "L[%d]: invalid output function ID %d", 
-				iL, pLayer->la.nOutFnId);
-		}
+	/* Check input function identifier: */
+	switch (pLayer->la.nInpFnId)
+	{
+	/* List all valid input functions here... */
+	case NN_FUNC_ZERO:
+	case NN_FUNC_SUM_1:
+	case NN_FUNC_SUM_2:
+		break;
+	default:
+		return Nn_Error(NN_INVALID_ATTRIBUTE, 
+			NN_ERR_PREFIX "L[%d]: invalid input function ID %d", 
+			iL, pLayer->la.nInpFnId);
+	}
 
-		/* Check all units of the layer: */
-		for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
-		{
-			/* Get unit */
-			pUnit = Nn_GetUnitAt(pLayer, iU);
+	/* Check activation function identifier: */
+	switch (pLayer->la.nActFnId)
+	{
+	/* List all valid activation functions here... */
+	case NN_FUNC_IDENTITY:
+	case NN_FUNC_THRESHOLD:
+	case NN_FUNC_LINEAR:
+	case NN_FUNC_SEMILINEAR:
+	case NN_FUNC_SIGMOID_1:
+	case NN_FUNC_SIGMOID_2:
+	case NN_FUNC_RBF_1:
+	case NN_FUNC_RBF_2:
+		break;
+	default:
+		return Nn_Error(NN_INVALID_ATTRIBUTE, 
+			NN_ERR_PREFIX "L[%d]: invalid activation function ID %d", 
+			iL, pLayer->la.nActFnId);
+	}
 
-			/* Set layer and unit ID */
-			pUnit->ua.iLayer     = iL; 
-			pUnit->ua.iUnit      = iU;
+	/* Check output function identifier: */
+	switch (pLayer->la.nOutFnId)
+	{
+	/* List all valid output functions here... */
+	case NN_FUNC_IDENTITY:
+	case NN_FUNC_LINEAR:
+	case NN_FUNC_QUADRATIC:
+	case NN_FUNC_EXPONENTIAL:
+		break;
+	default:
+		return Nn_Error(NN_INVALID_ATTRIBUTE, 
+			NN_ERR_PREFIX "L[%d]: invalid output function ID %d", 
+			iL, pLayer->la.nOutFnId);
+	}
 
-			/* Check number of incoming connections */
-			if (pUnit->ua.nNumConns < 0)
-				return Nn_Error(NN_INVALID_ATTRIBUTE, 
-					NN_ERR_PREFIX "U[%d][%d]: invalid number of connections: %d (should >= 0)", 
-					iL, iU, pUnit->ua.nNumConns);
+	return NN_OK;
+}
 
-			/* Check connection array */
-			if (pUnit->ua.nNumConns > 0 && pUnit->aConns == NULL)
-				return Nn_Error(NN_INCOMPLETE_STRUCTURE, 
-					NN_ERR_PREFIX "U[%i][%i]: no connections defined", 
-					iL, iU);
-			
-			/* Mark that a matrix is existing */
-			pUnit->ua.bHasMatrix = (short)(pUnit->ppfMatrix != NULL);
-			/* Check matrix */
-			bRbf = pLayer->la.nActFnId == NN_FUNC_RBF_1 ||
-			       pLayer->la.nActFnId == NN_FUNC_RBF_2; 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CheckUnitAttrib                                             */
+/* Purpose:    Checks the attributes of a unit                                */
+/* Remarks:    bHasMatrix must tell whether the unit has a matrix. The input  */
+/*             and output layer of the net must have been set.                */
+/* Returns:    NN_OK if the attributes are valid, an error code otherwise     */
+/*////////////////////////////////////////////////////////////////////////////*/
 
-			if (bRbf && pUnit->ua.nNumConns > 0 && !pUnit->ua.bHasMatrix)
-				return Nn_Error(NN_INCOMPLETE_STRUCTURE, 
-					NN_ERR_PREFIX "U[%d][%d]: no matrix defined", 
-					iL, iU);
+NN_STATUS Nn_CheckUnitAttrib (const NN_PNET pNet, short iL, short iU)
+{
+	NN_PLAYER pLayer;
+	NN_PUNIT  pUnit;
+	BOOL      bRbf;
 
-			if (!bRbf && pUnit->ua.bHasMatrix)
-				return Nn_Error(NN_INVALID_ATTRIBUTE, 
-					NN_ERR_PREFIX "U[%d][%d]: matrix can't be defined", 
-					iL, iU);
+	assert(pNet != NULL);
 
-			/* Check all incoming connections of the unit */
-			for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
-			{
-				/* Get connection */
-				pConn = Nn_GetConnAt(pUnit, iC);
+	/* Get layer and unit */
+	pLayer = Nn_GetLayerAt(pNet, iL);
+	pUnit  = Nn_GetUnitAt(pLayer, iU);
 
-				/* Check source layer index: */
-				if (pConn->ca.iLayer < 0 || pConn->ca.iLayer >= pNet->na.nNumLayers)
-					return Nn_Error(NN_INCONSITENT_NET, 
-						NN_ERR_PREFIX "C[%d][%d][%d]: invalid layer index %d (should be >= 0 and < %d)", 
-						iL, iU, iC, pNet->na.nNumLayers);
+	/* Check number of incoming connections */
+	if (pUnit->ua.nNumConns < 0)
+		return Nn_Error(NN_INVALID_ATTRIBUTE, 
+			NN_ERR_PREFIX "U[%d][%d]: invalid number of connections: %d (should >= 0)", 
+			iL, iU, pUnit->ua.nNumConns);
 
-				/* Get source layer */
-				pSrcLayer = Nn_GetLayerAt(pNet, pConn->ca.iLayer);
+	/* Check matrix */
+	bRbf = pLayer->la.nActFnId == NN_FUNC_RBF_1 ||
+	       pLayer->la.nActFnId == NN_FUNC_RBF_2; 
 
-				/* Check source unit index: */
-				if (pConn->ca.iUnit < 0 || pConn->ca.iUnit >= pSrcLayer->la.nNumUnits)
-					return Nn_Error(NN_INCONSITENT_NET, 
-						NN_ERR_PREFIX "C[%d][%d][%d]: invalid unit index %d (should be >= 0 and < %d)", 
-						iL, iU, iC, pSrcLayer->la.nNumUnits);
+	if (bRbf && pUnit->ua.nNumConns > 0 && !pUnit->ua.bHasMatrix)
+		return Nn_Error(NN_INCOMPLETE_STRUCTURE, 
+			NN_ERR_PREFIX "U[%d][%d]: no matrix defined", 
+			iL, iU);
 
-				/* Set the source unit of the connection */
-				pConn->pUnit = Nn_GetUnitAt(pSrcLayer, pConn->ca.iUnit);
-			}
-		}
+	if (!bRbf && pUnit->ua.bHasMatrix)
+		return Nn_Error(NN_INVALID_ATTRIBUTE, 
+			NN_ERR_PREFIX "U[%d][%d]: matrix can't be defined", 
+			iL, iU);
+
+	/* Check I/O transform function identifier: */
+	switch (pUnit->ua.nTrnFnId)
+	{
+	/* List all valid transform functions here... */
+	case NN_FUNC_ZERO:
+	case NN_FUNC_IDENTITY:
+	case NN_FUNC_EXPONENTIAL:
+	case NN_FUNC_LOGARITHMIC:
+		break;
+	default:
+		return Nn_Error(NN_INVALID_ATTRIBUTE, 
+			NN_ERR_PREFIX "U[%d][%d]: invalid transform function ID %d", 
+			iL, iU, pUnit->ua.nTrnFnId);
 	}
 
+	/* Check I/O transform flags and range */
+	if ((pUnit->ua.nTrnFlags & ~(NN_TRN_SCALE | NN_TRN_RANGE)) != 0)
+		return Nn_Error(NN_INVALID_ATTRIBUTE, 
+			NN_ERR_PREFIX "U[%d][%d]: invalid transform flags 0x%x", 
+			iL, iU, pUnit->ua.nTrnFlags);
+
+	if ((pUnit->ua.nTrnFlags & NN_TRN_SCALE) != 0 && !(pUnit->ua.fTrnMax != pUnit->ua.fTrnMin))
+		return Nn_Error(NN_INVALID_ATTRIBUTE, 
+			NN_ERR_PREFIX "U[%d][%d]: invalid transform range [%g, %g]", 
+			iL, iU, pUnit->ua.fTrnMin, pUnit->ua.fTrnMax);
+
+	if ((pUnit->ua.nTrnFlags & NN_TRN_RANGE) != 0 && !(pUnit->ua.fTrnMin <= pUnit->ua.fTrnMax))
+		return Nn_Error(NN_INVALID_ATTRIBUTE, 
+			NN_ERR_PREFIX "U[%d][%d]: invalid training range [%g, %g]", 
+			iL, iU, pUnit->ua.fTrnMin, pUnit->ua.fTrnMax);
+
+	/* Transforms are only allowed in either the input or the output layer */
+	if ((pUnit->ua.nTrnFnId != NN_FUNC_ZERO || pUnit->ua.nTrnFlags != 0) && 
+		(iL == pNet->na.iInpLayer) == (iL == pNet->na.iOutLayer))
+		return Nn_Error(NN_INVALID_ATTRIBUTE, 
+			NN_ERR_PREFIX "U[%d][%d]: transform can't be defined", 
+			iL, iU);
+
 	return NN_OK;
 }
 
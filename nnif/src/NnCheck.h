@@ -33,6 +33,21 @@ NN_STATUS Nn_AssertSemanticIntegrity
 	int     nNumOutUnits     /* The size of the net output vector  */
 );
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function:   Nn_CheckNetAttrib, Nn_CheckLayerAttrib, Nn_CheckUnitAttrib     */
+/* Purpose:    Check the attributes of the net, a layer and a unit, as done   */
+/*             by Nn_AssertSemanticIntegrity                                  */
+/* Remarks:    Used by loaders which build a frozen net without connection    */
+/*             structures (see Nn_MapNetFromBinFile). Nn_CheckNetAttrib sets  */
+/*             the input and output layer if they are not set, it must be     */
+/*             called before Nn_CheckUnitAttrib.                              */
+/* Returns:    NN_OK if the attributes are valid, an error code otherwise     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CheckNetAttrib (NN_PNET pNet, int nNumInpUnits, int nNumOutUnits);
+NN_STATUS Nn_CheckLayerAttrib (const NN_PNET pNet, short iL);
+NN_STATUS Nn_CheckUnitAttrib (const NN_PNET pNet, short iL, short iU);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_PrintLayerOutputs                                             */
 /* Purpose:  Prints the outputs of all units of all layers                    */
@@ -0,0 +1,385 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnLoad.c                                                      */
+/* Purpose:     Implementation of loading a set of neural nets at once        */
+/* Remarks:     Interface def. in NnLoad.h                                    */
+/*              The threads take the nets one by one from a shared counter,   */
+/*              so a large net doesn't hold up the small ones behind it. The  */
+/*              loading routines keep their state per call and the error      */
+/*              state per thread, so each thread copies the error of a net    */
+/*              into its result.                                              */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* For clock_gettime and sysconf */
+#elif !defined(_MSC_VER) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L /* For clock_gettime */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "NnBase.h"
+#include "NnProc.h"
+#include "NnProf.h"
+#include "NnTrace.h"
+#include "NnAscIO.h"
+#include "NnBinIO.h"
+#include "NnBin2IO.h"
+#include "NnStream.h"
+#include "NnLoad.h"
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#include <process.h>
+#define NN_ATOMIC_INC(p)  InterlockedIncrement((volatile LONG*) (p))
+typedef HANDLE     NN_LOAD_THREAD;
+#else
+#include <unistd.h>
+#include <pthread.h>
+#define NN_ATOMIC_INC(p)  __sync_add_and_fetch((p), 1)
+typedef pthread_t  NN_LOAD_THREAD;
+#endif
+
+/* Upper limit of the number of threads */
+#define NN_LOAD_THREADS_MAX  64
+
+/* Number of bytes at the beginning of a file checked for binary content */
+#define NN_LOAD_PROBE_SIZE   64
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_LOAD_JOB                                                       */
+/* Purpose: The nets of a call of Nn_LoadNets, shared by its threads          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnLoadJob
+{
+	const PCSTR*            apchPaths;    /* Paths of the NNFF files         */
+	int                     nNumNets;     /* Number of nets                  */
+	const NN_LOAD_OPTIONS*  pOptions;     /* The options                     */
+	NN_PNET*                apNets;       /* The nets                        */
+	NN_LOAD_RESULT*         aResults;     /* The results                     */
+	double                  dStartClock;  /* Clock at the call               */
+	volatile long           nNumTaken;    /* Number of nets taken by threads */
+}
+NN_LOAD_JOB;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_LOAD_WORKER                                                    */
+/* Purpose: The argument of a loading thread                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnLoadWorker
+{
+	NN_LOAD_JOB*    pJob;      /* The shared job       */
+	int             iThread;   /* Index of the thread  */
+	NN_LOAD_THREAD  thread;    /* The thread           */
+}
+NN_LOAD_WORKER;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Module local prototypes:                                                   */
+/*                                                                            */
+
+void      Nn_RunLoadWorker (NN_LOAD_WORKER* pWorker);
+void      Nn_LoadJobNet (NN_LOAD_JOB* pJob, int iNet, int iThread);
+NN_STATUS Nn_IsBinNetFile (PCSTR pchFilePath, BOOL* pbBinary, BOOL* pbBin2);
+BOOL      Nn_StartLoadWorker (NN_LOAD_WORKER* pWorker);
+void      Nn_JoinLoadWorker (NN_LOAD_WORKER* pWorker);
+int       Nn_GetNumProcessors (void);
+double    Nn_GetLoadClock (void);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_LoadNets                                                      */
+/* Purpose:  Loads a set of neural nets from NNFF files concurrently          */
+/* Remarks:  If a thread can't be started, its share is loaded by the others. */
+/* Returns:  NN_OK (or zero) if all nets were loaded, otherwise the error     */
+/*           code of the first net not loaded                                 */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_LoadNets
+(
+	const PCSTR*            apchPaths,
+	int                     nNumNets,
+	const NN_LOAD_OPTIONS*  pOptions,
+	NN_PNET*                apNets,
+	NN_LOAD_RESULT*         aResults
+)
+{
+	NN_LOAD_OPTIONS  options;
+	NN_LOAD_JOB      job;
+	NN_LOAD_WORKER   aWorkers[NN_LOAD_THREADS_MAX];
+	int              nNumThreads, nNumStarted, nNumFailed, iFailed, i;
+
+	assert(apchPaths != NULL || nNumNets == 0);
+	assert(apNets != NULL || nNumNets == 0);
+	assert(aResults != NULL || nNumNets == 0);
+
+	Nn_ClearError();
+
+	if (pOptions == NULL)
+	{
+		options.nNumThreads  = 0;
+		options.nNumInpUnits = -1;
+		options.nNumOutUnits = -1;
+		options.bMapFile     = FALSE;
+		options.bFreeze      = FALSE;
+		pOptions = &options;
+	}
+
+	nNumThreads = pOptions->nNumThreads > 0 ? pOptions->nNumThreads : Nn_GetNumProcessors();
+	if (nNumThreads > nNumNets)
+		nNumThreads = nNumNets;
+	if (nNumThreads > NN_LOAD_THREADS_MAX)
+		nNumThreads = NN_LOAD_THREADS_MAX;
+
+	for (i = 0; i < nNumNets; i++)
+	{
+		apNets[i] = NULL;
+		memset(&aResults[i], 0, sizeof (NN_LOAD_RESULT));
+	}
+
+	job.apchPaths   = apchPaths;
+	job.nNumNets    = nNumNets;
+	job.pOptions    = pOptions;
+	job.apNets      = apNets;
+	job.aResults    = aResults;
+	job.dStartClock = Nn_GetLoadClock();
+	job.nNumTaken   = 0;
+
+	/* The calling thread is worker 0 */
+	nNumStarted = 1;
+	for (i = 1; i < nNumThreads; i++)
+	{
+		aWorkers[nNumStarted].pJob    = &job;
+		aWorkers[nNumStarted].iThread = nNumStarted;
+		if (Nn_StartLoadWorker(&aWorkers[nNumStarted]))
+			nNumStarted++;
+	}
+
+	if (nNumNets > 0)
+	{
+		aWorkers[0].pJob    = &job;
+		aWorkers[0].iThread = 0;
+		Nn_RunLoadWorker(&aWorkers[0]);
+	}
+
+	for (i = 1; i < nNumStarted; i++)
+		Nn_JoinLoadWorker(&aWorkers[i]);
+
+	nNumFailed = 0;
+	iFailed    = -1;
+	for (i = 0; i < nNumNets; i++)
+	{
+		if (aResults[i].nStatus != NN_OK)
+		{
+			if (iFailed < 0)
+				iFailed = i;
+			nNumFailed++;
+		}
+	}
+
+	if (nNumFailed == 0)
+		return NN_OK;
+
+	return Nn_Error(aResults[iFailed].nStatus,
+		NN_ERR_PREFIX "%d of %d nets not loaded, first '%s'",
+		nNumFailed, nNumNets, apchPaths[iFailed]);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_RunLoadWorker                                                 */
+/* Purpose:  Loads nets of the job until all nets are taken                   */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_RunLoadWorker (NN_LOAD_WORKER* pWorker)
+{
+	NN_LOAD_JOB* pJob = pWorker->pJob;
+	long         iNet;
+
+	if (pWorker->iThread > 0)
+		Nn_SetTraceThreadName("nnif loader");
+
+	while ((iNet = NN_ATOMIC_INC(&pJob->nNumTaken) - 1) < pJob->nNumNets)
+		Nn_LoadJobNet(pJob, (int) iNet, pWorker->iThread);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_LoadJobNet                                                    */
+/* Purpose:  Loads a single net of the job and fills in its result            */
+/* Remarks:  Same as NnSwap.c does for a version: the net is frozen and its   */
+/*           batch work buffer created by a batch call without pixels. A      */
+/*           NNFF 2.x file is only mapped for frozen nets, since its mapped   */
+/*           net is frozen already (see Nn_MapNetFromBinFile).                */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_LoadJobNet (NN_LOAD_JOB* pJob, int iNet, int iThread)
+{
+	const NN_LOAD_OPTIONS* pOptions = pJob->pOptions;
+	NN_LOAD_RESULT*        pResult  = &pJob->aResults[iNet];
+	PCSTR                  pchPath  = pJob->apchPaths[iNet];
+	NN_PNET                pNet     = NULL;
+	NN_STATUS              nns;
+	BOOL                   bBinary, bBin2;
+	double                 dClock, dTraceStart;
+
+	dClock = Nn_GetLoadClock();
+	pResult->iThread    = iThread;
+	pResult->dStartTime = dClock - pJob->dStartClock;
+
+	nns = Nn_IsBinNetFile(pchPath, &bBinary, &bBin2);
+	if (nns == NN_OK)
+	{
+		if (!bBinary)
+			nns = Nn_CreateNetFromAscFile(pchPath, pOptions->nNumInpUnits, pOptions->nNumOutUnits, &pNet);
+		else if (pOptions->bMapFile && (pOptions->bFreeze || !bBin2))
+			nns = Nn_MapNetFromBinFile(pchPath, pOptions->nNumInpUnits, pOptions->nNumOutUnits, &pNet);
+		else
+			nns = Nn_CreateNetFromBinFile(pchPath, pOptions->nNumInpUnits, pOptions->nNumOutUnits, &pNet);
+	}
+	pResult->dLoadTime = Nn_GetLoadClock() - dClock;
+
+	if (nns == NN_OK && pOptions->bFreeze)
+	{
+		dClock      = Nn_GetLoadClock();
+		dTraceStart = Nn_GetTraceTime();
+		nns = Nn_FreezeNet(pNet);
+		if (nns == NN_OK)
+			nns = Nn_ProcessNetBatch(pNet, 0, NULL, NULL);
+		Nn_AddTraceSpan("nnif", "freeze", dTraceStart, -1);
+		pResult->dFreezeTime = Nn_GetLoadClock() - dClock;
+	}
+
+	if (nns != NN_OK)
+	{
+		/* The error of the net is that of this thread */
+		strncpy(pResult->pchErrMsg, Nn_GetErrMsg(), sizeof (pResult->pchErrMsg) - 1);
+		pResult->pchErrMsg[sizeof (pResult->pchErrMsg) - 1] = '\0';
+		Nn_DeleteNet(pNet);
+		pNet = NULL;
+	}
+
+	pResult->nStatus   = nns;
+	pJob->apNets[iNet] = pNet;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IsBinNetFile                                                  */
+/* Purpose:  Checks whether a NNFF file is binary, and whether it is 2.x      */
+/* Remarks:  The first bytes of the file are checked by Nn_IsBinNetMem and    */
+/*           Nn_IsBin2Mem.                                                    */
+/* Returns:  NN_OK (or zero) for success, NN_CANT_OPEN_FILE otherwise         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_IsBinNetFile (PCSTR pchFilePath, BOOL* pbBinary, BOOL* pbBin2)
+{
+	FILE*          istream;
+	unsigned char  achProbe[NN_LOAD_PROBE_SIZE];
+	size_t         nSize;
+
+	*pbBinary = FALSE;
+	*pbBin2   = FALSE;
+
+	istream = fopen(pchFilePath, "rb");
+	if (istream == NULL)
+		return Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't open file '%s'", pchFilePath);
+	nSize = fread(achProbe, 1, sizeof (achProbe), istream);
+	fclose(istream);
+
+	*pbBinary = Nn_IsBinNetMem(achProbe, nSize);
+	*pbBin2   = Nn_IsBin2Mem(achProbe, nSize);
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_StartLoadWorker, Nn_JoinLoadWorker                            */
+/* Purpose:  Starts a loading thread, waits for its end                       */
+/* Returns:  Nn_StartLoadWorker: TRUE if the thread was started               */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#if defined(_MSC_VER)
+
+static unsigned __stdcall Nn_LoadWorkerMain (void* pvWorker)
+{
+	Nn_RunLoadWorker((NN_LOAD_WORKER*) pvWorker);
+	Nn_CloseHwCounters();
+	return 0;
+}
+
+BOOL Nn_StartLoadWorker (NN_LOAD_WORKER* pWorker)
+{
+	pWorker->thread = (HANDLE) _beginthreadex(NULL, 0, Nn_LoadWorkerMain, pWorker, 0, NULL);
+	return pWorker->thread != 0;
+}
+
+void Nn_JoinLoadWorker (NN_LOAD_WORKER* pWorker)
+{
+	WaitForSingleObject(pWorker->thread, INFINITE);
+	CloseHandle(pWorker->thread);
+}
+
+#else
+
+static void* Nn_LoadWorkerMain (void* pvWorker)
+{
+	Nn_RunLoadWorker((NN_LOAD_WORKER*) pvWorker);
+	Nn_CloseHwCounters();
+	return NULL;
+}
+
+BOOL Nn_StartLoadWorker (NN_LOAD_WORKER* pWorker)
+{
+	return pthread_create(&pWorker->thread, NULL, Nn_LoadWorkerMain, pWorker) == 0;
+}
+
+void Nn_JoinLoadWorker (NN_LOAD_WORKER* pWorker)
+{
+	pthread_join(pWorker->thread, NULL);
+}
+
+#endif
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetNumProcessors                                              */
+/* Purpose:  Gets the number of processors online                             */
+/* Returns:  The number of processors, at least 1                             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+int Nn_GetNumProcessors (void)
+{
+	long nNum;
+#if defined(_MSC_VER)
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	nNum = (long) si.dwNumberOfProcessors;
+#else
+	nNum = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return nNum > 0 ? (int) nNum : 1;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetLoadClock                                                  */
+/* Purpose:  Reads the monotonic clock                                        */
+/* Returns:  The clock in seconds                                             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+double Nn_GetLoadClock (void)
+{
+#if defined(_MSC_VER)
+	LARGE_INTEGER nCount, nFreq;
+	QueryPerformanceCounter(&nCount);
+	QueryPerformanceFrequency(&nFreq);
+	return (double) nCount.QuadPart / (double) nFreq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+#endif
+}
+
+/* EOF ///////////////////////////////////////////////////////////////////////*/
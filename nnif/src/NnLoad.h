@@ -0,0 +1,83 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnLoad.h                                                      */
+/* Purpose:     Interface def. file for loading a set of neural nets at once  */
+/* Remarks:     Implemented in NnLoad.c                                       */
+/*              Nn_LoadNets loads the nets of a processor at startup on a     */
+/*              pool of threads created for the call. Each net is read from   */
+/*              its NNFF file (ASCII, binary NNFF 1.x or 2.0, recognized by   */
+/*              the content of the file) and validated, and optionally frozen */
+/*              and given its batch work buffer, by one of the threads. The   */
+/*              calling thread takes part in the loading.                     */
+/*              The allocator set by Nn_SetAllocator must be thread-safe.     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_LOAD_OPTIONS                                                   */
+/* Purpose: The options of Nn_LoadNets, the same for all nets                 */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnLoadOptions
+{
+	int   nNumThreads;    /* Number of threads, 0 for one per processor   */
+	int   nNumInpUnits;   /* Size of the input vectors, or -1             */
+	int   nNumOutUnits;   /* Size of the output vectors, or -1            */
+	BOOL  bMapFile;       /* Reads binary files through a memory mapping, */
+	                      /* NNFF 2.x files only with bFreeze             */
+	BOOL  bFreeze;        /* Freezes the nets and creates their batch     */
+	                      /* work buffers (see Nn_FreezeNet)              */
+}
+NN_LOAD_OPTIONS;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_LOAD_RESULT                                                    */
+/* Purpose: The status and the stage times of a net loaded by Nn_LoadNets     */
+/* Remarks: The times are in seconds. dStartTime counts from the call of      */
+/*          Nn_LoadNets, so it is the time the net waited for a thread.       */
+/*          dLoadTime covers reading and validating the net (the loading      */
+/*          routines call Nn_AssertSemanticIntegrity), dFreezeTime freezing   */
+/*          it and creating the batch work buffer.                            */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnLoadResult
+{
+	NN_STATUS  nStatus;          /* NN_OK or the error code of the net     */
+	char       pchErrMsg [512];  /* Error message, empty for success       */
+	int        iThread;          /* Index of the loading thread, 0 is the  */
+	                             /* calling thread                         */
+	double     dStartTime;       /* Start of loading the net               */
+	double     dLoadTime;        /* Reading and validating                 */
+	double     dFreezeTime;      /* Freezing, 0 if not frozen              */
+}
+NN_LOAD_RESULT;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_LoadNets                                                      */
+/* Purpose:  Loads a set of neural nets from NNFF files concurrently          */
+/* Remarks:  The nets are loaded in the order of the paths by at most         */
+/*           nNumThreads threads (at most one per net). A net that can't be   */
+/*           loaded is NULL in apNets and has the error in its result, the    */
+/*           other nets are loaded anyway. pOptions can be NULL for the       */
+/*           defaults: one thread per processor, sizes not checked, files     */
+/*           read, nets not frozen.                                           */
+/* Returns:  NN_OK (or zero) if all nets were loaded, otherwise the error     */
+/*           code of the first net not loaded                                 */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_LoadNets
+(
+	const PCSTR*            apchPaths,  /* Paths of the NNFF files           */
+	int                     nNumNets,   /* Number of nets                    */
+	const NN_LOAD_OPTIONS*  pOptions,   /* The options, or NULL              */
+	NN_PNET*                apNets,     /* Receives the nets (DIM=nNumNets)  */
+	NN_LOAD_RESULT*         aResults    /* Receives the results (DIM=nNumNets) */
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+/* EOF ///////////////////////////////////////////////////////////////////////*/
@@ -15,29 +15,30 @@
 
 #include "NnBase.h"
 #include "NnCheck.h"
+#include "NnProf.h"
+#include "NnTrace.h"
 #include "NnMemIO.h"
-
-/*////////////////////////////////////////////////////////////////////////////*/
-/* Module local memory I/O stream                                             */
-
-static NN_MSTREAM* g_stream;
+#include "NnBin2IO.h"
 
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Module local prototypes:                                                   */
 /*                                                                            */
-NN_STATUS Nn_ReadMemHeader  (long* pnSectionID, long* pnSectionSize);
-NN_STATUS Nn_ReadMemNet     (NN_PNET   pNet);
-NN_STATUS Nn_ReadMemLayer   (NN_PLAYER pLayer);
-NN_STATUS Nn_ReadMemUnit    (NN_PUNIT  pUnit);
-NN_STATUS Nn_ReadMemConns   (NN_PUNIT  pUnit);
-NN_STATUS Nn_ReadMemMatrix  (NN_PUNIT  pUnit);
-
-NN_STATUS Nn_WriteMemHeader (long nSectionID, long nSectionSize);
-NN_STATUS Nn_WriteMemNet    (const NN_PNET   pNet);
-NN_STATUS Nn_WriteMemLayer  (const NN_PLAYER pLayer);
-NN_STATUS Nn_WriteMemUnit   (const NN_PUNIT  pUnit);
-NN_STATUS Nn_WriteMemConns  (const NN_PUNIT  pUnit);
-NN_STATUS Nn_WriteMemMatrix (const NN_PUNIT  pUnit);
+long      Nn_GetMemSectionID (PCSTR pchID);
+NN_STATUS Nn_ReadMemHeader  (NN_MSTREAM* pMStream, long* pnSectionID, long* pnSectionSize);
+NN_STATUS Nn_ReadMemNet     (NN_MSTREAM* pMStream, NN_PNET   pNet);
+NN_STATUS Nn_ReadMemLayer   (NN_MSTREAM* pMStream, NN_PNET pNet, NN_PLAYER pLayer);
+NN_STATUS Nn_ReadMemUnit    (NN_MSTREAM* pMStream, NN_PNET pNet, NN_PUNIT  pUnit);
+NN_STATUS Nn_ReadMemConns   (NN_MSTREAM* pMStream, NN_PNET pNet, NN_PUNIT  pUnit);
+NN_STATUS Nn_ReadMemMatrix  (NN_MSTREAM* pMStream, NN_PNET pNet, NN_PUNIT  pUnit);
+size_t    Nn_GetMemArenaSize (NN_MSTREAM* pMStream, const NN_PNET pNet);
+BOOL      Nn_ScanMemSection (NN_MSTREAM* pMStream, long nSectionID, long nSectionSize, void* pAttrib, long nSkipSize);
+
+NN_STATUS Nn_WriteMemHeader (NN_MSTREAM* pMStream, long nSectionID, long nSectionSize);
+NN_STATUS Nn_WriteMemNet    (NN_MSTREAM* pMStream, const NN_PNET   pNet);
+NN_STATUS Nn_WriteMemLayer  (NN_MSTREAM* pMStream, const NN_PLAYER pLayer);
+NN_STATUS Nn_WriteMemUnit   (NN_MSTREAM* pMStream, const NN_PUNIT  pUnit);
+NN_STATUS Nn_WriteMemConns  (NN_MSTREAM* pMStream, const NN_PUNIT  pUnit);
+NN_STATUS Nn_WriteMemMatrix (NN_MSTREAM* pMStream, const NN_PUNIT  pUnit);
 
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_CreateNetFromMemFile                                          */
@@ -61,29 +62,41 @@ NN_STATUS Nn_CreateNetFromMemFile
 	int      nNumOutUnits   /* Number of output units                            */
 )
 {
-	NN_STATUS  nns;
+	NN_STATUS   nns;
+	double      dTraceStart;
+	NN_MSTREAM  mstream;
+	NN_MSTREAM* pMStream;
+	NN_HWPROF_DECL(hwSample)
 	
 	assert(pMem != NULL);
 	assert(ppNet != NULL);
 
+	NN_HWPROF_START(hwSample)
+	dTraceStart = Nn_GetTraceTime();
+
 	/* Set the global error code to NN_OF (or zero) */
 	Nn_ClearError();
 	/* Create an empty neural net object */
 	nns = Nn_CreateNet(ppNet);
+	/* If there was enough memory and the memory holds a NNFF 2.0 file */
+	if (nns == NN_OK && Nn_IsBin2Mem(pMem, nMemSize))
+	{
+		/* Read the neural net object directly from the memory */
+		nns = Nn_ReadBin2Net(*ppNet, pMem, nMemSize, pnBytesRead);
+	}
 	/* If there was enough memory */
-	if (nns == NN_OK)
+	else if (nns == NN_OK)
 	{
-		/* Open the NNFF memory chunk and save its handle global */
-		g_stream = Nn_MOpen((PMEM)pMem, nMemSize, "r");
-		if (g_stream != NULL)
+		/* Open the NNFF memory chunk on the stack */
+		pMStream = Nn_MInit(&mstream, (PMEM)pMem, nMemSize, "r");
+		if (pMStream != NULL)
 		{
 			/* Read the neural net object from the open file */
-			nns = Nn_ReadMemNet(*ppNet);
+			nns = Nn_ReadMemNet(pMStream, *ppNet);
 			/* Set the number of bytes that have been read */
 			if (pnBytesRead != NULL)
-				*pnBytesRead = Nn_MPos(g_stream);
-			/* Close the NNFF memory chunk */
-			Nn_MClose(g_stream);
+				*pnBytesRead = Nn_MPos(pMStream);
+			/* The stream needs no closing */
 		}
 		else
 			return Nn_Error(NN_OUT_OF_MEMORY, NN_ERR_PREFIX "can't open memory file");
@@ -91,8 +104,15 @@ NN_STATUS Nn_CreateNetFromMemFile
 
 	/* If the neural net object was read successfully */
 	if (nns == NN_OK)
+	{
 		/* Check and, if necessary, correct its internal semantic integrity */
 		nns = Nn_AssertSemanticIntegrity(*ppNet, nNumInpUnits, nNumOutUnits);
+		/* The counters are reset by the check, so count afterwards */
+		if (nns == NN_OK)
+		{
+			NN_HWPROF_STOP(*ppNet, NN_PROF_LOAD, 0, hwSample)
+		}
+	}
 	/* If the net was not read successfully */
 	else
 	{
@@ -101,9 +121,29 @@ NN_STATUS Nn_CreateNetFromMemFile
 		*ppNet = NULL;
 	}
 
+	Nn_AddTraceSpan("nnif", "load", dTraceStart, -1);
 	return nns;
 }
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetMemSectionID                                               */
+/* Purpose:  Converts a section ID string (e.g. NN_NET_SECTION_ID) into the   */
+/*           long integer stored in a section header of an NNFF memory chunk  */
+/* Remarks:  Only the 4 bytes of the code are copied, the remaining bytes of  */
+/*           a wider long are zero.                                           */
+/* Returns:  The section ID as long integer                                   */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+long Nn_GetMemSectionID (PCSTR pchID)
+{
+	long nID = 0;
+
+	assert(pchID != NULL);
+
+	memcpy(&nID, pchID, 4);
+	return nID;
+}
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_ReadMemHeader                                                 */
 /* Purpose:  Reads a section header to identify the following section in NNFF */
@@ -112,34 +152,145 @@ NN_STATUS Nn_CreateNetFromMemFile
 
 NN_STATUS Nn_ReadMemHeader 
 (
-	long* pnSectionID,   /* Section ID (4 byte code, 4th is zero) */
-	long* pnSectionSize  /* Size of the following section (4 byte integer) */
+	NN_MSTREAM* pMStream,      /* The open memory stream */
+	long*       pnSectionID,   /* Section ID (4 byte code, 4th is zero) */
+	long*       pnSectionSize  /* Size of the following section (4 byte integer) */
 )
 {
 	assert(pnSectionID != NULL);
 	assert(pnSectionSize != NULL);
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Read the section identifier (4 bytes) */
-	Nn_MRead(pnSectionID,   sizeof (long), 1, g_stream);
-	if (Nn_MError(g_stream))
+	Nn_MRead(pnSectionID,   sizeof (long), 1, pMStream);
+	if (Nn_MError(pMStream))
 		return Nn_SetFileReadError();
 	
 	/* Read the section size (4 bytes) */
-	Nn_MRead(pnSectionSize, sizeof (long), 1, g_stream);
-	if (Nn_MError(g_stream))
+	Nn_MRead(pnSectionSize, sizeof (long), 1, pMStream);
+	if (Nn_MError(pMStream))
 		return Nn_SetFileReadError();
 
 	return NN_OK;
 }
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetMemArenaSize                                               */
+/* Purpose:  Determines the arena size of the net in a first pass over the    */
+/*           layer and unit sections following the net section                */
+/* Remarks:  Only the section headers and attributes are read, the stream is  */
+/*           rewound afterwards. Errors are reported by the second pass,      */
+/*           which reads the net.                                             */
+/* Returns:  The arena size in bytes, zero if the sections are not valid      */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetMemArenaSize (NN_MSTREAM* pMStream, const NN_PNET pNet)
+{
+	NN_LAYER_ATTRIB la;
+	NN_UNIT_ATTRIB  ua;
+	size_t          nSize;
+	size_t          nPos;
+	long            nNumUnits, iU;
+	short           iL;
+
+	assert(pNet != NULL);
+	assert(pMStream != NULL);
+
+	nPos = Nn_MPos(pMStream);
+	nSize = Nn_GetLayersArenaSize(pNet->na.nNumLayers);
+	nNumUnits = 0;
+
+	/* For all layer sections */
+	for (iL = 0; iL < pNet->na.nNumLayers && nSize > 0; iL++)
+	{
+		if (Nn_ScanMemSection(pMStream, Nn_GetMemSectionID(NN_LAYER_SECTION_ID), NN_LAYER_SECTION_SIZE, &la, 0))
+		{
+			nSize += Nn_GetUnitsArenaSize(la.nNumUnits);
+			if (la.nNumUnits > 0)
+				nNumUnits += la.nNumUnits;
+		}
+		else
+			nSize = 0;
+	}
+
+	/* For all unit sections, each followed by its connections and matrix */
+	for (iU = 0; iU < nNumUnits && nSize > 0; iU++)
+	{
+		if (!Nn_ScanMemSection(pMStream, Nn_GetMemSectionID(NN_UNIT_SECTION_ID), NN_UNIT_SECTION_SIZE, &ua, 0))
+		{
+			nSize = 0;
+			break;
+		}
+		if (ua.nNumConns <= 0)
+			continue;
+
+		nSize += Nn_GetConnsArenaSize(ua.nNumConns);
+		if (!Nn_ScanMemSection(pMStream, Nn_GetMemSectionID(NN_CONN_SECTION_ID), NN_CONN_ENTRY_SIZE, NULL,
+								(long) ua.nNumConns * NN_CONN_ENTRY_SIZE))
+			nSize = 0;
+		else if (ua.bHasMatrix)
+		{
+			nSize += Nn_GetMatrixArenaSize(ua.nNumConns);
+			if (!Nn_ScanMemSection(pMStream, Nn_GetMemSectionID(NN_MATRIX_SECTION_ID), NN_MATRIX_ENTRY_SIZE, NULL,
+									(long) ua.nNumConns * ua.nNumConns * NN_MATRIX_ENTRY_SIZE))
+				nSize = 0;
+		}
+	}
+
+	/* Rewind to the layer sections */
+	pMStream->nCurrPos = nPos;
+	pMStream->nErrNo   = 0;
+	return nSize;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ScanMemSection                                                */
+/* Purpose:  Reads a section header from the NNFF memory chunk and then       */
+/*           either the section attributes or skips the given number of bytes */
+/* Remarks:  Used by the first pass, no error is set.                         */
+/* Returns:  TRUE if the header matches and the section could be read         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_ScanMemSection
+(
+	NN_MSTREAM* pMStream,     /* The open memory stream                     */
+	long        nSectionID,   /* Expected section ID                        */
+	long        nSectionSize, /* Expected section size                      */
+	void*       pAttrib,      /* Receives the section attributes or NULL    */
+	long        nSkipSize     /* Number of bytes to skip if pAttrib is NULL */
+)
+{
+	long nID, nSize;
+
+	/* Read the section header */
+	if (Nn_MRead(&nID,   sizeof (long), 1, pMStream) != 1 ||
+		Nn_MRead(&nSize, sizeof (long), 1, pMStream) != 1)
+		return FALSE;
+	if (nID != nSectionID || nSize != nSectionSize)
+		return FALSE;
+
+	if (pAttrib != NULL)
+	{
+		if (Nn_MRead(pAttrib, nSectionSize, 1, pMStream) != 1)
+			return FALSE;
+	}
+	else if (nSkipSize > 0)
+	{
+		if (pMStream->nCurrPos + nSkipSize > pMStream->nLastPos)
+			return FALSE;
+		pMStream->nCurrPos += nSkipSize;
+	}
+
+	return TRUE;
+}
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_ReadMemNet                                                    */
 /* Purpose:  Reads the complete neural net from the open NNFF file            */
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_ReadMemNet (NN_PNET pNet)
+NN_STATUS Nn_ReadMemNet (NN_MSTREAM* pMStream, NN_PNET pNet)
 {
 	NN_STATUS  nns;
 	short      iL, iU;
@@ -148,15 +299,15 @@ NN_STATUS Nn_ReadMemNet (NN_PNET pNet)
 	long       nSectionID, nSectionSize;
 
 	assert(pNet != NULL);
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Read the neural net section header */
-	nns = Nn_ReadMemHeader(&nSectionID, &nSectionSize);
+	nns = Nn_ReadMemHeader(pMStream, &nSectionID, &nSectionSize);
 	if (nns != NN_OK)
 		return nns;
 
 	/* If the identifier does not match: error */
-	if (nSectionID != *(long*)NN_NET_SECTION_ID)
+	if (nSectionID != Nn_GetMemSectionID(NN_NET_SECTION_ID))
 		return Nn_SetInvalidSectionIDError();
 		
 	/* If the size is not correct: error */
@@ -164,10 +315,15 @@ NN_STATUS Nn_ReadMemNet (NN_PNET pNet)
 		return Nn_SetInvalidSectionSizeError();
 
 	/* Read the complete neural nat section */
-	Nn_MRead(&pNet->na, NN_NET_SECTION_SIZE, 1, g_stream);
-	if (Nn_MError(g_stream))
+	Nn_MRead(&pNet->na, NN_NET_SECTION_SIZE, 1, pMStream);
+	if (Nn_MError(pMStream))
 		return Nn_SetFileReadError();
 
+	/* Size the arena of the net in a first pass and create it */
+	nns = Nn_CreateArena(pNet, Nn_GetMemArenaSize(pMStream, pNet));
+	if (nns != NN_OK)
+		return nns;
+
 	/* Create all layers for the neural net object */
 	nns = Nn_CreateLayers(pNet);
 	if (nns != NN_OK)
@@ -179,7 +335,7 @@ NN_STATUS Nn_ReadMemNet (NN_PNET pNet)
 		/* Get the layer at the given position */
 		pLayer = Nn_GetLayerAt(pNet, iL);
 		/* Read the layer from the NNFF memory chunk */
-		nns = Nn_ReadMemLayer(pLayer);
+		nns = Nn_ReadMemLayer(pMStream, pNet, pLayer);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -195,7 +351,7 @@ NN_STATUS Nn_ReadMemNet (NN_PNET pNet)
 			/* Get the unit at the given position */
 			pUnit = Nn_GetUnitAt(pLayer, iU);
 			/* Read the unit from the NNFF memory chunk */
-			nns = Nn_ReadMemUnit(pUnit);
+			nns = Nn_ReadMemUnit(pMStream, pNet, pUnit);
 			if (nns != NN_OK)
 				return nns;
 		}
@@ -210,21 +366,22 @@ NN_STATUS Nn_ReadMemNet (NN_PNET pNet)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_ReadMemLayer (NN_PLAYER pLayer)
+NN_STATUS Nn_ReadMemLayer (NN_MSTREAM* pMStream, NN_PNET pNet, NN_PLAYER pLayer)
 {
 	NN_STATUS nns;
 	long nSectionID, nSectionSize;
 	
+	assert(pNet != NULL);
 	assert(pLayer != NULL);
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Read the layer section header */
-	nns = Nn_ReadMemHeader(&nSectionID, &nSectionSize);
+	nns = Nn_ReadMemHeader(pMStream, &nSectionID, &nSectionSize);
 	if (nns != NN_OK)
 		return nns;
 
 	/* If the identifier does not match: error */
-	if (nSectionID != *(long*)NN_LAYER_SECTION_ID)
+	if (nSectionID != Nn_GetMemSectionID(NN_LAYER_SECTION_ID))
 		return Nn_SetInvalidSectionIDError();
 		
 	/* If the size is not correct: error */
@@ -232,15 +389,15 @@ NN_STATUS Nn_ReadMemLayer (NN_PLAYER pLayer)
 		return Nn_SetInvalidSectionSizeError();
 
 	/* Read the complete layer section from the file */
-	Nn_MRead(&pLayer->la, NN_LAYER_SECTION_SIZE, 1, g_stream);
-	if (Nn_MError(g_stream))
+	Nn_MRead(&pLayer->la, NN_LAYER_SECTION_SIZE, 1, pMStream);
+	if (Nn_MError(pMStream))
 		return Nn_SetFileReadError();
 
 	nns = NN_OK;
 
 	/* If the layer has units, create them */
 	if (pLayer->la.nNumUnits > 0)
-		nns = Nn_CreateUnits(pLayer);
+		nns = Nn_CreateUnitsIn(pNet, pLayer);
 	
 	return nns;
 }
@@ -251,21 +408,22 @@ NN_STATUS Nn_ReadMemLayer (NN_PLAYER pLayer)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_ReadMemUnit (NN_PUNIT  pUnit)
+NN_STATUS Nn_ReadMemUnit (NN_MSTREAM* pMStream, NN_PNET pNet, NN_PUNIT  pUnit)
 {
 	NN_STATUS nns;
 	long      nSectionID, nSectionSize;
 	
+	assert(pNet != NULL);
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Read the unit section header */
-	nns = Nn_ReadMemHeader(&nSectionID, &nSectionSize);
+	nns = Nn_ReadMemHeader(pMStream, &nSectionID, &nSectionSize);
 	if (nns != NN_OK)
 		return nns;
 
 	/* If the identifier does not match: error */
-	if (nSectionID != *(long*)NN_UNIT_SECTION_ID)
+	if (nSectionID != Nn_GetMemSectionID(NN_UNIT_SECTION_ID))
 		return Nn_SetInvalidSectionIDError();
 		
 	/* If the size is not correct: error */
@@ -273,14 +431,14 @@ NN_STATUS Nn_ReadMemUnit (NN_PUNIT  pUnit)
 		return Nn_SetInvalidSectionSizeError();
 
 	/* Read the complete unit section from the NNFF memory chunk */
-	Nn_MRead(&pUnit->ua, NN_UNIT_SECTION_SIZE, 1, g_stream);
-	if (Nn_MError(g_stream))
+	Nn_MRead(&pUnit->ua, NN_UNIT_SECTION_SIZE, 1, pMStream);
+	if (Nn_MError(pMStream))
 		return Nn_SetFileReadError();
 
 	/* If the units has incomming connections */
 	if (pUnit->ua.nNumConns > 0)
 	{
-		nns = Nn_ReadMemConns(pUnit);
+		nns = Nn_ReadMemConns(pMStream, pNet, pUnit);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -288,7 +446,7 @@ NN_STATUS Nn_ReadMemUnit (NN_PUNIT  pUnit)
 	/* If the unit has a matrix definition */
 	if (pUnit->ua.nNumConns > 0 && pUnit->ua.bHasMatrix)
 	{
-		nns = Nn_ReadMemMatrix(pUnit);
+		nns = Nn_ReadMemMatrix(pMStream, pNet, pUnit);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -303,23 +461,24 @@ NN_STATUS Nn_ReadMemUnit (NN_PUNIT  pUnit)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise               */
 /*////////////////////////////////////////////////////////////////////////////  */
 
-NN_STATUS Nn_ReadMemConns (NN_PUNIT  pUnit)
+NN_STATUS Nn_ReadMemConns (NN_MSTREAM* pMStream, NN_PNET pNet, NN_PUNIT  pUnit)
 {
 	NN_STATUS nns;
 	NN_PCONN  pConn;
 	short     iC;
 	long      nSectionID, nSectionSize;
 	
+	assert(pNet != NULL);
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Read the connection section header */
-	nns = Nn_ReadMemHeader(&nSectionID, &nSectionSize);
+	nns = Nn_ReadMemHeader(pMStream, &nSectionID, &nSectionSize);
 	if (nns != NN_OK)
 		return nns;
 
 	/* If the identifier does not match: error */
-	if (nSectionID != *(long*)NN_CONN_SECTION_ID)
+	if (nSectionID != Nn_GetMemSectionID(NN_CONN_SECTION_ID))
 		return Nn_SetInvalidSectionIDError();
 		
 	/* If the size is not correct: error */
@@ -327,7 +486,7 @@ NN_STATUS Nn_ReadMemConns (NN_PUNIT  pUnit)
 		return Nn_SetInvalidSectionSizeError();
 
 	/* Create the connections */
-	nns = Nn_CreateConns(pUnit);
+	nns = Nn_CreateConnsIn(pNet, pUnit);
 	if (nns != NN_OK)
 		return nns;
 
@@ -341,8 +500,8 @@ NN_STATUS Nn_ReadMemConns (NN_PUNIT  pUnit)
 		Nn_MRead(&pConn->ca,
 			  NN_CONN_ENTRY_SIZE, 
 			  1, 
-			  g_stream);
-		if (Nn_MError(g_stream))
+			  pMStream);
+		if (Nn_MError(pMStream))
 			return Nn_SetFileReadError();
 	}
 
@@ -356,23 +515,22 @@ NN_STATUS Nn_ReadMemConns (NN_PUNIT  pUnit)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise                      */
 /*////////////////////////////////////////////////////////////////////////////         */
 
-NN_STATUS Nn_ReadMemMatrix (NN_PUNIT pUnit)
+NN_STATUS Nn_ReadMemMatrix (NN_MSTREAM* pMStream, NN_PNET pNet, NN_PUNIT pUnit)
 {
 	NN_STATUS nns;
-	NN_FLOAT* pfRow;
-	short     iC;
 	long      nSectionID, nSectionSize;
 	
+	assert(pNet != NULL);
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Read the connection section header */
-	nns = Nn_ReadMemHeader(&nSectionID, &nSectionSize);
+	nns = Nn_ReadMemHeader(pMStream, &nSectionID, &nSectionSize);
 	if (nns != NN_OK)
 		return nns;
 
 	/* If the identifier does not match: error */
-	if (nSectionID != *(long*)NN_MATRIX_SECTION_ID)
+	if (nSectionID != Nn_GetMemSectionID(NN_MATRIX_SECTION_ID))
 		return Nn_SetInvalidSectionIDError();
 		
 	/* If the size is not correct: error */
@@ -380,24 +538,17 @@ NN_STATUS Nn_ReadMemMatrix (NN_PUNIT pUnit)
 		return Nn_SetInvalidSectionSizeError();
 
 	/* Create the matrix */
-	nns = Nn_CreateMatrix(pUnit);
+	nns = Nn_CreateMatrixIn(pNet, pUnit);
 	if (nns != NN_OK)
 		return nns;
 
-	/* Read all matrix rows from the NNFF memory chunk */
-	for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
-	{
-		/* Get the matrix row at the given row position */
-		pfRow = Nn_GetMatrixRowAt(pUnit, iC);
-
-		/* Read the row */
-		Nn_MRead(pfRow, 
-			  NN_MATRIX_ENTRY_SIZE * pUnit->ua.nNumConns,
-			  1,
-			  g_stream);
-		if (Nn_MError(g_stream))
-			return Nn_SetFileReadError();
-	}
+	/* Read all matrix rows from the NNFF memory chunk at once, they are contiguous */
+	Nn_MRead(Nn_GetMatrixElems(pUnit), 
+		  NN_MATRIX_ENTRY_SIZE * pUnit->ua.nNumConns * pUnit->ua.nNumConns,
+		  1,
+		  pMStream);
+	if (Nn_MError(pMStream))
+		return Nn_SetFileReadError();
 
 	/* Fine */
 	return NN_OK;
@@ -417,7 +568,9 @@ NN_STATUS Nn_WriteNetToMemFile
 	const NN_PNET pNet            /* Net object to write                  */
 )
 {
-	NN_STATUS  nns;
+	NN_STATUS   nns;
+	NN_MSTREAM  mstream;
+	NN_MSTREAM* pMStream;
 
 	assert(pMem != NULL);
 	assert(pNet != NULL);
@@ -425,17 +578,20 @@ NN_STATUS Nn_WriteNetToMemFile
 	/* Set the global error code to NN_OF (or zero) */
 	Nn_ClearError();
 
-	/* Open the NNFF memory file */
-	g_stream = Nn_MOpen(pMem, nMemSize, "w");
-	if (g_stream != NULL)
+	/* A frozen net has no connection structures left to write */
+	if (pNet->bFrozen)
+		return Nn_Error(NN_INCOMPLETE_STRUCTURE, NN_ERR_PREFIX "a frozen net can't be written");
+
+	/* Open the NNFF memory file on the stack */
+	pMStream = Nn_MInit(&mstream, pMem, nMemSize, "w");
+	if (pMStream != NULL)
 	{
 		/* Write the neural net object to the file */
-		nns = Nn_WriteMemNet(pNet);
+		nns = Nn_WriteMemNet(pMStream, pNet);
 		/* Set the number of bytes that have been written */
 		if (pnBytesWritten != NULL)
-			*pnBytesWritten = Nn_MPos(g_stream);
-		/* Close the NNFF memory file */
-		Nn_MClose(g_stream);
+			*pnBytesWritten = Nn_MPos(pMStream);
+		/* The stream needs no closing */
 	}
 	else
 		return Nn_Error(NN_OUT_OF_MEMORY, NN_ERR_PREFIX "can't open memory file");
@@ -449,18 +605,18 @@ NN_STATUS Nn_WriteNetToMemFile
 /* Returns:  NN_OK (or zero) for success, NN_FILE_WRITE_ERROR otherwise       */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteMemHeader (long nSectionID, long nSectionSize)
+NN_STATUS Nn_WriteMemHeader (NN_MSTREAM* pMStream, long nSectionID, long nSectionSize)
 {
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Write the section identifier (4 bytes) */
-	Nn_MWrite(&nSectionID,   sizeof (long), 1, g_stream);
-	if (Nn_MError(g_stream))
+	Nn_MWrite(&nSectionID,   sizeof (long), 1, pMStream);
+	if (Nn_MError(pMStream))
 		return Nn_SetFileWriteError();
 
 	/* Write the section size (4 bytes) */
-	Nn_MWrite(&nSectionSize, sizeof (long), 1, g_stream);
-	if (Nn_MError(g_stream))
+	Nn_MWrite(&nSectionSize, sizeof (long), 1, pMStream);
+	if (Nn_MError(pMStream))
 		return Nn_SetFileWriteError();
 	
 	return NN_OK;
@@ -472,7 +628,7 @@ NN_STATUS Nn_WriteMemHeader (long nSectionID, long nSectionSize)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteMemNet (const NN_PNET pNet)
+NN_STATUS Nn_WriteMemNet (NN_MSTREAM* pMStream, const NN_PNET pNet)
 {
 	NN_STATUS  nns;
 	short      iL, iU;
@@ -480,16 +636,16 @@ NN_STATUS Nn_WriteMemNet (const NN_PNET pNet)
 	NN_PUNIT   pUnit;
 	
 	assert(pNet != NULL);
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Write the net header */
-	nns = Nn_WriteMemHeader(*(long*)NN_NET_SECTION_ID, NN_NET_SECTION_SIZE);
+	nns = Nn_WriteMemHeader(pMStream, Nn_GetMemSectionID(NN_NET_SECTION_ID), NN_NET_SECTION_SIZE);
 	if (nns != NN_OK)
 		return nns;
 	
 	/* Write the complete net section */
-	Nn_MWrite(&pNet->na, NN_NET_SECTION_SIZE, 1, g_stream);
-	if (Nn_MError(g_stream))
+	Nn_MWrite(&pNet->na, NN_NET_SECTION_SIZE, 1, pMStream);
+	if (Nn_MError(pMStream))
 		return Nn_SetFileWriteError();
 	
 	/* Write all layer sections to the NNFF memory chunk */
@@ -499,7 +655,7 @@ NN_STATUS Nn_WriteMemNet (const NN_PNET pNet)
 		/* Get the layer at the given position */
 		pLayer = Nn_GetLayerAt(pNet, iL);
 		/* Write the layer section */
-		nns = Nn_WriteMemLayer(pLayer);
+		nns = Nn_WriteMemLayer(pMStream, pLayer);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -516,7 +672,7 @@ NN_STATUS Nn_WriteMemNet (const NN_PNET pNet)
 			/* Get the unit at the given position */
 			pUnit = Nn_GetUnitAt(pLayer, iU);
 			/* Write unit section */
-			nns = Nn_WriteMemUnit(pUnit);
+			nns = Nn_WriteMemUnit(pMStream, pUnit);
 			if (nns != NN_OK)
 				return nns;
 		}
@@ -531,21 +687,21 @@ NN_STATUS Nn_WriteMemNet (const NN_PNET pNet)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteMemLayer (const NN_PLAYER pLayer)
+NN_STATUS Nn_WriteMemLayer (NN_MSTREAM* pMStream, const NN_PLAYER pLayer)
 {
 	NN_STATUS nns;
 
 	assert(pLayer != NULL);
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Write the layer section header to the NNFF memory chunk */
-	nns = Nn_WriteMemHeader(*(long*)NN_LAYER_SECTION_ID, NN_LAYER_SECTION_SIZE);
+	nns = Nn_WriteMemHeader(pMStream, Nn_GetMemSectionID(NN_LAYER_SECTION_ID), NN_LAYER_SECTION_SIZE);
 	if (nns != NN_OK)
 		return nns;
 	
 	/* Write the layer section to the NNFF memory chunk */
-	Nn_MWrite(&pLayer->la, NN_LAYER_SECTION_SIZE, 1, g_stream);
-	if (Nn_MError(g_stream))
+	Nn_MWrite(&pLayer->la, NN_LAYER_SECTION_SIZE, 1, pMStream);
+	if (Nn_MError(pMStream))
 		return Nn_SetFileWriteError();
 
 	return NN_OK;
@@ -557,28 +713,28 @@ NN_STATUS Nn_WriteMemLayer (const NN_PLAYER pLayer)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteMemUnit  (const NN_PUNIT pUnit)
+NN_STATUS Nn_WriteMemUnit  (NN_MSTREAM* pMStream, const NN_PUNIT pUnit)
 {
 	NN_STATUS nns;
 
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Write the unit section header to the NNFF memory chunk */
-	nns = Nn_WriteMemHeader(*(long*)NN_UNIT_SECTION_ID, NN_UNIT_SECTION_SIZE);
+	nns = Nn_WriteMemHeader(pMStream, Nn_GetMemSectionID(NN_UNIT_SECTION_ID), NN_UNIT_SECTION_SIZE);
 	if (nns != NN_OK)
 		return nns;
 
 	/* Write the unit section to the NNFF memory chunk */
-	Nn_MWrite(&pUnit->ua, NN_UNIT_SECTION_SIZE, 1, g_stream);
-	if (Nn_MError(g_stream))
+	Nn_MWrite(&pUnit->ua, NN_UNIT_SECTION_SIZE, 1, pMStream);
+	if (Nn_MError(pMStream))
 		return Nn_SetFileWriteError();
 
 	/* If the unit has incoming connections */
 	if (pUnit->ua.nNumConns > 0 && pUnit->aConns != NULL)
 	{
 		/* Write all connections directly after the unit section: */
-		nns =  Nn_WriteMemConns(pUnit);
+		nns =  Nn_WriteMemConns(pMStream, pUnit);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -587,7 +743,7 @@ NN_STATUS Nn_WriteMemUnit  (const NN_PUNIT pUnit)
 	if (pUnit->ua.nNumConns > 0 && pUnit->ppfMatrix != NULL)
 	{
 		/* Write the matrix definitiondirectly after the connection section: */
-		nns =  Nn_WriteMemMatrix(pUnit);
+		nns =  Nn_WriteMemMatrix(pMStream, pUnit);
 		if (nns != NN_OK)
 			return nns;
 	}
@@ -601,17 +757,17 @@ NN_STATUS Nn_WriteMemUnit  (const NN_PUNIT pUnit)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteMemConns (const NN_PUNIT pUnit)
+NN_STATUS Nn_WriteMemConns (NN_MSTREAM* pMStream, const NN_PUNIT pUnit)
 {
 	NN_STATUS nns;
 	NN_PCONN  pConn;
 	short     iC;
 
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Write the connection section header to the NNFF memory chunk */
-	nns = Nn_WriteMemHeader(*(long*)NN_CONN_SECTION_ID, NN_CONN_ENTRY_SIZE);
+	nns = Nn_WriteMemHeader(pMStream, Nn_GetMemSectionID(NN_CONN_SECTION_ID), NN_CONN_ENTRY_SIZE);
 	if (nns != NN_OK)
 		return nns;
 
@@ -626,8 +782,8 @@ NN_STATUS Nn_WriteMemConns (const NN_PUNIT pUnit)
 		Nn_MWrite(&pConn->ca, 
 			      NN_CONN_ENTRY_SIZE, 
 			      1, 
-			      g_stream);
-		if (Nn_MError(g_stream))
+			      pMStream);
+		if (Nn_MError(pMStream))
 			return Nn_SetFileWriteError();
 	}
 
@@ -640,17 +796,17 @@ NN_STATUS Nn_WriteMemConns (const NN_PUNIT pUnit)
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
-NN_STATUS Nn_WriteMemMatrix  (const NN_PUNIT pUnit)
+NN_STATUS Nn_WriteMemMatrix  (NN_MSTREAM* pMStream, const NN_PUNIT pUnit)
 {
 	NN_STATUS nns;
 	NN_FLOAT* pfRow;
 	short     iC;
 
 	assert(pUnit != NULL);
-	assert(g_stream != NULL);
+	assert(pMStream != NULL);
 
 	/* Write the unit section header to the NNFF memory chunk */
-	nns = Nn_WriteMemHeader(*(long*)NN_MATRIX_SECTION_ID, NN_MATRIX_ENTRY_SIZE);
+	nns = Nn_WriteMemHeader(pMStream, Nn_GetMemSectionID(NN_MATRIX_SECTION_ID), NN_MATRIX_ENTRY_SIZE);
 	if (nns != NN_OK)
 		return nns;
 
@@ -665,8 +821,8 @@ NN_STATUS Nn_WriteMemMatrix  (const NN_PUNIT pUnit)
 		Nn_MWrite(pfRow, 
 			      NN_MATRIX_ENTRY_SIZE * pUnit->ua.nNumConns,
 			      1,
-			      g_stream);
-		if (Nn_MError(g_stream))
+			      pMStream);
+		if (Nn_MError(pMStream))
 			return Nn_SetFileReadError();
 	}
 
@@ -691,10 +847,27 @@ NN_MSTREAM* Nn_MOpen (PMEM pMem, size_t nMemSize, PCSTR pchMode)
 	if (pMem == NULL || nMemSize == 0U)
 		return NULL;
 	
-	pMStream = (NN_MSTREAM*) calloc(1, sizeof (NN_MSTREAM));
+	pMStream = (NN_MSTREAM*) Nn_Alloc(sizeof (NN_MSTREAM));
 	if (pMStream == NULL)
 		return NULL;
 
+	return Nn_MInit(pMStream, pMem, nMemSize, pchMode);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_MInit                                                         */
+/* Purpose:  Opens a memory stream in a caller provided structure             */
+/* Returns:  pMStream if the stream can be opened, NULL otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_MSTREAM* Nn_MInit (NN_MSTREAM* pMStream, PMEM pMem, size_t nMemSize, PCSTR pchMode)
+{
+	assert(pMStream != NULL);
+	assert(pchMode != NULL);
+
+	if (pMem == NULL || nMemSize == 0U)
+		return NULL;
+
 	pMStream->pMemBase  = pMem;
 	pMStream->nCurrPos  = 0U;
 	pMStream->nLastPos  = nMemSize;
@@ -715,7 +888,7 @@ int Nn_MClose (NN_MSTREAM* pMStream)
 	if (pMStream == NULL)
 		return 1;
 	
-	free(pMStream);
+	Nn_Free(pMStream);
 	return 0;
 }
 
@@ -20,7 +20,8 @@ extern "C" {
 /*           the number of input and output units. The return value of        */
 /*           Nn_AssertSemanticIntegrity is returned by Nn_CreateFromMemFile.  */
 /*           The comparision of the number of input and output units can      */
-/*           be supressed if passed each a -1.                                */
+/*           be supressed if passed each a -1. NNFF 1.x and 2.0 files are     */
+/*           read.                                                            */
 /* Returns:  NN_OK (or zero) for success, an error code otherwise             */
 /*////////////////////////////////////////////////////////////////////////////*/
 
@@ -76,6 +77,16 @@ NN_MSTREAM;
 
 NN_MSTREAM* Nn_MOpen (PMEM pMem, size_t nMemSize, PCSTR pchMode);
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_MInit                                                         */
+/* Purpose:  Opens a memory stream in a caller provided structure, e.g. on    */
+/*           the stack, without allocating memory                             */
+/* Remarks:  The stream needs no Nn_MClose.                                   */
+/* Returns:  pMStream if the stream can be opened, NULL otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_MSTREAM* Nn_MInit (NN_MSTREAM* pMStream, PMEM pMem, size_t nMemSize, PCSTR pchMode);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_MClose                                                        */
 /* Purpose:  Standard library 'fclose' equivalent for a memory stream         */
@@ -18,6 +18,8 @@
 
 #include "NnBase.h"
 #include "NnProc.h"
+#include "NnProf.h"
+#include "NnTrace.h"
 
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Module local prototypes:                                                   */
@@ -29,6 +31,9 @@ void Nn_SetInput       (NN_PLAYER pLayer, const double * adInp);
 void Nn_GetOutput_f32  (NN_PLAYER pLayer, float  * afOut);
 void Nn_GetOutput      (NN_PLAYER pLayer, double * adOut);
 
+NN_FLOAT Nn_CalcTrnInp (const NN_PUNIT pUnit, NN_FLOAT fX);
+NN_FLOAT Nn_CalcTrnOut (const NN_PUNIT pUnit, NN_FLOAT fY);
+
 void Nn_CalcInpFn  (NN_PNET pNet, NN_PLAYER pLayer);
 void Nn_CalcActFn  (NN_PLAYER pLayer);
 void Nn_CalcOutFn  (NN_PLAYER pLayer);
@@ -52,6 +57,17 @@ void Nn_CalcOutFnQuadratic   (NN_PLAYER pLayer);
 void Nn_CalcOutFnExponential (NN_PLAYER pLayer);
 void Nn_CalcOutFnLogarithmic (NN_PLAYER pLayer);
 
+NN_STATUS Nn_ProcessPixels    (NN_PNET pNet, int nNumPixels, const double* adInp, double* adOut,
+                               PCMEM pValidMask, PMEM pRangeMask, BOOL bSkipOutOfRange, double dFillValue);
+void Nn_ScatterBlock          (NN_PNET pNet, int nNumPixels, const int* aiPixel, double* adOut);
+NN_STATUS Nn_AllocBatchBuffer (NN_PNET pNet);
+void Nn_ProcessBlock          (NN_PNET pNet, int nNumPixels);
+void Nn_CalcBlockInpFn        (NN_PNET pNet, NN_PLAYER pLayer, int nNumPixels);
+void Nn_CalcBlockActFn        (NN_PLAYER pLayer, int nNumPixels);
+void Nn_CalcBlockOutFn        (NN_PLAYER pLayer, int nNumPixels);
+void Nn_CalcBlockTrnInp       (const NN_PUNIT pUnit, NN_FLOAT* afX, int nNumPixels);
+void Nn_CalcBlockTrnOut       (const NN_PUNIT pUnit, NN_FLOAT* afY, int nNumPixels);
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_ProcessNet_f32                                                */
 /* Purpose:  Computes the net output from a given net input for 4 byte floats. */
@@ -69,10 +85,16 @@ void Nn_ProcessNet_f32
 {
 	short     iL;
 	NN_PLAYER pLayer;
+	NN_PROF_DECL(nTicks)
+	NN_HWPROF_DECL(hwSample)
+
+	NN_HWPROF_START(hwSample)
 
 	/* For all layers */
 	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
 	{
+		NN_PROF_START(nTicks)
+
 		/* Get the layer at the given position */
 		pLayer = pNet->aLayers + iL;
 
@@ -92,7 +114,11 @@ void Nn_ProcessNet_f32
 		/* If this is the output layer, get the output vector (4 bytes) */
 		if (iL == pNet->na.iOutLayer)
 			Nn_GetOutput_f32(pLayer, afOut);
+
+		NN_PROF_STOP(pNet, iL, 1, nTicks)
 	}
+
+	NN_HWPROF_STOP(pNet, NN_PROF_NET, 1, hwSample)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -112,10 +138,16 @@ void Nn_ProcessNet
 {
 	short     iL;
 	NN_PLAYER pLayer;
+	NN_PROF_DECL(nTicks)
+	NN_HWPROF_DECL(hwSample)
+
+	NN_HWPROF_START(hwSample)
 
 	/* For all layers */
 	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
 	{
+		NN_PROF_START(nTicks)
+
 		/* Get the layer at the given position */
 		pLayer = pNet->aLayers + iL;
 
@@ -135,7 +167,11 @@ void Nn_ProcessNet
 		/* If this is the output layer, get the output vector (8 bytes) */
 		if (iL == pNet->na.iOutLayer)
 			Nn_GetOutput(pLayer, adOut);
+
+		NN_PROF_STOP(pNet, iL, 1, nTicks)
 	}
+
+	NN_HWPROF_STOP(pNet, NN_PROF_NET, 1, hwSample)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -153,7 +189,7 @@ void Nn_SetInput_f32(NN_PLAYER pLayer, const float * afInp)
 	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
 	{
 		pUnit = pLayer->aUnits + iU;
-		pUnit->fInp += (NN_FLOAT) afInp[iU];
+		pUnit->fInp += Nn_CalcTrnInp(pUnit, (NN_FLOAT) afInp[iU]);
 	}
 }
 
@@ -172,7 +208,7 @@ void Nn_SetInput(NN_PLAYER pLayer, const double * adInp)
 	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
 	{
 		pUnit = pLayer->aUnits + iU;
-		pUnit->fInp += adInp[iU];
+		pUnit->fInp += Nn_CalcTrnInp(pUnit, adInp[iU]);
 	}
 }
 
@@ -191,7 +227,7 @@ void Nn_GetOutput_f32(NN_PLAYER pLayer, float * afOut)
 	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
 	{
 		pUnit = pLayer->aUnits + iU;
-		afOut[iU] = (float) pUnit->fOut;
+		afOut[iU] = (float) Nn_CalcTrnOut(pUnit, pUnit->fOut);
 	}
 }
 
@@ -210,8 +246,58 @@ void Nn_GetOutput(NN_PLAYER pLayer, double * adOut)
 	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
 	{
 		pUnit = pLayer->aUnits + iU;
-		adOut[iU] = pUnit->fOut;
+		adOut[iU] = Nn_CalcTrnOut(pUnit, pUnit->fOut);
+	}
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CalcTrnInp                                                    */
+/* Purpose:  Applies the I/O transform of an input unit to a net input value  */
+/* Remarks:  See NN_TRN_SCALE in NnBase.h                                     */
+/* Returns:  The transformed value                                            */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_FLOAT Nn_CalcTrnInp(const NN_PUNIT pUnit, NN_FLOAT fX)
+{
+	switch (pUnit->ua.nTrnFnId)
+	{
+	case NN_FUNC_EXPONENTIAL:
+		fX = exp(fX);
+		break;
+	case NN_FUNC_LOGARITHMIC:
+		fX = log(fX);
+		break;
+	}
+
+	if (pUnit->ua.nTrnFlags & NN_TRN_SCALE)
+		fX = (fX - pUnit->ua.fTrnMin) / (pUnit->ua.fTrnMax - pUnit->ua.fTrnMin);
+
+	return fX;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CalcTrnOut                                                    */
+/* Purpose:  Applies the I/O transform of an output unit to a net output value */
+/* Remarks:  See NN_TRN_SCALE in NnBase.h                                      */
+/* Returns:  The transformed value                                             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_FLOAT Nn_CalcTrnOut(const NN_PUNIT pUnit, NN_FLOAT fY)
+{
+	if (pUnit->ua.nTrnFlags & NN_TRN_SCALE)
+		fY = fY * (pUnit->ua.fTrnMax - pUnit->ua.fTrnMin) + pUnit->ua.fTrnMin;
+
+	switch (pUnit->ua.nTrnFnId)
+	{
+	case NN_FUNC_EXPONENTIAL:
+		fY = exp(fY);
+		break;
+	case NN_FUNC_LOGARITHMIC:
+		fY = log(fY);
+		break;
 	}
+
+	return fY;
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -341,8 +427,10 @@ void Nn_CalcInpFnZero(NN_PNET pNet, NN_PLAYER pLayer)
 void Nn_CalcInpFnSum1(NN_PNET pNet, NN_PLAYER pLayer)
 {
 	short     iU, iC;
-	NN_PUNIT  pUnit;
+	NN_PUNIT  pUnit, aSrcUnits;
 	NN_PCONN  pConn;
+	NN_FLOAT* afWeight;
+	long      iConn;
 
 	/* For all units of the given layer */
 	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
@@ -357,13 +445,25 @@ void Nn_CalcInpFnSum1(NN_PNET pNet, NN_PLAYER pLayer)
 		if (pUnit->ua.nNumConns == 0)
 			continue;
 
-		/* For all incoming connections of the given unit */
-		for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
+		if (pNet->bFrozen)
 		{
-			/* Get the connection at the given position */
-			pConn = pUnit->aConns + iC;
-			/* Add the weighted output of the source unit to the unit input */
-			pUnit->fInp += pConn->pUnit->fOut * pConn->ca.fWeight;
+			/* The compact connections of the frozen net, see Nn_FreezeNet */
+			aSrcUnits = pNet->aLayers[0].aUnits;
+			afWeight  = pNet->afConnWeight + pUnit->iFirstConn;
+			iConn     = pUnit->iFirstSrc;
+			for (iC = 0; iC < pUnit->ua.nNumConns; iC++, iConn++)
+				pUnit->fInp += aSrcUnits[NN_CONN_SRC(pNet, iConn)].fOut * afWeight[iC];
+		}
+		else
+		{
+			/* For all incoming connections of the given unit */
+			for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
+			{
+				/* Get the connection at the given position */
+				pConn = pUnit->aConns + iC;
+				/* Add the weighted output of the source unit to the unit input */
+				pUnit->fInp += pConn->pUnit->fOut * pConn->ca.fWeight;
+			}
 		}
 		
 		/* Calculate the resulting unit input */
@@ -382,9 +482,11 @@ void Nn_CalcInpFnSum1(NN_PNET pNet, NN_PLAYER pLayer)
 void Nn_CalcInpFnSum2(NN_PNET pNet, NN_PLAYER pLayer)
 {
 	short     iU, iC;
-	NN_PUNIT  pUnit;
+	NN_PUNIT  pUnit, aSrcUnits;
 	NN_PCONN  pConn;
 	NN_FLOAT  fOut, fOutSum;
+	NN_FLOAT* afWeight;
+	long      iConn;
 
 	/* For all units of the given layer */
 	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
@@ -402,17 +504,33 @@ void Nn_CalcInpFnSum2(NN_PNET pNet, NN_PLAYER pLayer)
 		if (pUnit->ua.nNumConns <= 0)
 			continue;
 
-		/* For all incoming connections of the given unit */
-		for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
+		if (pNet->bFrozen)
 		{
-			/* Get the connection at the given position */
-			pConn = pUnit->aConns + iC;
-			/* Get the output of the source unit */
-			fOut  = pConn->pUnit->fOut;
-			/* Add the weighted output of the source unit to the unit input */
-			pUnit->fInp += fOut * pConn->ca.fWeight;
-			/* Add the output to the output sum */
-			fOutSum += fOut;
+			/* The compact connections of the frozen net, see Nn_FreezeNet */
+			aSrcUnits = pNet->aLayers[0].aUnits;
+			afWeight  = pNet->afConnWeight + pUnit->iFirstConn;
+			iConn     = pUnit->iFirstSrc;
+			for (iC = 0; iC < pUnit->ua.nNumConns; iC++, iConn++)
+			{
+				fOut  = aSrcUnits[NN_CONN_SRC(pNet, iConn)].fOut;
+				pUnit->fInp += fOut * afWeight[iC];
+				fOutSum += fOut;
+			}
+		}
+		else
+		{
+			/* For all incoming connections of the given unit */
+			for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
+			{
+				/* Get the connection at the given position */
+				pConn = pUnit->aConns + iC;
+				/* Get the output of the source unit */
+				fOut  = pConn->pUnit->fOut;
+				/* Add the weighted output of the source unit to the unit input */
+				pUnit->fInp += fOut * pConn->ca.fWeight;
+				/* Add the output to the output sum */
+				fOutSum += fOut;
+			}
 		}
 		
 		/* Calculate the resulting unit input */
@@ -700,3 +818,684 @@ void Nn_CalcOutFnLogarithmic(NN_PLAYER pLayer)
 }
 
 /*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ProcessNetBatch                                               */
+/* Purpose:  Computes the net outputs for a batch of input vectors (8 byte    */
+/*           floats).                                                         */
+/* Remarks:  See Nn_ProcessPixels                                             */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ProcessNetBatch
+(
+	NN_PNET        pNet,       /* The neural net object                */
+	int            nNumPixels, /* Number of input/output vectors       */
+	const double*  adInp,      /* Net input vectors (DIM=nNumPixels*nNumInp)  */
+	double*        adOut       /* Net output vectors (DIM=nNumPixels*nNumOut) */
+)
+{
+	assert(adOut != NULL || nNumPixels == 0);
+	return Nn_ProcessPixels(pNet, nNumPixels, adInp, adOut, NULL, NULL, FALSE, 0.0);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ProcessNetBatchMasked                                         */
+/* Purpose:  Computes the net outputs for the valid pixels of a batch of      */
+/*           input vectors (8 byte floats).                                   */
+/* Remarks:  See Nn_ProcessPixels                                             */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ProcessNetBatchMasked
+(
+	NN_PNET        pNet,       /* The neural net object                */
+	int            nNumPixels, /* Number of input/output vectors       */
+	const double*  adInp,      /* Net input vectors (DIM=nNumPixels*nNumInp)  */
+	double*        adOut,      /* Net output vectors (DIM=nNumPixels*nNumOut) */
+	PCMEM          pValidMask, /* Validity mask (DIM=NN_MASK_SIZE(nNumPixels)) */
+	double         dFillValue  /* Output value for invalid pixels      */
+)
+{
+	assert(adOut != NULL || nNumPixels == 0);
+	return Nn_ProcessPixels(pNet, nNumPixels, adInp, adOut, pValidMask, NULL, FALSE, dFillValue);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ProcessNetBatchRanged                                         */
+/* Purpose:  Computes the net outputs for the valid pixels of a batch of      */
+/*           input vectors (8 byte floats) and checks the input ranges.       */
+/* Remarks:  See Nn_ProcessPixels                                             */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ProcessNetBatchRanged
+(
+	NN_PNET        pNet,       /* The neural net object                */
+	int            nNumPixels, /* Number of input/output vectors       */
+	const double*  adInp,      /* Net input vectors (DIM=nNumPixels*nNumInp)  */
+	double*        adOut,      /* Net output vectors (DIM=nNumPixels*nNumOut) */
+	PCMEM          pValidMask, /* Validity mask (DIM=NN_MASK_SIZE(nNumPixels)) */
+	PMEM           pRangeMask, /* Out-of-range mask (DIM=NN_MASK_SIZE(nNumPixels)) */
+	BOOL           bSkipOutOfRange, /* If TRUE, out-of-range pixels are not evaluated */
+	double         dFillValue  /* Output value for pixels not evaluated */
+)
+{
+	assert(adOut != NULL || nNumPixels == 0);
+	return Nn_ProcessPixels(pNet, nNumPixels, adInp, adOut, pValidMask, pRangeMask, bSkipOutOfRange, dFillValue);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CheckInputRange                                               */
+/* Purpose:  Checks the valid pixels of a batch of input vectors against the  */
+/*           training ranges of the input units.                              */
+/* Remarks:  See Nn_ProcessPixels                                             */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CheckInputRange
+(
+	NN_PNET        pNet,       /* The neural net object                */
+	int            nNumPixels, /* Number of input vectors              */
+	const double*  adInp,      /* Net input vectors (DIM=nNumPixels*nNumInp)  */
+	PCMEM          pValidMask, /* Validity mask (DIM=NN_MASK_SIZE(nNumPixels)) */
+	PMEM           pRangeMask  /* Out-of-range mask (DIM=NN_MASK_SIZE(nNumPixels)) */
+)
+{
+	assert(pRangeMask != NULL || nNumPixels == 0);
+	return Nn_ProcessPixels(pNet, nNumPixels, adInp, NULL, pValidMask, pRangeMask, FALSE, 0.0);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ProcessPixels                                                 */
+/* Purpose:  Common implementation of the batch routines                      */
+/* Remarks:  The input vectors of the valid pixels are transposed into the    */
+/*           input block of the work buffer, so that every unit sees a dense  */
+/*           vector of NN_BATCH_SIZE values. The pixel indices are remembered */
+/*           in order to scatter the block outputs back.                      */
+/*           The range check is fused into the transposition: every input     */
+/*           vector is compared with the raw input bounds kept in the work    */
+/*           buffer before it is appended to the block. If adOut is NULL,     */
+/*           only the range check is performed.                               */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ProcessPixels
+(
+	NN_PNET        pNet,
+	int            nNumPixels,
+	const double*  adInp,
+	double*        adOut,
+	PCMEM          pValidMask,
+	PMEM           pRangeMask,
+	BOOL           bSkipOutOfRange,
+	double         dFillValue
+)
+{
+	NN_STATUS     nStatus;
+	int           nNumInp, nNumOut;
+	int           iP, nNumBlock, iU, nOutOfRange;
+	int           aiPixel[NN_BATCH_SIZE];
+	BOOL          bCheckRange;
+	const double* pdInp;
+	double*       pdOut;
+	NN_FLOAT*     afMin;
+	NN_FLOAT*     afMax;
+	NN_FLOAT*     afBlock;
+	double        dTraceStart;
+	NN_HWPROF_DECL(hwSample)
+
+	assert(pNet != NULL);
+	assert(nNumPixels >= 0);
+	assert(adInp != NULL || nNumPixels == 0);
+
+	/* Make sure the work buffer exists */
+	nStatus = Nn_AllocBatchBuffer(pNet);
+	if (nStatus != NN_OK)
+		return nStatus;
+
+	NN_HWPROF_START(hwSample)
+	dTraceStart = Nn_GetTraceTime();
+
+	nNumInp     = Nn_GetInputLayer(pNet)->la.nNumUnits;
+	nNumOut     = Nn_GetOutputLayer(pNet)->la.nNumUnits;
+	nNumBlock   = 0;
+	bCheckRange = pRangeMask != NULL || bSkipOutOfRange;
+
+	afMin   = pNet->afBatch;
+	afMax   = afMin + nNumInp;
+	afBlock = afMax + nNumInp;
+
+	if (pRangeMask != NULL)
+		memset(pRangeMask, 0, NN_MASK_SIZE(nNumPixels));
+
+	/* For all pixels */
+	for (iP = 0; iP < nNumPixels; iP++)
+	{
+		pdInp = adInp + (size_t) iP * nNumInp;
+
+		/* Invalid pixels are not evaluated, just set their fill value */
+		if (pValidMask != NULL && !NN_MASK_GET(pValidMask, iP))
+		{
+			if (adOut != NULL)
+			{
+				pdOut = adOut + (size_t) iP * nNumOut;
+				for (iU = 0; iU < nNumOut; iU++)
+					pdOut[iU] = dFillValue;
+			}
+			continue;
+		}
+
+		/* Compare the input vector with the bounds, NaN is out of range */
+		if (bCheckRange)
+		{
+			nOutOfRange = 0;
+			for (iU = 0; iU < nNumInp; iU++)
+				nOutOfRange |= !(pdInp[iU] >= afMin[iU]) | !(pdInp[iU] <= afMax[iU]);
+
+			if (nOutOfRange)
+			{
+				if (pRangeMask != NULL)
+					NN_MASK_SET(pRangeMask, iP);
+				if (bSkipOutOfRange && adOut != NULL)
+				{
+					pdOut = adOut + (size_t) iP * nNumOut;
+					for (iU = 0; iU < nNumOut; iU++)
+						pdOut[iU] = dFillValue;
+					continue;
+				}
+			}
+		}
+
+		/* Range check only */
+		if (adOut == NULL)
+			continue;
+
+		/* Append the input vector to the input block */
+		for (iU = 0; iU < nNumInp; iU++)
+			afBlock[iU * NN_BATCH_SIZE + nNumBlock] = pdInp[iU];
+		aiPixel[nNumBlock++] = iP;
+
+		/* If the block is complete, evaluate it */
+		if (nNumBlock == NN_BATCH_SIZE)
+		{
+			Nn_ProcessBlock(pNet, nNumBlock);
+			Nn_ScatterBlock(pNet, nNumBlock, aiPixel, adOut);
+			nNumBlock = 0;
+		}
+	}
+
+	/* Evaluate the remaining pixels */
+	if (nNumBlock > 0)
+	{
+		Nn_ProcessBlock(pNet, nNumBlock);
+		Nn_ScatterBlock(pNet, nNumBlock, aiPixel, adOut);
+	}
+
+	NN_HWPROF_STOP(pNet, NN_PROF_NET, nNumPixels, hwSample)
+	Nn_AddTraceSpan("nnif", adOut != NULL ? "batch" : "range check", dTraceStart, nNumPixels);
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ScatterBlock                                                  */
+/* Purpose:  Copies the output block of the output layer back to the output   */
+/*           vectors of the pixels                                            */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_ScatterBlock(NN_PNET pNet, int nNumPixels, const int* aiPixel, double* adOut)
+{
+	NN_PLAYER pOutLayer;
+	int       iB, iU, nNumOut;
+	double*   pdOut;
+
+	pOutLayer = Nn_GetOutputLayer(pNet);
+	nNumOut   = pOutLayer->la.nNumUnits;
+
+	for (iB = 0; iB < nNumPixels; iB++)
+	{
+		pdOut = adOut + (size_t) aiPixel[iB] * nNumOut;
+		for (iU = 0; iU < nNumOut; iU++)
+			pdOut[iU] = pOutLayer->afBatchOut[iU * NN_BATCH_SIZE + iB];
+	}
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_AllocBatchBuffer                                              */
+/* Purpose:  Allocates the work buffer of the batch routines, if not already  */
+/*           done.                                                            */
+/* Remarks:  The buffer holds the lower and upper input bounds of the range   */
+/*           check, the transposed input block and the output blocks of all  */
+/*           layers, each block has NN_BATCH_SIZE values per unit. The buffer */
+/*           is released by Nn_AssertSemanticIntegrity and Nn_DeleteNet.      */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_AllocBatchBuffer(NN_PNET pNet)
+{
+	short     iL, iU;
+	size_t    nNumValues;
+	NN_PLAYER pLayer;
+	NN_FLOAT* afBlocks;
+
+	assert(pNet != NULL);
+
+	if (pNet->afBatch != NULL)
+		return NN_OK;
+
+	pNet->afBatch = (NN_FLOAT*) Nn_Alloc(Nn_GetBatchBufferSize(pNet));
+	if (pNet->afBatch == NULL)
+		return Nn_SetOutOfMemoryError();
+
+	/* Set the input bounds */
+	pLayer = Nn_GetInputLayer(pNet);
+	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+	{
+		Nn_GetInpBounds(pLayer->aUnits + iU, 
+		                pNet->afBatch + iU, 
+		                pNet->afBatch + pLayer->la.nNumUnits + iU);
+	}
+
+	/* Assign the output blocks of the layers */
+	afBlocks   = pNet->afBatch + 2 * pLayer->la.nNumUnits;
+	nNumValues = pLayer->la.nNumUnits;
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		pLayer = pNet->aLayers + iL;
+		pLayer->afBatchOut = afBlocks + nNumValues * NN_BATCH_SIZE;
+		nNumValues += pLayer->la.nNumUnits;
+	}
+
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBatchBufferSize                                            */
+/* Purpose:  Gets the size of the work buffer of the batch routines           */
+/* Remarks:  See Nn_AllocBatchBuffer for the layout.                          */
+/* Returns:  The size in bytes                                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_GetBatchBufferSize(const NN_PNET pNet)
+{
+	short  iL;
+	size_t nNumInp, nNumValues;
+
+	assert(pNet != NULL);
+
+	/* Sum up the number of units, the input block comes first */
+	nNumInp    = Nn_GetInputLayer(pNet)->la.nNumUnits;
+	nNumValues = nNumInp;
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+		nNumValues += pNet->aLayers[iL].la.nNumUnits;
+
+	return (2 * nNumInp + nNumValues * NN_BATCH_SIZE) * sizeof (NN_FLOAT);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetInpBounds                                                  */
+/* Purpose:  Gets the bounds of the range check for an input unit             */
+/*           (see NnProc.h)                                                   */
+/* Remarks:  The training range refers to the transformed input values, so it */
+/*           is mapped back with the inverse transform function. Units        */
+/*           without training range accept all values except NaN.             */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_GetInpBounds(const NN_PUNIT pUnit, NN_FLOAT* pfMin, NN_FLOAT* pfMax)
+{
+	NN_FLOAT fMin, fMax;
+
+	if ((pUnit->ua.nTrnFlags & NN_TRN_RANGE) == 0)
+	{
+		*pfMin = -HUGE_VAL;
+		*pfMax = +HUGE_VAL;
+		return;
+	}
+
+	fMin = pUnit->ua.fTrnMin;
+	fMax = pUnit->ua.fTrnMax;
+
+	switch (pUnit->ua.nTrnFnId)
+	{
+	case NN_FUNC_EXPONENTIAL:
+		/* exp(x) in [fMin, fMax] */
+		fMin = (fMin > 0.0) ? log(fMin) : -HUGE_VAL;
+		fMax = (fMax > 0.0) ? log(fMax) : -HUGE_VAL;
+		break;
+	case NN_FUNC_LOGARITHMIC:
+		/* log(x) in [fMin, fMax] */
+		fMin = exp(fMin);
+		fMax = exp(fMax);
+		break;
+	}
+
+	*pfMin = fMin;
+	*pfMax = fMax;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ProcessBlock                                                  */
+/* Purpose:  Evaluates all layers for the pixels in the input block           */
+/* Remarks:  The input block must have been filled in, the outputs are left   */
+/*           in the output blocks of the layers.                              */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_ProcessBlock(NN_PNET pNet, int nNumPixels)
+{
+	short     iL, iU;
+	int       iP;
+	NN_PLAYER pLayer;
+	NN_FLOAT* afOut;
+	NN_FLOAT* afInp;
+	NN_PROF_DECL(nTicks)
+
+	/* For all layers */
+	for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+	{
+		NN_PROF_START(nTicks)
+
+		/* Get the layer at the given position */
+		pLayer = pNet->aLayers + iL;
+
+		/* Calculate the input function */
+		Nn_CalcBlockInpFn(pNet, pLayer, nNumPixels);
+
+		/* If this is the input layer, add the input block */
+		if (iL == pNet->na.iInpLayer)
+		{
+			for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+			{
+				afOut = pLayer->afBatchOut + iU * NN_BATCH_SIZE;
+				afInp = pNet->afBatch + 2 * pLayer->la.nNumUnits + iU * NN_BATCH_SIZE;
+				Nn_CalcBlockTrnInp(pLayer->aUnits + iU, afInp, nNumPixels);
+				for (iP = 0; iP < nNumPixels; iP++)
+					afOut[iP] += afInp[iP];
+			}
+		}
+
+		/* Calculate the activation function */
+		Nn_CalcBlockActFn(pLayer, nNumPixels);
+
+		/* Calculate the output function */
+		Nn_CalcBlockOutFn(pLayer, nNumPixels);
+
+		/* If this is the output layer, transform the output block */
+		if (iL == pNet->na.iOutLayer)
+		{
+			for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+			{
+				afOut = pLayer->afBatchOut + iU * NN_BATCH_SIZE;
+				Nn_CalcBlockTrnOut(pLayer->aUnits + iU, afOut, nNumPixels);
+			}
+		}
+
+		NN_PROF_STOP(pNet, iL, nNumPixels, nTicks)
+	}
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CalcBlockInpFn                                                */
+/* Purpose:  Calculates the input function of a layer for a block of pixels   */
+/* Remarks:  The result is stored in the output block of the layer           */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_CalcBlockInpFn(NN_PNET pNet, NN_PLAYER pLayer, int nNumPixels)
+{
+	short     iU, iC;
+	int       iP;
+	long      nSrc;
+	NN_PUNIT  pUnit;
+	NN_FLOAT  fW;
+	NN_FLOAT* afX;
+	NN_FLOAT* afSrc;
+	NN_FLOAT* afBase;
+	NN_FLOAT* afWeight;
+	NN_FLOAT  afSum[NN_BATCH_SIZE];
+
+	/* The output blocks of all layers follow each other, so the block of a */
+	/* source unit is found by its number (see Nn_CreateConnTable)          */
+	afBase = pNet->aLayers[0].afBatchOut;
+
+	/* For all units of the given layer */
+	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+	{
+		pUnit = pLayer->aUnits + iU;
+		afX   = pLayer->afBatchOut + iU * NN_BATCH_SIZE;
+
+		/* Initialize unit input to zero */
+		for (iP = 0; iP < nNumPixels; iP++)
+			afX[iP] = 0.0;
+
+		/* See Nn_CalcInpFnZero, Nn_CalcInpFnSum1 and Nn_CalcInpFnSum2 */
+		if (pLayer->la.nInpFnId == NN_FUNC_ZERO || pUnit->ua.nNumConns <= 0)
+			continue;
+
+		if (pLayer->la.nInpFnId == NN_FUNC_SUM_2)
+		{
+			for (iP = 0; iP < nNumPixels; iP++)
+				afSum[iP] = 0.0;
+		}
+
+		/* For all incoming connections of the given unit */
+		afWeight = pNet->afConnWeight + pUnit->iFirstConn;
+		for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
+		{
+			nSrc  = NN_CONN_SRC(pNet, pUnit->iFirstSrc + iC);
+			afSrc = afBase + nSrc * NN_BATCH_SIZE;
+			fW    = afWeight[iC];
+
+			/* Add the weighted output of the source unit to the unit input */
+			for (iP = 0; iP < nNumPixels; iP++)
+				afX[iP] += afSrc[iP] * fW;
+
+			if (pLayer->la.nInpFnId == NN_FUNC_SUM_2)
+			{
+				for (iP = 0; iP < nNumPixels; iP++)
+					afSum[iP] += afSrc[iP];
+			}
+		}
+
+		if (pLayer->la.nInpFnId == NN_FUNC_SUM_2)
+		{
+			for (iP = 0; iP < nNumPixels; iP++)
+				afX[iP] /= afSum[iP];
+		}
+
+		/* Calculate the resulting unit input */
+		for (iP = 0; iP < nNumPixels; iP++)
+		{
+			afX[iP] *= pUnit->ua.fInpScale;
+			afX[iP] += pUnit->ua.fInpBias;
+		}
+	}
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CalcBlockActFn                                                */
+/* Purpose:  Calculates the activation function of a layer for a block of     */
+/*           pixels                                                           */
+/* Remarks:  Works in place on the output block of the layer, see            */
+/*           Nn_CalcActFn for the individual functions                        */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_CalcBlockActFn(NN_PLAYER pLayer, int nNumPixels)
+{
+	short     iU;
+	int       iP;
+	NN_FLOAT* afX;
+	NN_FLOAT  fT = pLayer->la.fActThres;
+	NN_FLOAT  fS = pLayer->la.fActSlope;
+
+	/* For all units of the given layer */
+	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+	{
+		afX = pLayer->afBatchOut + iU * NN_BATCH_SIZE;
+
+		switch (pLayer->la.nActFnId)
+		{
+		case NN_FUNC_THRESHOLD:
+			for (iP = 0; iP < nNumPixels; iP++)
+			{
+				afX[iP] = fS * (afX[iP] - fT);
+				if (afX[iP] < 0.0)
+					afX[iP] = 0.0;
+				if (afX[iP] > 0.0)
+					afX[iP] = 1.0;
+			}
+			break;
+		case NN_FUNC_LINEAR:
+			for (iP = 0; iP < nNumPixels; iP++)
+				afX[iP] = fS * (afX[iP] - fT);
+			break;
+		case NN_FUNC_SEMILINEAR:
+			for (iP = 0; iP < nNumPixels; iP++)
+			{
+				afX[iP] = fS * (afX[iP] - fT);
+				if (afX[iP] < 0.0)
+					afX[iP] = 0.0;
+				if (afX[iP] > 1.0)
+					afX[iP] = 1.0;
+			}
+			break;
+		case NN_FUNC_SIGMOID_1:
+			for (iP = 0; iP < nNumPixels; iP++)
+				afX[iP] = 1.0 / (1.0 + exp(fT - fS * afX[iP]));
+			break;
+		case NN_FUNC_IDENTITY:
+		case NN_FUNC_SIGMOID_2: /* NOT IMPLEMENTED YET, see Nn_CalcActFnSigmoid2 */
+		case NN_FUNC_RBF_1:     /* NOT IMPLEMENTED YET, see Nn_CalcActFnRbf1 */
+		case NN_FUNC_RBF_2:     /* NOT IMPLEMENTED YET, see Nn_CalcActFnRbf2 */
+			break;
+		default:
+			assert(FALSE); /* TODO: Add error handler here... */
+		}
+	}
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CalcBlockOutFn                                                */
+/* Purpose:  Calculates the output function of a layer for a block of pixels  */
+/* Remarks:  Works in place on the output block of the layer, see            */
+/*           Nn_CalcOutFn for the individual functions                        */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_CalcBlockOutFn(NN_PLAYER pLayer, int nNumPixels)
+{
+	short     iU;
+	int       iP;
+	NN_PUNIT  pUnit;
+	NN_FLOAT* afX;
+	NN_FLOAT  fS, fB;
+
+	/* Nothing to do for the identity */
+	if (pLayer->la.nOutFnId == NN_FUNC_IDENTITY)
+		return;
+
+	/* For all units of the given layer */
+	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+	{
+		pUnit = pLayer->aUnits + iU;
+		afX   = pLayer->afBatchOut + iU * NN_BATCH_SIZE;
+		fS    = pUnit->ua.fOutScale;
+		fB    = pUnit->ua.fOutBias;
+
+		switch (pLayer->la.nOutFnId)
+		{
+		case NN_FUNC_LINEAR:
+			for (iP = 0; iP < nNumPixels; iP++)
+				afX[iP] = fS * afX[iP] + fB;
+			break;
+		case NN_FUNC_QUADRATIC:
+			for (iP = 0; iP < nNumPixels; iP++)
+			{
+				afX[iP] = fS * afX[iP] + fB;
+				afX[iP] *= afX[iP];
+			}
+			break;
+		case NN_FUNC_EXPONENTIAL:
+			for (iP = 0; iP < nNumPixels; iP++)
+				afX[iP] = exp(fS * afX[iP] + fB);
+			break;
+		case NN_FUNC_LOGARITHMIC:
+			for (iP = 0; iP < nNumPixels; iP++)
+				afX[iP] = log(fS * afX[iP] + fB);
+			break;
+		default:
+			assert(FALSE); /* TODO: Add error handler here... */
+		}
+	}
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CalcBlockTrnInp                                               */
+/* Purpose:  Applies the I/O transform of an input unit to a block of net     */
+/*           input values                                                     */
+/* Remarks:  Works in place, see Nn_CalcTrnInp                                */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_CalcBlockTrnInp(const NN_PUNIT pUnit, NN_FLOAT* afX, int nNumPixels)
+{
+	int       iP;
+	NN_FLOAT  fMin, fRange;
+
+	switch (pUnit->ua.nTrnFnId)
+	{
+	case NN_FUNC_EXPONENTIAL:
+		for (iP = 0; iP < nNumPixels; iP++)
+			afX[iP] = exp(afX[iP]);
+		break;
+	case NN_FUNC_LOGARITHMIC:
+		for (iP = 0; iP < nNumPixels; iP++)
+			afX[iP] = log(afX[iP]);
+		break;
+	}
+
+	if (pUnit->ua.nTrnFlags & NN_TRN_SCALE)
+	{
+		fMin   = pUnit->ua.fTrnMin;
+		fRange = pUnit->ua.fTrnMax - pUnit->ua.fTrnMin;
+		for (iP = 0; iP < nNumPixels; iP++)
+			afX[iP] = (afX[iP] - fMin) / fRange;
+	}
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CalcBlockTrnOut                                               */
+/* Purpose:  Applies the I/O transform of an output unit to a block of net    */
+/*           output values                                                    */
+/* Remarks:  Works in place, see Nn_CalcTrnOut                                */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_CalcBlockTrnOut(const NN_PUNIT pUnit, NN_FLOAT* afY, int nNumPixels)
+{
+	int       iP;
+	NN_FLOAT  fMin, fRange;
+
+	if (pUnit->ua.nTrnFlags & NN_TRN_SCALE)
+	{
+		fMin   = pUnit->ua.fTrnMin;
+		fRange = pUnit->ua.fTrnMax - pUnit->ua.fTrnMin;
+		for (iP = 0; iP < nNumPixels; iP++)
+			afY[iP] = afY[iP] * fRange + fMin;
+	}
+
+	switch (pUnit->ua.nTrnFnId)
+	{
+	case NN_FUNC_EXPONENTIAL:
+		for (iP = 0; iP < nNumPixels; iP++)
+			afY[iP] = exp(afY[iP]);
+		break;
+	case NN_FUNC_LOGARITHMIC:
+		for (iP = 0; iP < nNumPixels; iP++)
+			afY[iP] = log(afY[iP]);
+		break;
+	}
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
\ No newline at end of file
@@ -12,10 +12,21 @@
 extern "C" {
 #endif
 
+/* Number of pixels evaluated together by the batch routines */
+#define NN_BATCH_SIZE  64
+
+/* Pixel mask handling: bit (i % 8) of byte (i / 8) belongs to pixel i */
+#define NN_MASK_SIZE(nNumPixels)  (((nNumPixels) + 7) / 8)
+#define NN_MASK_GET(pMask, i)     (((pMask)[(i) >> 3] >> ((i) & 7)) & 1)
+#define NN_MASK_SET(pMask, i)     ((pMask)[(i) >> 3] |= (unsigned char) (1 << ((i) & 7)))
+#define NN_MASK_CLR(pMask, i)     ((pMask)[(i) >> 3] &= (unsigned char) ~(1 << ((i) & 7)))
+
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_ProcessNet                                                    */
 /* Purpose:  Computes the net output from a given net input for 8 byte floats. */
-/* Remarks:  IMPORTANT: This function shall only be used if a previous call to */
+/* Remarks:  The I/O transforms of the input and output units are applied to  */
+/*           the vectors (see NN_TRN_SCALE in NnBase.h).                      */
+/*           IMPORTANT: This function shall only be used if a previous call to */
 /*           Nn_AssertSemanticIntegrity returned NN_OK.                        */
 /* Returns:  No return value                                                   */
 /*//////////////////////////////////////////////////////////////////////////// */
@@ -30,7 +41,8 @@ void Nn_ProcessNet
 /*////////////////////////////////////////////////////////////////////////////*/
 /* Function: Nn_ProcessNet_f32                                                */
 /* Purpose:  Computes the net output from a given net input for 4 byte floats. */
-/* Remarks:  IMPORTANT: This function shall only be used if a previous call to */
+/* Remarks:  The I/O transforms are applied as in Nn_ProcessNet.               */
+/*           IMPORTANT: This function shall only be used if a previous call to */
 /*           Nn_AssertSemanticIntegrity returned NN_OK.                        */
 /* Returns:  No return value                                                   */
 /*//////////////////////////////////////////////////////////////////////////// */
@@ -42,6 +54,138 @@ void Nn_ProcessNet_f32
 	float*         afOut  /* Net output vector    */
 );
 
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ProcessNetBatch                                               */
+/* Purpose:  Computes the net outputs for a batch of input vectors (8 byte    */
+/*           floats).                                                         */
+/* Remarks:  The input vectors are stored one after the other, i.e. the input */
+/*           of pixel i starts at adInp[i * <number of input units>]. The same */
+/*           applies to the output vectors.                                    */
+/*           The pixels are evaluated in blocks of NN_BATCH_SIZE, the results  */
+/*           are equal to those of Nn_ProcessNet as long as all connections    */
+/*           lead from a preceding layer. The I/O transforms are applied to    */
+/*           whole blocks.                                                     */
+/*           IMPORTANT: This function shall only be used if a previous call to */
+/*           Nn_AssertSemanticIntegrity returned NN_OK.                        */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise           */
+/*//////////////////////////////////////////////////////////////////////////// */
+
+NN_STATUS Nn_ProcessNetBatch
+(
+	NN_PNET        pNet,       /* The neural net object                */
+	int            nNumPixels, /* Number of input/output vectors       */
+	const double*  adInp,      /* Net input vectors (DIM=nNumPixels*nNumInp)  */
+	double*        adOut       /* Net output vectors (DIM=nNumPixels*nNumOut) */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ProcessNetBatchMasked                                         */
+/* Purpose:  Computes the net outputs for the valid pixels of a batch of      */
+/*           input vectors (8 byte floats).                                   */
+/* Remarks:  Works like Nn_ProcessNetBatch, but only pixels having their bit  */
+/*           set in the validity mask are evaluated (see NN_MASK_GET). The     */
+/*           valid pixels are compacted into dense blocks before evaluation,   */
+/*           so the costs are proportional to the number of valid pixels.      */
+/*           All outputs of invalid pixels are set to the fill value, their    */
+/*           input vectors are never read. If the mask is NULL, all pixels are */
+/*           considered valid.                                                 */
+/*           IMPORTANT: This function shall only be used if a previous call to */
+/*           Nn_AssertSemanticIntegrity returned NN_OK.                        */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise           */
+/*//////////////////////////////////////////////////////////////////////////// */
+
+NN_STATUS Nn_ProcessNetBatchMasked
+(
+	NN_PNET        pNet,       /* The neural net object                */
+	int            nNumPixels, /* Number of input/output vectors       */
+	const double*  adInp,      /* Net input vectors (DIM=nNumPixels*nNumInp)  */
+	double*        adOut,      /* Net output vectors (DIM=nNumPixels*nNumOut) */
+	PCMEM          pValidMask, /* Validity mask (DIM=NN_MASK_SIZE(nNumPixels)) */
+	double         dFillValue  /* Output value for invalid pixels      */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ProcessNetBatchRanged                                         */
+/* Purpose:  Computes the net outputs for the valid pixels of a batch of      */
+/*           input vectors (8 byte floats) and flags the pixels being out of  */
+/*           the training range.                                              */
+/* Remarks:  Works like Nn_ProcessNetBatchMasked, but additionally checks the */
+/*           input vectors of the valid pixels against the training ranges    */
+/*           of the input units (see NN_TRN_RANGE in NnBase.h). A pixel is out */
+/*           of range, if any of its inputs is outside the range or NaN. For   */
+/*           such pixels the bit in the out-of-range mask is set, all other    */
+/*           bits are cleared. The mask can be NULL.                           */
+/*           If bSkipOutOfRange is TRUE, out-of-range pixels are not evaluated */
+/*           and their outputs are set to the fill value.                      */
+/*           The range check is fused with the transposition of the input     */
+/*           vectors, so it does not require an extra pass over the input.     */
+/*           IMPORTANT: This function shall only be used if a previous call to */
+/*           Nn_AssertSemanticIntegrity returned NN_OK.                        */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise           */
+/*//////////////////////////////////////////////////////////////////////////// */
+
+NN_STATUS Nn_ProcessNetBatchRanged
+(
+	NN_PNET        pNet,       /* The neural net object                */
+	int            nNumPixels, /* Number of input/output vectors       */
+	const double*  adInp,      /* Net input vectors (DIM=nNumPixels*nNumInp)  */
+	double*        adOut,      /* Net output vectors (DIM=nNumPixels*nNumOut) */
+	PCMEM          pValidMask, /* Validity mask (DIM=NN_MASK_SIZE(nNumPixels)) */
+	PMEM           pRangeMask, /* Out-of-range mask (DIM=NN_MASK_SIZE(nNumPixels)) */
+	BOOL           bSkipOutOfRange, /* If TRUE, out-of-range pixels are not evaluated */
+	double         dFillValue  /* Output value for pixels not evaluated */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CheckInputRange                                               */
+/* Purpose:  Flags the pixels of a batch of input vectors which are out of    */
+/*           the training range.                                              */
+/* Remarks:  Performs the range check of Nn_ProcessNetBatchRanged only, the   */
+/*           net is not evaluated.                                            */
+/*           IMPORTANT: This function shall only be used if a previous call to */
+/*           Nn_AssertSemanticIntegrity returned NN_OK.                        */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise           */
+/*//////////////////////////////////////////////////////////////////////////// */
+
+NN_STATUS Nn_CheckInputRange
+(
+	NN_PNET        pNet,       /* The neural net object                */
+	int            nNumPixels, /* Number of input vectors              */
+	const double*  adInp,      /* Net input vectors (DIM=nNumPixels*nNumInp)  */
+	PCMEM          pValidMask, /* Validity mask (DIM=NN_MASK_SIZE(nNumPixels)) */
+	PMEM           pRangeMask  /* Out-of-range mask (DIM=NN_MASK_SIZE(nNumPixels)) */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetBatchBufferSize                                            */
+/* Purpose:  Gets the size of the work buffer of the batch routines           */
+/* Remarks:  The buffer is allocated with the first call of a batch routine   */
+/*           and grows with the number of units times NN_BATCH_SIZE.          */
+/* Returns:  The size in bytes                                                */
+/*//////////////////////////////////////////////////////////////////////////// */
+
+size_t Nn_GetBatchBufferSize
+(
+	const NN_PNET  pNet    /* The neural net object */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetInpBounds                                                  */
+/* Purpose:  Gets the bounds of the range check for an input unit, i.e. the   */
+/*           training range mapped back to the raw input values.              */
+/* Remarks:  Used by Nn_ProcessNetBatchRanged and Nn_CheckInputRange. Units   */
+/*           without training range give -HUGE_VAL and +HUGE_VAL.             */
+/* Returns:  No return value                                                  */
+/*//////////////////////////////////////////////////////////////////////////// */
+
+void Nn_GetInpBounds
+(
+	const NN_PUNIT pUnit,  /* An input unit           */
+	NN_FLOAT*      pfMin,  /* Receives the lower bound */
+	NN_FLOAT*      pfMax   /* Receives the upper bound */
+);
+
+
 
 #ifdef __cplusplus
 }
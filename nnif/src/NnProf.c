@@ -0,0 +1,656 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnProf.c                                                      */
+/* Purpose:     Implementation of the neural net profiling routines           */
+/* Remarks:     Interface def. in NnProf.h                                    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* For clock_gettime and syscall */
+#elif !defined(_MSC_VER) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L /* For clock_gettime */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <errno.h>
+
+#include "NnBase.h"
+#include "NnProc.h"
+#include "NnProf.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define NN_PROF_RDTSC
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define NN_PROF_RDTSC
+#endif
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define NN_PROF_PERF
+#endif
+
+/* Index of the net and load counters behind the layer counters */
+#define NN_PROF_INDEX(pNet, iKind)  ((pNet)->na.nNumLayers - 1 - (iKind))
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Module local variables:                                                    */
+/*                                                                            */
+
+static BOOL g_bHwProfiling = FALSE;
+
+/* The counters are opened per thread, read as a group through the leader */
+static NN_THREAD_LOCAL char g_achHwStatus[256] = "not opened";
+static NN_THREAD_LOCAL int g_nHwState = 0;   /* 0: not opened, 1: open, -1: not available */
+static NN_THREAD_LOCAL int g_nHwLeader = -1;
+static NN_THREAD_LOCAL int g_nHwMask = 0;
+static NN_THREAD_LOCAL int g_nHwNumSlots = 0;
+static NN_THREAD_LOCAL int g_aiHwSlot[NN_HW_NUM_COUNTERS];
+static NN_THREAD_LOCAL int g_aiHwFd[NN_HW_NUM_COUNTERS];
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Module local prototypes:                                                   */
+/*                                                                            */
+
+void Nn_InitLayerProfile (NN_PNET pNet, int iL, NN_PROFILE* pProfile);
+NN_PROFILE* Nn_GetProfileData (NN_PNET pNet);
+void Nn_CountMemoryBlock (const NN_PNET pNet, const void* pBlock, size_t nSize, size_t* pnArenaUsed, NN_MEMORY_STATS* pStats);
+void Nn_OpenHwCounters (void);
+BOOL Nn_ReadHwCounters (NN_COUNTER* anValue);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IsProfilingEnabled                                            */
+/* Purpose:  Checks whether the library has been compiled with NN_PROFILING   */
+/* Returns:  TRUE if the counters are maintained, FALSE otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsProfilingEnabled (void)
+{
+#ifdef NN_PROFILING
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetProfileTickUnit                                            */
+/* Purpose:  Gets the unit of the nNumTicks counter                           */
+/* Returns:  "cycles" if the time stamp counter of the CPU is used, "ns"      */
+/*           otherwise                                                        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+PCSTR Nn_GetProfileTickUnit (void)
+{
+#ifdef NN_PROF_RDTSC
+	return "cycles";
+#else
+	return "ns";
+#endif
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetProfileTicks                                               */
+/* Purpose:  Reads the time stamp counter of the CPU, or the monotonic clock  */
+/*           if the counter is not available                                  */
+/* Returns:  The current tick count                                           */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_COUNTER Nn_GetProfileTicks (void)
+{
+#if defined(NN_PROF_RDTSC) && defined(_MSC_VER)
+	return __rdtsc();
+#elif defined(NN_PROF_RDTSC)
+	unsigned int nLo, nHi;
+	__asm__ __volatile__ ("rdtsc" : "=a" (nLo), "=d" (nHi));
+	return ((NN_COUNTER) nHi << 32) | nLo;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (NN_COUNTER) ts.tv_sec * 1000000000 + (NN_COUNTER) ts.tv_nsec;
+#endif
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetProfile                                                    */
+/* Purpose:  Gets the profiling counters of a layer or of the whole net       */
+/* Remarks:  For NN_PROF_NET the counters of all layers are summed up,        */
+/*           nNumCalls and nNumPixels are those of the first layer, the       */
+/*           hardware counters are those of the processing calls.             */
+/* Returns:  NN_OK (or zero) for success, NN_INVALID_ATTRIBUTE if the layer   */
+/*           index is invalid                                                 */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_GetProfile
+(
+	const NN_PNET  pNet,     /* The neural net object                    */
+	int            iL,       /* Layer index, NN_PROF_NET or NN_PROF_LOAD */
+	NN_PROFILE*    pProfile  /* Receives the counters                    */
+)
+{
+	NN_PROFILE* pLayerProf;
+	NN_PROFILE* pNetProf;
+	int         i;
+
+	assert(pNet != NULL);
+	assert(pProfile != NULL);
+
+	if (iL < NN_PROF_LOAD || iL >= pNet->na.nNumLayers)
+		return Nn_Error(NN_INVALID_ATTRIBUTE,
+			NN_ERR_PREFIX "invalid layer index for profile: %d (should be >= %d and < %d)",
+			iL, NN_PROF_LOAD, pNet->na.nNumLayers);
+
+	memset(pProfile, 0, sizeof (NN_PROFILE));
+	if (pNet->aProfile == NULL)
+		return NN_OK;
+
+	if (iL != NN_PROF_NET)
+	{
+		*pProfile = pNet->aProfile[iL >= 0 ? iL : NN_PROF_INDEX(pNet, iL)];
+		return NN_OK;
+	}
+
+	for (i = 0; i < pNet->na.nNumLayers; i++)
+	{
+		pLayerProf = pNet->aProfile + i;
+		if (i == 0)
+		{
+			pProfile->nNumCalls  = pLayerProf->nNumCalls;
+			pProfile->nNumPixels = pLayerProf->nNumPixels;
+		}
+		pProfile->nNumTicks      += pLayerProf->nNumTicks;
+		pProfile->nNumMacs       += pLayerProf->nNumMacs;
+		pProfile->nNumTrans      += pLayerProf->nNumTrans;
+		pProfile->nMacsPerPixel  += pLayerProf->nMacsPerPixel;
+		pProfile->nTransPerPixel += pLayerProf->nTransPerPixel;
+	}
+
+	pNetProf = pNet->aProfile + NN_PROF_INDEX(pNet, NN_PROF_NET);
+	pProfile->nNumInstrs    = pNetProf->nNumInstrs;
+	pProfile->nNumCycles    = pNetProf->nNumCycles;
+	pProfile->nNumL1dMisses = pNetProf->nNumL1dMisses;
+	pProfile->nNumLlcMisses = pNetProf->nNumLlcMisses;
+	pProfile->nNumBrMisses  = pNetProf->nNumBrMisses;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ResetProfile                                                  */
+/* Purpose:  Sets all profiling counters of the net to zero                   */
+/* Remarks:  The static costs per pixel are kept.                             */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_ResetProfile (NN_PNET pNet)
+{
+	NN_PROFILE* pProfile;
+	NN_COUNTER  nMacsPerPixel, nTransPerPixel;
+	int         i;
+
+	assert(pNet != NULL);
+
+	if (pNet->aProfile == NULL)
+		return;
+
+	for (i = 0; i < pNet->na.nNumLayers + 2; i++)
+	{
+		pProfile = pNet->aProfile + i;
+		nMacsPerPixel  = pProfile->nMacsPerPixel;
+		nTransPerPixel = pProfile->nTransPerPixel;
+		memset(pProfile, 0, sizeof (NN_PROFILE));
+		pProfile->nMacsPerPixel  = nMacsPerPixel;
+		pProfile->nTransPerPixel = nTransPerPixel;
+	}
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetProfileData                                                */
+/* Purpose:  Gets the counters of the net, allocates them with the first call */
+/* Remarks:  The layer counters are followed by those of the processing calls */
+/*           and of the loading, see NN_PROF_INDEX.                           */
+/* Returns:  The counters or NULL if out of memory                            */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_PROFILE* Nn_GetProfileData (NN_PNET pNet)
+{
+	int i;
+
+	if (pNet->aProfile == NULL)
+	{
+		pNet->aProfile = (NN_PROFILE*) Nn_Alloc((pNet->na.nNumLayers + 2) * sizeof (NN_PROFILE));
+		if (pNet->aProfile == NULL)
+			return NULL;
+		for (i = 0; i < pNet->na.nNumLayers; i++)
+			Nn_InitLayerProfile(pNet, i, pNet->aProfile + i);
+	}
+	return pNet->aProfile;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_AddLayerProfile                                               */
+/* Purpose:  Adds a single evaluation of a layer to the counters              */
+/* Remarks:  If the counters can't be allocated, the evaluation is silently   */
+/*           not counted.                                                     */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_AddLayerProfile (NN_PNET pNet, int iL, int nNumPixels, NN_COUNTER nNumTicks)
+{
+	NN_PROFILE* pProfile;
+
+	if (Nn_GetProfileData(pNet) == NULL)
+		return;
+
+	pProfile = pNet->aProfile + iL;
+	pProfile->nNumCalls  += 1;
+	pProfile->nNumPixels += nNumPixels;
+	pProfile->nNumTicks  += nNumTicks;
+	pProfile->nNumMacs   += pProfile->nMacsPerPixel  * nNumPixels;
+	pProfile->nNumTrans  += pProfile->nTransPerPixel * nNumPixels;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_SetHwProfiling                                                */
+/* Purpose:  Switches the collection of the hardware counters on or off       */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_SetHwProfiling (BOOL bEnable)
+{
+	g_bHwProfiling = bEnable;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetHwCounterMask                                              */
+/* Purpose:  Gets the hardware counters available to the calling thread       */
+/* Returns:  A combination of the NN_HW_ flags                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+int Nn_GetHwCounterMask (void)
+{
+#ifndef NN_PROFILING
+	return 0;
+#else
+	if (g_nHwState == 0)
+		Nn_OpenHwCounters();
+	return g_nHwMask;
+#endif
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetHwCounterStatus                                            */
+/* Purpose:  Gets a description of the hardware counter availability          */
+/* Returns:  A static string                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+PCSTR Nn_GetHwCounterStatus (void)
+{
+#ifndef NN_PROFILING
+	return "not compiled in (see NN_PROFILING)";
+#else
+	return g_achHwStatus;
+#endif
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_OpenHwCounters                                                */
+/* Purpose:  Opens the hardware counters of the calling thread                */
+/* Remarks:  The counters are opened as a group, so that they can be read     */
+/*           with a single system call. Counters which are not supported are  */
+/*           left out. If none can be opened, the reason is kept in the       */
+/*           status and the thread is not tried again.                        */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_OpenHwCounters (void)
+{
+#ifdef NN_PROF_PERF
+	static const unsigned long aConfig[NN_HW_NUM_COUNTERS][2] =
+	{
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D 
+		                      | (PERF_COUNT_HW_CACHE_OP_READ << 8) 
+		                      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+	};
+	struct perf_event_attr attr;
+	int i, fd, nErrNo = 0;
+
+	g_nHwState    = -1;
+	g_nHwLeader   = -1;
+	g_nHwMask     = 0;
+	g_nHwNumSlots = 0;
+
+	for (i = 0; i < NN_HW_NUM_COUNTERS; i++)
+	{
+		g_aiHwSlot[i] = -1;
+		g_aiHwFd[i]   = -1;
+
+		memset(&attr, 0, sizeof (attr));
+		attr.size           = sizeof (attr);
+		attr.type           = (unsigned) aConfig[i][0];
+		attr.config         = aConfig[i][1];
+		attr.read_format    = PERF_FORMAT_GROUP;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv     = 1;
+
+		/* This thread, any CPU */
+		fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, g_nHwLeader, 0);
+		if (fd < 0)
+		{
+			if (nErrNo == 0)
+				nErrNo = errno;
+			continue;
+		}
+		if (g_nHwLeader < 0)
+			g_nHwLeader = fd;
+		g_aiHwFd[i]   = fd;
+		g_aiHwSlot[i] = g_nHwNumSlots++;
+		g_nHwMask |= 1 << i;
+	}
+
+	if (g_nHwLeader < 0)
+	{
+		sprintf(g_achHwStatus, "perf_event_open failed: %s%s", strerror(nErrNo),
+			(nErrNo == EACCES || nErrNo == EPERM) ? " (see /proc/sys/kernel/perf_event_paranoid)" : "");
+		return;
+	}
+
+	g_nHwState = 1;
+	if (nErrNo != 0)
+		sprintf(g_achHwStatus, "available, some counters not supported: %s", strerror(nErrNo));
+	else
+		strcpy(g_achHwStatus, "available");
+#else
+	g_nHwState = -1;
+	strcpy(g_achHwStatus, "not supported on this platform");
+#endif
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CloseHwCounters                                               */
+/* Purpose:  Closes the hardware counters of the calling thread               */
+/* Remarks:  The members of the group are closed before the leader. The       */
+/*           thread state is reset, so the counters are opened again with     */
+/*           the next use.                                                    */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_CloseHwCounters (void)
+{
+	int i;
+
+#ifdef NN_PROF_PERF
+	if (g_nHwState == 1)
+	{
+		for (i = 0; i < NN_HW_NUM_COUNTERS; i++)
+		{
+			if (g_aiHwFd[i] >= 0 && g_aiHwFd[i] != g_nHwLeader)
+				close(g_aiHwFd[i]);
+		}
+		close(g_nHwLeader);
+	}
+#endif
+
+	g_nHwState    = 0;
+	g_nHwLeader   = -1;
+	g_nHwMask     = 0;
+	g_nHwNumSlots = 0;
+	for (i = 0; i < NN_HW_NUM_COUNTERS; i++)
+	{
+		g_aiHwSlot[i] = -1;
+		g_aiHwFd[i]   = -1;
+	}
+	strcpy(g_achHwStatus, "not opened");
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReadHwCounters                                                */
+/* Purpose:  Reads the current values of the hardware counters of the calling */
+/*           thread                                                           */
+/* Remarks:  Counters not available are set to zero.                          */
+/* Returns:  TRUE if the counters could be read, FALSE otherwise              */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_ReadHwCounters (NN_COUNTER* anValue)
+{
+#ifdef NN_PROF_PERF
+	unsigned long long anBuf[1 + NN_HW_NUM_COUNTERS];
+	int i;
+
+	if (g_nHwState == 0)
+		Nn_OpenHwCounters();
+	if (g_nHwState != 1)
+		return FALSE;
+
+	/* Group read format: number of counters, followed by the values */
+	if (read(g_nHwLeader, anBuf, sizeof (anBuf)) < (int) ((1 + g_nHwNumSlots) * sizeof (anBuf[0])))
+		return FALSE;
+
+	for (i = 0; i < NN_HW_NUM_COUNTERS; i++)
+		anValue[i] = g_aiHwSlot[i] >= 0 ? anBuf[1 + g_aiHwSlot[i]] : 0;
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_StartHwProfile                                                */
+/* Purpose:  Takes the hardware counter reading at the start of a call        */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_StartHwProfile (NN_HW_SAMPLE* pSample)
+{
+	pSample->bValid = g_bHwProfiling && Nn_ReadHwCounters(pSample->anValue);
+	pSample->nTicks = Nn_GetProfileTicks();
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_StopHwProfile                                                 */
+/* Purpose:  Adds the hardware counter differences since Nn_StartHwProfile to */
+/*           the net or load counters of the net                              */
+/* Remarks:  The ticks are only added for NN_PROF_LOAD, the ticks of the      */
+/*           processing calls are counted per layer.                          */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_StopHwProfile (NN_PNET pNet, int iKind, int nNumPixels, const NN_HW_SAMPLE* pSample)
+{
+	NN_COUNTER  anValue[NN_HW_NUM_COUNTERS];
+	NN_COUNTER  nTicks;
+	NN_PROFILE* pProfile;
+
+	nTicks = Nn_GetProfileTicks() - pSample->nTicks;
+	if (pNet == NULL || Nn_GetProfileData(pNet) == NULL)
+		return;
+
+	pProfile = pNet->aProfile + NN_PROF_INDEX(pNet, iKind);
+	pProfile->nNumCalls  += 1;
+	pProfile->nNumPixels += nNumPixels;
+	if (iKind == NN_PROF_LOAD)
+		pProfile->nNumTicks += nTicks;
+
+	if (!pSample->bValid || !Nn_ReadHwCounters(anValue))
+		return;
+
+	pProfile->nNumInstrs    += anValue[0] - pSample->anValue[0];
+	pProfile->nNumCycles    += anValue[1] - pSample->anValue[1];
+	pProfile->nNumL1dMisses += anValue[2] - pSample->anValue[2];
+	pProfile->nNumLlcMisses += anValue[3] - pSample->anValue[3];
+	pProfile->nNumBrMisses  += anValue[4] - pSample->anValue[4];
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetMemoryStats                                                */
+/* Purpose:  Gets the heap memory held by a net object                        */
+/* Remarks:  Follows the allocations of NnBase.c: one block per layer array,  */
+/*           unit array, connection array and matrix. The connections of a    */
+/*           frozen net exist only as compact connections.                    */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_GetMemoryStats (const NN_PNET pNet, NN_MEMORY_STATS* pStats)
+{
+	NN_PLAYER pLayer;
+	NN_PUNIT  pUnit;
+	size_t    nNumConns, nTableBytes, nArenaUsed;
+	short     iL, iU;
+
+	assert(pNet != NULL);
+	assert(pStats != NULL);
+
+	memset(pStats, 0, sizeof (NN_MEMORY_STATS));
+
+	pStats->nNetBytes  = sizeof (NN_NET);
+	pStats->nNumAllocs = 1;
+
+	/* Bytes of the structures within the arena */
+	nArenaUsed = 0;
+	if (pNet->pArenaBlock != NULL)
+	{
+		pStats->nArenaBytes = pNet->nArenaSize + NN_ARENA_ALIGN;
+		pStats->nNumAllocs++;
+	}
+
+	if (pNet->aLayers != NULL)
+	{
+		pStats->nLayerBytes = pNet->na.nNumLayers * sizeof (NN_LAYER);
+		Nn_CountMemoryBlock(pNet, pNet->aLayers, pStats->nLayerBytes, &nArenaUsed, pStats);
+
+		for (iL = 0; iL < pNet->na.nNumLayers; iL++)
+		{
+			pLayer = pNet->aLayers + iL;
+			if (pLayer->aUnits == NULL)
+				continue;
+
+			pStats->nUnitBytes += pLayer->la.nNumUnits * sizeof (NN_UNIT);
+			pStats->nNumUnits  += pLayer->la.nNumUnits;
+			Nn_CountMemoryBlock(pNet, pLayer->aUnits, pLayer->la.nNumUnits * sizeof (NN_UNIT), &nArenaUsed, pStats);
+
+			for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+			{
+				pUnit     = pLayer->aUnits + iU;
+				nNumConns = pUnit->ua.nNumConns;
+				if (pUnit->aConns != NULL || pNet->bFrozen)
+				{
+					pStats->nParamBytes += nNumConns * sizeof (NN_FLOAT);
+					pStats->nNumConns   += (long) nNumConns;
+				}
+				if (pUnit->aConns != NULL)
+				{
+					pStats->nConnBytes  += nNumConns * sizeof (NN_CONN);
+					Nn_CountMemoryBlock(pNet, pUnit->aConns, nNumConns * sizeof (NN_CONN), &nArenaUsed, pStats);
+				}
+				if (pUnit->ppfMatrix != NULL)
+				{
+					pStats->nMatrixBytes += Nn_GetMatrixSize(pUnit->ua.nNumConns);
+					pStats->nParamBytes  += nNumConns * nNumConns * sizeof (NN_FLOAT);
+					Nn_CountMemoryBlock(pNet, pUnit->ppfMatrix, Nn_GetMatrixSize(pUnit->ua.nNumConns), &nArenaUsed, pStats);
+				}
+			}
+		}
+	}
+
+	if (pNet->afConnWeight != NULL)
+	{
+		/* The weights and source units in the view of a mapped file are */
+		/* no heap memory. The weights come first, unless in the view.   */
+		nTableBytes = 0;
+		if (!Nn_IsViewBlock(pNet, pNet->afConnWeight))
+			nTableBytes += pStats->nNumConns * sizeof (NN_FLOAT);
+		if (pNet->anConnSrc16 != NULL)
+			nTableBytes += pStats->nNumConns * sizeof (unsigned short);
+		else if (!Nn_IsViewBlock(pNet, pNet->anConnSrc32))
+			nTableBytes += pStats->nNumConns * sizeof (unsigned int);
+		pStats->nPlanBytes += nTableBytes;
+		if (nTableBytes > 0)
+			Nn_CountMemoryBlock(pNet, Nn_IsViewBlock(pNet, pNet->afConnWeight) ? 
+				(const void*) pNet->anConnSrc32 : (const void*) pNet->afConnWeight, nTableBytes, &nArenaUsed, pStats);
+	}
+	if (pNet->afBatch != NULL)
+	{
+		pStats->nCacheBytes += Nn_GetBatchBufferSize(pNet);
+		pStats->nNumAllocs++;
+	}
+	if (pNet->aProfile != NULL)
+	{
+		pStats->nCacheBytes += (pNet->na.nNumLayers + 2) * sizeof (NN_PROFILE);
+		pStats->nNumAllocs++;
+	}
+
+	pStats->nTotalBytes = pStats->nNetBytes + pStats->nLayerBytes + pStats->nUnitBytes + pStats->nConnBytes + 
+	                      pStats->nMatrixBytes + pStats->nPlanBytes + pStats->nCacheBytes + 
+	                      pStats->nArenaBytes - nArenaUsed;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CountMemoryBlock                                              */
+/* Purpose:  Counts a block of the net either as part of the arena or as a    */
+/*           heap block of its own                                            */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_CountMemoryBlock
+(
+	const NN_PNET     pNet,
+	const void*       pBlock,
+	size_t            nSize,
+	size_t*           pnArenaUsed,
+	NN_MEMORY_STATS*  pStats
+)
+{
+	if (Nn_IsArenaBlock(pNet, pBlock))
+		*pnArenaUsed += nSize;
+	else if (pBlock != NULL)
+		pStats->nNumAllocs++;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_InitLayerProfile                                              */
+/* Purpose:  Computes the static costs per pixel of a layer                   */
+/* Remarks:  Each connection counts as a multiply-add, unless the input       */
+/*           function is NN_FUNC_ZERO. Transcendental calls are counted for   */
+/*           the sigmoid activation, the exponential and logarithmic output   */
+/*           functions and the corresponding I/O transforms.                  */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_InitLayerProfile (NN_PNET pNet, int iL, NN_PROFILE* pProfile)
+{
+	NN_PLAYER pLayer;
+	NN_PUNIT  pUnit;
+	short     iU;
+
+	pLayer = pNet->aLayers + iL;
+
+	for (iU = 0; iU < pLayer->la.nNumUnits; iU++)
+	{
+		pUnit = pLayer->aUnits + iU;
+
+		if (pLayer->la.nInpFnId != NN_FUNC_ZERO)
+			pProfile->nMacsPerPixel += pUnit->ua.nNumConns;
+
+		if (pLayer->la.nActFnId == NN_FUNC_SIGMOID_1)
+			pProfile->nTransPerPixel++;
+
+		if (pLayer->la.nOutFnId == NN_FUNC_EXPONENTIAL ||
+			pLayer->la.nOutFnId == NN_FUNC_LOGARITHMIC)
+			pProfile->nTransPerPixel++;
+
+		if ((iL == pNet->na.iInpLayer || iL == pNet->na.iOutLayer) &&
+			(pUnit->ua.nTrnFnId == NN_FUNC_EXPONENTIAL ||
+			 pUnit->ua.nTrnFnId == NN_FUNC_LOGARITHMIC))
+			pProfile->nTransPerPixel++;
+	}
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,233 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnProf.h                                                      */
+/* Purpose:     Interface def. file for the neural net profiling routines     */
+/* Remarks:     Implemented in NnProf.c                                       */
+/*              The counters are only maintained if the library is compiled   */
+/*              with NN_PROFILING defined (see 'make profile'), otherwise the */
+/*              counting code is not compiled into the processing routines    */
+/*              and all counters stay zero.                                   */
+/*              The hardware counters (instructions, cycles, cache and branch */
+/*              misses) are read via perf_event_open on Linux and have to be  */
+/*              switched on with Nn_SetHwProfiling. Where the counters are    */
+/*              not permitted, e.g. in containers, they stay zero.            */
+/*              The memory statistics (Nn_GetMemoryStats) are always          */
+/*              available.                                                    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The counter type, at least 64 bits */
+#ifdef _MSC_VER
+typedef unsigned __int64    NN_COUNTER;
+#else
+typedef unsigned long long  NN_COUNTER;
+#endif
+
+/* Special indexes for Nn_GetProfile */
+#define NN_PROF_NET   -1   /* The whole net                                     */
+#define NN_PROF_LOAD  -2   /* Loading the net (Nn_CreateNetFrom*File)           */
+
+/* Hardware counters, see Nn_GetHwCounterMask */
+#define NN_HW_INSTRS       0x01
+#define NN_HW_CYCLES       0x02
+#define NN_HW_L1D_MISSES   0x04
+#define NN_HW_LLC_MISSES   0x08
+#define NN_HW_BR_MISSES    0x10
+#define NN_HW_NUM_COUNTERS 5
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_PROFILE                                                        */
+/* Purpose: Profiling counters of a single layer or of the whole net          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnProfile
+{
+	NN_COUNTER  nNumCalls;      /* Number of evaluations (pixels or blocks)   */
+	NN_COUNTER  nNumPixels;     /* Number of evaluated pixels                 */
+	NN_COUNTER  nNumTicks;      /* Elapsed time, see Nn_GetProfileTickUnit    */
+	NN_COUNTER  nNumMacs;       /* Number of multiply-add operations          */
+	NN_COUNTER  nNumTrans;      /* Number of transcendental calls (exp, log)  */
+	NN_COUNTER  nMacsPerPixel;  /* Multiply-adds per pixel (static costs)     */
+	NN_COUNTER  nTransPerPixel; /* Transcendental calls per pixel (static costs) */
+	NN_COUNTER  nNumInstrs;     /* Retired instructions                       */
+	NN_COUNTER  nNumCycles;     /* CPU cycles                                 */
+	NN_COUNTER  nNumL1dMisses;  /* L1 data cache read misses                  */
+	NN_COUNTER  nNumLlcMisses;  /* Last level cache misses                    */
+	NN_COUNTER  nNumBrMisses;   /* Mispredicted branches                      */
+}
+NN_PROFILE;
+
+/* A hardware counter reading, internal use (see NN_HWPROF_START) */
+typedef struct SNnHwSample
+{
+	NN_COUNTER  anValue[NN_HW_NUM_COUNTERS];
+	NN_COUNTER  nTicks;
+	BOOL        bValid;
+}
+NN_HW_SAMPLE;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_MEMORY_STATS                                                   */
+/* Purpose: Heap memory held by a net object, see Nn_GetMemoryStats           */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnMemoryStats
+{
+	size_t  nNetBytes;      /* The net structure                            */
+	size_t  nLayerBytes;    /* The layer structures                         */
+	size_t  nUnitBytes;     /* The unit structures                          */
+	size_t  nConnBytes;     /* The connection structures                    */
+	size_t  nMatrixBytes;   /* The inverse co-variance matrices             */
+	size_t  nPlanBytes;     /* Compiled plans, e.g. the compact connections */
+	size_t  nCacheBytes;    /* Work buffer of the batch routines, profiling counters */
+	size_t  nArenaBytes;    /* The arena (see Nn_CreateArena), holding the  */
+	                        /* structures above that were allocated from it */
+	size_t  nTotalBytes;    /* Sum of all of the above, the arena counted once */
+	size_t  nParamBytes;    /* Thereof weights and matrix elements          */
+	long    nNumAllocs;     /* Number of heap blocks                        */
+	long    nNumUnits;      /* Number of units                              */
+	long    nNumConns;      /* Number of connections                        */
+}
+NN_MEMORY_STATS;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IsProfilingEnabled                                            */
+/* Purpose:  Checks whether the library has been compiled with NN_PROFILING   */
+/* Returns:  TRUE if the counters are maintained, FALSE otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsProfilingEnabled (void);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetProfileTickUnit                                            */
+/* Purpose:  Gets the unit of the nNumTicks counter                           */
+/* Returns:  "cycles" if the time stamp counter of the CPU is used, "ns"      */
+/*           otherwise                                                        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+PCSTR Nn_GetProfileTickUnit (void);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetProfile                                                    */
+/* Purpose:  Gets the profiling counters of a layer or of the whole net       */
+/* Remarks:  If iL is NN_PROF_NET, the counters of all layers are summed up   */
+/*           and the hardware counters of the processing calls are given.     */
+/*           If iL is NN_PROF_LOAD, the ticks and hardware counters of        */
+/*           loading the net are given. The hardware counters are only        */
+/*           collected for the net as a whole, not per layer.                 */
+/*           The counters are reset by Nn_ResetProfile and by                 */
+/*           Nn_AssertSemanticIntegrity.                                      */
+/* Returns:  NN_OK (or zero) for success, NN_INVALID_ATTRIBUTE if the layer   */
+/*           index is invalid                                                 */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_GetProfile
+(
+	const NN_PNET  pNet,     /* The neural net object          */
+	int            iL,       /* Layer index, NN_PROF_NET or NN_PROF_LOAD */
+	NN_PROFILE*    pProfile  /* Receives the counters          */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ResetProfile                                                  */
+/* Purpose:  Sets all profiling counters of the net to zero                   */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_ResetProfile (NN_PNET pNet);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_SetHwProfiling                                                */
+/* Purpose:  Switches the collection of the hardware counters on or off       */
+/* Remarks:  Off by default, since reading the counters costs two system      */
+/*           calls per processing call. The counters are opened per thread    */
+/*           with the first processing call of the thread.                    */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_SetHwProfiling (BOOL bEnable);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetHwCounterMask                                              */
+/* Purpose:  Gets the hardware counters available to the calling thread       */
+/* Remarks:  Opens the counters of the thread if not done yet.                */
+/* Returns:  A combination of the NN_HW_ flags, zero if no counters are       */
+/*           available (see Nn_GetHwCounterStatus)                            */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+int Nn_GetHwCounterMask (void);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetHwCounterStatus                                            */
+/* Purpose:  Gets a description of the hardware counter availability, e.g.    */
+/*           the reason why perf_event_open failed                            */
+/* Remarks:  The status is that of the calling thread.                        */
+/* Returns:  A static string                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+PCSTR Nn_GetHwCounterStatus (void);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CloseHwCounters                                               */
+/* Purpose:  Closes the hardware counters of the calling thread               */
+/* Remarks:  The counters are opened per thread with its first profiled call  */
+/*           and hold a file descriptor per counter. A thread which has done  */
+/*           profiled calls should call this function before it ends, else    */
+/*           the descriptors are leaked. The counters are opened again if     */
+/*           the thread uses them afterwards.                                 */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_CloseHwCounters (void);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetMemoryStats                                                */
+/* Purpose:  Gets the heap memory held by a net object                        */
+/* Remarks:  The sizes are those requested from the allocator, its own        */
+/*           overhead per heap block (typically 8 to 16 bytes) is not         */
+/*           included. The caches are allocated with the first batch call     */
+/*           and with profiling, so they are zero for a freshly loaded net.   */
+/*           Structures allocated from the arena of the net are counted by    */
+/*           their kind and do not count as heap blocks of their own.         */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_GetMemoryStats
+(
+	const NN_PNET     pNet,    /* The neural net object */
+	NN_MEMORY_STATS*  pStats   /* Receives the statistics */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Internal use by the processing routines (see NnProc.c)                     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_COUNTER Nn_GetProfileTicks (void);
+void Nn_AddLayerProfile (NN_PNET pNet, int iL, int nNumPixels, NN_COUNTER nNumTicks);
+void Nn_StartHwProfile (NN_HW_SAMPLE* pSample);
+void Nn_StopHwProfile (NN_PNET pNet, int iKind, int nNumPixels, const NN_HW_SAMPLE* pSample);
+
+#ifdef NN_PROFILING
+#define NN_PROF_DECL(t)               NN_COUNTER t;
+#define NN_PROF_START(t)              (t) = Nn_GetProfileTicks();
+#define NN_PROF_STOP(pNet, iL, n, t)  Nn_AddLayerProfile((pNet), (iL), (n), Nn_GetProfileTicks() - (t));
+#define NN_HWPROF_DECL(s)                   NN_HW_SAMPLE s;
+#define NN_HWPROF_START(s)                  Nn_StartHwProfile(&(s));
+#define NN_HWPROF_STOP(pNet, iKind, n, s)   Nn_StopHwProfile((pNet), (iKind), (n), &(s));
+#else
+#define NN_PROF_DECL(t)
+#define NN_PROF_START(t)
+#define NN_PROF_STOP(pNet, iL, n, t)
+#define NN_HWPROF_DECL(s)
+#define NN_HWPROF_START(s)
+#define NN_HWPROF_STOP(pNet, iKind, n, s)
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+/* EOF ///////////////////////////////////////////////////////////////////////*/
+
@@ -0,0 +1,515 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnReg.c                                                       */
+/* Purpose:     Implementation of the shared neural net registry              */
+/* Remarks:     Interface def. in NnReg.h                                     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#if !defined(_MSC_VER) && !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE 500 /* For realpath */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "NnBase.h"
+#include "NnProf.h"
+#include "NnBinIO.h"
+#include "NnReg.h"
+
+#if defined(_MSC_VER)
+#define NN_PATH_MAX  _MAX_PATH
+#elif defined(PATH_MAX)
+#define NN_PATH_MAX  PATH_MAX
+#else
+#define NN_PATH_MAX  4096
+#endif
+
+/* FNV-1a parameters (64 bit) */
+#define NN_FNV_BASIS  ((NN_HASH) 0xcbf29ce4UL << 32 | (NN_HASH) 0x84222325UL)
+#define NN_FNV_PRIME  ((NN_HASH) 0x00000100UL << 32 | (NN_HASH) 0x000001b3UL)
+
+/* Size of the read buffer for hashing a file */
+#define NN_HASH_BUF_SIZE  8192
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Module local prototypes:                                                   */
+/*                                                                            */
+
+NN_STATUS      Nn_GetCanonicalPath (PCSTR pchFilePath, char* pchPath);
+NN_STATUS      Nn_HashFile (PCSTR pchPath, NN_HASH* pnHash);
+NN_STATUS      Nn_CheckRegUnits (const NN_PNET pNet, int nNumInpUnits, int nNumOutUnits);
+NN_REG_ENTRY*  Nn_FindRegEntry (NN_REGISTRY* pReg, PCSTR pchPath, long nFileSize, long nFileTime);
+NN_REG_ENTRY*  Nn_FindRegEntryByHash (NN_REGISTRY* pReg, long nFileSize, NN_HASH nHash);
+void           Nn_AddRegAlias (NN_REG_ENTRY* pEntry, PCSTR pchPath, long nFileSize, long nFileTime);
+void           Nn_UpdateRegBytes (NN_REG_ENTRY* pEntry);
+void           Nn_EvictRegNets (NN_REGISTRY* pReg);
+void           Nn_DeleteRegEntry (NN_REG_ENTRY* pEntry);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CreateRegistry                                                */
+/* Purpose:  Creates an empty net registry                                    */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateRegistry (size_t nBudget, NN_REGISTRY** ppReg)
+{
+	assert(ppReg != NULL);
+
+	*ppReg = (NN_REGISTRY*) Nn_Alloc(sizeof (NN_REGISTRY));
+	if (*ppReg == NULL)
+		return Nn_SetOutOfMemoryError();
+
+	(*ppReg)->nBudget = nBudget;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_DeleteRegistry                                                */
+/* Purpose:  Deletes the registry and all of its nets                         */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_DeleteRegistry (NN_REGISTRY* pReg)
+{
+	NN_REG_ENTRY* pEntry;
+
+	if (pReg == NULL)
+		return;
+
+	while (pReg->pFirst != NULL)
+	{
+		pEntry = pReg->pFirst;
+		pReg->pFirst = pEntry->pNext;
+		Nn_DeleteRegEntry(pEntry);
+	}
+	Nn_Free(pReg);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_AcquireNet                                                    */
+/* Purpose:  Gets a handle of the net of a binary NNFF file                   */
+/* Remarks:  The cheap checks come first: the path with the size and time of  */
+/*           the file, then the content hash, which needs the file to be read */
+/*           once, and only then the file is loaded. A hash hit is recorded   */
+/*           as alias, so the next acquire of the file finds it by its path.  */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_AcquireNet
+(
+	NN_REGISTRY*  pReg,
+	PCSTR         pchFilePath,
+	int           nNumInpUnits,
+	int           nNumOutUnits,
+	NN_HNET*      phNet
+)
+{
+	NN_STATUS     nns;
+	NN_REG_ENTRY* pEntry;
+	NN_PNET       pNet;
+	NN_HASH       nHash;
+	struct stat   fileStat;
+	char          achPath[NN_PATH_MAX];
+
+	assert(pReg != NULL);
+	assert(pchFilePath != NULL);
+	assert(phNet != NULL);
+
+	*phNet = NULL;
+	pNet   = NULL;
+	nHash  = 0;
+	Nn_ClearError();
+
+	nns = Nn_GetCanonicalPath(pchFilePath, achPath);
+	if (nns != NN_OK)
+		return nns;
+	if (stat(achPath, &fileStat) != 0)
+		return Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't open binary file '%s' for read", pchFilePath);
+
+	/* The same file as before */
+	pEntry = Nn_FindRegEntry(pReg, achPath, (long) fileStat.st_size, (long) fileStat.st_mtime);
+	if (pEntry == NULL)
+	{
+		/* The same content as another file, e.g. a copy */
+		nns = Nn_HashFile(achPath, &nHash);
+		if (nns != NN_OK)
+			return nns;
+		pEntry = Nn_FindRegEntryByHash(pReg, (long) fileStat.st_size, nHash);
+		if (pEntry != NULL)
+			Nn_AddRegAlias(pEntry, achPath, (long) fileStat.st_size, (long) fileStat.st_mtime);
+	}
+
+	if (pEntry != NULL)
+	{
+		nns = Nn_CheckRegUnits(pEntry->pNet, nNumInpUnits, nNumOutUnits);
+		if (nns != NN_OK)
+			return nns;
+		pReg->nNumHits++;
+	}
+	else
+	{
+		nns = Nn_CreateNetFromBinFile(achPath, -1, -1, &pNet);
+		if (nns == NN_OK)
+			nns = Nn_CheckRegUnits(pNet, nNumInpUnits, nNumOutUnits);
+		if (nns != NN_OK)
+		{
+			Nn_DeleteNet(pNet);
+			return nns;
+		}
+
+		pEntry = (NN_REG_ENTRY*) Nn_Alloc(sizeof (NN_REG_ENTRY));
+		if (pEntry != NULL)
+			pEntry->pchPath = (char*) Nn_Alloc(strlen(achPath) + 1);
+		if (pEntry == NULL || pEntry->pchPath == NULL)
+		{
+			Nn_Free(pEntry);
+			Nn_DeleteNet(pNet);
+			return Nn_SetOutOfMemoryError();
+		}
+		strcpy(pEntry->pchPath, achPath);
+		pEntry->pReg      = pReg;
+		pEntry->nFileSize = (long) fileStat.st_size;
+		pEntry->nFileTime = (long) fileStat.st_mtime;
+		pEntry->nHash     = nHash;
+		pEntry->pNet      = pNet;
+		pEntry->pNext     = pReg->pFirst;
+		pReg->pFirst = pEntry;
+		pReg->nNumLoads++;
+		Nn_UpdateRegBytes(pEntry);
+	}
+
+	pEntry->nRefCount++;
+	pEntry->nLastUse = ++pReg->nTick;
+	Nn_EvictRegNets(pReg);
+
+	*phNet = pEntry;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_UseNet                                                        */
+/* Purpose:  Gets the net of a handle for processing                          */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_UseNet (NN_HNET hNet, NN_PNET* ppNet)
+{
+	NN_STATUS nns;
+
+	assert(hNet != NULL);
+	assert(hNet->nRefCount > 0);
+	assert(ppNet != NULL);
+
+	*ppNet = NULL;
+
+	/* Compile the net with its first use */
+	if (!hNet->pNet->bFrozen)
+	{
+		nns = Nn_FreezeNet(hNet->pNet);
+		if (nns != NN_OK)
+			return nns;
+		Nn_UpdateRegBytes(hNet);
+	}
+
+	hNet->nLastUse = ++hNet->pReg->nTick;
+	*ppNet = hNet->pNet;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReleaseNet                                                    */
+/* Purpose:  Releases a handle given out by Nn_AcquireNet                     */
+/* Remarks:  The heap memory of the net is updated first, since the batch     */
+/*           routines may have allocated their work buffer in the meantime.   */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_ReleaseNet (NN_HNET hNet)
+{
+	if (hNet == NULL)
+		return;
+
+	assert(hNet->nRefCount > 0);
+
+	hNet->nRefCount--;
+	Nn_UpdateRegBytes(hNet);
+	Nn_EvictRegNets(hNet->pReg);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetRegistryStats                                              */
+/* Purpose:  Gets the statistics of a registry                                */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_GetRegistryStats (const NN_REGISTRY* pReg, NN_REGISTRY_STATS* pStats)
+{
+	NN_REG_ENTRY* pEntry;
+
+	assert(pReg != NULL);
+	assert(pStats != NULL);
+
+	memset(pStats, 0, sizeof (NN_REGISTRY_STATS));
+	for (pEntry = pReg->pFirst; pEntry != NULL; pEntry = pEntry->pNext)
+	{
+		pStats->nNumNets++;
+		if (pEntry->nRefCount > 0)
+			pStats->nNumUsed++;
+	}
+	pStats->nBytes      = pReg->nBytes;
+	pStats->nNumLoads   = pReg->nNumLoads;
+	pStats->nNumHits    = pReg->nNumHits;
+	pStats->nNumEvicted = pReg->nNumEvicted;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetCanonicalPath                                              */
+/* Purpose:  Gets the absolute path of a file without links, '.' and '..'     */
+/* Remarks:  pchPath must hold NN_PATH_MAX characters.                        */
+/* Returns:  NN_OK (or zero) for success, NN_CANT_OPEN_FILE otherwise         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_GetCanonicalPath (PCSTR pchFilePath, char* pchPath)
+{
+#if defined(_MSC_VER)
+	if (_fullpath(pchPath, pchFilePath, NN_PATH_MAX) == NULL)
+#else
+	if (realpath(pchFilePath, pchPath) == NULL)
+#endif
+		return Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't open binary file '%s' for read", pchFilePath);
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_HashFile                                                      */
+/* Purpose:  Computes the 64 bit FNV-1a hash of the content of a file         */
+/* Returns:  NN_OK (or zero) for success, NN_CANT_OPEN_FILE or                */
+/*           NN_FILE_READ_ERROR otherwise                                     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_HashFile (PCSTR pchPath, NN_HASH* pnHash)
+{
+	FILE*         pFile;
+	unsigned char aBuf[NN_HASH_BUF_SIZE];
+	size_t        nRead, i;
+	NN_HASH       nHash;
+
+	pFile = fopen(pchPath, "rb");
+	if (pFile == NULL)
+		return Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't open binary file '%s' for read", pchPath);
+
+	nHash = NN_FNV_BASIS;
+	while ((nRead = fread(aBuf, 1, sizeof (aBuf), pFile)) > 0)
+	{
+		for (i = 0; i < nRead; i++)
+			nHash = (nHash ^ aBuf[i]) * NN_FNV_PRIME;
+	}
+	if (ferror(pFile))
+	{
+		fclose(pFile);
+		return Nn_Error(NN_FILE_READ_ERROR, NN_ERR_PREFIX "reading from '%s' failed!", pchPath);
+	}
+	fclose(pFile);
+
+	*pnHash = nHash;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CheckRegUnits                                                 */
+/* Purpose:  Checks the number of input and output units of a registry net    */
+/*           like Nn_AssertSemanticIntegrity                                  */
+/* Returns:  NN_OK (or zero) for success, NN_INVALID_ATTRIBUTE otherwise      */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CheckRegUnits (const NN_PNET pNet, int nNumInpUnits, int nNumOutUnits)
+{
+	if (nNumInpUnits > 0 && pNet->aLayers[pNet->na.iInpLayer].la.nNumUnits != nNumInpUnits)
+		return Nn_Error(NN_INVALID_ATTRIBUTE,
+			NN_ERR_PREFIX "L[%d]: invalid number of input units: %d (%d expected)",
+			pNet->na.iInpLayer, pNet->aLayers[pNet->na.iInpLayer].la.nNumUnits, nNumInpUnits);
+
+	if (nNumOutUnits > 0 && pNet->aLayers[pNet->na.iOutLayer].la.nNumUnits != nNumOutUnits)
+		return Nn_Error(NN_INVALID_ATTRIBUTE,
+			NN_ERR_PREFIX "L[%d]: invalid number of output units: %d (%d expected)",
+			pNet->na.iOutLayer, pNet->aLayers[pNet->na.iOutLayer].la.nNumUnits, nNumOutUnits);
+
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_FindRegEntry                                                  */
+/* Purpose:  Finds the entry of a file by its canonical path, size and time   */
+/* Remarks:  The aliases of the entries are searched as well.                 */
+/* Returns:  The entry, NULL if not found                                     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_REG_ENTRY* Nn_FindRegEntry (NN_REGISTRY* pReg, PCSTR pchPath, long nFileSize, long nFileTime)
+{
+	NN_REG_ENTRY* pEntry;
+	NN_REG_ALIAS* pAlias;
+
+	for (pEntry = pReg->pFirst; pEntry != NULL; pEntry = pEntry->pNext)
+	{
+		if (pEntry->nFileSize == nFileSize &&
+			pEntry->nFileTime == nFileTime &&
+			strcmp(pEntry->pchPath, pchPath) == 0)
+			return pEntry;
+
+		for (pAlias = pEntry->pAliases; pAlias != NULL; pAlias = pAlias->pNext)
+		{
+			if (pAlias->nFileSize == nFileSize &&
+				pAlias->nFileTime == nFileTime &&
+				strcmp(pAlias->pchPath, pchPath) == 0)
+				return pEntry;
+		}
+	}
+	return NULL;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_FindRegEntryByHash                                            */
+/* Purpose:  Finds the entry of a file by its size and content hash           */
+/* Returns:  The entry, NULL if not found                                     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_REG_ENTRY* Nn_FindRegEntryByHash (NN_REGISTRY* pReg, long nFileSize, NN_HASH nHash)
+{
+	NN_REG_ENTRY* pEntry;
+
+	for (pEntry = pReg->pFirst; pEntry != NULL; pEntry = pEntry->pNext)
+	{
+		if (pEntry->nFileSize == nFileSize && pEntry->nHash == nHash)
+			return pEntry;
+	}
+	return NULL;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_AddRegAlias                                                   */
+/* Purpose:  Records a file found by its content hash with an entry, so that  */
+/*           Nn_FindRegEntry finds it without hashing it again                */
+/* Remarks:  A known path gets the new size and time, e.g. the file of the    */
+/*           entry itself after a touch. If out of memory, the file is just   */
+/*           not recorded and hashed again with the next acquire.             */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_AddRegAlias (NN_REG_ENTRY* pEntry, PCSTR pchPath, long nFileSize, long nFileTime)
+{
+	NN_REG_ALIAS* pAlias;
+
+	if (strcmp(pEntry->pchPath, pchPath) == 0)
+	{
+		pEntry->nFileSize = nFileSize;
+		pEntry->nFileTime = nFileTime;
+		return;
+	}
+
+	for (pAlias = pEntry->pAliases; pAlias != NULL; pAlias = pAlias->pNext)
+	{
+		if (strcmp(pAlias->pchPath, pchPath) == 0)
+			break;
+	}
+
+	if (pAlias == NULL)
+	{
+		pAlias = (NN_REG_ALIAS*) Nn_Alloc(sizeof (NN_REG_ALIAS));
+		if (pAlias != NULL)
+			pAlias->pchPath = (char*) Nn_Alloc(strlen(pchPath) + 1);
+		if (pAlias == NULL || pAlias->pchPath == NULL)
+		{
+			Nn_Free(pAlias);
+			return;
+		}
+		strcpy(pAlias->pchPath, pchPath);
+		pAlias->pNext = pEntry->pAliases;
+		pEntry->pAliases = pAlias;
+	}
+
+	pAlias->nFileSize = nFileSize;
+	pAlias->nFileTime = nFileTime;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_UpdateRegBytes                                                */
+/* Purpose:  Updates the heap memory of an entry and of its registry          */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_UpdateRegBytes (NN_REG_ENTRY* pEntry)
+{
+	NN_MEMORY_STATS stats;
+
+	Nn_GetMemoryStats(pEntry->pNet, &stats);
+	pEntry->pReg->nBytes -= pEntry->nBytes;
+	pEntry->nBytes = stats.nTotalBytes;
+	pEntry->pReg->nBytes += pEntry->nBytes;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_EvictRegNets                                                  */
+/* Purpose:  Deletes the least recently used unreferenced nets until the      */
+/*           registry is within its budget                                    */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_EvictRegNets (NN_REGISTRY* pReg)
+{
+	NN_REG_ENTRY** ppEntry;
+	NN_REG_ENTRY** ppOldest;
+	NN_REG_ENTRY*  pEntry;
+
+	if (pReg->nBudget == 0)
+		return;
+
+	while (pReg->nBytes > pReg->nBudget)
+	{
+		ppOldest = NULL;
+		for (ppEntry = &pReg->pFirst; *ppEntry != NULL; ppEntry = &(*ppEntry)->pNext)
+		{
+			if ((*ppEntry)->nRefCount == 0 &&
+				(ppOldest == NULL || (*ppEntry)->nLastUse < (*ppOldest)->nLastUse))
+				ppOldest = ppEntry;
+		}
+		/* Only referenced nets left */
+		if (ppOldest == NULL)
+			return;
+
+		pEntry = *ppOldest;
+		*ppOldest = pEntry->pNext;
+		pReg->nBytes -= pEntry->nBytes;
+		pReg->nNumEvicted++;
+		Nn_DeleteRegEntry(pEntry);
+	}
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_DeleteRegEntry                                                */
+/* Purpose:  Deletes an entry (already unlinked) with its net and aliases     */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_DeleteRegEntry (NN_REG_ENTRY* pEntry)
+{
+	NN_REG_ALIAS* pAlias;
+
+	while (pEntry->pAliases != NULL)
+	{
+		pAlias = pEntry->pAliases;
+		pEntry->pAliases = pAlias->pNext;
+		Nn_Free(pAlias->pchPath);
+		Nn_Free(pAlias);
+	}
+	Nn_DeleteNet(pEntry->pNet);
+	Nn_Free(pEntry->pchPath);
+	Nn_Free(pEntry);
+}
+
+/* EOF ///////////////////////////////////////////////////////////////////////*/
+
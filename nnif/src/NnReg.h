@@ -0,0 +1,177 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnReg.h                                                       */
+/* Purpose:     Interface def. file for the shared neural net registry        */
+/* Remarks:     Implemented in NnReg.c                                        */
+/*              A registry loads a binary NNFF file once and hands out the    */
+/*              net to all modules acquiring the same file, identified by its */
+/*              canonical path or by the hash of its content. The nets are    */
+/*              reference counted, frozen (see Nn_FreezeNet) with the first   */
+/*              use and kept after the last release until the memory budget   */
+/*              of the registry is exceeded, then the least recently used     */
+/*              unreferenced nets are deleted.                                */
+/*              A registry is not thread-safe, all calls for it have to be    */
+/*              serialized. The batch routines of a shared net must not be    */
+/*              called concurrently either, since they use the work buffer of */
+/*              the net.                                                      */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The hash type, at least 64 bits */
+#ifdef _MSC_VER
+typedef unsigned __int64    NN_HASH;
+#else
+typedef unsigned long long  NN_HASH;
+#endif
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_REG_ALIAS                                                      */
+/* Purpose: Another file of the same content as the file of an entry          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnRegAlias
+{
+	struct SNnRegAlias*  pNext;         /* Next alias of the entry            */
+	char*                pchPath;       /* Canonical path of the file         */
+	long                 nFileSize;     /* Size of the file in bytes          */
+	long                 nFileTime;     /* Modification time of the file      */
+}
+NN_REG_ALIAS;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_REG_ENTRY                                                      */
+/* Purpose: A net of the registry, its handle is NN_HNET                      */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnRegEntry
+{
+	struct SNnRegEntry*  pNext;         /* Next entry of the registry         */
+	struct SNnRegistry*  pReg;          /* The owning registry                */
+	char*                pchPath;       /* Canonical path of the file         */
+	long                 nFileSize;     /* Size of the file in bytes          */
+	long                 nFileTime;     /* Modification time of the file      */
+	NN_HASH              nHash;         /* Hash of the file content           */
+	NN_REG_ALIAS*        pAliases;      /* Files found by the content hash    */
+	NN_PNET              pNet;          /* The net                            */
+	long                 nRefCount;     /* Number of handles given out        */
+	unsigned long        nLastUse;      /* Tick of the last acquire or use    */
+	size_t               nBytes;        /* Heap memory held by the net        */
+}
+NN_REG_ENTRY, *NN_HNET;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_REGISTRY                                                       */
+/* Purpose: The registry, created by Nn_CreateRegistry                        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnRegistry
+{
+	NN_REG_ENTRY*  pFirst;       /* The entries, most recently added first   */
+	size_t         nBudget;      /* Memory budget in bytes, 0 for unlimited  */
+	size_t         nBytes;       /* Heap memory held by all nets             */
+	unsigned long  nTick;        /* Use counter for the LRU order            */
+	long           nNumLoads;    /* Number of nets loaded                    */
+	long           nNumHits;     /* Number of acquires served without a load */
+	long           nNumEvicted;  /* Number of nets deleted for the budget    */
+}
+NN_REGISTRY;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_REGISTRY_STATS                                                 */
+/* Purpose: Statistics of a registry, see Nn_GetRegistryStats                 */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnRegistryStats
+{
+	long    nNumNets;       /* Number of nets held                          */
+	long    nNumUsed;       /* Thereof referenced by handles                */
+	size_t  nBytes;         /* Heap memory held by the nets                 */
+	long    nNumLoads;      /* Number of nets loaded                        */
+	long    nNumHits;       /* Number of acquires served without a load     */
+	long    nNumEvicted;    /* Number of nets deleted for the budget        */
+}
+NN_REGISTRY_STATS;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CreateRegistry                                                */
+/* Purpose:  Creates an empty net registry                                    */
+/* Remarks:  nBudget is the heap memory in bytes (see Nn_GetMemoryStats) up   */
+/*           to which unreferenced nets are kept, 0 keeps all of them. Nets   */
+/*           referenced by handles are never deleted, so the budget can be    */
+/*           exceeded by them.                                                */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateRegistry (size_t nBudget, NN_REGISTRY** ppReg);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_DeleteRegistry                                                */
+/* Purpose:  Deletes the registry and all of its nets                         */
+/* Remarks:  All handles of the registry become invalid.                      */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_DeleteRegistry (NN_REGISTRY* pReg);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_AcquireNet                                                    */
+/* Purpose:  Gets a handle of the net of a binary NNFF file                   */
+/* Remarks:  The file is loaded with Nn_CreateNetFromBinFile unless the       */
+/*           registry already holds it: a file of the same canonical path,    */
+/*           size and modification time, or of the same size and content      */
+/*           hash (64 bit FNV-1a), e.g. a copy. The content is not compared   */
+/*           byte by byte, two files of the same size and hash are taken to   */
+/*           be the same. A file found by its hash is recorded as an alias of */
+/*           the entry, so it is not read and hashed again as long as its     */
+/*           size and modification time stay the same. As with                */
+/*           Nn_CreateNetFromBinFile, the number of input and output units    */
+/*           is checked unless passed as -1. The handle is released with      */
+/*           Nn_ReleaseNet, the net is obtained with Nn_UseNet.               */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_AcquireNet
+(
+	NN_REGISTRY*  pReg,          /* The registry                   */
+	PCSTR         pchFilePath,   /* Path of the binary NNFF file   */
+	int           nNumInpUnits,  /* Size of the input vector       */
+	int           nNumOutUnits,  /* Size of the output vector      */
+	NN_HNET*      phNet          /* Receives the handle            */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_UseNet                                                        */
+/* Purpose:  Gets the net of a handle for processing                          */
+/* Remarks:  The net is frozen with its first use. It is shared by all        */
+/*           handles of the file and must not be modified or deleted. It      */
+/*           remains valid until the handle is released.                      */
+/* Returns:  NN_OK (or zero) for success, NN_OUT_OF_MEMORY otherwise          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_UseNet (NN_HNET hNet, NN_PNET* ppNet);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReleaseNet                                                    */
+/* Purpose:  Releases a handle given out by Nn_AcquireNet                     */
+/* Remarks:  The net is kept while the registry is within its budget.         */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_ReleaseNet (NN_HNET hNet);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetRegistryStats                                              */
+/* Purpose:  Gets the statistics of a registry                                */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_GetRegistryStats (const NN_REGISTRY* pReg, NN_REGISTRY_STATS* pStats);
+
+
+#ifdef __cplusplus
+}
+#endif
+/* EOF ///////////////////////////////////////////////////////////////////////*/
+
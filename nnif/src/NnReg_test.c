@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NnBase.h"
+#include "NnCheck.h"
+#include "NnBinIO.h"
+#include "NnReg.h"
+
+int failures = 0;
+
+#define ASSERTI(E,A) if ((E)!=(A)) {failures++; printf("%s(%d): assertion failed: expected %d, but '%s' yield %d\n", __FILE__, __LINE__, (int)(E), #A, (int)(A));}
+#define ASSERTL(E,A) if ((E)!=(A)) {failures++; printf("%s(%d): assertion failed: expected %ld, but '%s' yield %ld\n", __FILE__, __LINE__, (long)(E), #A, (long)(A));}
+#define ASSERTT(A)   if (!(A)) {failures++; printf("%s(%d): assertion failed: '%s'\n", __FILE__, __LINE__, #A);}
+
+#define FILE_A "NnReg_test_a.nnf"
+#define FILE_B "NnReg_test_b.nnf"
+#define FILE_C "NnReg_test_c.nnf"
+#define FILE_D "NnReg_test_d.nnf"
+
+/*
+ * Writes a fully connected 3-layer net with nNumHidden hidden units to a
+ * binary NNFF file.
+ */
+void writeTestNet(const char* pchFile, int nNumHidden)
+{
+    NN_PNET   pNet;
+    NN_PLAYER pLayer;
+    NN_PUNIT  pUnit;
+    NN_PCONN  pConn;
+    short     anNumUnits[3];
+    short     iL, iU, iC;
+
+    anNumUnits[0] = 3;
+    anNumUnits[1] = (short) nNumHidden;
+    anNumUnits[2] = 2;
+
+    Nn_CreateNet(&pNet);
+    pNet->na.nNumLayers = 3;
+    Nn_CreateLayers(pNet);
+    for (iL = 0; iL < 3; iL++)
+    {
+        pLayer = Nn_GetLayerAt(pNet, iL);
+        pLayer->la.nNumUnits = anNumUnits[iL];
+        Nn_CreateUnits(pLayer);
+        for (iU = 0; iU < pLayer->la.nNumUnits && iL > 0; iU++)
+        {
+            pUnit = Nn_GetUnitAt(pLayer, iU);
+            pUnit->ua.nNumConns = anNumUnits[iL-1];
+            Nn_CreateConns(pUnit);
+            for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
+            {
+                pConn = Nn_GetConnAt(pUnit, iC);
+                pConn->ca.iLayer  = (short) (iL-1);
+                pConn->ca.iUnit   = iC;
+                pConn->ca.fWeight = 0.1 * (iU + 1) - 0.05 * iC;
+            }
+        }
+    }
+
+    if (Nn_AssertSemanticIntegrity(pNet, 3, 2) != NN_OK ||
+        Nn_WriteNetToBinFile(pchFile, pNet) != NN_OK)
+    {
+        printf("can't write %s: %s\n", pchFile, Nn_GetErrMsg());
+        exit(-1);
+    }
+    Nn_DeleteNet(pNet);
+}
+
+/*
+ * Copies a file, the copy has the same content but another path.
+ */
+void copyFile(const char* pchSrc, const char* pchDst)
+{
+    FILE* pSrc;
+    FILE* pDst;
+    int   ch;
+
+    pSrc = fopen(pchSrc, "rb");
+    pDst = fopen(pchDst, "wb");
+    if (pSrc == NULL || pDst == NULL)
+    {
+        printf("can't copy %s to %s\n", pchSrc, pchDst);
+        exit(-1);
+    }
+    while ((ch = getc(pSrc)) != EOF)
+        putc(ch, pDst);
+    fclose(pSrc);
+    fclose(pDst);
+}
+
+int main(int argc, char** argv)
+{
+    NN_REGISTRY*      pReg;
+    NN_REGISTRY_STATS stats;
+    NN_HNET           hNet1, hNet2, hNet3, hNetA, hNetC, hNetD;
+    NN_PNET           pNet1, pNet2;
+    size_t            nBytesA, nBytesC, nBytesD;
+
+    writeTestNet(FILE_A, 4);
+    copyFile(FILE_A, FILE_B);
+    writeTestNet(FILE_C, 8);
+    writeTestNet(FILE_D, 12);
+
+    /* Dedup by path and by content hash */
+    ASSERTI(NN_OK, Nn_CreateRegistry(0, &pReg));
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_A, 3, 2, &hNet1));
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, "./" FILE_A, -1, -1, &hNet2));
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_B, 3, -1, &hNet3));
+    ASSERTT(hNet1 != NULL && hNet1 == hNet2 && hNet1 == hNet3);
+    ASSERTL(3L, hNet1->nRefCount);
+    Nn_GetRegistryStats(pReg, &stats);
+    ASSERTL(1L, stats.nNumNets);
+    ASSERTL(1L, stats.nNumLoads);
+    ASSERTL(2L, stats.nNumHits);
+
+    /* The copy is recorded as alias, once, and found by its path again */
+    ASSERTT(hNet1->pAliases != NULL && hNet1->pAliases->pNext == NULL);
+    ASSERTT(hNet1->pAliases != NULL && strstr(hNet1->pAliases->pchPath, FILE_B) != NULL);
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_B, 3, 2, &hNet2));
+    ASSERTT(hNet2 == hNet1 && hNet1->pAliases->pNext == NULL);
+    Nn_ReleaseNet(hNet2);
+
+    /* All handles share the frozen net */
+    ASSERTI(NN_OK, Nn_UseNet(hNet1, &pNet1));
+    ASSERTI(NN_OK, Nn_UseNet(hNet3, &pNet2));
+    ASSERTT(pNet1 != NULL && pNet1 == pNet2 && pNet1->bFrozen);
+
+    /* A mismatch of the units fails without a handle, for a held and a new net */
+    hNet2 = hNet1;
+    ASSERTI(NN_INVALID_ATTRIBUTE, Nn_AcquireNet(pReg, FILE_A, 4, 2, &hNet2));
+    ASSERTT(hNet2 == NULL);
+    ASSERTI(NN_INVALID_ATTRIBUTE, Nn_AcquireNet(pReg, FILE_C, 3, 3, &hNet2));
+    ASSERTT(hNet2 == NULL);
+    Nn_GetRegistryStats(pReg, &stats);
+    ASSERTL(1L, stats.nNumNets);
+    ASSERTL(3L, hNet1->nRefCount);
+
+    /* Release, the net is kept without a budget */
+    Nn_ReleaseNet(hNet1);
+    Nn_ReleaseNet(hNet3);
+    ASSERTL(1L, hNet1->nRefCount);
+    Nn_ReleaseNet(hNet1);
+    Nn_GetRegistryStats(pReg, &stats);
+    ASSERTL(1L, stats.nNumNets);
+    ASSERTL(0L, stats.nNumUsed);
+    ASSERTL(0L, stats.nNumEvicted);
+
+    /* The sizes of the nets as loaded */
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_C, 3, 2, &hNetC));
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_D, 3, 2, &hNetD));
+    nBytesC = hNetC->nBytes;
+    nBytesD = hNetD->nBytes;
+    Nn_DeleteRegistry(pReg);
+    ASSERTI(NN_OK, Nn_CreateRegistry(0, &pReg));
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_A, 3, 2, &hNetA));
+    nBytesA = hNetA->nBytes;
+    Nn_DeleteRegistry(pReg);
+    ASSERTT(nBytesA > 0 && nBytesA < nBytesC && nBytesC < nBytesD);
+
+    /* LRU eviction: A and C fit, A is used again, D evicts C only */
+    ASSERTI(NN_OK, Nn_CreateRegistry(nBytesA + nBytesD + nBytesC / 2, &pReg));
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_A, 3, 2, &hNetA));
+    Nn_ReleaseNet(hNetA);
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_C, 3, 2, &hNetC));
+    Nn_ReleaseNet(hNetC);
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_A, 3, 2, &hNetA));
+    Nn_ReleaseNet(hNetA);
+    Nn_GetRegistryStats(pReg, &stats);
+    ASSERTL(2L, stats.nNumNets);
+    ASSERTL(0L, stats.nNumEvicted);
+    ASSERTL(nBytesA + nBytesC, stats.nBytes);
+
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_D, 3, 2, &hNetD));
+    Nn_GetRegistryStats(pReg, &stats);
+    ASSERTL(2L, stats.nNumNets);
+    ASSERTL(1L, stats.nNumEvicted);
+    ASSERTL(nBytesA + nBytesD, stats.nBytes);
+
+    /* A is still held by the registry, C has to be loaded again */
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_A, 3, 2, &hNetA));
+    Nn_GetRegistryStats(pReg, &stats);
+    ASSERTL(3L, stats.nNumLoads);
+    ASSERTI(NN_OK, Nn_AcquireNet(pReg, FILE_C, 3, 2, &hNetC));
+    Nn_GetRegistryStats(pReg, &stats);
+    ASSERTL(4L, stats.nNumLoads);
+
+    /* Referenced nets exceed the budget, they are deleted with the release */
+    ASSERTL(3L, stats.nNumNets);
+    ASSERTL(3L, stats.nNumUsed);
+    ASSERTT(stats.nBytes > pReg->nBudget);
+    Nn_ReleaseNet(hNetA);
+    Nn_ReleaseNet(hNetC);
+    Nn_ReleaseNet(hNetD);
+    Nn_GetRegistryStats(pReg, &stats);
+    ASSERTL(0L, stats.nNumUsed);
+    ASSERTT(stats.nBytes <= pReg->nBudget);
+    Nn_DeleteRegistry(pReg);
+
+    remove(FILE_A);
+    remove(FILE_B);
+    remove(FILE_C);
+    remove(FILE_D);
+
+    printf("%d failure(s)\n", failures);
+    return failures;
+}
@@ -0,0 +1,522 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnStream.c                                                    */
+/* Purpose:     Implementation of reading neural nets from byte streams       */
+/* Remarks:     Interface def. in NnStream.h                                  */
+/*              The stream is read by the parsers of the formats: the ASCII   */
+/*              scanner takes its lines from it, the binary NNFF 1.x reader   */
+/*              its sections (see Nn_ReadAscStreamNet, Nn_ReadBinStreamNet).  */
+/*              Each load has its own stream and buffer, so several threads   */
+/*              can read nets at once.                                        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "NnBase.h"
+#include "NnCheck.h"
+#include "NnProf.h"
+#include "NnTrace.h"
+#include "NnAscIO.h"
+#include "NnBinIO.h"
+#include "NnBin2IO.h"
+#include "NnStream.h"
+#include "utils/endian_order.h"
+
+#if defined(_MSC_VER)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/* Name of a source in messages if not given */
+#define NN_STREAM_NAME        "<stream>"
+
+/* Number of bytes at the beginning of a stream checked for binary content */
+#define NN_STREAM_PROBE_SIZE  64
+
+/* Size of the first block holding a NNFF 2.0 file, doubled as it fills up */
+#define NN_STREAM_IMAGE_CHUNK  (1 << 20)
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Module local prototypes:                                                   */
+/*                                                                            */
+NN_STATUS Nn_ReadBin2Stream (NN_ISTREAM* pIStream, NN_PNET pNet);
+BOOL      Nn_IFill (NN_ISTREAM* pIStream, size_t nSize);
+long      Nn_IReadSource (NN_ISTREAM* pIStream, PMEM pBuffer, size_t nSize);
+long      Nn_ReadFd (void* pvSource, PMEM pBuffer, size_t nSize);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CreateNetFromStream                                           */
+/* Purpose:  Reads a neural net object from a NNFF file in a stream           */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateNetFromStream
+(
+	NN_READ_FUNC  fnRead,
+	void*         pvSource,
+	PCSTR         pchName,
+	int           nNumInpUnits,
+	int           nNumOutUnits,
+	NN_PNET*      ppNet
+)
+{
+	NN_STATUS   nns;
+	NN_ISTREAM  istream;
+	PMEM        pBuffer;
+	PCMEM       pProbe;
+	size_t      nProbeSize;
+	double      dTraceStart;
+	NN_HWPROF_DECL(hwSample)
+
+	assert(fnRead != NULL);
+	assert(ppNet != NULL);
+
+	*ppNet = NULL;
+	if (pchName == NULL)
+		pchName = NN_STREAM_NAME;
+
+	NN_HWPROF_START(hwSample)
+	dTraceStart = Nn_GetTraceTime();
+
+	/* Set the global error code to NN_OF (or zero) */
+	Nn_ClearError();
+
+	pBuffer = (PMEM) Nn_Alloc(NN_STREAM_BUFFER_SIZE);
+	if (pBuffer == NULL)
+		return Nn_SetOutOfMemoryError();
+	Nn_IInit(&istream, fnRead, pvSource, pBuffer, NN_STREAM_BUFFER_SIZE);
+
+	/* Recognize the format by the first bytes, they stay in the stream */
+	nProbeSize = Nn_IPeek(&istream, &pProbe, NN_STREAM_PROBE_SIZE);
+	if (Nn_IError(&istream))
+		nns = Nn_Error(NN_FILE_READ_ERROR, NN_ERR_PREFIX "reading from '%s' failed!", pchName);
+	/* An empty stream */
+	else if (nProbeSize == 0)
+		nns = Nn_SetFileReadError();
+	else if (Nn_IsBin2Mem(pProbe, nProbeSize))
+	{
+		nns = Nn_CreateNet(ppNet);
+		if (nns == NN_OK)
+			nns = Nn_ReadBin2Stream(&istream, *ppNet);
+	}
+	else if (Nn_IsBinNetMem(pProbe, nProbeSize))
+	{
+		nns = Nn_CreateNet(ppNet);
+		if (nns == NN_OK)
+			nns = Nn_ReadBinStreamNet(*ppNet, &istream);
+	}
+	else
+	{
+		/* The parser creates the net */
+		nns = Nn_ReadAscStreamNet(&istream, pchName, ppNet);
+	}
+
+	Nn_Free(pBuffer);
+
+	/* If the neural net object was read successfully */
+	if (nns == NN_OK)
+	{
+		/* Check and, if necessary, correct its internal semantic integrity */
+		nns = Nn_AssertSemanticIntegrity(*ppNet, nNumInpUnits, nNumOutUnits);
+		/* The counters are reset by the check, so count afterwards */
+		if (nns == NN_OK)
+		{
+			NN_HWPROF_STOP(*ppNet, NN_PROF_LOAD, 0, hwSample)
+		}
+	}
+	/* If the net was not read successfully */
+	else
+	{
+		/* Realease the object instance */
+		Nn_DeleteNet(*ppNet);
+		*ppNet = NULL;
+	}
+
+	Nn_AddTraceSpan("nnif", "stream", dTraceStart, -1);
+	return nns;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CreateNetFromFd                                               */
+/* Purpose:  Reads a neural net object from a NNFF file in a stream given by  */
+/*           an open file descriptor                                          */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateNetFromFd
+(
+	int       hFile,
+	PCSTR     pchName,
+	int       nNumInpUnits,
+	int       nNumOutUnits,
+	NN_PNET*  ppNet
+)
+{
+	assert(hFile >= 0);
+
+	return Nn_CreateNetFromStream(Nn_ReadFd, &hFile, pchName, nNumInpUnits, nNumOutUnits, ppNet);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IsBinNetMem                                                   */
+/* Purpose:  Checks whether the first bytes of a NNFF file are binary         */
+/* Returns:  TRUE if binary, FALSE otherwise                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsBinNetMem (PCMEM pMem, size_t nMemSize)
+{
+	size_t i;
+
+	assert(pMem != NULL || nMemSize == 0);
+
+	if (Nn_IsBin2Mem(pMem, nMemSize))
+		return TRUE;
+
+	for (i = 0; i < nMemSize; i++)
+	{
+		if (pMem[i] < 32 &&
+			!(pMem[i] == '\t' || pMem[i] == '\n' || pMem[i] == '\r'))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReadBin2Stream                                                */
+/* Purpose:  Reads a neural net object from a NNFF 2.0 file in a stream       */
+/* Remarks:  The blocks of the file are located by offsets, so the file is    */
+/*           read into a single block, past the buffer of the stream, and     */
+/*           read from there. The file size of the header is not trusted: the */
+/*           block grows as the bytes arrive, so a short stream can't make it */
+/*           larger than twice the bytes read or NN_STREAM_IMAGE_CHUNK.       */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ReadBin2Stream (NN_ISTREAM* pIStream, NN_PNET pNet)
+{
+	NN_STATUS       nns;
+	NN_BIN2_HEADER  hdr;
+	PCMEM           pHeader;
+	PMEM            pImage;
+	PMEM            pGrown;
+	size_t          nImageSize, nBlockSize, nDone, nTake;
+
+	assert(pIStream != NULL);
+	assert(pNet != NULL);
+
+	if (Nn_IPeek(pIStream, &pHeader, sizeof (NN_BIN2_HEADER)) < sizeof (NN_BIN2_HEADER))
+		return Nn_SetFileReadError();
+	memcpy(&hdr, pHeader, sizeof (NN_BIN2_HEADER));
+	if (eo_endian_order() != LITTLE_ENDIAN)
+	{
+		eo_swap_int_n((int*) &hdr.nFileSize, 1);
+		eo_swap_int_n((int*) &hdr.nLayersOffset, 1);
+		eo_swap_short_n((short*) &hdr.nNumLayers, 1);
+	}
+
+	/* The file must at least hold the layer records, the rest is */
+	/* checked by Nn_ReadBin2Net                                  */
+	if (hdr.nNumLayers <= 0 ||
+		hdr.nLayersOffset < sizeof (NN_BIN2_HEADER) || hdr.nLayersOffset > hdr.nFileSize ||
+		(hdr.nFileSize - hdr.nLayersOffset) / sizeof (NN_BIN2_LAYER) < (size_t) hdr.nNumLayers)
+		return Nn_Error(NN_INVALID_FILE_FORMAT, NN_ERR_PREFIX "invalid header in NNFF 2.0 file");
+
+	nImageSize = (size_t) hdr.nFileSize;
+	nBlockSize = nImageSize < NN_STREAM_IMAGE_CHUNK ? nImageSize : NN_STREAM_IMAGE_CHUNK;
+	pImage = (PMEM) Nn_Alloc(nBlockSize);
+	if (pImage == NULL)
+		return Nn_SetOutOfMemoryError();
+
+	nns   = NN_OK;
+	nDone = 0;
+	while (nDone < nImageSize)
+	{
+		/* The block is full, double it */
+		if (nDone == nBlockSize)
+		{
+			nBlockSize = nBlockSize <= nImageSize / 2 ? 2 * nBlockSize : nImageSize;
+			pGrown = (PMEM) Nn_Alloc(nBlockSize);
+			if (pGrown == NULL)
+			{
+				nns = Nn_SetOutOfMemoryError();
+				break;
+			}
+			memcpy(pGrown, pImage, nDone);
+			Nn_Free(pImage);
+			pImage = pGrown;
+		}
+
+		nTake = nBlockSize - nDone;
+		if (Nn_IRead(pImage + nDone, nTake, 1, pIStream) != 1)
+		{
+			nns = Nn_SetFileReadError();
+			break;
+		}
+		nDone += nTake;
+	}
+
+	if (nns == NN_OK)
+		nns = Nn_ReadBin2Net(pNet, pImage, nImageSize, NULL);
+
+	Nn_Free(pImage);
+	return nns;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IInit                                                         */
+/* Purpose:  Opens an input stream in a caller provided structure             */
+/* Returns:  pIStream                                                         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_ISTREAM* Nn_IInit (NN_ISTREAM* pIStream, NN_READ_FUNC fnRead, void* pvSource, PMEM pBuffer, size_t nBufSize)
+{
+	assert(pIStream != NULL);
+	assert(fnRead != NULL);
+	assert(pBuffer != NULL && nBufSize > 0);
+
+	pIStream->fnRead   = fnRead;
+	pIStream->pvSource = pvSource;
+	pIStream->pBuffer  = pBuffer;
+	pIStream->nBufSize = nBufSize;
+	pIStream->nBufPos  = 0;
+	pIStream->nBufEnd  = 0;
+	pIStream->nCurrPos = 0;
+	pIStream->bEof     = FALSE;
+	pIStream->nErrNo   = 0;
+	return pIStream;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IRead                                                         */
+/* Purpose:  Standard library 'fread' equivalent for an input stream          */
+/* Returns:  The number of full items actually read                           */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_IRead (void* pBuffer, size_t nSize, size_t nCount, NN_ISTREAM* pIStream)
+{
+	PMEM   pDst;
+	size_t nTotal, nDone, nTake;
+	long   nRead;
+
+	assert(pIStream != NULL);
+
+	if (nSize == 0 || nCount == 0)
+		return 0;
+	if (nCount > ((size_t) -1) / nSize)
+		return 0;
+
+	pDst   = (PMEM) pBuffer;
+	nTotal = nSize * nCount;
+	nDone  = 0;
+
+	while (nDone < nTotal)
+	{
+		/* Take the bytes in the buffer first */
+		if (pIStream->nBufPos < pIStream->nBufEnd)
+		{
+			nTake = pIStream->nBufEnd - pIStream->nBufPos;
+			if (nTake > nTotal - nDone)
+				nTake = nTotal - nDone;
+			memcpy(pDst + nDone, pIStream->pBuffer + pIStream->nBufPos, nTake);
+			pIStream->nBufPos  += nTake;
+			pIStream->nCurrPos += nTake;
+			nDone += nTake;
+		}
+		/* The rest of a large read bypasses the buffer */
+		else if (nTotal - nDone >= pIStream->nBufSize)
+		{
+			nRead = Nn_IReadSource(pIStream, pDst + nDone, nTotal - nDone);
+			if (nRead <= 0)
+				break;
+			pIStream->nCurrPos += (size_t) nRead;
+			nDone += (size_t) nRead;
+		}
+		else if (!Nn_IFill(pIStream, 1))
+			break;
+	}
+
+	return nDone / nSize;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IReadBlock                                                    */
+/* Purpose:  Takes a block of bytes from an input stream without copying it   */
+/* Returns:  The block, NULL if the stream ends before                        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+PCMEM Nn_IReadBlock (NN_ISTREAM* pIStream, size_t nSize)
+{
+	PCMEM pBlock;
+
+	assert(pIStream != NULL);
+
+	if (!Nn_IFill(pIStream, nSize))
+		return NULL;
+	pBlock = pIStream->pBuffer + pIStream->nBufPos;
+	pIStream->nBufPos  += nSize;
+	pIStream->nCurrPos += nSize;
+	return pBlock;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IPeek                                                         */
+/* Purpose:  Gets the next bytes of an input stream without taking them       */
+/* Returns:  The number of bytes in *ppBlock                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_IPeek (NN_ISTREAM* pIStream, PCMEM* ppBlock, size_t nSize)
+{
+	assert(pIStream != NULL);
+	assert(ppBlock != NULL);
+
+	if (nSize > pIStream->nBufSize)
+		nSize = pIStream->nBufSize;
+	Nn_IFill(pIStream, nSize);
+
+	*ppBlock = pIStream->pBuffer + pIStream->nBufPos;
+	if (nSize > pIStream->nBufEnd - pIStream->nBufPos)
+		nSize = pIStream->nBufEnd - pIStream->nBufPos;
+	return nSize;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IGets                                                         */
+/* Purpose:  Standard library 'fgets' equivalent for an input stream          */
+/* Remarks:  Reads up to nMaxLen - 1 characters, the line feed included.      */
+/* Returns:  pchLine, NULL if the stream ended before a character was read    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+char* Nn_IGets (char* pchLine, int nMaxLen, NN_ISTREAM* pIStream)
+{
+	PCMEM  pBegin, pEnd;
+	size_t nLen, nTake;
+
+	assert(pchLine != NULL && nMaxLen > 0);
+	assert(pIStream != NULL);
+
+	nLen = 0;
+	while (nLen + 1 < (size_t) nMaxLen)
+	{
+		if (pIStream->nBufPos == pIStream->nBufEnd && !Nn_IFill(pIStream, 1))
+			break;
+
+		/* Copy up to the line feed in the buffer */
+		pBegin = pIStream->pBuffer + pIStream->nBufPos;
+		nTake  = pIStream->nBufEnd - pIStream->nBufPos;
+		if (nTake > (size_t) nMaxLen - 1 - nLen)
+			nTake = (size_t) nMaxLen - 1 - nLen;
+		pEnd = (PCMEM) memchr(pBegin, '\n', nTake);
+		if (pEnd != NULL)
+			nTake = (size_t) (pEnd - pBegin) + 1;
+
+		memcpy(pchLine + nLen, pBegin, nTake);
+		pIStream->nBufPos  += nTake;
+		pIStream->nCurrPos += nTake;
+		nLen += nTake;
+		if (pEnd != NULL)
+			break;
+	}
+
+	if (nLen == 0)
+		return NULL;
+	pchLine[nLen] = '\0';
+	return pchLine;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IFill                                                         */
+/* Purpose:  Reads from the source until the buffer holds nSize bytes         */
+/* Remarks:  The bytes left in the buffer are moved to its beginning first.   */
+/* Returns:  TRUE if the buffer holds nSize bytes                             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IFill (NN_ISTREAM* pIStream, size_t nSize)
+{
+	size_t nLeft;
+	long   nRead;
+
+	nLeft = pIStream->nBufEnd - pIStream->nBufPos;
+	if (nLeft >= nSize)
+		return TRUE;
+	if (nSize > pIStream->nBufSize)
+		return FALSE;
+
+	if (pIStream->nBufPos > 0)
+	{
+		memmove(pIStream->pBuffer, pIStream->pBuffer + pIStream->nBufPos, nLeft);
+		pIStream->nBufPos = 0;
+		pIStream->nBufEnd = nLeft;
+	}
+
+	while (pIStream->nBufEnd < nSize)
+	{
+		nRead = Nn_IReadSource(pIStream, pIStream->pBuffer + pIStream->nBufEnd,
+							   pIStream->nBufSize - pIStream->nBufEnd);
+		if (nRead <= 0)
+			return FALSE;
+		pIStream->nBufEnd += (size_t) nRead;
+	}
+	return TRUE;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IReadSource                                                   */
+/* Purpose:  Calls the read function of the source                            */
+/* Remarks:  Sets the end and error flags of the stream, a source is not      */
+/*           read again after either.                                         */
+/* Returns:  The number of bytes read, zero at the end or for an error        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+long Nn_IReadSource (NN_ISTREAM* pIStream, PMEM pBuffer, size_t nSize)
+{
+	long nRead;
+
+	if (pIStream->bEof || pIStream->nErrNo != 0)
+		return 0;
+
+	nRead = pIStream->fnRead(pIStream->pvSource, pBuffer, nSize);
+	if (nRead < 0 || (size_t) nRead > nSize)
+	{
+		pIStream->nErrNo = 1;
+		return 0;
+	}
+	if (nRead == 0)
+		pIStream->bEof = TRUE;
+	return nRead;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReadFd                                                        */
+/* Purpose:  The read function of a file descriptor                           */
+/* Remarks:  Reads interrupted by a signal are repeated.                      */
+/* Returns:  The number of bytes read, zero at the end, -1 for an error       */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+long Nn_ReadFd (void* pvSource, PMEM pBuffer, size_t nSize)
+{
+	int  hFile;
+	long nRead;
+
+	hFile = *(const int*) pvSource;
+
+	/* Reads of at most 1 GB fit the return value on all platforms */
+	if (nSize > 0x40000000)
+		nSize = 0x40000000;
+	do
+	{
+#if defined(_MSC_VER)
+		nRead = (long) _read(hFile, pBuffer, (unsigned int) nSize);
+#else
+		nRead = (long) read(hFile, pBuffer, nSize);
+#endif
+	}
+	while (nRead < 0 && errno == EINTR);
+
+	return nRead < 0 ? -1 : nRead;
+}
+
+/* EOF ///////////////////////////////////////////////////////////////////////*/
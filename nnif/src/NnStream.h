@@ -0,0 +1,185 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnStream.h                                                    */
+/* Purpose:     Interface def. file for reading neural nets from byte streams */
+/* Remarks:     Implemented in NnStream.c                                     */
+/*              The bytes of a NNFF file are pulled through a read function,  */
+/*              e.g. from a pipe, a socket or a member of an archive, into a  */
+/*              buffer of fixed size, and the net is built while they come    */
+/*              in. ASCII and binary NNFF 1.x files are parsed section by     */
+/*              section from the buffer. NNFF 2.0 files locate their blocks   */
+/*              by offsets, they are read at once into a block of the size    */
+/*              given in their header.                                        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size of the buffer of a stream read by Nn_CreateNetFromStream */
+#define NN_STREAM_BUFFER_SIZE  65536
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_READ_FUNC                                                      */
+/* Purpose: The function reading the bytes of a stream from its source        */
+/* Remarks: Reads up to nSize bytes into pBuffer, like 'read'. It may return  */
+/*          less than nSize bytes before the end of the source, it is called  */
+/*          again for the rest.                                               */
+/*          Returns the number of bytes read, zero at the end of the source   */
+/*          and a negative value for an error.                                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef long (*NN_READ_FUNC) (void* pvSource, PMEM pBuffer, size_t nSize);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:     NN_ISTREAM                                                       */
+/* Purpose:  Structure that represents a buffered input stream                */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnIStream
+{
+	NN_READ_FUNC  fnRead;      /* The read function of the source          */
+	void*         pvSource;    /* The source passed to the read function   */
+	PMEM          pBuffer;     /* The buffer                               */
+	size_t        nBufSize;    /* Size of the buffer in bytes              */
+	size_t        nBufPos;     /* Position of the next byte in the buffer  */
+	size_t        nBufEnd;     /* End of the bytes in the buffer           */
+	size_t        nCurrPos;    /* Position of the next byte in the stream  */
+	BOOL          bEof;        /* Set at the end of the source             */
+	int           nErrNo;      /* Set by a read error of the source        */
+}
+NN_ISTREAM;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CreateNetFromStream                                           */
+/* Purpose:  Reads a neural net object from a NNFF file in a stream           */
+/* Remarks:  The format is recognized by the first bytes of the stream        */
+/*           (ASCII, binary NNFF 1.x or 2.0). The function calls              */
+/*           Nn_AssertSemanticIntegrity if the net object was succesfully     */
+/*           read in. Bytes following the net may have been taken from the    */
+/*           source. The nets of NNFF 1.x and ASCII files have no arena, see  */
+/*           Nn_FreezeNet.                                                    */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateNetFromStream
+(
+	NN_READ_FUNC  fnRead,        /* The read function of the source          */
+	void*         pvSource,      /* The source passed to the read function   */
+	PCSTR         pchName,       /* Name of the source in messages, or NULL  */
+	int           nNumInpUnits,  /* Size of the input vector                 */
+	int           nNumOutUnits,  /* Size of the output vector                */
+	NN_PNET*      ppNet          /* The created neural net object            */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CreateNetFromFd                                               */
+/* Purpose:  Reads a neural net object from a NNFF file in a stream given by  */
+/*           an open file descriptor, e.g. of a pipe or a socket              */
+/* Remarks:  Same as Nn_CreateNetFromStream. The descriptor is read from its  */
+/*           current position and left open.                                  */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateNetFromFd
+(
+	int       hFile,         /* The open file descriptor                 */
+	PCSTR     pchName,       /* Name of the source in messages, or NULL  */
+	int       nNumInpUnits,  /* Size of the input vector                 */
+	int       nNumOutUnits,  /* Size of the output vector                */
+	NN_PNET*  ppNet          /* The created neural net object            */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IsBinNetMem                                                   */
+/* Purpose:  Checks whether the first bytes of a NNFF file are binary         */
+/* Remarks:  A binary file starts with the magic number of NNFF 2.0 or, in    */
+/*           NNFF 1.x, with the big-endian section identifier of the net,     */
+/*           so the first bytes hold a control character. The first bytes of  */
+/*           an ASCII file are text.                                          */
+/* Returns:  TRUE if binary, FALSE otherwise                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsBinNetMem (PCMEM pMem, size_t nMemSize);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Input stream routines                                                      */
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IInit                                                         */
+/* Purpose:  Opens an input stream in a caller provided structure on a        */
+/*           caller provided buffer                                           */
+/* Remarks:  The stream needs no closing. Blocks taken by Nn_IReadBlock and   */
+/*           Nn_IPeek are limited to the size of the buffer.                  */
+/* Returns:  pIStream                                                         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_ISTREAM* Nn_IInit (NN_ISTREAM* pIStream, NN_READ_FUNC fnRead, void* pvSource, PMEM pBuffer, size_t nBufSize);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IRead                                                         */
+/* Purpose:  Standard library 'fread' equivalent for an input stream          */
+/* Remarks:  Large reads go from the source directly to pBuffer.              */
+/* Returns:  The number of full items actually read, which may be less than   */
+/*           nCount if an error occurs or if the end of the stream is reached */
+/*           before reaching nCount.                                          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_IRead
+(
+	void*       pBuffer,  /* Pointer to the item or list of items to read */
+	size_t      nSize,    /* Size (in bytes) of an item                  */
+	size_t      nCount,   /* Number of items to read                     */
+	NN_ISTREAM* pIStream  /* Input stream                                */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IReadBlock                                                    */
+/* Purpose:  Takes a block of bytes from an input stream without copying it   */
+/* Remarks:  The block lies in the buffer of the stream and is valid up to    */
+/*           the next call on the stream. It is not aligned.                  */
+/* Returns:  The block, NULL if the stream ends before or nSize exceeds the   */
+/*           size of the buffer                                               */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+PCMEM Nn_IReadBlock (NN_ISTREAM* pIStream, size_t nSize);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IPeek                                                         */
+/* Purpose:  Gets the next bytes of an input stream without taking them       */
+/* Remarks:  The bytes lie in the buffer of the stream, see Nn_IReadBlock.    */
+/* Returns:  The number of bytes in *ppBlock, less than nSize at the end of   */
+/*           the stream                                                       */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+size_t Nn_IPeek (NN_ISTREAM* pIStream, PCMEM* ppBlock, size_t nSize);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IGets                                                         */
+/* Purpose:  Standard library 'fgets' equivalent for an input stream          */
+/* Returns:  pchLine, NULL if the stream ended before a character was read    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+char* Nn_IGets (char* pchLine, int nMaxLen, NN_ISTREAM* pIStream);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IPos                                                          */
+/* Purpose:  Standard library 'ftell' equivalent for an input stream          */
+/* Returns:  The number of bytes taken from the stream                        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+/* Prototype: size_t Nn_IPos (NN_ISTREAM* pIStream); */
+#define Nn_IPos(pIStream) ((pIStream)->nCurrPos)
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IError                                                        */
+/* Purpose:  Standard library 'ferror' equivalent for an input stream         */
+/* Returns:  Nonzero if the read function of the source reported an error     */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+/* Prototype: int Nn_IError (NN_ISTREAM* pIStream); */
+#define Nn_IError(pIStream) ((pIStream)->nErrNo)
+
+#ifdef __cplusplus
+}
+#endif
+/* EOF ///////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,270 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnSwap.c                                                      */
+/* Purpose:     Implementation of hot-swappable neural nets                   */
+/* Remarks:     Interface def. in NnSwap.h                                    */
+/*              The slots work like hazard pointers: a worker stores the      */
+/*              version it is about to use in its slot and checks afterwards  */
+/*              that it is still the current one. The reloading thread        */
+/*              replaces the current version first and then waits until no    */
+/*              slot holds the old one. Both sides store and load the         */
+/*              pointers sequentially consistent, so either the reloading     */
+/*              thread sees the slot or the worker sees the new version and   */
+/*              tries again.                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "NnBase.h"
+#include "NnProc.h"
+#include "NnBinIO.h"
+#include "NnSwap.h"
+
+/* Sequentially consistent pointer access, volatile reads are acquire on MSVC */
+#if defined(_MSC_VER)
+#include <windows.h>
+#define NN_LOAD_PTR(p)       (p)
+#define NN_STORE_PTR(p, v)   ((p) = (v), MemoryBarrier())
+#define NN_YIELD()           SwitchToThread()
+#else
+#include <sched.h>
+#define NN_LOAD_PTR(p)       __atomic_load_n(&(p), __ATOMIC_SEQ_CST)
+#define NN_STORE_PTR(p, v)   __atomic_store_n(&(p), (v), __ATOMIC_SEQ_CST)
+#define NN_YIELD()           sched_yield()
+#endif
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Module local prototypes:                                                   */
+/*                                                                            */
+
+NN_STATUS Nn_LoadSwapVersion (NN_SWAP_NET* pSwap, PCSTR pchFilePath, long nVersion, NN_SWAP_VERSION** ppVersion);
+void      Nn_DeleteSwapVersion (NN_SWAP_VERSION* pVersion);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CreateSwapNet                                                 */
+/* Purpose:  Creates a swap net and loads its first version                   */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateSwapNet
+(
+	PCSTR          pchFilePath,
+	int            nNumInpUnits,
+	int            nNumOutUnits,
+	int            nNumSlots,
+	NN_SWAP_NET**  ppSwap
+)
+{
+	NN_STATUS         nns;
+	NN_SWAP_NET*      pSwap;
+	NN_SWAP_VERSION*  pVersion;
+
+	assert(pchFilePath != NULL);
+	assert(nNumSlots > 0);
+	assert(ppSwap != NULL);
+
+	*ppSwap = NULL;
+	Nn_ClearError();
+
+	pSwap = (NN_SWAP_NET*) Nn_Alloc(sizeof (NN_SWAP_NET));
+	if (pSwap == NULL)
+		return Nn_SetOutOfMemoryError();
+	pSwap->aSlots = (NN_SWAP_SLOT*) Nn_Alloc(nNumSlots * sizeof (NN_SWAP_SLOT));
+	if (pSwap->aSlots == NULL)
+	{
+		Nn_Free(pSwap);
+		return Nn_SetOutOfMemoryError();
+	}
+	pSwap->nNumSlots    = nNumSlots;
+	pSwap->nNumInpUnits = nNumInpUnits;
+	pSwap->nNumOutUnits = nNumOutUnits;
+
+	nns = Nn_LoadSwapVersion(pSwap, pchFilePath, 1, &pVersion);
+	if (nns != NN_OK)
+	{
+		Nn_DeleteSwapNet(pSwap);
+		return nns;
+	}
+	pSwap->pCurrent = pVersion;
+
+	*ppSwap = pSwap;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_DeleteSwapNet                                                 */
+/* Purpose:  Deletes a swap net with its current version                      */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_DeleteSwapNet (NN_SWAP_NET* pSwap)
+{
+	if (pSwap == NULL)
+		return;
+
+	Nn_DeleteSwapVersion(pSwap->pCurrent);
+	Nn_Free(pSwap->aSlots);
+	Nn_Free(pSwap);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReloadSwapNet                                                 */
+/* Purpose:  Loads a new version and makes it the current one                 */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ReloadSwapNet (NN_SWAP_NET* pSwap, PCSTR pchFilePath)
+{
+	NN_STATUS         nns;
+	NN_SWAP_VERSION*  pOld;
+	NN_SWAP_VERSION*  pNew;
+	int               iS;
+
+	assert(pSwap != NULL);
+	assert(pchFilePath != NULL);
+
+	Nn_ClearError();
+
+	pOld = pSwap->pCurrent;
+	nns = Nn_LoadSwapVersion(pSwap, pchFilePath, pOld->nVersion + 1, &pNew);
+	if (nns != NN_OK)
+		return nns;
+
+	/* Publish the new version */
+	NN_STORE_PTR(pSwap->pCurrent, pNew);
+
+	/* Wait for the workers still using the old version */
+	for (iS = 0; iS < pSwap->nNumSlots; iS++)
+	{
+		while (NN_LOAD_PTR(pSwap->aSlots[iS].pInUse) == pOld)
+			NN_YIELD();
+	}
+
+	Nn_DeleteSwapVersion(pOld);
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_EnterSwapNet                                                  */
+/* Purpose:  Gets the net of the current version for a worker slot            */
+/* Returns:  The net of the slot                                              */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_PNET Nn_EnterSwapNet (NN_SWAP_NET* pSwap, int iSlot)
+{
+	NN_SWAP_VERSION* pVersion;
+	NN_SWAP_SLOT*    pSlot;
+
+	assert(pSwap != NULL);
+	assert(iSlot >= 0 && iSlot < pSwap->nNumSlots);
+
+	pSlot = pSwap->aSlots + iSlot;
+	do
+	{
+		pVersion = NN_LOAD_PTR(pSwap->pCurrent);
+		NN_STORE_PTR(pSlot->pInUse, pVersion);
+	}
+	while (pVersion != NN_LOAD_PTR(pSwap->pCurrent));
+
+	return pVersion->apNets[iSlot];
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_LeaveSwapNet                                                  */
+/* Purpose:  Ends the use of the net obtained by Nn_EnterSwapNet              */
+/* Remarks:  The store completes all accesses to the net before the slot is   */
+/*           released.                                                        */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_LeaveSwapNet (NN_SWAP_NET* pSwap, int iSlot)
+{
+	assert(pSwap != NULL);
+	assert(iSlot >= 0 && iSlot < pSwap->nNumSlots);
+
+	NN_STORE_PTR(pSwap->aSlots[iSlot].pInUse, NULL);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetSwapVersion                                                */
+/* Purpose:  Gets the number of the current version                           */
+/* Returns:  The version number                                               */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+long Nn_GetSwapVersion (const NN_SWAP_NET* pSwap)
+{
+	assert(pSwap != NULL);
+
+	return NN_LOAD_PTR(pSwap->pCurrent)->nVersion;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_LoadSwapVersion                                               */
+/* Purpose:  Loads a version: one frozen net per slot with its batch work     */
+/*           buffer, so that the workers need not allocate anything           */
+/* Remarks:  The file is read once per slot, the nets can't be copied since   */
+/*           a frozen net can't be written.                                   */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_LoadSwapVersion (NN_SWAP_NET* pSwap, PCSTR pchFilePath, long nVersion, NN_SWAP_VERSION** ppVersion)
+{
+	NN_STATUS         nns;
+	NN_SWAP_VERSION*  pVersion;
+	int               iS;
+
+	*ppVersion = NULL;
+
+	pVersion = (NN_SWAP_VERSION*) Nn_Alloc(sizeof (NN_SWAP_VERSION));
+	if (pVersion == NULL)
+		return Nn_SetOutOfMemoryError();
+	pVersion->apNets = (NN_PNET*) Nn_Alloc(pSwap->nNumSlots * sizeof (NN_PNET));
+	if (pVersion->apNets == NULL)
+	{
+		Nn_Free(pVersion);
+		return Nn_SetOutOfMemoryError();
+	}
+	pVersion->nVersion = nVersion;
+	pVersion->nNumNets = pSwap->nNumSlots;
+
+	for (iS = 0; iS < pSwap->nNumSlots; iS++)
+	{
+		nns = Nn_CreateNetFromBinFile(pchFilePath, pSwap->nNumInpUnits, pSwap->nNumOutUnits, &pVersion->apNets[iS]);
+		if (nns == NN_OK)
+			nns = Nn_FreezeNet(pVersion->apNets[iS]);
+		if (nns == NN_OK)
+			nns = Nn_ProcessNetBatch(pVersion->apNets[iS], 0, NULL, NULL);
+		if (nns != NN_OK)
+		{
+			Nn_DeleteSwapVersion(pVersion);
+			return nns;
+		}
+	}
+
+	*ppVersion = pVersion;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_DeleteSwapVersion                                             */
+/* Purpose:  Deletes a version with its nets                                  */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_DeleteSwapVersion (NN_SWAP_VERSION* pVersion)
+{
+	int iS;
+
+	if (pVersion == NULL)
+		return;
+
+	for (iS = 0; iS < pVersion->nNumNets; iS++)
+		Nn_DeleteNet(pVersion->apNets[iS]);
+	Nn_Free(pVersion->apNets);
+	Nn_Free(pVersion);
+}
+
+/* EOF ///////////////////////////////////////////////////////////////////////*/
+
@@ -0,0 +1,136 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnSwap.h                                                      */
+/* Purpose:     Interface def. file for hot-swappable neural nets             */
+/* Remarks:     Implemented in NnSwap.c                                       */
+/*              A swap net gives worker threads the current version of a net  */
+/*              while another thread loads a new version and replaces the     */
+/*              current one. The processing routines keep their state in the  */
+/*              net, so a version holds a private copy of the net for each    */
+/*              worker slot. The copies are loaded, frozen and given their    */
+/*              batch work buffer by the reloading thread.                    */
+/*              The workers enter and leave the net without locks, they only  */
+/*              publish the version they use in their slot. A replaced        */
+/*              version is deleted once no slot uses it any more.             */
+/*              Each slot must be used by a single thread at a time, and      */
+/*              only one thread at a time may call Nn_ReloadSwapNet.          */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_SWAP_VERSION                                                   */
+/* Purpose: A version of a swap net, one net per worker slot                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnSwapVersion
+{
+	long      nVersion;     /* Number of the version, starting with 1   */
+	int       nNumNets;     /* Number of nets, the number of slots      */
+	NN_PNET*  apNets;       /* The nets, one per slot                   */
+}
+NN_SWAP_VERSION;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_SWAP_SLOT                                                      */
+/* Purpose: The version a worker slot is using, a cache line of its own       */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnSwapSlot
+{
+	NN_SWAP_VERSION* volatile pInUse;   /* Version in use, NULL if none */
+	char  achPad[NN_ARENA_ALIGN - sizeof (NN_SWAP_VERSION*)];
+}
+NN_SWAP_SLOT;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Type:    NN_SWAP_NET                                                       */
+/* Purpose: A hot-swappable net, created by Nn_CreateSwapNet                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+typedef struct SNnSwapNet
+{
+	NN_SWAP_VERSION* volatile pCurrent;  /* The current version            */
+	int            nNumSlots;     /* Number of worker slots               */
+	NN_SWAP_SLOT*  aSlots;        /* The worker slots                     */
+	int            nNumInpUnits;  /* Size of the input vector, or -1      */
+	int            nNumOutUnits;  /* Size of the output vector, or -1     */
+}
+NN_SWAP_NET;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CreateSwapNet                                                 */
+/* Purpose:  Creates a swap net and loads its first version from a binary     */
+/*           NNFF file                                                        */
+/* Remarks:  The number of input and output units is checked for all          */
+/*           versions unless passed as -1.                                    */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CreateSwapNet
+(
+	PCSTR          pchFilePath,   /* Path of the binary NNFF file   */
+	int            nNumInpUnits,  /* Size of the input vector       */
+	int            nNumOutUnits,  /* Size of the output vector      */
+	int            nNumSlots,     /* Number of worker slots         */
+	NN_SWAP_NET**  ppSwap         /* Receives the swap net          */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_DeleteSwapNet                                                 */
+/* Purpose:  Deletes a swap net with its current version                      */
+/* Remarks:  No slot may be in use.                                           */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_DeleteSwapNet (NN_SWAP_NET* pSwap);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_ReloadSwapNet                                                 */
+/* Purpose:  Loads a new version from a binary NNFF file and makes it the     */
+/*           current one                                                      */
+/* Remarks:  The workers entering the net afterwards get the new version.     */
+/*           The call waits until no slot uses the old version any more and   */
+/*           then deletes it, so it takes at least as long as the longest     */
+/*           evaluation in progress. If the new version can't be loaded, the  */
+/*           current one remains.                                             */
+/* Returns:  NN_OK (or zero) for success, an error code otherwise             */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_ReloadSwapNet (NN_SWAP_NET* pSwap, PCSTR pchFilePath);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_EnterSwapNet                                                  */
+/* Purpose:  Gets the net of the current version for a worker slot            */
+/* Remarks:  The net remains valid until Nn_LeaveSwapNet is called for the    */
+/*           slot, so a worker should leave the net between its batches.      */
+/*           Wait-free unless a version is replaced at the same time.         */
+/* Returns:  The net of the slot                                              */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_PNET Nn_EnterSwapNet (NN_SWAP_NET* pSwap, int iSlot);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_LeaveSwapNet                                                  */
+/* Purpose:  Ends the use of the net obtained by Nn_EnterSwapNet              */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_LeaveSwapNet (NN_SWAP_NET* pSwap, int iSlot);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetSwapVersion                                                */
+/* Purpose:  Gets the number of the current version                           */
+/* Returns:  1 for the version loaded by Nn_CreateSwapNet, incremented by     */
+/*           each successful Nn_ReloadSwapNet                                 */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+long Nn_GetSwapVersion (const NN_SWAP_NET* pSwap);
+
+
+#ifdef __cplusplus
+}
+#endif
+/* EOF ///////////////////////////////////////////////////////////////////////*/
+
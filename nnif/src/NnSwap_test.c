@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "NnBase.h"
+#include "NnCheck.h"
+#include "NnProc.h"
+#include "NnBinIO.h"
+#include "NnSwap.h"
+
+int failures = 0;
+
+#define ASSERTI(E,A) if ((E)!=(A)) {failures++; printf("%s(%d): assertion failed: expected %d, but '%s' yield %d\n", __FILE__, __LINE__, (int)(E), #A, (int)(A));}
+#define ASSERTL(E,A) if ((E)!=(A)) {failures++; printf("%s(%d): assertion failed: expected %ld, but '%s' yield %ld\n", __FILE__, __LINE__, (long)(E), #A, (long)(A));}
+#define ASSERTT(A)   if (!(A)) {failures++; printf("%s(%d): assertion failed: '%s'\n", __FILE__, __LINE__, #A);}
+
+#define NUM_WORKERS  4
+#define NUM_RELOADS  50
+
+#define NUM_INP  3
+#define NUM_OUT  2
+
+/* The versions are loaded alternately from the two files, odd ones from A */
+static const char* apchFiles[2] = { "NnSwap_test_b.nnf", "NnSwap_test_a.nnf" };
+
+/* The outputs of the nets of the two files for the test input */
+static const double adInp[NUM_INP] = { 0.2, 0.5, 0.8 };
+static double aadOut[2][NUM_OUT];
+
+static NN_SWAP_NET* pSwap;
+static int  bStop;
+static long anLastVersion[NUM_WORKERS];
+static long anNumErrors[NUM_WORKERS];
+
+/*
+ * Writes a fully connected 3-layer net to a binary NNFF file, the weights
+ * are multiplied by fScale.
+ */
+void writeTestNet(const char* pchFile, double fScale)
+{
+    NN_PNET   pNet;
+    NN_PLAYER pLayer;
+    NN_PUNIT  pUnit;
+    NN_PCONN  pConn;
+    short     anNumUnits[3];
+    short     iL, iU, iC;
+
+    anNumUnits[0] = NUM_INP;
+    anNumUnits[1] = 6;
+    anNumUnits[2] = NUM_OUT;
+
+    Nn_CreateNet(&pNet);
+    pNet->na.nNumLayers = 3;
+    Nn_CreateLayers(pNet);
+    for (iL = 0; iL < 3; iL++)
+    {
+        pLayer = Nn_GetLayerAt(pNet, iL);
+        pLayer->la.nNumUnits = anNumUnits[iL];
+        Nn_CreateUnits(pLayer);
+        for (iU = 0; iU < pLayer->la.nNumUnits && iL > 0; iU++)
+        {
+            pUnit = Nn_GetUnitAt(pLayer, iU);
+            pUnit->ua.nNumConns = anNumUnits[iL-1];
+            Nn_CreateConns(pUnit);
+            for (iC = 0; iC < pUnit->ua.nNumConns; iC++)
+            {
+                pConn = Nn_GetConnAt(pUnit, iC);
+                pConn->ca.iLayer  = (short) (iL-1);
+                pConn->ca.iUnit   = iC;
+                pConn->ca.fWeight = fScale * (0.1 * (iU + 1) - 0.05 * iC);
+            }
+        }
+    }
+
+    if (Nn_AssertSemanticIntegrity(pNet, NUM_INP, NUM_OUT) != NN_OK ||
+        Nn_WriteNetToBinFile(pchFile, pNet) != NN_OK)
+    {
+        printf("can't write %s: %s\n", pchFile, Nn_GetErrMsg());
+        exit(-1);
+    }
+    Nn_DeleteNet(pNet);
+}
+
+/*
+ * Evaluates the net of the slot until stopped. The version in use must
+ * never go back, and the outputs must be those of its file.
+ */
+void* runWorker(void* pvSlot)
+{
+    NN_PNET pNet;
+    long    nVersion;
+    double  adOut[NUM_OUT];
+    int     iSlot, i;
+
+    iSlot = (int) (size_t) pvSlot;
+
+    while (!__atomic_load_n(&bStop, __ATOMIC_ACQUIRE))
+    {
+        pNet = Nn_EnterSwapNet(pSwap, iSlot);
+        nVersion = pSwap->aSlots[iSlot].pInUse->nVersion;
+        Nn_ProcessNet(pNet, adInp, adOut);
+        Nn_LeaveSwapNet(pSwap, iSlot);
+
+        for (i = 0; i < NUM_OUT; i++)
+        {
+            if (adOut[i] != aadOut[nVersion % 2][i])
+                anNumErrors[iSlot]++;
+        }
+        if (nVersion < anLastVersion[iSlot])
+            anNumErrors[iSlot]++;
+        __atomic_store_n(&anLastVersion[iSlot], nVersion, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv)
+{
+    NN_ALLOC_STATS stats;
+    NN_PNET        pNet;
+    pthread_t      aThreads[NUM_WORKERS];
+    size_t         nBaseBytes, nSwapBytes;
+    long           nVersion;
+    int            i;
+
+    writeTestNet(apchFiles[1], 1.0);
+    writeTestNet(apchFiles[0], -0.5);
+    for (i = 0; i < 2; i++)
+    {
+        ASSERTI(NN_OK, Nn_CreateNetFromBinFile(apchFiles[i], NUM_INP, NUM_OUT, &pNet));
+        Nn_ProcessNet(pNet, adInp, aadOut[i]);
+        Nn_DeleteNet(pNet);
+    }
+    ASSERTT(aadOut[0][0] != aadOut[1][0]);
+
+    Nn_GetAllocStats(&stats);
+    nBaseBytes = stats.nLiveBytes;
+
+    /* A failing first load leaves nothing behind */
+    pSwap = (NN_SWAP_NET*) 1;
+    ASSERTT(Nn_CreateSwapNet("NnSwap_test_x.nnf", NUM_INP, NUM_OUT, NUM_WORKERS, &pSwap) != NN_OK);
+    ASSERTT(pSwap == NULL);
+    Nn_GetAllocStats(&stats);
+    ASSERTL(nBaseBytes, stats.nLiveBytes);
+
+    ASSERTI(NN_OK, Nn_CreateSwapNet(apchFiles[1], NUM_INP, NUM_OUT, NUM_WORKERS, &pSwap));
+    ASSERTL(1L, Nn_GetSwapVersion(pSwap));
+    Nn_GetAllocStats(&stats);
+    nSwapBytes = stats.nLiveBytes;
+
+    for (i = 0; i < NUM_WORKERS; i++)
+        pthread_create(&aThreads[i], NULL, runWorker, (void*) (size_t) i);
+
+    for (nVersion = 2; nVersion <= NUM_RELOADS + 1; nVersion++)
+    {
+        ASSERTI(NN_OK, Nn_ReloadSwapNet(pSwap, apchFiles[nVersion % 2]));
+        ASSERTL(nVersion, Nn_GetSwapVersion(pSwap));
+
+        /* The old version has been deleted, the versions have the same size */
+        Nn_GetAllocStats(&stats);
+        ASSERTL(nSwapBytes, stats.nLiveBytes);
+
+        /* All workers get to the new version */
+        for (i = 0; i < NUM_WORKERS; i++)
+        {
+            while (__atomic_load_n(&anLastVersion[i], __ATOMIC_ACQUIRE) < nVersion)
+                sched_yield();
+        }
+    }
+
+    /* A failing reload keeps the current version */
+    ASSERTT(Nn_ReloadSwapNet(pSwap, "NnSwap_test_x.nnf") != NN_OK);
+    ASSERTL(NUM_RELOADS + 1L, Nn_GetSwapVersion(pSwap));
+    Nn_GetAllocStats(&stats);
+    ASSERTL(nSwapBytes, stats.nLiveBytes);
+
+    __atomic_store_n(&bStop, 1, __ATOMIC_RELEASE);
+    for (i = 0; i < NUM_WORKERS; i++)
+    {
+        pthread_join(aThreads[i], NULL);
+        ASSERTL(0L, anNumErrors[i]);
+        ASSERTL(NUM_RELOADS + 1L, anLastVersion[i]);
+    }
+
+    Nn_DeleteSwapNet(pSwap);
+    Nn_GetAllocStats(&stats);
+    ASSERTL(nBaseBytes, stats.nLiveBytes);
+
+    remove(apchFiles[0]);
+    remove(apchFiles[1]);
+
+    printf("%d failure(s)\n", failures);
+    return failures;
+}
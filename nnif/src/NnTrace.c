@@ -0,0 +1,241 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnTrace.c                                                     */
+/* Purpose:     Implementation of the neural net trace writer                 */
+/* Remarks:     Interface def. in NnTrace.h                                   */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* For clock_gettime and syscall */
+#elif !defined(_MSC_VER) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L /* For clock_gettime */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "NnBase.h"
+#include "NnTrace.h"
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#define NN_TRACE_NAME_LEN  128
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Module local variables:                                                    */
+/*                                                                            */
+
+static FILE*  g_pTraceFile = NULL;
+static double g_dTraceStart = 0.0;
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Module local prototypes:                                                   */
+/*                                                                            */
+
+double        Nn_GetTraceClock (void);
+unsigned long Nn_GetTraceThreadId (void);
+void          Nn_EscapeTraceName (PCSTR pchName, char* pchBuf);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_OpenTrace                                                     */
+/* Purpose:  Opens a trace file, from now on spans are written to it          */
+/* Remarks:  The file starts with the array of trace events, the first entry  */
+/*           is a metadata event so that every span can be prefixed with a   */
+/*           comma.                                                           */
+/* Returns:  NN_OK (or zero) for success, NN_CANT_OPEN_FILE otherwise         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_OpenTrace (PCSTR pchFilePath)
+{
+	FILE* pFile;
+
+	assert(pchFilePath != NULL);
+
+	Nn_CloseTrace();
+
+	pFile = fopen(pchFilePath, "w");
+	if (pFile == NULL)
+		return Nn_Error(NN_CANT_OPEN_FILE, NN_ERR_PREFIX "can't open trace file '%s' for write", pchFilePath);
+
+	fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+		"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"nnif\"}}");
+
+	g_dTraceStart = Nn_GetTraceClock();
+	g_pTraceFile = pFile;
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CloseTrace                                                    */
+/* Purpose:  Completes and closes the trace file                              */
+/* Returns:  NN_OK (or zero) for success, NN_FILE_WRITE_ERROR otherwise       */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CloseTrace (void)
+{
+	FILE* pFile;
+	BOOL  bError;
+
+	pFile = g_pTraceFile;
+	if (pFile == NULL)
+		return NN_OK;
+	g_pTraceFile = NULL;
+
+	fprintf(pFile, "\n]}\n");
+	bError = ferror(pFile);
+	if (fclose(pFile) != 0 || bError)
+		return Nn_Error(NN_FILE_WRITE_ERROR, NN_ERR_PREFIX "failed to write trace file");
+	return NN_OK;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IsTraceOpen                                                   */
+/* Purpose:  Checks whether spans are currently written                       */
+/* Returns:  TRUE if a trace file is open, FALSE otherwise                    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsTraceOpen (void)
+{
+	return g_pTraceFile != NULL;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetTraceTime                                                  */
+/* Purpose:  Gets the current time of the trace                               */
+/* Returns:  Microseconds since Nn_OpenTrace, zero if no trace is open        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+double Nn_GetTraceTime (void)
+{
+	if (g_pTraceFile == NULL)
+		return 0.0;
+	return Nn_GetTraceClock() - g_dTraceStart;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_AddTraceSpan                                                  */
+/* Purpose:  Writes a span from the given start time until now on the track   */
+/*           of the calling thread                                            */
+/* Remarks:  The event is written with a single call to fprintf, which locks  */
+/*           the stream, so events of different threads are not mixed.       */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_AddTraceSpan
+(
+	PCSTR   pchCategory,
+	PCSTR   pchName,
+	double  dStartTime,
+	long    nNumItems
+)
+{
+	FILE*  pFile;
+	double dEndTime;
+	char   achCategory[NN_TRACE_NAME_LEN];
+	char   achName[NN_TRACE_NAME_LEN];
+	char   achArgs[64];
+
+	pFile = g_pTraceFile;
+	if (pFile == NULL)
+		return;
+
+	dEndTime = Nn_GetTraceClock() - g_dTraceStart;
+	Nn_EscapeTraceName(pchCategory, achCategory);
+	Nn_EscapeTraceName(pchName, achName);
+	if (nNumItems >= 0)
+		sprintf(achArgs, ",\"args\":{\"items\":%ld}", nNumItems);
+	else
+		achArgs[0] = '\0';
+
+	fprintf(pFile, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%lu%s}",
+		achName, achCategory, dStartTime, dEndTime - dStartTime, Nn_GetTraceThreadId(), achArgs);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_SetTraceThreadName                                            */
+/* Purpose:  Sets the name shown for the track of the calling thread          */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_SetTraceThreadName (PCSTR pchName)
+{
+	FILE* pFile;
+	char  achName[NN_TRACE_NAME_LEN];
+
+	pFile = g_pTraceFile;
+	if (pFile == NULL)
+		return;
+
+	Nn_EscapeTraceName(pchName, achName);
+	fprintf(pFile, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+		Nn_GetTraceThreadId(), achName);
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetTraceClock                                                 */
+/* Purpose:  Reads the monotonic clock                                        */
+/* Returns:  The clock in microseconds                                        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+double Nn_GetTraceClock (void)
+{
+#if defined(_MSC_VER)
+	LARGE_INTEGER nCount, nFreq;
+	QueryPerformanceCounter(&nCount);
+	QueryPerformanceFrequency(&nFreq);
+	return 1e6 * (double) nCount.QuadPart / (double) nFreq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return 1e6 * (double) ts.tv_sec + 1e-3 * (double) ts.tv_nsec;
+#endif
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetTraceThreadId                                              */
+/* Purpose:  Gets the id of the track of the calling thread                   */
+/* Remarks:  The system thread id, so the tracks match those of other tools.  */
+/*           Where not available, all spans are written to a single track.    */
+/* Returns:  The thread id                                                    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+unsigned long Nn_GetTraceThreadId (void)
+{
+#if defined(_MSC_VER)
+	return (unsigned long) GetCurrentThreadId();
+#elif defined(__linux__)
+	return (unsigned long) syscall(SYS_gettid);
+#else
+	return 1;
+#endif
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_EscapeTraceName                                               */
+/* Purpose:  Copies a name into a JSON string, truncated if necessary         */
+/* Remarks:  pchBuf must hold NN_TRACE_NAME_LEN characters.                   */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_EscapeTraceName (PCSTR pchName, char* pchBuf)
+{
+	int i = 0;
+
+	for (; pchName != NULL && *pchName != '\0' && i < NN_TRACE_NAME_LEN - 2; pchName++)
+	{
+		if (*pchName == '"' || *pchName == '\\')
+			pchBuf[i++] = '\\';
+		pchBuf[i++] = (unsigned char) *pchName < ' ' ? ' ' : *pchName;
+	}
+	pchBuf[i] = '\0';
+}
+
+/* EOF ///////////////////////////////////////////////////////////////////////*/
+
@@ -0,0 +1,87 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+/* File:        NnTrace.h                                                     */
+/* Purpose:     Interface def. file for the neural net trace writer           */
+/* Remarks:     Implemented in NnTrace.c                                      */
+/*              The trace is written in the Chrome trace event format (JSON)  */
+/*              and can be viewed with Perfetto or chrome://tracing. Every    */
+/*              span is written as a single complete event ("ph":"X") on the  */
+/*              track of the calling thread, so threads can write spans       */
+/*              concurrently.                                                 */
+/*              The library itself writes spans for loading a net and for     */
+/*              the batch routines (category "nnif"), applications may add    */
+/*              their own spans.                                              */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_OpenTrace                                                     */
+/* Purpose:  Opens a trace file, from now on spans are written to it          */
+/* Remarks:  An already open trace is closed first. Time stamps are counted   */
+/*           from the opening of the trace.                                   */
+/* Returns:  NN_OK (or zero) for success, NN_CANT_OPEN_FILE otherwise         */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_OpenTrace (PCSTR pchFilePath);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_CloseTrace                                                    */
+/* Purpose:  Completes and closes the trace file                              */
+/* Remarks:  No other thread may write spans while the trace is closed.       */
+/* Returns:  NN_OK (or zero) for success, NN_FILE_WRITE_ERROR otherwise       */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+NN_STATUS Nn_CloseTrace (void);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_IsTraceOpen                                                   */
+/* Purpose:  Checks whether spans are currently written                       */
+/* Returns:  TRUE if a trace file is open, FALSE otherwise                    */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+BOOL Nn_IsTraceOpen (void);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_GetTraceTime                                                  */
+/* Purpose:  Gets the current time of the trace, to be passed as start time   */
+/*           to Nn_AddTraceSpan                                               */
+/* Returns:  Microseconds since Nn_OpenTrace, zero if no trace is open        */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+double Nn_GetTraceTime (void);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_AddTraceSpan                                                  */
+/* Purpose:  Writes a span from the given start time until now on the track   */
+/*           of the calling thread                                            */
+/* Remarks:  Does nothing if no trace is open. If nNumItems is not negative,  */
+/*           it is written as argument "items" of the span (e.g. the number   */
+/*           of pixels processed).                                            */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_AddTraceSpan
+(
+	PCSTR   pchCategory, /* Category of the span, e.g. "nnif"      */
+	PCSTR   pchName,     /* Name of the span                       */
+	double  dStartTime,  /* Start time as given by Nn_GetTraceTime */
+	long    nNumItems    /* Number of items processed or -1        */
+);
+
+/*////////////////////////////////////////////////////////////////////////////*/
+/* Function: Nn_SetTraceThreadName                                            */
+/* Purpose:  Sets the name shown for the track of the calling thread          */
+/* Remarks:  Does nothing if no trace is open.                                */
+/* Returns:  No return value                                                  */
+/*////////////////////////////////////////////////////////////////////////////*/
+
+void Nn_SetTraceThreadName (PCSTR pchName);
+
+
+#ifdef __cplusplus
+}
+#endif
+/* EOF ///////////////////////////////////////////////////////////////////////*/
+
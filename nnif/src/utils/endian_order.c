@@ -1,11 +1,63 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "endian_order.h"
 
+/*
+ * Byte swap instructions of the compiler, used for single values and for
+ * the elements the shuffle kernel below leaves over. Without them the bytes
+ * are swapped one by one.
+ */
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8)))
+#define EO_BSWAP16(v) __builtin_bswap16(v)
+#define EO_BSWAP32(v) __builtin_bswap32(v)
+#define EO_BSWAP64(v) __builtin_bswap64(v)
+typedef unsigned short      eo_uint16;
+typedef unsigned int        eo_uint32;
+typedef unsigned long long  eo_uint64;
+#elif defined(_MSC_VER)
+#define EO_BSWAP16(v) _byteswap_ushort(v)
+#define EO_BSWAP32(v) _byteswap_ulong(v)
+#define EO_BSWAP64(v) _byteswap_uint64(v)
+typedef unsigned short      eo_uint16;
+typedef unsigned long       eo_uint32;
+typedef unsigned __int64    eo_uint64;
+#endif
+
+/*
+ * Byte shuffle instructions for the arrays. A shuffle reverses the bytes of
+ * all 2, 4 or 8 byte elements of a 16 (SSSE3) or 32 (AVX2) byte vector at
+ * once. GCC and clang compile the kernels for their target on x86 whatever
+ * the flags, and the processor is asked before they are called. Other
+ * compilers use them if the flags target the instruction set (e.g.
+ * /arch:AVX2).
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#include <immintrin.h>
+#define EO_VEC_AVX2
+#define EO_VEC_SSSE3
+#define EO_TARGET(t)   __attribute__((target(t)))
+#define EO_CPU_HAS(t)  __builtin_cpu_supports(t)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define EO_VEC_AVX2
+#define EO_TARGET(t)
+#define EO_CPU_HAS(t)  1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define EO_VEC_SSSE3
+#define EO_TARGET(t)
+#define EO_CPU_HAS(t)  1
+#endif
+
 void eo_swap2(const char* pv1, char* pv2); 
 void eo_swap4(const char* pv1, char* pv2); 
 void eo_swap8(const char* pv1, char* pv2);
+void eo_swap_elems(void* pvDst, const void* pvSrc, int n, int nSize);
+size_t eo_shuffle_avx2(char* pDst, const char* pSrc, size_t nBytes, const char* achMask);
+size_t eo_shuffle_ssse3(char* pDst, const char* pSrc, size_t nBytes, const char* achMask);
 
 
 int eo_endian_order() 
@@ -60,32 +112,212 @@ double eo_swap_double(double v)
 
 void eo_swap_short_n(short* pv, int n) 
 {
-    int i;
-    for (i = 0; i < n; i++, pv++) 
-        *pv = eo_swap_short(*pv);
+    eo_swap_elems(pv, pv, n, sizeof (short));
 }
 
 void eo_swap_int_n(int* pv, int n)
 {
-    int i;
-    for (i = 0; i < n; i++, pv++)
-        *pv = eo_swap_int(*pv);
+    eo_swap_elems(pv, pv, n, sizeof (int));
 }
 
 void eo_swap_long_n(long* pv, int n)
 {
-    int i;
-    for (i = 0; i < n; i++, pv++) 
-        *pv = eo_swap_long(*pv);
+    eo_swap_elems(pv, pv, n, sizeof (long));
+}
+
+void eo_swap_float_n(float* pv, int n)
+{
+    eo_swap_elems(pv, pv, n, sizeof (float));
 }
 
 void eo_swap_double_n(double* pv, int n) 
 {
-    int i;
-    for (i = 0; i < n; i++, pv++) 
-        *pv = eo_swap_double(*pv);
+    eo_swap_elems(pv, pv, n, sizeof (double));
+}
+
+void eo_copy_swap_short_n(short* pv, const void* pvSrc, int n)
+{
+    eo_swap_elems(pv, pvSrc, n, sizeof (short));
+}
+
+void eo_copy_swap_int_n(int* pv, const void* pvSrc, int n)
+{
+    eo_swap_elems(pv, pvSrc, n, sizeof (int));
+}
+
+void eo_copy_swap_long_n(long* pv, const void* pvSrc, int n)
+{
+    eo_swap_elems(pv, pvSrc, n, sizeof (long));
+}
+
+void eo_copy_swap_float_n(float* pv, const void* pvSrc, int n)
+{
+    eo_swap_elems(pv, pvSrc, n, sizeof (float));
+}
+
+void eo_copy_swap_double_n(double* pv, const void* pvSrc, int n)
+{
+    eo_swap_elems(pv, pvSrc, n, sizeof (double));
+}
+
+/*
+ * Reverses the bytes of n elements of nSize (2, 4 or 8) bytes each from
+ * pvSrc to pvDst. Both may be unaligned, pvDst may be equal to pvSrc but
+ * must not overlap it otherwise.
+ */
+void eo_swap_elems(void* pvDst, const void* pvSrc, int n, int nSize)
+{
+    char*       pDst;
+    const char* pSrc;
+    char        achElem[8];
+    size_t      nBytes, i;
+#ifdef EO_BSWAP64
+    eo_uint16   u16;
+    eo_uint32   u32;
+    eo_uint64   u64;
+#endif
+#if defined(EO_VEC_AVX2) || defined(EO_VEC_SSSE3)
+    char        achMask[32];
+    size_t      j;
+#endif
+
+    if (n <= 0)
+        return;
+
+    pDst   = (char*) pvDst;
+    pSrc   = (const char*) pvSrc;
+    nBytes = (size_t) n * nSize;
+    i      = 0;
+
+#if defined(EO_VEC_AVX2) || defined(EO_VEC_SSSE3)
+    /* The mask selects the bytes of each element in reverse order, */
+    /* its first half serves the 16 byte vectors                     */
+    for (j = 0; j < sizeof (achMask); j++)
+        achMask[j] = (char) (j - j % nSize + nSize - 1 - j % nSize);
+#endif
+#ifdef EO_VEC_AVX2
+    if (EO_CPU_HAS("avx2"))
+        i = eo_shuffle_avx2(pDst, pSrc, nBytes, achMask);
+#endif
+#ifdef EO_VEC_SSSE3
+    if (EO_CPU_HAS("ssse3"))
+        i += eo_shuffle_ssse3(pDst + i, pSrc + i, nBytes - i, achMask);
+#endif
+
+#ifdef EO_BSWAP64
+    switch (nSize)
+    {
+    case 2:
+        for (; i < nBytes; i += 2)
+        {
+            memcpy(&u16, pSrc + i, 2);
+            u16 = EO_BSWAP16(u16);
+            memcpy(pDst + i, &u16, 2);
+        }
+        break;
+    case 4:
+        for (; i < nBytes; i += 4)
+        {
+            memcpy(&u32, pSrc + i, 4);
+            u32 = EO_BSWAP32(u32);
+            memcpy(pDst + i, &u32, 4);
+        }
+        break;
+    case 8:
+        for (; i < nBytes; i += 8)
+        {
+            memcpy(&u64, pSrc + i, 8);
+            u64 = EO_BSWAP64(u64);
+            memcpy(pDst + i, &u64, 8);
+        }
+        break;
+    }
+#endif
+
+    /* The elements left, copied first since eo_swap<n> works out-of-place */
+    for (; i < nBytes; i += nSize)
+    {
+        memcpy(achElem, pSrc + i, nSize);
+        if (nSize == 2)
+            eo_swap2(achElem, pDst + i);
+        else if (nSize == 4)
+            eo_swap4(achElem, pDst + i);
+        else
+            eo_swap8(achElem, pDst + i);
+    }
 }
 
+/*
+ * The shuffle kernels of eo_swap_elems: reverse the bytes of the elements
+ * of whole vectors from pSrc to pDst with the mask of eo_swap_elems, and
+ * return the number of bytes done.
+ */
+#ifdef EO_VEC_AVX2
+
+EO_TARGET("avx2")
+size_t eo_shuffle_avx2(char* pDst, const char* pSrc, size_t nBytes, const char* achMask)
+{
+    __m256i vMask, v;
+    size_t  i;
+
+    vMask = _mm256_loadu_si256((const __m256i*) achMask);
+    for (i = 0; i + 32 <= nBytes; i += 32)
+    {
+        v = _mm256_loadu_si256((const __m256i*) (pSrc + i));
+        _mm256_storeu_si256((__m256i*) (pDst + i), _mm256_shuffle_epi8(v, vMask));
+    }
+    return i;
+}
+
+#endif
+
+#ifdef EO_VEC_SSSE3
+
+EO_TARGET("ssse3")
+size_t eo_shuffle_ssse3(char* pDst, const char* pSrc, size_t nBytes, const char* achMask)
+{
+    __m128i vMask, v;
+    size_t  i;
+
+    vMask = _mm_loadu_si128((const __m128i*) achMask);
+    for (i = 0; i + 16 <= nBytes; i += 16)
+    {
+        v = _mm_loadu_si128((const __m128i*) (pSrc + i));
+        _mm_storeu_si128((__m128i*) (pDst + i), _mm_shuffle_epi8(v, vMask));
+    }
+    return i;
+}
+
+#endif
+
+#ifdef EO_BSWAP64
+
+void eo_swap2(const char* pv1, char* pv2) 
+{
+   eo_uint16 u;
+   memcpy(&u, pv1, 2);
+   u = EO_BSWAP16(u);
+   memcpy(pv2, &u, 2);
+}
+
+void eo_swap4(const char* pv1, char* pv2) 
+{
+   eo_uint32 u;
+   memcpy(&u, pv1, 4);
+   u = EO_BSWAP32(u);
+   memcpy(pv2, &u, 4);
+}
+
+void eo_swap8(const char* pv1, char* pv2) 
+{
+   eo_uint64 u;
+   memcpy(&u, pv1, 8);
+   u = EO_BSWAP64(u);
+   memcpy(pv2, &u, 8);
+}
+
+#else
+
 void eo_swap2(const char* pv1, char* pv2) 
 {
    pv2[0] = pv1[1];
@@ -112,3 +344,5 @@ void eo_swap8(const char* pv1, char* pv2)
    pv2[7] = pv1[0];
 }
 
+#endif
+
@@ -30,6 +30,16 @@ void   eo_swap_long_n(long* pv, int n);
 void   eo_swap_float_n(float* pv, int n);
 void   eo_swap_double_n(double* pv, int n);
 
+/**
+ * Copies n values from pvSrc to pv and swaps their bytes on the way.
+ * pvSrc may be unaligned, e.g. point into a file in memory.
+ */
+void   eo_copy_swap_short_n(short* pv, const void* pvSrc, int n);
+void   eo_copy_swap_int_n(int* pv, const void* pvSrc, int n);
+void   eo_copy_swap_long_n(long* pv, const void* pvSrc, int n);
+void   eo_copy_swap_float_n(float* pv, const void* pvSrc, int n);
+void   eo_copy_swap_double_n(double* pv, const void* pvSrc, int n);
+
 #ifdef __cplusplus
 }
 #endif
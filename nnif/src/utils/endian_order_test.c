@@ -1,6 +1,7 @@
 #include "endian_order.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 int failures = 0;
 
@@ -8,6 +9,79 @@ int failures = 0;
 #define ASSERTL(E,A) if ((E)!=(A)) {failures++; printf("%s(%d): assertion failed: expected %ld, but '%s' yield %ld\n", __FILE__, __LINE__, E, #A, A);}
 #define ASSERTF(E,A,D) if (abs((E)-(A))>=D) {failures++; printf("%s(%d): assertion failed: expected %f, but '%s' yield %f\n", __FILE__, __LINE__, E, #A, A);}
 
+#define NUM_ELEMS_MAX 70
+
+/*
+ * Swaps n elements of nSize bytes from pSrc to pDst by the array function
+ * of that size, in place if bInPlace.
+ */
+void swapElems(char* pDst, const char* pSrc, int n, int nSize, int bInPlace)
+{
+    if (bInPlace)
+    {
+        memmove(pDst, pSrc, (size_t) n * nSize);
+        if (nSize == 2)
+            eo_swap_short_n((short*) pDst, n);
+        else if (nSize == 4)
+            eo_swap_int_n((int*) pDst, n);
+        else
+            eo_swap_double_n((double*) pDst, n);
+    }
+    else
+    {
+        if (nSize == 2)
+            eo_copy_swap_short_n((short*) pDst, pSrc, n);
+        else if (nSize == 4)
+            eo_copy_swap_int_n((int*) pDst, pSrc, n);
+        else
+            eo_copy_swap_double_n((double*) pDst, pSrc, n);
+    }
+}
+
+/*
+ * Checks the array functions for elements of nSize bytes against a byte by
+ * byte reversal: all counts up to NUM_ELEMS_MAX, so that the tails of the
+ * 16 and 32 byte vectors are covered, with source and destination at all
+ * offsets of an element. The bytes around the destination stay untouched.
+ */
+void checkSwapElems(int nSize)
+{
+    char   achSrc[NUM_ELEMS_MAX * 8 + 16];
+    char   achDst[NUM_ELEMS_MAX * 8 + 16];
+    char*  pSrc;
+    char*  pDst;
+    int    n, iSrc, iDst, bInPlace, i, b, nBad;
+
+    for (i = 0; i < (int) sizeof (achSrc); i++)
+        achSrc[i] = (char) (i * 7 + 3);
+
+    for (bInPlace = 0; bInPlace <= 1; bInPlace++)
+    for (iSrc = 0; iSrc < nSize; iSrc++)
+    for (iDst = 0; iDst < nSize; iDst++)
+    for (n = 0; n <= NUM_ELEMS_MAX; n++)
+    {
+        pSrc = achSrc + iSrc;
+        pDst = achDst + 8 + iDst;
+        memset(achDst, 0x5a, sizeof (achDst));
+        swapElems(pDst, pSrc, n, nSize, bInPlace);
+
+        nBad = 0;
+        for (i = 0; i < n; i++)
+        {
+            for (b = 0; b < nSize; b++)
+                nBad += pDst[i * nSize + b] != pSrc[i * nSize + nSize - 1 - b];
+        }
+        for (i = 0; i < (int) sizeof (achDst); i++)
+            nBad += (achDst + i < pDst || achDst + i >= pDst + n * nSize) && achDst[i] != 0x5a;
+        if (nBad != 0)
+        {
+            failures++;
+            printf("%s(%d): %d bytes wrong swapping %d elements of %d bytes (offsets %d, %d, in place %d)\n",
+                   __FILE__, __LINE__, nBad, n, nSize, iSrc, iDst, bInPlace);
+        }
+    }
+}
+
 int main(int argc, char** argv)
 {
     printf("BE = %d\n", BIG_ENDIAN);   
@@ -44,6 +118,33 @@ int main(int argc, char** argv)
     ASSERTF(0.0, eo_swap_double(1.0), 1E-10)
     ASSERTF(0.0, eo_swap_double(1234.56789), 1E-10)
 
+    checkSwapElems(2);
+    checkSwapElems(4);
+    checkSwapElems(8);
+
+    /* The float arrays give the single values, and swapping twice restores them */
+    {
+        float  afSrc[NUM_ELEMS_MAX], afSwap[NUM_ELEMS_MAX], afCopy[NUM_ELEMS_MAX];
+        char   achSrc[NUM_ELEMS_MAX * 4 + 1];
+        int    i, nBad = 0;
+
+        for (i = 0; i < NUM_ELEMS_MAX; i++)
+            afSrc[i] = afSwap[i] = 1.5F * i - 20.25F;
+        memcpy(achSrc + 1, afSrc, sizeof (afSrc));
+        eo_swap_float_n(afSwap, NUM_ELEMS_MAX - 1);
+        eo_copy_swap_float_n(afCopy, achSrc + 1, NUM_ELEMS_MAX - 1);
+        for (i = 0; i < NUM_ELEMS_MAX - 1; i++)
+        {
+            nBad += memcmp(&afSwap[i], &afCopy[i], sizeof (float)) != 0;
+            afCopy[i] = eo_swap_float(afSrc[i]);
+            nBad += memcmp(&afSwap[i], &afCopy[i], sizeof (float)) != 0;
+        }
+        nBad += afSwap[NUM_ELEMS_MAX - 1] != afSrc[NUM_ELEMS_MAX - 1];
+        eo_swap_float_n(afSwap, NUM_ELEMS_MAX - 1);
+        nBad += memcmp(afSwap, afSrc, sizeof (afSrc)) != 0;
+        ASSERTI(0, nBad);
+    }
+
     printf("%d failure(s)\n", failures); 
     return failures; 
 }
@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lz_pack.h"
+
+/*
+ * SSE2 sums up the differences of 16 bytes at once, in four steps of
+ * shifted additions.
+ */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define LZP_SSE2
+#endif
+
+/* Size of the hash table of the packer, entries of 4 bytes on the stack */
+#define LZP_HASH_BITS  13
+
+/* Largest match offset, limited by its 2 bytes */
+#define LZP_MAX_OFFSET 65535
+
+typedef unsigned int lzp_uint32;
+
+lzp_uint32     lzp_read32(const unsigned char* p);
+unsigned char* lzp_put_length(unsigned char* pDst, size_t n);
+unsigned char* lzp_put_sequence(unsigned char* pDst, const unsigned char* pDstEnd,
+                                const unsigned char* pLit, size_t nLit, size_t nOffset, size_t nMatch);
+int            lzp_get_length(const unsigned char** ppSrc, const unsigned char* pSrcEnd, size_t* pn, size_t nMax);
+
+
+size_t lzp_bound(size_t nSize)
+{
+    return nSize + nSize / 255 + 16;
+}
+
+size_t lzp_max_size(size_t nPackedSize)
+{
+    /* A byte of a stream yields at most 255 bytes, as a match length byte */
+    return nPackedSize > ((size_t) -1) / 255 ? (size_t) -1 : nPackedSize * 255;
+}
+
+/*
+ * Greedy packer: the 4 bytes at each position are looked up in a hash table
+ * of the last position they were seen at. Without a match the positions
+ * are skipped faster the longer the literals get, so data which doesn't
+ * pack is passed quickly.
+ */
+size_t lzp_pack(void* pvDst, size_t nDstSize, const void* pvSrc, size_t nSrcSize)
+{
+    const unsigned char* pSrc;
+    unsigned char*       pDst;
+    unsigned char*       pDstEnd;
+    lzp_uint32           anHash[1 << LZP_HASH_BITS];
+    lzp_uint32           nSeq;
+    size_t               i, iAnchor, iRef, nMatch;
+    unsigned int         iHash;
+
+    pSrc    = (const unsigned char*) pvSrc;
+    pDst    = (unsigned char*) pvDst;
+    pDstEnd = pDst + nDstSize;
+
+    memset(anHash, 0, sizeof (anHash));
+
+    i = 0;
+    iAnchor = 0;
+    while (i + LZP_MIN_MATCH <= nSrcSize)
+    {
+        nSeq  = lzp_read32(pSrc + i);
+        iHash = (unsigned int) ((nSeq * 2654435761U) >> (32 - LZP_HASH_BITS));
+        iRef  = anHash[iHash];
+        anHash[iHash] = (lzp_uint32) i;
+
+        if (iRef < i && i - iRef <= LZP_MAX_OFFSET && lzp_read32(pSrc + iRef) == nSeq)
+        {
+            nMatch = LZP_MIN_MATCH;
+            while (i + nMatch < nSrcSize && pSrc[iRef + nMatch] == pSrc[i + nMatch])
+                nMatch++;
+
+            pDst = lzp_put_sequence(pDst, pDstEnd, pSrc + iAnchor, i - iAnchor, i - iRef, nMatch);
+            if (pDst == NULL)
+                return 0;
+            i += nMatch;
+            iAnchor = i;
+        }
+        else
+            i += 1 + ((i - iAnchor) >> 6);
+    }
+
+    /* The literals left end the stream */
+    pDst = lzp_put_sequence(pDst, pDstEnd, pSrc + iAnchor, nSrcSize - iAnchor, 0, 0);
+    if (pDst == NULL)
+        return 0;
+    return (size_t) (pDst - (unsigned char*) pvDst);
+}
+
+int lzp_unpack(void* pvDst, size_t nDstSize, const void* pvSrc, size_t nSrcSize)
+{
+    const unsigned char* pSrc;
+    const unsigned char* pSrcEnd;
+    const unsigned char* pMatch;
+    unsigned char*       pDst;
+    unsigned char*       pDstEnd;
+    unsigned char*       pMatchEnd;
+    size_t               nLit, nOffset, nMatch;
+    unsigned char        nToken;
+
+    pSrc    = (const unsigned char*) pvSrc;
+    pSrcEnd = pSrc + nSrcSize;
+    pDst    = (unsigned char*) pvDst;
+    pDstEnd = pDst + nDstSize;
+
+    while (pSrc < pSrcEnd)
+    {
+        nToken = *pSrc++;
+
+        /* The literals, a short run is copied as 16 bytes if there is room */
+        nLit = nToken >> 4;
+        if (nLit < 15 && pSrcEnd - pSrc >= 16 && pDstEnd - pDst >= 16)
+        {
+            memcpy(pDst, pSrc, 16);
+        }
+        else
+        {
+            if (nLit == 15 && lzp_get_length(&pSrc, pSrcEnd, &nLit, nDstSize) != 0)
+                return -1;
+            if (nLit > (size_t) (pSrcEnd - pSrc) || nLit > (size_t) (pDstEnd - pDst))
+                return -1;
+            memcpy(pDst, pSrc, nLit);
+        }
+        pDst += nLit;
+        pSrc += nLit;
+
+        /* The last token has no match */
+        if (pSrc == pSrcEnd)
+            break;
+
+        /* The match */
+        if (pSrcEnd - pSrc < 2)
+            return -1;
+        nOffset = (size_t) pSrc[0] | ((size_t) pSrc[1] << 8);
+        pSrc += 2;
+        if (nOffset == 0 || nOffset > (size_t) (pDst - (unsigned char*) pvDst))
+            return -1;
+
+        nMatch = nToken & 15;
+        if (nMatch == 15 && lzp_get_length(&pSrc, pSrcEnd, &nMatch, nDstSize) != 0)
+            return -1;
+        nMatch += LZP_MIN_MATCH;
+        if (nMatch > (size_t) (pDstEnd - pDst))
+            return -1;
+
+        pMatch    = pDst - nOffset;
+        pMatchEnd = pDst + nMatch;
+        if (nOffset == 1)
+        {
+            /* A run of a single byte, as the zeros of the differences */
+            memset(pDst, *pMatch, nMatch);
+        }
+        else if (nOffset >= 8 && (size_t) (pDstEnd - pDst) >= nMatch + 7)
+        {
+            /* 8 bytes at once, the last copy may overrun the match */
+            do
+            {
+                memcpy(pDst, pMatch, 8);
+                pDst   += 8;
+                pMatch += 8;
+            }
+            while (pDst < pMatchEnd);
+        }
+        else
+        {
+            while (pDst < pMatchEnd)
+                *pDst++ = *pMatch++;
+        }
+        pDst = pMatchEnd;
+    }
+
+    return pDst == pDstEnd ? 0 : -1;
+}
+
+void lzp_shuffle(void* pvDst, const void* pvSrc, size_t nElems, int nSize)
+{
+    unsigned char*       pDst;
+    const unsigned char* pSrc;
+    size_t               i;
+    int                  b;
+
+    pDst = (unsigned char*) pvDst;
+    pSrc = (const unsigned char*) pvSrc;
+
+    for (b = 0; b < nSize; b++)
+        for (i = 0; i < nElems; i++)
+            *pDst++ = pSrc[i * nSize + b];
+}
+
+void lzp_delta(void* pv, size_t nSize)
+{
+    unsigned char* p;
+    unsigned char  c, cPrev;
+    size_t         i;
+
+    p = (unsigned char*) pv;
+    cPrev = 0;
+    for (i = 0; i < nSize; i++)
+    {
+        c = p[i];
+        p[i] = (unsigned char) (c - cPrev);
+        cPrev = c;
+    }
+}
+
+void lzp_undelta(void* pv, size_t nSize)
+{
+    unsigned char* p;
+    unsigned char  c;
+    size_t         i;
+#ifdef LZP_SSE2
+    __m128i        v, vCarry;
+#endif
+
+    p = (unsigned char*) pv;
+    c = 0;
+    i = 0;
+
+#ifdef LZP_SSE2
+    vCarry = _mm_setzero_si128();
+    for (; i + 16 <= nSize; i += 16)
+    {
+        v = _mm_loadu_si128((const __m128i*) (p + i));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi8(v, vCarry);
+        _mm_storeu_si128((__m128i*) (p + i), v);
+        vCarry = _mm_set1_epi8((char) p[i + 15]);
+    }
+    if (i > 0)
+        c = p[i - 1];
+#endif
+
+    for (; i < nSize; i++)
+    {
+        c = (unsigned char) (c + p[i]);
+        p[i] = c;
+    }
+}
+
+void lzp_unshuffle(void* pvDst, const void* pvSrc, size_t nElems, int nSize)
+{
+    unsigned char*       pDst;
+    const unsigned char* pSrc;
+    size_t               i;
+    int                  b;
+
+    pDst = (unsigned char*) pvDst;
+    pSrc = (const unsigned char*) pvSrc;
+
+    /* The destination is written in order, the planes are read side by side */
+    if (nSize == 8)
+    {
+        for (i = 0; i < nElems; i++, pDst += 8)
+        {
+            pDst[0] = pSrc[i];
+            pDst[1] = pSrc[i + nElems];
+            pDst[2] = pSrc[i + 2 * nElems];
+            pDst[3] = pSrc[i + 3 * nElems];
+            pDst[4] = pSrc[i + 4 * nElems];
+            pDst[5] = pSrc[i + 5 * nElems];
+            pDst[6] = pSrc[i + 6 * nElems];
+            pDst[7] = pSrc[i + 7 * nElems];
+        }
+        return;
+    }
+
+    for (i = 0; i < nElems; i++)
+        for (b = 0; b < nSize; b++)
+            *pDst++ = pSrc[i + b * nElems];
+}
+
+lzp_uint32 lzp_read32(const unsigned char* p)
+{
+    lzp_uint32 v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+unsigned char* lzp_put_length(unsigned char* pDst, size_t n)
+{
+    for (; n >= 255; n -= 255)
+        *pDst++ = 255;
+    *pDst++ = (unsigned char) n;
+    return pDst;
+}
+
+/*
+ * Writes a token with its literals and match, a match length of 0 writes
+ * the last token.
+ * @return The end of the token, NULL if it doesn't fit.
+ */
+unsigned char* lzp_put_sequence(unsigned char* pDst, const unsigned char* pDstEnd,
+                                const unsigned char* pLit, size_t nLit, size_t nOffset, size_t nMatch)
+{
+    size_t nSize;
+
+    nSize = 1 + nLit + (nLit >= 15 ? (nLit - 15) / 255 + 1 : 0);
+    if (nMatch > 0)
+        nSize += 2 + (nMatch - LZP_MIN_MATCH >= 15 ? (nMatch - LZP_MIN_MATCH - 15) / 255 + 1 : 0);
+    if (nSize > (size_t) (pDstEnd - pDst))
+        return NULL;
+
+    *pDst++ = (unsigned char) (((nLit < 15 ? nLit : 15) << 4) |
+                               (nMatch == 0 ? 0 : nMatch - LZP_MIN_MATCH < 15 ? nMatch - LZP_MIN_MATCH : 15));
+    if (nLit >= 15)
+        pDst = lzp_put_length(pDst, nLit - 15);
+    memcpy(pDst, pLit, nLit);
+    pDst += nLit;
+
+    if (nMatch > 0)
+    {
+        *pDst++ = (unsigned char) (nOffset & 255);
+        *pDst++ = (unsigned char) (nOffset >> 8);
+        if (nMatch - LZP_MIN_MATCH >= 15)
+            pDst = lzp_put_length(pDst, nMatch - LZP_MIN_MATCH - 15);
+    }
+    return pDst;
+}
+
+/*
+ * Reads the length bytes continuing a nibble of 15 into *pn.
+ * @return 0 for success, -1 if the stream ends or the length exceeds nMax.
+ */
+int lzp_get_length(const unsigned char** ppSrc, const unsigned char* pSrcEnd, size_t* pn, size_t nMax)
+{
+    const unsigned char* pSrc;
+    unsigned char        c;
+
+    pSrc = *ppSrc;
+    do
+    {
+        if (pSrc >= pSrcEnd)
+            return -1;
+        c = *pSrc++;
+        *pn += c;
+        if (*pn > nMax)
+            return -1;
+    }
+    while (c == 255);
+
+    *ppSrc = pSrc;
+    return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef _LZ_PACK_H
+#define _LZ_PACK_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A small LZ77 codec for binary payloads, without external dependencies.
+ * A packed stream is a sequence of tokens. Each token is one byte with the
+ * number of literals in the high and the match length minus LZP_MIN_MATCH
+ * in the low nibble, a nibble of 15 is continued by length bytes added to
+ * it up to the first one below 255. The token is followed by the literal
+ * length bytes, the literals, the match offset (2 bytes, little-endian,
+ * 1..65535) and the match length bytes. The last token has literals only.
+ *
+ * Floating point elements often pack better in byte planes (see
+ * lzp_shuffle), where the sign and exponent bytes of similar values and
+ * the zero low bytes of rounded values form runs, possibly of differences
+ * (see lzp_delta). Elements repeated as a whole pack better as they are.
+ */
+
+#define LZP_MIN_MATCH 4
+
+/**
+ * @return The maximum size of the stream packed from nSize bytes.
+ */
+size_t lzp_bound(size_t nSize);
+
+/**
+ * @return The maximum number of bytes a stream of nPackedSize bytes can
+ *         unpack to.
+ */
+size_t lzp_max_size(size_t nPackedSize);
+
+/**
+ * Packs nSrcSize bytes from pvSrc to pvDst.
+ * @return The size of the packed stream, 0 if it doesn't fit nDstSize
+ *         (lzp_bound(nSrcSize) is always enough).
+ */
+size_t lzp_pack(void* pvDst, size_t nDstSize, const void* pvSrc, size_t nSrcSize);
+
+/**
+ * Unpacks a stream of nSrcSize bytes from pvSrc to pvDst. The stream is
+ * checked, a corrupt one never writes beyond nDstSize bytes.
+ * @return 0 if the stream unpacked to exactly nDstSize bytes, -1 otherwise.
+ */
+int lzp_unpack(void* pvDst, size_t nDstSize, const void* pvSrc, size_t nSrcSize);
+
+/**
+ * Splits nElems elements of nSize bytes from pvSrc into nSize byte planes
+ * in pvDst, the plane b holding the byte b of all elements.
+ */
+void lzp_shuffle(void* pvDst, const void* pvSrc, size_t nElems, int nSize);
+
+/**
+ * Replaces each of nSize bytes by its difference to the byte before, in
+ * place.
+ */
+void lzp_delta(void* pv, size_t nSize);
+
+/**
+ * Undoes lzp_delta, in place.
+ */
+void lzp_undelta(void* pv, size_t nSize);
+
+/**
+ * Joins nElems elements of nSize bytes from the byte planes in pvSrc to
+ * pvDst, undoing lzp_shuffle.
+ */
+void lzp_unshuffle(void* pvDst, const void* pvSrc, size_t nElems, int nSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LZ_PACK_H */